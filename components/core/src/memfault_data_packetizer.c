@@ -8,13 +8,18 @@
 #include <string.h>
 #include <inttypes.h>
 
+#include "memfault/config.h"
 #include "memfault/core/compiler.h"
 #include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/data_source_lz.h"
 #include "memfault/core/data_source_rle.h"
 #include "memfault/core/debug_log.h"
 #include "memfault/core/math.h"
+#include "memfault/core/platform/core.h"
 #include "memfault/core/platform/debug_log.h"
 #include "memfault/util/chunk_transport.h"
+#include "memfault/util/crc16_ccitt.h"
+#include "memfault/util/varint.h"
 
 MEMFAULT_STATIC_ASSERT(MEMFAULT_PACKETIZER_MIN_BUF_LEN == MEMFAULT_MIN_CHUNK_BUF_LEN,
                        "Minimum packetizer payload size must match underlying transport");
@@ -42,6 +47,12 @@ MEMFAULT_WEAK const sMemfaultDataSourceImpl g_memfault_data_rle_source = {
   .mark_msg_read_cb = prv_data_source_mark_event_read_stub,
 };
 
+MEMFAULT_WEAK const sMemfaultDataSourceImpl g_memfault_data_lz_source = {
+  .has_more_msgs_cb = prv_data_source_has_event_stub,
+  .read_msg_cb = prv_data_source_read_stub,
+  .mark_msg_read_cb = prv_data_source_mark_event_read_stub,
+};
+
 MEMFAULT_WEAK const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
   .has_more_msgs_cb = prv_data_source_has_event_stub,
   .read_msg_cb = prv_data_source_read_stub,
@@ -66,6 +77,12 @@ bool memfault_data_source_rle_encoder_set_active(
   return false;
 }
 
+MEMFAULT_WEAK
+bool memfault_data_source_lz_encoder_set_active(
+    MEMFAULT_UNUSED const sMemfaultDataSourceImpl *active_source) {
+  return false;
+}
+
 // NOTE: These values are used by the Memfault cloud chunks API
 typedef enum {
   kMfltMessageType_None = 0,
@@ -77,50 +94,227 @@ typedef enum {
 typedef struct MemfaultDataSource {
   eMfltMessageType type;
   bool use_rle;
+  //! Compressed with the LZ codec rather than RLE. Only set for the message being sent.
+  bool use_lz;
+  //! Held back while the byte budget is exhausted
+  bool deferrable;
   const sMemfaultDataSourceImpl *impl;
 } sMemfaultDataSource;
 
+#define MEMFAULT_PACKETIZER_WEIGHTED_FAIR \
+  (MEMFAULT_PACKETIZER_SCHEDULER == MEMFAULT_PACKETIZER_SCHEDULER_WEIGHTED_FAIR)
+
+//! Sources are listed from highest to lowest priority
 static const sMemfaultDataSource s_memfault_data_source[] = {
   {
     .type = kMfltMessageType_Coredump,
     .use_rle = true,
+    .deferrable = false,
     .impl = &g_memfault_coredump_data_source,
   },
   {
     .type = kMfltMessageType_Event,
     .use_rle = false,
+    .deferrable = false,
     .impl = &g_memfault_event_data_source,
   },
   {
     .type = kMfltMessageType_Log,
     .use_rle = false,
+    .deferrable = true,
     .impl = &g_memfault_log_data_source,
   }
 };
 
+#define MEMFAULT_PACKETIZER_NUM_SOURCES MEMFAULT_ARRAY_SIZE(s_memfault_data_source)
+
+MEMFAULT_STATIC_ASSERT(MEMFAULT_PACKETIZER_NUM_CHANNELS <= MEMFAULT_CHUNK_TRANSPORT_MAX_CHANNELS,
+                       "The chunk transport does not support that many channels");
+
+//! Passed to prv_get_source_with_data() to check the sources on every channel
+#define MEMFAULT_PACKETIZER_ANY_CHANNEL ((size_t)MEMFAULT_PACKETIZER_NUM_CHANNELS)
+
+#if MEMFAULT_PACKETIZER_WEIGHTED_FAIR
+//! Indexed like s_memfault_data_source
+static const uint32_t s_memfault_data_source_weights[] = {
+  MEMFAULT_PACKETIZER_SCHEDULER_COREDUMP_WEIGHT,
+  MEMFAULT_PACKETIZER_SCHEDULER_EVENT_WEIGHT,
+  MEMFAULT_PACKETIZER_SCHEDULER_LOG_WEIGHT,
+};
+MEMFAULT_STATIC_ASSERT(MEMFAULT_ARRAY_SIZE(s_memfault_data_source_weights) ==
+                           MEMFAULT_ARRAY_SIZE(s_memfault_data_source),
+                       "A weight must be provided for every data source");
+#endif
+
+#if MEMFAULT_PACKETIZER_SCHEDULER != MEMFAULT_PACKETIZER_SCHEDULER_STRICT_PRIORITY
+typedef struct {
+#if MEMFAULT_PACKETIZER_SCHEDULER == MEMFAULT_PACKETIZER_SCHEDULER_ROUND_ROBIN
+  //! The source which gets the first chance to provide the next message
+  size_t next_source_idx;
+#elif MEMFAULT_PACKETIZER_WEIGHTED_FAIR
+  //! Start-time fair queuing: every message is tagged with the virtual time at which it starts &
+  //! finishes being sent, where a message's virtual duration is its size divided by the weight of
+  //! its source. The message with the earliest start tag is picked next.
+  uint64_t virtual_time;
+  //! The finish tag of the last message picked from each source
+  uint64_t finish_tags[MEMFAULT_PACKETIZER_NUM_SOURCES];
+#endif
+} sMfltPacketizerSchedulerState;
+
+static sMfltPacketizerSchedulerState s_mflt_packetizer_scheduler;
+#endif
+
+//! The bytes produced by each source in the current accounting period, indexed like
+//! s_memfault_data_source
+static uint32_t s_mflt_packetizer_bytes_sent[MEMFAULT_PACKETIZER_NUM_SOURCES];
+
+#if MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED
+#define MEMFAULT_PACKETIZER_MS_PER_HOUR (60 * 60 * 1000)
+
+//! Tokens are counted in bytes times milliseconds per hour so that refilling every few
+//! milliseconds doesn't round down to nothing
+#define MEMFAULT_PACKETIZER_BYTE_BUDGET_MAX_TOKENS \
+  ((int64_t)MEMFAULT_PACKETIZER_BYTE_BUDGET_BURST_BYTES * MEMFAULT_PACKETIZER_MS_PER_HOUR)
+
+MEMFAULT_STATIC_ASSERT(MEMFAULT_PACKETIZER_BYTE_BUDGET_BYTES_PER_HOUR > 0,
+                       "The byte budget must refill");
+
+typedef struct {
+  bool initialized;
+  //! Goes negative when coredumps & events are sent over budget
+  int64_t tokens;
+  uint64_t last_refill_ms;
+} sMfltPacketizerByteBudget;
+
+static sMfltPacketizerByteBudget s_mflt_packetizer_byte_budget;
+
+static void prv_byte_budget_refill(void) {
+  sMfltPacketizerByteBudget *budget = &s_mflt_packetizer_byte_budget;
+  const uint64_t now_ms = memfault_platform_get_time_since_boot_ms();
+  if (!budget->initialized) {
+    *budget = (sMfltPacketizerByteBudget) {
+      .initialized = true,
+      .tokens = MEMFAULT_PACKETIZER_BYTE_BUDGET_MAX_TOKENS,
+      .last_refill_ms = now_ms,
+    };
+    return;
+  }
+
+  // only refill for as long as it takes to fill the bucket so the math can't overflow
+  const uint64_t rate = MEMFAULT_PACKETIZER_BYTE_BUDGET_BYTES_PER_HOUR;
+  const uint64_t tokens_needed =
+      (uint64_t)(MEMFAULT_PACKETIZER_BYTE_BUDGET_MAX_TOKENS - budget->tokens);
+  const uint64_t ms_to_fill = (tokens_needed + rate - 1) / rate;
+  const uint64_t elapsed_ms = MEMFAULT_MIN(now_ms - budget->last_refill_ms, ms_to_fill);
+  budget->last_refill_ms = now_ms;
+  budget->tokens = MEMFAULT_MIN(budget->tokens + (int64_t)(elapsed_ms * rate),
+                                MEMFAULT_PACKETIZER_BYTE_BUDGET_MAX_TOKENS);
+}
+#endif
+
+//! @return true if deferrable sources are allowed to start a new message
+static bool prv_byte_budget_available(void) {
+#if MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED
+  prv_byte_budget_refill();
+  return s_mflt_packetizer_byte_budget.tokens > 0;
+#else
+  return true;
+#endif
+}
+
+static void prv_account_bytes_sent(size_t source_idx, size_t num_bytes) {
+  s_mflt_packetizer_bytes_sent[source_idx] += (uint32_t)num_bytes;
+#if MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED
+  prv_byte_budget_refill();
+  s_mflt_packetizer_byte_budget.tokens -= (int64_t)num_bytes * MEMFAULT_PACKETIZER_MS_PER_HOUR;
+#endif
+}
+
+#if MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+typedef enum {
+  kMfltPreemptState_None = 0,
+  //! A coredump was aborted & events are sent until there are none left
+  kMfltPreemptState_Preempting,
+  //! The coredump is being sent again and can't be preempted until it completes
+  kMfltPreemptState_Preempted,
+} eMfltPreemptState;
+
+static eMfltPreemptState s_mflt_packetizer_preempt_state;
+#endif
+
 typedef struct {
   size_t total_size;
   sMemfaultDataSource source;
+  //! Index of the source within s_memfault_data_source
+  size_t source_idx;
 } sMessageMetadata;
 
+//! A point in a message chunks can be sent from again without reading the message up to it
+typedef struct {
+  uint32_t offset;
+  uint16_t crc16;
+} sMfltPacketizerSeekPoint;
+
 typedef struct {
   bool active_message;
+  //! Every chunk of the message has been returned but it is kept in its data source until
+  //! memfault_packetizer_ack() is called
+  bool awaiting_ack;
   sMessageMetadata msg_metadata;
   sMfltChunkTransportCtx curr_msg_ctx;
+  //! Where the last few chunks started, used as a ring
+  sMfltPacketizerSeekPoint seek_history[MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN];
+  size_t seek_history_idx;
 } sMfltTransportState;
 
 typedef MEMFAULT_PACKED_STRUCT {
   uint8_t mflt_msg_type; // eMfltMessageType
 } sMfltPacketizerHdr;
 
-static sMfltTransportState s_mflt_packetizer_state;
+//! Indexed by channel id. Each channel has at most one message in flight.
+static sMfltTransportState s_mflt_packetizer_state[MEMFAULT_PACKETIZER_NUM_CHANNELS];
+//! The channel the next chunk is read from
+static size_t s_mflt_packetizer_active_channel;
+//! sPacketizerConfig.require_ack of the last call to memfault_packetizer_begin()
+static bool s_mflt_packetizer_require_ack;
+
+static sMfltTransportState *prv_active_state(void) {
+  return &s_mflt_packetizer_state[s_mflt_packetizer_active_channel];
+}
+
+//! Sources are assigned channels in priority order, sharing the last channel if there aren't
+//! enough to go around
+static size_t prv_source_channel(size_t source_idx) {
+  const size_t last_channel = MEMFAULT_PACKETIZER_NUM_CHANNELS - 1;
+  return MEMFAULT_MIN(source_idx, last_channel);
+}
 
 static void prv_reset_packetizer_state(void) {
-  s_mflt_packetizer_state = (sMfltTransportState) {
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    s_mflt_packetizer_state[i] = (sMfltTransportState) {
+      .active_message = false,
+    };
+  }
+  s_mflt_packetizer_active_channel = 0;
+
+  memfault_data_source_rle_encoder_set_active(NULL);
+  memfault_data_source_lz_encoder_set_active(NULL);
+}
+
+static void prv_reset_channel_state(sMfltTransportState *state) {
+  const bool rle_in_use = state->msg_metadata.source.use_rle;
+  const bool lz_in_use = state->msg_metadata.source.use_lz;
+  *state = (sMfltTransportState) {
     .active_message = false,
   };
 
-  memfault_data_source_rle_encoder_set_active(NULL);
+  // the encoder can only be released if it isn't in use by a message on another channel
+  if ((MEMFAULT_PACKETIZER_NUM_CHANNELS == 1) || rle_in_use) {
+    memfault_data_source_rle_encoder_set_active(NULL);
+  }
+  if ((MEMFAULT_PACKETIZER_NUM_CHANNELS == 1) || lz_in_use) {
+    memfault_data_source_lz_encoder_set_active(NULL);
+  }
 }
 
 static void prv_data_source_chunk_transport_msg_reader(uint32_t offset, void *buf,
@@ -129,13 +323,19 @@ static void prv_data_source_chunk_transport_msg_reader(uint32_t offset, void *bu
   size_t read_offset = 0;
   const size_t hdr_size = sizeof(sMfltPacketizerHdr);
 
-  const sMessageMetadata *msg_metadata = &s_mflt_packetizer_state.msg_metadata;
+  const sMessageMetadata *msg_metadata = &prv_active_state()->msg_metadata;
   if (offset < hdr_size) {
     const uint8_t rle_enable_mask = 0x80;
-    const uint8_t msg_type = (uint8_t)msg_metadata->source.type;
+    const uint8_t lz_enable_mask = 0x40;
+    uint8_t msg_type = (uint8_t)msg_metadata->source.type;
+    if (msg_metadata->source.use_rle) {
+      msg_type |= rle_enable_mask;
+    } else if (msg_metadata->source.use_lz) {
+      msg_type |= lz_enable_mask;
+    }
 
     sMfltPacketizerHdr hdr = {
-      .mflt_msg_type = msg_metadata->source.use_rle ? msg_type | rle_enable_mask : msg_type,
+      .mflt_msg_type = msg_type,
     };
     uint8_t *hdr_bytes = (uint8_t *)&hdr;
 
@@ -164,73 +364,243 @@ static void prv_data_source_chunk_transport_msg_reader(uint32_t offset, void *bu
   }
 }
 
-static bool prv_get_source_with_data(size_t *total_size, sMemfaultDataSource *active_source) {
-  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(s_memfault_data_source); i++) {
-    const sMemfaultDataSource *data_source = &s_memfault_data_source[i];
-    const bool rle_enabled = data_source->use_rle &&
-        memfault_data_source_rle_encoder_set_active(data_source->impl);
+#if MEMFAULT_PACKETIZER_WEIGHTED_FAIR
+static uint64_t prv_start_tag(size_t source_idx) {
+  return MEMFAULT_MAX(s_mflt_packetizer_scheduler.virtual_time,
+                      s_mflt_packetizer_scheduler.finish_tags[source_idx]);
+}
+#endif
 
-    *active_source = (sMemfaultDataSource) {
-      .type = data_source->type,
-      .use_rle = rle_enabled,
-      .impl = rle_enabled ? &g_memfault_data_rle_source : data_source->impl,
-    };
+//! Populates order with the indices of the data sources, in the order they should be checked for
+//! the next message
+static void prv_scheduler_get_order(size_t order[MEMFAULT_PACKETIZER_NUM_SOURCES]) {
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_SOURCES; i++) {
+#if MEMFAULT_PACKETIZER_SCHEDULER == MEMFAULT_PACKETIZER_SCHEDULER_ROUND_ROBIN
+    order[i] = (s_mflt_packetizer_scheduler.next_source_idx + i) % MEMFAULT_PACKETIZER_NUM_SOURCES;
+#else
+    order[i] = i;
+#endif
+  }
 
-    if (active_source->impl->has_more_msgs_cb(total_size)) {
-      return true;
+#if MEMFAULT_PACKETIZER_WEIGHTED_FAIR
+  // earliest start tag first, ties broken by priority. There are only a handful of sources so an
+  // insertion sort is plenty.
+  for (size_t i = 1; i < MEMFAULT_PACKETIZER_NUM_SOURCES; i++) {
+    const size_t source_idx = order[i];
+    size_t j = i;
+    while ((j > 0) && (prv_start_tag(order[j - 1]) > prv_start_tag(source_idx))) {
+      order[j] = order[j - 1];
+      j--;
     }
+    order[j] = source_idx;
   }
-  return false;
+#endif
 }
 
-static bool prv_more_messages_to_send(sMessageMetadata *msg_metadata) {
-  size_t total_size;
-  sMemfaultDataSource active_source;
-  if (!prv_get_source_with_data(&total_size, &active_source)) {
-    return false;
-  }
+//! Updates the scheduler once a message has been picked to be sent
+static void prv_scheduler_message_loaded(const sMessageMetadata *msg_metadata) {
+#if MEMFAULT_PACKETIZER_SCHEDULER == MEMFAULT_PACKETIZER_SCHEDULER_ROUND_ROBIN
+  s_mflt_packetizer_scheduler.next_source_idx =
+      (msg_metadata->source_idx + 1) % MEMFAULT_PACKETIZER_NUM_SOURCES;
+#elif MEMFAULT_PACKETIZER_WEIGHTED_FAIR
+  // sizes are scaled up so small messages from heavily weighted sources still advance the clock
+  const size_t idx = msg_metadata->source_idx;
+  const uint64_t start_tag = prv_start_tag(idx);
+  s_mflt_packetizer_scheduler.virtual_time = start_tag;
+  s_mflt_packetizer_scheduler.finish_tags[idx] =
+      start_tag + (((uint64_t)msg_metadata->total_size << 8) / s_memfault_data_source_weights[idx]);
+#else
+  (void)msg_metadata;
+#endif
+}
+
+//! Finds the next message to send
+//!
+//! @param channel Only the sources assigned to this channel are checked, unless it is
+//!  MEMFAULT_PACKETIZER_ANY_CHANNEL
+//! @param only_type When not kMfltMessageType_None, only the source of this type is checked
+static bool prv_get_source_with_data(size_t channel, eMfltMessageType only_type,
+                                     sMessageMetadata *msg_metadata) {
+  size_t order[MEMFAULT_PACKETIZER_NUM_SOURCES];
+  prv_scheduler_get_order(order);
+
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_SOURCES; i++) {
+    const sMemfaultDataSource *data_source = &s_memfault_data_source[order[i]];
+    if ((channel != MEMFAULT_PACKETIZER_ANY_CHANNEL) && (prv_source_channel(order[i]) != channel)) {
+      continue;
+    }
+    if ((only_type != kMfltMessageType_None) && (data_source->type != only_type)) {
+      continue;
+    }
+    if (data_source->deferrable && !prv_byte_budget_available()) {
+      // waits for the budget to refill. A message already in flight is always completed.
+      continue;
+    }
+
+    // a message which was RLE encoded when it was saved is sent as is
+    const bool pre_encoded = data_source->use_rle &&
+        (data_source->impl->is_rle_encoded_cb != NULL) && data_source->impl->is_rle_encoded_cb();
+    // the LZ codec, when compiled in, takes the place of RLE
+    const bool lz_enabled = data_source->use_rle && !pre_encoded &&
+        memfault_data_source_lz_encoder_set_active(data_source->impl);
+    const bool rle_enabled = data_source->use_rle && !pre_encoded && !lz_enabled &&
+        memfault_data_source_rle_encoder_set_active(data_source->impl);
+
+    const sMemfaultDataSourceImpl *impl = data_source->impl;
+    if (lz_enabled) {
+      impl = &g_memfault_data_lz_source;
+    } else if (rle_enabled) {
+      impl = &g_memfault_data_rle_source;
+    }
 
-  if (msg_metadata != NULL) {
     *msg_metadata = (sMessageMetadata) {
-      .total_size = total_size,
-      .source = active_source,
+      .source = {
+        .type = data_source->type,
+        .use_rle = rle_enabled || pre_encoded,
+        .use_lz = lz_enabled,
+        .impl = impl,
+      },
+      .source_idx = order[i],
     };
+
+    if (msg_metadata->source.impl->has_more_msgs_cb(&msg_metadata->total_size)) {
+      return true;
+    }
   }
+  return false;
+}
 
-  return true;
+static bool prv_more_messages_to_send(size_t channel, sMessageMetadata *msg_metadata) {
+  sMessageMetadata unused_metadata;
+  return prv_get_source_with_data(channel, kMfltMessageType_None,
+                                  (msg_metadata != NULL) ? msg_metadata : &unused_metadata);
 }
 
-static bool prv_load_next_message_to_send(bool enable_multi_packet_chunks,
-                                          sMfltTransportState *state) {
-  sMessageMetadata msg_metadata;
-  if (!prv_more_messages_to_send(&msg_metadata)) {
-    return false;
+//! Picks the next message to send, taking a coredump which was preempted into account
+static bool prv_pick_next_message(size_t channel, sMessageMetadata *msg_metadata) {
+#if MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+  if (s_mflt_packetizer_preempt_state == kMfltPreemptState_Preempting) {
+    if (prv_get_source_with_data(channel, kMfltMessageType_Event, msg_metadata)) {
+      return true;
+    }
+    // all caught up, the coredump is next in line again
+    s_mflt_packetizer_preempt_state = kMfltPreemptState_Preempted;
   }
+#endif
+  return prv_more_messages_to_send(channel, msg_metadata);
+}
+
+static void prv_load_message(size_t channel, bool enable_multi_packet_chunks,
+                             const sMessageMetadata *msg_metadata, sMfltTransportState *state) {
+  prv_scheduler_message_loaded(msg_metadata);
 
   *state = (sMfltTransportState) {
     .active_message = true,
-    .msg_metadata = msg_metadata,
+    .msg_metadata = *msg_metadata,
     .curr_msg_ctx = (sMfltChunkTransportCtx) {
-      .total_size = msg_metadata.total_size + sizeof(sMfltPacketizerHdr),
+      .total_size = msg_metadata->total_size + sizeof(sMfltPacketizerHdr),
       .read_msg = prv_data_source_chunk_transport_msg_reader,
       .enable_multi_call_chunk = enable_multi_packet_chunks,
+      .channel_id = (uint8_t)channel,
     },
   };
-  memfault_chunk_transport_get_chunk_info(&s_mflt_packetizer_state.curr_msg_ctx);
+  memfault_chunk_transport_get_chunk_info(&state->curr_msg_ctx);
+}
+
+static bool prv_load_next_message_to_send(size_t channel, bool enable_multi_packet_chunks,
+                                          sMfltTransportState *state) {
+  sMessageMetadata msg_metadata;
+  if (!prv_pick_next_message(channel, &msg_metadata)) {
+    return false;
+  }
+
+  prv_load_message(channel, enable_multi_packet_chunks, &msg_metadata, state);
   return true;
 }
 
-static void prv_mark_message_send_complete_and_cleanup(void) {
+//! Loads the next message on every idle channel and picks the channel the next chunk is read
+//! from. The channels with a message in flight take turns, one chunk at a time.
+static bool prv_load_messages_and_select_channel(bool enable_multi_packet_chunks) {
+  for (size_t channel = 0; channel < MEMFAULT_PACKETIZER_NUM_CHANNELS; channel++) {
+    sMfltTransportState *state = &s_mflt_packetizer_state[channel];
+    if (!state->active_message) {
+      prv_load_next_message_to_send(channel, enable_multi_packet_chunks, state);
+    }
+  }
+
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    const size_t channel =
+        (s_mflt_packetizer_active_channel + i) % MEMFAULT_PACKETIZER_NUM_CHANNELS;
+    const sMfltTransportState *state = &s_mflt_packetizer_state[channel];
+    if (state->active_message && !state->awaiting_ack) {
+      s_mflt_packetizer_active_channel = channel;
+      return true;
+    }
+  }
+
+#if MEMFAULT_PACKETIZER_WEIGHTED_FAIR
+  // Every source is idle so nobody is owed anything. Starting over also keeps the tags from
+  // growing without bound.
+  s_mflt_packetizer_scheduler = (sMfltPacketizerSchedulerState) { 0 };
+#endif
+  return false;
+}
+
+static void prv_mark_message_send_complete_and_cleanup(sMfltTransportState *state) {
   // we've finished sending the data so delete it
-  s_mflt_packetizer_state.msg_metadata.source.impl->mark_msg_read_cb();
+  state->msg_metadata.source.impl->mark_msg_read_cb();
 
-  prv_reset_packetizer_state();
+#if MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+  if (state->msg_metadata.source.type == kMfltMessageType_Coredump) {
+    s_mflt_packetizer_preempt_state = kMfltPreemptState_None;
+  }
+#endif
+
+  prv_reset_channel_state(state);
 }
 
 void memfault_packetizer_abort(void) {
   prv_reset_packetizer_state();
 }
 
+#if MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+//! Aborts the coredump being sent if events are waiting. This is only done between chunks so the
+//! receiver simply discards the partial coredump.
+static void prv_preempt_coredump_if_events_waiting(void) {
+  // preemption is only needed when coredumps & events share the one channel
+  const sMfltTransportState *state = &s_mflt_packetizer_state[0];
+  if (!state->active_message || state->awaiting_ack ||
+      (state->msg_metadata.source.type != kMfltMessageType_Coredump) ||
+      (s_mflt_packetizer_preempt_state != kMfltPreemptState_None)) {
+    return;
+  }
+
+  size_t total_size;
+  if (!g_memfault_event_data_source.has_more_msgs_cb(&total_size)) {
+    return;
+  }
+
+  prv_reset_packetizer_state();
+  s_mflt_packetizer_preempt_state = kMfltPreemptState_Preempting;
+}
+#endif
+
+//! Remembers where the chunk about to be sent starts so memfault_packetizer_seek() can get back
+//! to it cheaply
+static void prv_record_seek_point(sMfltTransportState *state) {
+  const sMfltChunkTransportCtx *ctx = &state->curr_msg_ctx;
+  if ((ctx->read_offset == 0) || ctx->enable_multi_call_chunk) {
+    // the start of the message is always known and a multi-call chunk can't be rewound
+    return;
+  }
+
+  state->seek_history[state->seek_history_idx] = (sMfltPacketizerSeekPoint) {
+    .offset = ctx->read_offset,
+    .crc16 = ctx->crc16_incremental,
+  };
+  state->seek_history_idx = (state->seek_history_idx + 1) % MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN;
+}
+
 eMemfaultPacketizerStatus memfault_packetizer_get_next(void *buf, size_t *buf_len) {
   if (buf == NULL || buf_len == NULL) {
     // We may want to consider just asserting on these. For now, just log an error
@@ -239,30 +609,38 @@ eMemfaultPacketizerStatus memfault_packetizer_get_next(void *buf, size_t *buf_le
     return kMemfaultPacketizerStatus_NoMoreData;
   }
 
-  if (!s_mflt_packetizer_state.active_message) {
+  sMfltTransportState *state = prv_active_state();
+  if (!state->active_message || state->awaiting_ack) {
     // To load a new message, memfault_packetizer_begin() must first be called
     return kMemfaultPacketizerStatus_NoMoreData;
   }
 
+  prv_record_seek_point(state);
   size_t original_size = *buf_len;
-  bool md = memfault_chunk_transport_get_next_chunk(
-      &s_mflt_packetizer_state.curr_msg_ctx, buf, buf_len);
+  bool md = memfault_chunk_transport_get_next_chunk(&state->curr_msg_ctx, buf, buf_len);
 
   if (*buf_len == 0) {
     MEMFAULT_LOG_ERROR("Buffer of %d bytes too small to packetize data",
                        (int)original_size);
   }
+  prv_account_bytes_sent(state->msg_metadata.source_idx, *buf_len);
 
   if (!md) {
-    // the entire message has been chunked up, perform clean up
-    prv_mark_message_send_complete_and_cleanup();
-
-    // we have reached the end of a message
-    return kMemfaultPacketizerStatus_EndOfChunk;
+    // the entire message has been chunked up, perform clean up unless the caller wants to hear
+    // that the chunks were delivered first
+    if (s_mflt_packetizer_require_ack) {
+      state->awaiting_ack = true;
+    } else {
+      prv_mark_message_send_complete_and_cleanup(state);
+    }
+  } else if (state->curr_msg_ctx.enable_multi_call_chunk) {
+    return kMemfaultPacketizerStatus_MoreDataForChunk;
   }
 
-  return s_mflt_packetizer_state.curr_msg_ctx.enable_multi_call_chunk ?
-      kMemfaultPacketizerStatus_MoreDataForChunk : kMemfaultPacketizerStatus_EndOfChunk;
+  // the chunk is complete, give the next channel a turn
+  s_mflt_packetizer_active_channel =
+      (s_mflt_packetizer_active_channel + 1) % MEMFAULT_PACKETIZER_NUM_CHANNELS;
+  return kMemfaultPacketizerStatus_EndOfChunk;
 }
 
 bool memfault_packetizer_begin(const sPacketizerConfig *cfg,
@@ -272,28 +650,305 @@ bool memfault_packetizer_begin(const sPacketizerConfig *cfg,
     return false;
   }
 
-  if (!s_mflt_packetizer_state.active_message) {
-    if (!prv_load_next_message_to_send(cfg->enable_multi_packet_chunk, &s_mflt_packetizer_state)) {
-      // no new messages to send
-      *metadata_out = (sPacketizerMetadata) { 0 };
-      return false;
-    }
+  s_mflt_packetizer_require_ack = cfg->require_ack;
+
+#if MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+  prv_preempt_coredump_if_events_waiting();
+#endif
+
+  // a chunk spanning multiple calls to memfault_packetizer_get_next() can't be interrupted
+  const sMfltTransportState *state = prv_active_state();
+  const bool chunk_in_progress = state->active_message &&
+      state->curr_msg_ctx.enable_multi_call_chunk && (state->curr_msg_ctx.read_offset != 0);
+  if (!chunk_in_progress &&
+      !prv_load_messages_and_select_channel(cfg->enable_multi_packet_chunk)) {
+    // no new messages to send
+    *metadata_out = (sPacketizerMetadata) { 0 };
+    return false;
   }
 
-  const bool send_in_progress = s_mflt_packetizer_state.curr_msg_ctx.read_offset != 0;
+  state = prv_active_state();
+  const bool send_in_progress = state->curr_msg_ctx.read_offset != 0;
   *metadata_out = (sPacketizerMetadata) {
-    .single_chunk_message_length = s_mflt_packetizer_state.curr_msg_ctx.single_chunk_message_length,
+    .single_chunk_message_length = state->curr_msg_ctx.single_chunk_message_length,
     .send_in_progress = send_in_progress,
   };
   return true;
 }
 
-bool memfault_packetizer_data_available(void) {
-  if (s_mflt_packetizer_state.active_message) {
+#define MEMFAULT_PACKETIZER_CHECKPOINT_MAGIC 0x4b504350 /* PCPK */
+
+//! Computed field by field so the checkpoint can be copied around without worrying about padding
+static uint16_t prv_checkpoint_crc(const sMemfaultPacketizerCheckpoint *checkpoint) {
+  uint16_t crc16 = memfault_crc16_ccitt_compute(MEMFAULT_CRC16_CCITT_INITIAL_VALUE,
+                                                &checkpoint->magic, sizeof(checkpoint->magic));
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    const sMemfaultPacketizerCheckpointMsg *msg = &checkpoint->msgs[i];
+    crc16 = memfault_crc16_ccitt_compute(crc16, &msg->msg_type, sizeof(msg->msg_type));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &msg->use_rle, sizeof(msg->use_rle));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &msg->total_size, sizeof(msg->total_size));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &msg->read_offset, sizeof(msg->read_offset));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &msg->crc16, sizeof(msg->crc16));
+  }
+  return crc16;
+}
+
+void memfault_packetizer_get_checkpoint(sMemfaultPacketizerCheckpoint *checkpoint) {
+  if (checkpoint == NULL) {
+    MEMFAULT_LOG_ERROR("%s: NULL input arguments", __func__);
+    return;
+  }
+
+  *checkpoint = (sMemfaultPacketizerCheckpoint) {
+    .magic = MEMFAULT_PACKETIZER_CHECKPOINT_MAGIC,
+  };
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    const sMfltTransportState *state = &s_mflt_packetizer_state[i];
+    const sMfltChunkTransportCtx *ctx = &state->curr_msg_ctx;
+    if (!state->active_message || ctx->enable_multi_call_chunk) {
+      continue;
+    }
+
+    checkpoint->msgs[i] = (sMemfaultPacketizerCheckpointMsg) {
+      .msg_type = (uint8_t)state->msg_metadata.source.type,
+      .use_rle = state->msg_metadata.source.use_rle,
+      .total_size = ctx->total_size,
+      .read_offset = ctx->read_offset,
+      .crc16 = ctx->crc16_incremental,
+    };
+  }
+  checkpoint->crc16 = prv_checkpoint_crc(checkpoint);
+}
+
+//! Reads the message in flight on a channel from a point whose CRC16 is known up to end_offset
+//!
+//! @return The CRC16 of the message up to end_offset
+static uint16_t prv_read_back_crc16(size_t channel, const sMfltPacketizerSeekPoint *start,
+                                    uint32_t end_offset) {
+  // the message reader works on the active channel
+  const size_t active_channel = s_mflt_packetizer_active_channel;
+  s_mflt_packetizer_active_channel = channel;
+
+  uint16_t crc16 = start->crc16;
+  uint8_t buf[32];
+  for (uint32_t offset = start->offset; offset < end_offset;) {
+    const size_t bytes_to_read = MEMFAULT_MIN(sizeof(buf), end_offset - offset);
+    prv_data_source_chunk_transport_msg_reader(offset, buf, bytes_to_read);
+    crc16 = memfault_crc16_ccitt_compute(crc16, buf, bytes_to_read);
+    offset += bytes_to_read;
+  }
+
+  s_mflt_packetizer_active_channel = active_channel;
+  return crc16;
+}
+
+//! Loads the message from the checkpoint on its channel and fast forwards to the offset it had
+//! been sent up to
+//!
+//! @return true if the message was resumed, false if it changed since the checkpoint was taken
+static bool prv_resume_message(size_t channel, const sMemfaultPacketizerCheckpointMsg *msg) {
+  sMessageMetadata msg_metadata;
+  if ((msg->msg_type == kMfltMessageType_None) ||
+      !prv_get_source_with_data(channel, (eMfltMessageType)msg->msg_type, &msg_metadata)) {
+    return false;
+  }
+
+  sMfltTransportState *state = &s_mflt_packetizer_state[channel];
+  prv_load_message(channel, false, &msg_metadata, state);
+  if ((state->msg_metadata.source.use_rle != msg->use_rle) ||
+      (state->curr_msg_ctx.total_size != msg->total_size) ||
+      (msg->read_offset >= msg->total_size)) {
+    // a different message, it will be sent from the start
+    return false;
+  }
+
+  // Read back what was already sent to check the message is the same
+  const sMfltPacketizerSeekPoint start = {
+    .offset = 0,
+    .crc16 = MEMFAULT_CRC16_CCITT_INITIAL_VALUE,
+  };
+  const uint16_t crc16 = prv_read_back_crc16(channel, &start, msg->read_offset);
+
+  if (crc16 != msg->crc16) {
+    // the contents changed, i.e the message was held in RAM, so start over
+    prv_reset_channel_state(state);
+    return false;
+  }
+
+  state->curr_msg_ctx.read_offset = msg->read_offset;
+  state->curr_msg_ctx.crc16_incremental = crc16;
+  return true;
+}
+
+bool memfault_packetizer_restore_checkpoint(const sMemfaultPacketizerCheckpoint *checkpoint) {
+  if ((checkpoint == NULL) || (checkpoint->magic != MEMFAULT_PACKETIZER_CHECKPOINT_MAGIC) ||
+      (checkpoint->crc16 != prv_checkpoint_crc(checkpoint))) {
+    return false;
+  }
+
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    if (s_mflt_packetizer_state[i].active_message) {
+      MEMFAULT_LOG_ERROR("Checkpoint must be restored before sending data");
+      return false;
+    }
+  }
+
+  bool resumed = false;
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    const sMemfaultPacketizerCheckpointMsg *msg = &checkpoint->msgs[i];
+    if (msg->read_offset != 0) {
+      resumed |= prv_resume_message(i, msg);
+    }
+  }
+  s_mflt_packetizer_active_channel = 0;
+  return resumed;
+}
+
+bool memfault_packetizer_seek(uint8_t channel_id, uint32_t offset) {
+  if (channel_id >= MEMFAULT_PACKETIZER_NUM_CHANNELS) {
+    return false;
+  }
+
+  sMfltTransportState *state = &s_mflt_packetizer_state[channel_id];
+  sMfltChunkTransportCtx *ctx = &state->curr_msg_ctx;
+  if (!state->active_message || ctx->enable_multi_call_chunk || (offset > ctx->read_offset)) {
+    return false;
+  }
+  if (offset == ctx->read_offset) {
     return true;
   }
 
-  return prv_more_messages_to_send(NULL);
+  // start from the closest point before the offset with a known CRC16
+  sMfltPacketizerSeekPoint start = {
+    .offset = 0,
+    .crc16 = MEMFAULT_CRC16_CCITT_INITIAL_VALUE,
+  };
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN; i++) {
+    const sMfltPacketizerSeekPoint *point = &state->seek_history[i];
+    if ((point->offset <= offset) && (point->offset > start.offset)) {
+      start = *point;
+    }
+  }
+
+  ctx->crc16_incremental = prv_read_back_crc16(channel_id, &start, offset);
+  ctx->read_offset = offset;
+  // the chunks from the offset on will be sent again before the message can be acknowledged
+  state->awaiting_ack = false;
+  return true;
+}
+
+bool memfault_packetizer_ack_pending(uint8_t channel_id) {
+  return (channel_id < MEMFAULT_PACKETIZER_NUM_CHANNELS) &&
+         s_mflt_packetizer_state[channel_id].awaiting_ack;
+}
+
+bool memfault_packetizer_ack(uint8_t channel_id) {
+  if (!memfault_packetizer_ack_pending(channel_id)) {
+    return false;
+  }
+
+  prv_mark_message_send_complete_and_cleanup(&s_mflt_packetizer_state[channel_id]);
+  return true;
+}
+
+bool memfault_packetizer_get_byte_stats(sMemfaultPacketizerByteStats *stats) {
+  if (stats == NULL) {
+    return false;
+  }
+
+  *stats = (sMemfaultPacketizerByteStats) { 0 };
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_SOURCES; i++) {
+    const uint32_t bytes_sent = s_mflt_packetizer_bytes_sent[i];
+    switch (s_memfault_data_source[i].type) {
+      case kMfltMessageType_Coredump:
+        stats->coredump_bytes += bytes_sent;
+        break;
+      case kMfltMessageType_Event:
+        stats->event_bytes += bytes_sent;
+        break;
+      case kMfltMessageType_Log:
+        stats->log_bytes += bytes_sent;
+        break;
+      case kMfltMessageType_None:
+      default:
+        break;
+    }
+  }
+
+#if MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED
+  prv_byte_budget_refill();
+  const int64_t byte_budget =
+      s_mflt_packetizer_byte_budget.tokens / MEMFAULT_PACKETIZER_MS_PER_HOUR;
+  stats->byte_budget = (int32_t)MEMFAULT_MAX(MEMFAULT_MIN(byte_budget, INT32_MAX), INT32_MIN);
+#endif
+  return true;
+}
+
+void memfault_packetizer_reset_byte_stats(void) {
+  memset(s_mflt_packetizer_bytes_sent, 0, sizeof(s_mflt_packetizer_bytes_sent));
+}
+
+//! Looks up the data pending in the source itself, never the RLE or LZ encoders, which would have
+//! to make a pass over the data to compute the encoded size
+static void prv_get_source_pending_stats(const sMemfaultDataSource *data_source,
+                                         sMemfaultPacketizerPendingSourceStats *source_stats) {
+  const sMemfaultDataSourceImpl *impl = data_source->impl;
+  size_t num_msgs = 0;
+  size_t num_bytes = 0;
+  if (impl->get_pending_stats_cb != NULL) {
+    impl->get_pending_stats_cb(&num_msgs, &num_bytes);
+  } else if (impl->has_more_msgs_cb(&num_bytes)) {
+    // only the next message is known about
+    num_msgs = 1;
+  } else {
+    num_bytes = 0;
+  }
+
+  *source_stats = (sMemfaultPacketizerPendingSourceStats) {
+    .count = (uint32_t)num_msgs,
+    .bytes = (uint32_t)num_bytes,
+  };
+}
+
+bool memfault_packetizer_get_pending_stats(sMemfaultPacketizerPendingStats *stats) {
+  if (stats == NULL) {
+    return false;
+  }
+
+  *stats = (sMemfaultPacketizerPendingStats) { 0 };
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_SOURCES; i++) {
+    const sMemfaultDataSource *data_source = &s_memfault_data_source[i];
+    sMemfaultPacketizerPendingSourceStats *source_stats;
+    switch (data_source->type) {
+      case kMfltMessageType_Coredump:
+        source_stats = &stats->coredumps;
+        break;
+      case kMfltMessageType_Event:
+        source_stats = &stats->events;
+        break;
+      case kMfltMessageType_Log:
+        source_stats = &stats->logs;
+        break;
+      case kMfltMessageType_None:
+      default:
+        continue;
+    }
+
+    prv_get_source_pending_stats(data_source, source_stats);
+  }
+
+  stats->total_bytes = stats->coredumps.bytes + stats->events.bytes + stats->logs.bytes;
+  return true;
+}
+
+bool memfault_packetizer_data_available(void) {
+  for (size_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    if (s_mflt_packetizer_state[i].active_message) {
+      return true;
+    }
+  }
+
+  return prv_more_messages_to_send(MEMFAULT_PACKETIZER_ANY_CHANNEL, NULL);
 }
 
 bool memfault_packetizer_get_chunk(void *buf, size_t *buf_len) {
@@ -321,3 +976,57 @@ bool memfault_packetizer_get_chunk(void *buf, size_t *buf_len) {
 
   return true;
 }
+
+bool memfault_packetizer_get_chunk_batch(void *buf, size_t *buf_len) {
+  if ((buf == NULL) || (buf_len == NULL)) {
+    MEMFAULT_LOG_ERROR("%s: NULL input arguments", __func__);
+    return false;
+  }
+
+  uint8_t *batch = buf;
+  size_t bytes_written = 0;
+  while (true) {
+    // the length of the chunk can't take more bytes to encode than the space left does
+    uint8_t chunk_len_hdr[MEMFAULT_UINT32_MAX_VARINT_LENGTH];
+    const size_t space_available = *buf_len - bytes_written;
+    const size_t max_hdr_len = memfault_encode_varint_u32((uint32_t)space_available,
+                                                          chunk_len_hdr);
+    if (space_available < (max_hdr_len + MEMFAULT_PACKETIZER_MIN_BUF_LEN)) {
+      break;
+    }
+
+    uint8_t *chunk = &batch[bytes_written + max_hdr_len];
+    size_t chunk_len = space_available - max_hdr_len;
+    if (!memfault_packetizer_get_chunk(chunk, &chunk_len)) {
+      break;
+    }
+
+    const size_t hdr_len = memfault_encode_varint_u32((uint32_t)chunk_len, chunk_len_hdr);
+    memcpy(&batch[bytes_written], chunk_len_hdr, hdr_len);
+    memmove(&batch[bytes_written + hdr_len], chunk, chunk_len);
+    bytes_written += hdr_len + chunk_len;
+  }
+
+  *buf_len = bytes_written;
+  return bytes_written != 0;
+}
+
+bool memfault_packetizer_chunk_batch_next(const void *batch, size_t batch_len, size_t *offset,
+                                          const void **chunk, size_t *chunk_len) {
+  if ((batch == NULL) || (offset == NULL) || (chunk == NULL) || (chunk_len == NULL) ||
+      (*offset >= batch_len)) {
+    return false;
+  }
+
+  const uint8_t *bytes = batch;
+  uint32_t len;
+  const size_t hdr_len = memfault_decode_varint_u32(&bytes[*offset], batch_len - *offset, &len);
+  if ((hdr_len == 0) || (len == 0) || (len > (batch_len - *offset - hdr_len))) {
+    return false;
+  }
+
+  *chunk = &bytes[*offset + hdr_len];
+  *chunk_len = len;
+  *offset += hdr_len + len;
+  return true;
+}
@@ -0,0 +1,181 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! A double-buffered layer on top of memfault_packetizer_get_chunk() for transports which send
+//! data in the background. Buffers are handed out & given back in the same order so the pool is
+//! used as a ring.
+//!
+//! With sMemfaultPacketizerAsyncConfig.require_ack set, messages are sent with
+//! sPacketizerConfig.require_ack so a message is only deleted once the buffer holding its last
+//! chunk has been given back as sent.
+
+#include "memfault/core/data_packetizer.h"
+
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/config.h"
+#include "memfault/core/debug_log.h"
+
+typedef struct {
+  bool started;
+  sMemfaultPacketizerAsyncConfig cfg;
+  //! The next buffer to fill
+  size_t next_buf_idx;
+  //! Bit n is set when the buffer holds the last chunk of the message on channel n
+  uint32_t final_chunk_channels[MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS];
+  //! Written from the completion path, which may run in an interrupt
+  volatile bool in_flight[MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS];
+  volatile bool sent[MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS];
+  volatile bool send_failed;
+} sMfltPacketizerAsyncState;
+
+static sMfltPacketizerAsyncState s_mflt_packetizer_async_state;
+
+static bool prv_any_in_flight(void) {
+  for (size_t i = 0; i < s_mflt_packetizer_async_state.cfg.num_bufs; i++) {
+    if (s_mflt_packetizer_async_state.in_flight[i]) {
+      return true;
+    }
+  }
+  return false;
+}
+
+//! @return A mask of the channels with a message waiting to be acknowledged
+static uint32_t prv_ack_pending_channels(void) {
+  uint32_t channels = 0;
+  for (uint8_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+    if (memfault_packetizer_ack_pending(i)) {
+      channels |= (1u << i);
+    }
+  }
+  return channels;
+}
+
+//! Once a buffer holding the last chunk of a message is back, deletes the message if the chunk
+//! was sent. If it wasn't, the message is sent again after memfault_packetizer_abort().
+static void prv_ack_if_sent(size_t buf_idx) {
+  sMfltPacketizerAsyncState *state = &s_mflt_packetizer_async_state;
+  const uint32_t channels = state->final_chunk_channels[buf_idx];
+  if (state->in_flight[buf_idx] || (channels == 0)) {
+    return;
+  }
+
+  if (state->sent[buf_idx]) {
+    for (uint8_t i = 0; i < MEMFAULT_PACKETIZER_NUM_CHANNELS; i++) {
+      if ((channels & (1u << i)) != 0) {
+        memfault_packetizer_ack(i);
+      }
+    }
+  }
+  state->final_chunk_channels[buf_idx] = 0;
+}
+
+static void prv_ack_all_sent(void) {
+  for (size_t i = 0; i < s_mflt_packetizer_async_state.cfg.num_bufs; i++) {
+    prv_ack_if_sent(i);
+  }
+}
+
+static bool prv_get_chunk(void *buf, size_t *buf_len) {
+  const sPacketizerConfig cfg = {
+    .enable_multi_packet_chunk = false,
+    .require_ack = s_mflt_packetizer_async_state.cfg.require_ack,
+  };
+  sPacketizerMetadata metadata;
+  return memfault_packetizer_begin(&cfg, &metadata) &&
+         (memfault_packetizer_get_next(buf, buf_len) == kMemfaultPacketizerStatus_EndOfChunk);
+}
+
+bool memfault_packetizer_async_start(const sMemfaultPacketizerAsyncConfig *cfg) {
+  if ((cfg == NULL) || (cfg->buf_pool == NULL) || (cfg->chunk_ready_cb == NULL) ||
+      (cfg->num_bufs == 0) || (cfg->num_bufs > MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS) ||
+      (cfg->chunk_buf_len < MEMFAULT_PACKETIZER_MIN_BUF_LEN)) {
+    MEMFAULT_LOG_ERROR("Invalid async packetizer config");
+    return false;
+  }
+
+  if (s_mflt_packetizer_async_state.started) {
+    if (prv_any_in_flight()) {
+      MEMFAULT_LOG_ERROR("Async packetizer has chunks in flight");
+      return false;
+    }
+    prv_ack_all_sent();
+  }
+
+  s_mflt_packetizer_async_state = (sMfltPacketizerAsyncState) {
+    .started = true,
+    .cfg = *cfg,
+  };
+  return true;
+}
+
+size_t memfault_packetizer_async_fill(void) {
+  sMfltPacketizerAsyncState *state = &s_mflt_packetizer_async_state;
+  if (!state->started) {
+    return 0;
+  }
+
+  if (state->send_failed) {
+    // The chunks which made it through can't be told apart from those which didn't so wait for
+    // every buffer to come back and then send the messages in flight again from the start
+    if (prv_any_in_flight()) {
+      return 0;
+    }
+    // messages whose last chunk made it through before the failure are done with
+    prv_ack_all_sent();
+    memfault_packetizer_abort();
+    state->send_failed = false;
+  }
+
+  prv_ack_all_sent();
+
+  size_t num_chunks = 0;
+  while (!state->in_flight[state->next_buf_idx]) {
+    // the buffer may have come back since the acks above
+    prv_ack_if_sent(state->next_buf_idx);
+
+    uint8_t *buf = (uint8_t *)state->cfg.buf_pool +
+                   (state->next_buf_idx * state->cfg.chunk_buf_len);
+    size_t buf_len = state->cfg.chunk_buf_len;
+    const uint32_t ack_pending_channels = prv_ack_pending_channels();
+    if (!prv_get_chunk(buf, &buf_len)) {
+      break;
+    }
+
+    // mark the buffer before handing it over since it may come back before the callback returns
+    state->final_chunk_channels[state->next_buf_idx] =
+        prv_ack_pending_channels() & ~ack_pending_channels;
+    state->sent[state->next_buf_idx] = false;
+    state->in_flight[state->next_buf_idx] = true;
+    state->next_buf_idx = (state->next_buf_idx + 1) % state->cfg.num_bufs;
+    num_chunks++;
+    state->cfg.chunk_ready_cb(buf, buf_len, state->cfg.ctx);
+  }
+  return num_chunks;
+}
+
+void memfault_packetizer_async_chunk_sent(const void *buf, bool success) {
+  sMfltPacketizerAsyncState *state = &s_mflt_packetizer_async_state;
+  const uintptr_t pool_start = (uintptr_t)state->cfg.buf_pool;
+  const uintptr_t buf_addr = (uintptr_t)buf;
+  if (!state->started || (buf_addr < pool_start)) {
+    return;
+  }
+
+  const size_t offset = buf_addr - pool_start;
+  const size_t buf_idx = offset / state->cfg.chunk_buf_len;
+  if ((buf_idx >= state->cfg.num_bufs) || ((offset % state->cfg.chunk_buf_len) != 0)) {
+    return;
+  }
+
+  // flag the failure first so the buffer isn't refilled before the failure is seen
+  if (!success) {
+    state->send_failed = true;
+  }
+  state->sent[buf_idx] = success;
+  state->in_flight[buf_idx] = false;
+}
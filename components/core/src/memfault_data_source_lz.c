@@ -0,0 +1,248 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! See header for more details
+
+#include "memfault/config.h"
+
+#if MEMFAULT_DATA_SOURCE_LZ_ENABLED
+
+#include "memfault/core/data_source_lz.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/core/compiler.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/math.h"
+#include "memfault/util/crc16_ccitt.h"
+#include "memfault/util/lz.h"
+
+//! The most the encoder can produce in one go, when flushed at the end of the message: every
+//! byte it still buffers written out as literals plus a token for each literal run. A match token
+//! is always shorter than the bytes it replaces.
+#define MEMFAULT_DATA_SOURCE_LZ_BUFFERED_LEN \
+  (MEMFAULT_LZ_ENCODER_MAX_LITERAL_RUN + MEMFAULT_LZ_ENCODER_LOOKAHEAD_LEN)
+#define MEMFAULT_DATA_SOURCE_LZ_PENDING_LEN                                                    \
+  (MEMFAULT_DATA_SOURCE_LZ_BUFFERED_LEN +                                                      \
+   (MEMFAULT_DATA_SOURCE_LZ_BUFFERED_LEN / MEMFAULT_LZ_ENCODER_MAX_LITERAL_RUN) + 1)
+
+typedef struct {
+  size_t original_size;
+  size_t total_lz_size;
+  sMemfaultLzEncoder encoder;
+  // The offset of the next byte of the backing data source to feed to the encoder
+  uint32_t bytes_processed;
+  bool finished;
+  // Output of the encoder not consumed yet and the offset in the encoded stream it starts at
+  uint8_t pending[MEMFAULT_DATA_SOURCE_LZ_PENDING_LEN];
+  uint32_t pending_offset;
+  uint32_t pending_len;
+  bool pending_overflow;
+  // The block of the backing data source most recently read
+  uint8_t temp_buf[64];
+  uint32_t temp_buf_offset;
+  uint32_t temp_buf_len;
+} sMemfaultDataSourceLzState;
+
+//! The encoded size of the message last computed. Like the RLE size cache, this is kept across
+//! memfault_data_source_lz_encoder_set_active() so sending the message again after an abort does
+//! not require compressing it all a second time.
+typedef struct {
+  uint32_t original_size;
+  uint32_t lz_size;
+  //! The CRC16 of the start of the message, to tell it apart from another of the same size
+  uint16_t fingerprint;
+} sMemfaultDataSourceLzSizeCache;
+
+static const sMemfaultDataSourceImpl *s_active_data_source = NULL;
+static sMemfaultDataSourceLzState s_ds_lz_state;
+static sMemfaultDataSourceLzSizeCache s_ds_lz_size_cache;
+static uint8_t s_ds_lz_window[MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE];
+
+bool memfault_data_source_lz_encoder_set_active(const sMemfaultDataSourceImpl *source) {
+  if (source == s_active_data_source) {
+    return true;
+  }
+
+  s_ds_lz_state = (sMemfaultDataSourceLzState) { 0 };
+  s_active_data_source = source;
+  return true;
+}
+
+static void prv_encoder_write_cb(MEMFAULT_UNUSED void *ctx, const void *buf, size_t buf_len) {
+  sMemfaultDataSourceLzState *state = &s_ds_lz_state;
+  if ((state->pending_len + buf_len) > sizeof(state->pending)) {
+    state->pending_overflow = true;
+    return;
+  }
+  memcpy(&state->pending[state->pending_len], buf, buf_len);
+  state->pending_len += (uint32_t)buf_len;
+}
+
+//! Starts encoding the message from the beginning
+static void prv_encoder_reset(MemfaultLzWriteCallback write_cb) {
+  const sMemfaultLzConfig config = {
+    .window = s_ds_lz_window,
+    .window_size = sizeof(s_ds_lz_window),
+  };
+  sMemfaultDataSourceLzState *state = &s_ds_lz_state;
+  memfault_lz_encoder_init(&state->encoder, &config, write_cb, NULL);
+  state->bytes_processed = 0;
+  state->finished = false;
+  state->pending_offset = 0;
+  state->pending_len = 0;
+  state->pending_overflow = false;
+}
+
+//! @return The block of the backing data source starting at offset, reusing the one held in
+//! temp_buf when possible
+static const uint8_t *prv_read_block(uint32_t offset, size_t *len_out) {
+  sMemfaultDataSourceLzState *state = &s_ds_lz_state;
+  if ((state->temp_buf_len == 0) || (offset < state->temp_buf_offset) ||
+      (offset >= (state->temp_buf_offset + state->temp_buf_len))) {
+    const size_t bytes_left = state->original_size - offset;
+    state->temp_buf_len = (uint32_t)MEMFAULT_MIN(bytes_left, sizeof(state->temp_buf));
+    state->temp_buf_offset = offset;
+    s_active_data_source->read_msg_cb(offset, state->temp_buf, state->temp_buf_len);
+  }
+
+  const uint32_t block_offset = offset - state->temp_buf_offset;
+  *len_out = state->temp_buf_len - block_offset;
+  return &state->temp_buf[block_offset];
+}
+
+static uint16_t prv_compute_fingerprint(void) {
+  size_t len;
+  const uint8_t *block = prv_read_block(0, &len);
+  return memfault_crc16_ccitt_compute(MEMFAULT_CRC16_CCITT_INITIAL_VALUE, block, len);
+}
+
+//! Do one pass over the data source currently saved in backing storage to compute the size it
+//! compresses to
+static size_t prv_compute_lz_size(void) {
+  sMemfaultDataSourceLzState *state = &s_ds_lz_state;
+  // the first block read is used for the first bytes encoded too
+  const uint16_t fingerprint = prv_compute_fingerprint();
+  prv_encoder_reset(NULL);
+  while (state->bytes_processed != state->original_size) {
+    size_t len;
+    const uint8_t *block = prv_read_block(state->bytes_processed, &len);
+    memfault_lz_encode(&state->encoder, block, len);
+    state->bytes_processed += (uint32_t)len;
+  }
+  const size_t lz_size = memfault_lz_encoder_finish(&state->encoder);
+
+  s_ds_lz_size_cache = (sMemfaultDataSourceLzSizeCache) {
+    .original_size = (uint32_t)state->original_size,
+    .lz_size = (uint32_t)lz_size,
+    .fingerprint = fingerprint,
+  };
+  prv_encoder_reset(prv_encoder_write_cb);
+  return lz_size;
+}
+
+//! Feeds the next byte of the message to the encoder, or flushes it once the whole message has
+//! been fed. A single byte at a time bounds how much output the encoder can produce.
+//!
+//! @return false if the whole message has already been encoded
+static bool prv_encode_more(void) {
+  sMemfaultDataSourceLzState *state = &s_ds_lz_state;
+  if (state->bytes_processed < state->original_size) {
+    size_t len;
+    const uint8_t *block = prv_read_block(state->bytes_processed, &len);
+    memfault_lz_encode(&state->encoder, block, 1);
+    state->bytes_processed++;
+    return true;
+  }
+
+  if (state->finished) {
+    return false;
+  }
+  memfault_lz_encoder_finish(&state->encoder);
+  state->finished = true;
+  return true;
+}
+
+static bool prv_data_source_lz_read(uint32_t offset, void *buf, size_t buf_len) {
+  sMemfaultDataSourceLzState *state = &s_ds_lz_state;
+  if ((state->total_lz_size == 0) || ((offset + buf_len) > state->total_lz_size)) {
+    return false;
+  }
+
+  if (offset < state->pending_offset) {
+    // the encoder state can't be rewound so encode the message from the beginning again
+    prv_encoder_reset(prv_encoder_write_cb);
+  }
+
+  uint8_t *bufp = (uint8_t *)buf;
+  while (buf_len > 0) {
+    const uint32_t pending_end = state->pending_offset + state->pending_len;
+    if (offset < pending_end) {
+      const size_t bytes_to_copy = MEMFAULT_MIN(buf_len, pending_end - offset);
+      memcpy(bufp, &state->pending[offset - state->pending_offset], bytes_to_copy);
+      bufp += bytes_to_copy;
+      buf_len -= bytes_to_copy;
+      offset += (uint32_t)bytes_to_copy;
+      continue;
+    }
+
+    // everything pending is behind the offset being read so make room for more
+    state->pending_offset = pending_end;
+    state->pending_len = 0;
+    if (!prv_encode_more() || state->pending_overflow) {
+      return false;
+    }
+  }
+  return true;
+}
+
+MEMFAULT_WEAK
+bool memfault_data_source_lz_read_msg(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_data_source_lz_read(offset, buf, buf_len);
+}
+
+bool memfault_data_source_lz_has_more_msgs(size_t *total_size_out) {
+  sMemfaultDataSourceLzState *state = &s_ds_lz_state;
+  const bool has_msgs = s_active_data_source->has_more_msgs_cb(&state->original_size);
+  if (!has_msgs) {
+    return has_msgs;
+  }
+
+  // we have already computed what the compressed size will be, no need to do it again
+  if (state->total_lz_size != 0) {
+    *total_size_out = state->total_lz_size;
+    return true;
+  }
+
+  const sMemfaultDataSourceLzSizeCache *cache = &s_ds_lz_size_cache;
+  if ((cache->lz_size != 0) && (cache->original_size == state->original_size) &&
+      (cache->fingerprint == prv_compute_fingerprint())) {
+    state->total_lz_size = cache->lz_size;
+    prv_encoder_reset(prv_encoder_write_cb);
+  } else {
+    state->total_lz_size = prv_compute_lz_size();
+  }
+
+  *total_size_out = state->total_lz_size;
+  return true;
+}
+
+void memfault_data_source_lz_mark_msg_read(void) {
+  s_ds_lz_state = (sMemfaultDataSourceLzState) { 0 };
+  s_ds_lz_size_cache = (sMemfaultDataSourceLzSizeCache) { 0 };
+  s_active_data_source->mark_msg_read_cb();
+}
+
+//! Expose a data source for use by the Memfault Packetizer
+const sMemfaultDataSourceImpl g_memfault_data_lz_source = {
+  .has_more_msgs_cb = memfault_data_source_lz_has_more_msgs,
+  .read_msg_cb = memfault_data_source_lz_read_msg,
+  .mark_msg_read_cb = memfault_data_source_lz_mark_msg_read,
+};
+
+#endif /* MEMFAULT_DATA_SOURCE_LZ_ENABLED */
@@ -19,6 +19,7 @@
 #include "memfault/core/compiler.h"
 #include "memfault/core/data_packetizer_source.h"
 #include "memfault/core/math.h"
+#include "memfault/util/crc16_ccitt.h"
 #include "memfault/util/rle.h"
 
 //! Helper function that computes the RLE length of the message being processed
@@ -57,6 +58,9 @@ typedef enum {
 typedef struct {
   eMemfaultDataSourceRleState state;
   uint8_t temp_buf[128];
+  // The offset & length of the block of the backing data source held in temp_buf
+  uint32_t temp_buf_offset;
+  uint32_t temp_buf_len;
   // The number of bytes written within the current RLE sequence
   uint32_t write_offset;
   // The total number of bytes that have been processed from the backing data source
@@ -75,6 +79,17 @@ typedef struct {
 
 static sMemfaultDataSourceRleState s_ds_rle_state;
 
+#define MEMFAULT_DATA_SOURCE_RLE_CACHE_MAGIC 0x43454c52 /* RLEC */
+
+//! The number of encoded bytes between index entries until the index fills up. The spacing is
+//! doubled every time the index is thinned out to make room for more entries.
+#define MEMFAULT_DATA_SOURCE_RLE_INDEX_MIN_SPACING 128
+
+//! Describes the message s_ds_rle_state is for once its size has been computed. Unlike
+//! s_ds_rle_state, it is not reset by memfault_data_source_rle_encoder_set_active().
+static sMemfaultDataSourceRleCache s_ds_rle_cache;
+static uint32_t s_ds_rle_index_spacing;
+
 bool memfault_data_source_rle_encoder_set_active(const sMemfaultDataSourceImpl *source) {
   if (source == s_active_data_source) {
     return true;
@@ -85,6 +100,77 @@ bool memfault_data_source_rle_encoder_set_active(const sMemfaultDataSourceImpl *
   return true;
 }
 
+static uint32_t prv_index_last_offset(void) {
+  const sMemfaultDataSourceRleCache *cache = &s_ds_rle_cache;
+  return (cache->num_entries == 0) ? 0 : cache->entries[cache->num_entries - 1].encoded_offset;
+}
+
+//! Records the encoder state at the end of the sequence which was just found if it is far enough
+//! from the last entry in the index
+static void prv_index_add(const sMemfaultRleCtx *rle_ctx) {
+  sMemfaultDataSourceRleCache *cache = &s_ds_rle_cache;
+  // the sequence found has already been added to the encoded size so this is where it ends
+  const uint32_t encoded_offset = rle_ctx->total_rle_size;
+  if (encoded_offset < (prv_index_last_offset() + s_ds_rle_index_spacing)) {
+    return;
+  }
+
+  const size_t max_entries = MEMFAULT_ARRAY_SIZE(cache->entries);
+  if (cache->num_entries == max_entries) {
+    // keep every other entry so the entries stay evenly spread out over the message
+    for (size_t i = 0; i < (max_entries / 2); i++) {
+      cache->entries[i] = cache->entries[(2 * i) + 1];
+    }
+    cache->num_entries = (uint16_t)(max_entries / 2);
+    s_ds_rle_index_spacing *= 2;
+    if (encoded_offset < (prv_index_last_offset() + s_ds_rle_index_spacing)) {
+      return;
+    }
+  }
+
+  cache->entries[cache->num_entries++] = (sMemfaultDataSourceRleIndexEntry) {
+    .encoded_offset = encoded_offset,
+    .curr_offset = rle_ctx->curr_offset,
+    .seq_start_offset = rle_ctx->seq_start_offset,
+    .seq_count = (uint32_t)rle_ctx->seq_count,
+    .num_repeats = (uint32_t)rle_ctx->num_repeats,
+    .last_byte = rle_ctx->last_byte,
+    .state = (uint8_t)rle_ctx->state,
+  };
+}
+
+//! Puts the encoder in the state an index entry was recorded in or at the beginning of the
+//! message if entry is NULL
+static void prv_index_restore(const sMemfaultDataSourceRleIndexEntry *entry) {
+  // Note: the block held in temp_buf is kept since it may still be useful
+  sMemfaultDataSourceRleEncodeCtx *encode_ctx = &s_ds_rle_state.encode_ctx;
+  encode_ctx->state = kMemfaultDataSourceRleState_FindingSeqLength;
+  encode_ctx->write_offset = 0;
+  encode_ctx->bytes_processed = 0;
+  encode_ctx->curr_encoded_len = 0;
+  s_ds_rle_state.rle_ctx = (sMemfaultRleCtx) { 0 };
+  if (entry == NULL) {
+    return;
+  }
+
+  s_ds_rle_state.rle_ctx = (sMemfaultRleCtx) {
+    .total_rle_size = entry->encoded_offset,
+    .last_byte = entry->last_byte,
+    .seq_start_offset = entry->seq_start_offset,
+    .state = (eMemfaultRleState)entry->state,
+    .seq_count = entry->seq_count,
+    .num_repeats = entry->num_repeats,
+    .curr_offset = entry->curr_offset,
+  };
+  encode_ctx->bytes_processed = entry->curr_offset;
+  encode_ctx->curr_encoded_len = entry->encoded_offset;
+}
+
+//! @return The CRC16 of the first block of the message
+static uint16_t prv_compute_fingerprint(const void *data, size_t data_len) {
+  return memfault_crc16_ccitt_compute(MEMFAULT_CRC16_CCITT_INITIAL_VALUE, data, data_len);
+}
+
 static bool prv_data_source_rle_has_more_msgs_prepare(const void *data,
                                                       size_t data_len) {
   const uint8_t *buf = data;
@@ -93,6 +179,9 @@ static bool prv_data_source_rle_has_more_msgs_prepare(const void *data,
   while (bytes_encoded != data_len) {
     bytes_encoded += memfault_rle_encode(
         &s_ds_rle_state.rle_ctx, &buf[bytes_encoded], data_len - bytes_encoded);
+    if (s_ds_rle_state.rle_ctx.write_info.available) {
+      prv_index_add(&s_ds_rle_state.rle_ctx);
+    }
   }
 
   const bool all_bytes_processed =
@@ -173,8 +262,15 @@ static uint32_t prv_data_source_rle_build_msg_incremental(uint8_t *buf,
       MEMFAULT_MIN(buf_len, total_write_len - encode_ctx->write_offset);
 
   const uint32_t start_offset = prv_data_source_rle_get_backing_read_offset();
-  s_active_data_source->read_msg_cb(start_offset, &buf[header_bytes_to_write],
-                                    data_to_write);
+  if ((start_offset >= encode_ctx->temp_buf_offset) &&
+      ((start_offset + data_to_write) <=
+       (encode_ctx->temp_buf_offset + encode_ctx->temp_buf_len))) {
+    memcpy(&buf[header_bytes_to_write],
+           &encode_ctx->temp_buf[start_offset - encode_ctx->temp_buf_offset], data_to_write);
+  } else {
+    s_active_data_source->read_msg_cb(start_offset, &buf[header_bytes_to_write],
+                                      data_to_write);
+  }
   encode_ctx->write_offset += data_to_write;
 
   const size_t bytes_written = header_bytes_to_write + data_to_write;
@@ -195,10 +291,35 @@ static bool prv_data_source_rle_fill_msg(uint8_t **bufpp, size_t *buf_len) {
   return *buf_len == 0;
 }
 
+//! @return The bytes of the backing data source from offset onwards held in temp_buf. The block at
+//!   offset is read in first if it isn't there already.
+static const uint8_t *prv_data_source_rle_read_block(uint32_t offset, size_t *len_out) {
+  sMemfaultDataSourceRleEncodeCtx *encode_ctx = &s_ds_rle_state.encode_ctx;
+  const uint32_t temp_buf_end = encode_ctx->temp_buf_offset + encode_ctx->temp_buf_len;
+  if ((offset < encode_ctx->temp_buf_offset) || (offset >= temp_buf_end)) {
+    // Start the block at the sequence being searched when it is close by so the data written
+    // out for the sequence can be copied from the block as well
+    const uint32_t seq_start_offset = s_ds_rle_state.rle_ctx.seq_start_offset;
+    const uint32_t block_offset =
+        ((offset - seq_start_offset) < (sizeof(encode_ctx->temp_buf) / 2)) ? seq_start_offset :
+                                                                            offset;
+    encode_ctx->temp_buf_offset = block_offset;
+    encode_ctx->temp_buf_len = (uint32_t)MEMFAULT_MIN(
+        s_ds_rle_state.original_size - block_offset, sizeof(encode_ctx->temp_buf));
+    s_active_data_source->read_msg_cb(block_offset, encode_ctx->temp_buf,
+                                      encode_ctx->temp_buf_len);
+  }
+
+  *len_out = encode_ctx->temp_buf_offset + encode_ctx->temp_buf_len - offset;
+  return &encode_ctx->temp_buf[offset - encode_ctx->temp_buf_offset];
+}
+
+static bool prv_data_source_rle_seek(uint32_t offset);
+
 static bool prv_data_source_rle_read(uint32_t offset, void *buf,
                                      size_t buf_len) {
   sMemfaultDataSourceRleEncodeCtx *encode_ctx = &s_ds_rle_state.encode_ctx;
-  if (offset != encode_ctx->curr_encoded_len) {
+  if ((offset != encode_ctx->curr_encoded_len) && !prv_data_source_rle_seek(offset)) {
     return false; // Read happened from an unexpected offset
   }
 
@@ -210,15 +331,9 @@ static bool prv_data_source_rle_read(uint32_t offset, void *buf,
   }
 
   while (encode_ctx->bytes_processed != s_ds_rle_state.original_size) {
-    uint8_t *working_buf = &encode_ctx->temp_buf[0];
-    const size_t working_buf_size = sizeof(encode_ctx->temp_buf);
-
-    const size_t bytes_remaining =
-        s_ds_rle_state.original_size - encode_ctx->bytes_processed;
-    const size_t bytes_read = MEMFAULT_MIN(bytes_remaining, working_buf_size);
-
-    const size_t read_offset = prv_data_source_rle_get_backing_read_offset();
-    s_active_data_source->read_msg_cb(read_offset, working_buf, bytes_read);
+    size_t bytes_read;
+    const uint8_t *working_buf = prv_data_source_rle_read_block(
+        prv_data_source_rle_get_backing_read_offset(), &bytes_read);
     prv_data_source_rle_read_msg_prepare(working_buf, bytes_read);
 
     // do we know what to write for the next block yet?
@@ -233,11 +348,45 @@ static bool prv_data_source_rle_read(uint32_t offset, void *buf,
   return true;
 }
 
+//! Brings the encoder to the point where the encoded stream continues from offset
+//!
+//! Encoding resumes from the closest point before the offset out of the current position and the
+//! run boundaries in the index, or from the beginning of the message if there is none.
+static bool prv_data_source_rle_seek(uint32_t offset) {
+  if ((s_ds_rle_state.total_rle_size == 0) || (offset > s_ds_rle_state.total_rle_size)) {
+    return false;
+  }
+
+  const sMemfaultDataSourceRleIndexEntry *entry = NULL;
+  for (size_t i = 0; i < s_ds_rle_cache.num_entries; i++) {
+    if (s_ds_rle_cache.entries[i].encoded_offset <= offset) {
+      entry = &s_ds_rle_cache.entries[i];
+    }
+  }
+
+  sMemfaultDataSourceRleEncodeCtx *encode_ctx = &s_ds_rle_state.encode_ctx;
+  const uint32_t entry_offset = (entry == NULL) ? 0 : entry->encoded_offset;
+  if ((offset < encode_ctx->curr_encoded_len) || (entry_offset > encode_ctx->curr_encoded_len)) {
+    prv_index_restore(entry);
+  }
+
+  // encode the rest of the way and throw the output away
+  uint8_t buf[32];
+  while (encode_ctx->curr_encoded_len != offset) {
+    const size_t bytes_to_read = MEMFAULT_MIN(sizeof(buf), offset - encode_ctx->curr_encoded_len);
+    prv_data_source_rle_read(encode_ctx->curr_encoded_len, buf, bytes_to_read);
+  }
+  return true;
+}
+
 //! Do one read pass over the data source currently saved in backing
 //! storage to compute what the total RLE size of the data we will be encoding
 static size_t prv_compute_rle_size(void) {
   sMemfaultRleCtx *rle_ctx = &s_ds_rle_state.rle_ctx;
 
+  s_ds_rle_cache = (sMemfaultDataSourceRleCache) { 0 };
+  s_ds_rle_index_spacing = MEMFAULT_DATA_SOURCE_RLE_INDEX_MIN_SPACING;
+
   size_t bytes_processed = 0;
 
   while (bytes_processed != s_ds_rle_state.original_size) {
@@ -248,6 +397,9 @@ static size_t prv_compute_rle_size(void) {
     const size_t bytes_to_read = MEMFAULT_MIN(bytes_left, working_buf_size);
     s_active_data_source->read_msg_cb(bytes_processed, working_buf,
                                       bytes_to_read);
+    if (bytes_processed == 0) {
+      s_ds_rle_cache.fingerprint = prv_compute_fingerprint(working_buf, bytes_to_read);
+    }
     prv_data_source_rle_has_more_msgs_prepare(working_buf, bytes_to_read);
     bytes_processed += bytes_to_read;
   }
@@ -255,9 +407,40 @@ static size_t prv_compute_rle_size(void) {
   s_ds_rle_state.total_rle_size = rle_ctx->total_rle_size;
 
   *rle_ctx = (sMemfaultRleCtx){0};
+
+  s_ds_rle_cache.magic = MEMFAULT_DATA_SOURCE_RLE_CACHE_MAGIC;
+  s_ds_rle_cache.original_size = (uint32_t)s_ds_rle_state.original_size;
+  s_ds_rle_cache.rle_size = (uint32_t)s_ds_rle_state.total_rle_size;
   return s_ds_rle_state.total_rle_size;
 }
 
+//! Checks whether the cache was computed for the message queued up, in which case the size &
+//! index are picked up from it. Only the start of the message needs to be read to check.
+static bool prv_load_from_cache(void) {
+  const sMemfaultDataSourceRleCache *cache = &s_ds_rle_cache;
+  if ((cache->magic != MEMFAULT_DATA_SOURCE_RLE_CACHE_MAGIC) ||
+      (cache->original_size != s_ds_rle_state.original_size)) {
+    return false;
+  }
+
+  sMemfaultDataSourceRleEncodeCtx *encode_ctx = &s_ds_rle_state.encode_ctx;
+  uint8_t *working_buf = &encode_ctx->temp_buf[0];
+  const size_t bytes_to_read = MEMFAULT_MIN(s_ds_rle_state.original_size,
+                                            sizeof(encode_ctx->temp_buf));
+  s_active_data_source->read_msg_cb(0, working_buf, bytes_to_read);
+  if (prv_compute_fingerprint(working_buf, bytes_to_read) != cache->fingerprint) {
+    return false;
+  }
+
+  // the block is where encoding starts from so keep it around
+  encode_ctx->temp_buf_offset = 0;
+  encode_ctx->temp_buf_len = (uint32_t)bytes_to_read;
+
+  s_ds_rle_state.total_rle_size = cache->rle_size;
+  prv_index_restore(NULL);
+  return true;
+}
+
 MEMFAULT_WEAK
 bool memfault_data_source_rle_read_msg(uint32_t offset, void *buf, size_t buf_len) {
   return prv_data_source_rle_read(offset, buf, buf_len);
@@ -277,12 +460,67 @@ bool memfault_data_source_rle_has_more_msgs(size_t *total_size_out) {
     return true;
   }
 
-  *total_size_out = prv_compute_rle_size();
+  *total_size_out = prv_load_from_cache() ? s_ds_rle_state.total_rle_size :
+                                             prv_compute_rle_size();
+  return true;
+}
+
+//! Computed field by field so the cache can be copied around without worrying about padding
+static uint16_t prv_cache_crc(const sMemfaultDataSourceRleCache *cache) {
+  uint16_t crc16 = MEMFAULT_CRC16_CCITT_INITIAL_VALUE;
+  crc16 = memfault_crc16_ccitt_compute(crc16, &cache->magic, sizeof(cache->magic));
+  crc16 = memfault_crc16_ccitt_compute(crc16, &cache->original_size, sizeof(cache->original_size));
+  crc16 = memfault_crc16_ccitt_compute(crc16, &cache->rle_size, sizeof(cache->rle_size));
+  crc16 = memfault_crc16_ccitt_compute(crc16, &cache->fingerprint, sizeof(cache->fingerprint));
+  crc16 = memfault_crc16_ccitt_compute(crc16, &cache->num_entries, sizeof(cache->num_entries));
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(cache->entries); i++) {
+    const sMemfaultDataSourceRleIndexEntry *entry = &cache->entries[i];
+    crc16 = memfault_crc16_ccitt_compute(crc16, &entry->encoded_offset,
+                                         sizeof(entry->encoded_offset));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &entry->curr_offset, sizeof(entry->curr_offset));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &entry->seq_start_offset,
+                                         sizeof(entry->seq_start_offset));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &entry->seq_count, sizeof(entry->seq_count));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &entry->num_repeats, sizeof(entry->num_repeats));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &entry->last_byte, sizeof(entry->last_byte));
+    crc16 = memfault_crc16_ccitt_compute(crc16, &entry->state, sizeof(entry->state));
+  }
+  return crc16;
+}
+
+void memfault_data_source_rle_get_cache(sMemfaultDataSourceRleCache *cache) {
+  if (cache == NULL) {
+    return;
+  }
+
+  if (s_ds_rle_cache.magic != MEMFAULT_DATA_SOURCE_RLE_CACHE_MAGIC) {
+    *cache = (sMemfaultDataSourceRleCache) { 0 };
+    return;
+  }
+
+  *cache = s_ds_rle_cache;
+  cache->crc16 = prv_cache_crc(cache);
+}
+
+bool memfault_data_source_rle_restore_cache(const sMemfaultDataSourceRleCache *cache) {
+  if ((cache == NULL) || (cache->magic != MEMFAULT_DATA_SOURCE_RLE_CACHE_MAGIC) ||
+      (cache->num_entries > MEMFAULT_ARRAY_SIZE(cache->entries)) ||
+      (cache->crc16 != prv_cache_crc(cache))) {
+    return false;
+  }
+
+  if (s_ds_rle_state.total_rle_size != 0) {
+    // a message is already being encoded
+    return false;
+  }
+
+  s_ds_rle_cache = *cache;
   return true;
 }
 
 void memfault_data_source_rle_mark_msg_read(void) {
   s_ds_rle_state = (sMemfaultDataSourceRleState) { 0 };
+  s_ds_rle_cache = (sMemfaultDataSourceRleCache) { 0 };
   s_active_data_source->mark_msg_read_cb();
 }
 
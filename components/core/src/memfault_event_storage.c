@@ -26,6 +26,16 @@
 #include "memfault/core/platform/system_time.h"
 #include "memfault/core/sdk_assert.h"
 #include "memfault/util/circular_buffer.h"
+#include "memfault/util/varint.h"
+
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+#include "memfault/core/serializer_helper.h"
+#include "memfault/util/lz.h"
+#endif
+
+#if MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED || MEMFAULT_EVENT_STORAGE_STATS_ENABLED
+#include "memfault/core/platform/core.h"
+#endif
 
 //
 // Routines which can optionally be implemented.
@@ -60,65 +70,613 @@ const sMemfaultNonVolatileEventStorageImpl g_memfault_platform_nv_event_storage_
 
 typedef struct {
   bool write_in_progress;
+  //! Size of the header the event will be stored with. Since the size of the event isn't known
+  //! up front, it is large enough to describe an event filling all of the free space.
+  size_t hdr_len;
   size_t bytes_written;
+  //! Set if data was appended which did not fit in storage
+  bool overflowed;
+  //! When the write began, only tracked when MEMFAULT_EVENT_STORAGE_STATS_ENABLED is set
+  uint32_t begin_time_ms;
 } sMemfaultEventStorageWriteState;
 
+//! Position of an event within the message currently being read
+typedef struct {
+  //! The index of the event within the message
+  size_t event_idx;
+  //! Offset of the event header within the circular buffer
+  size_t storage_offset;
+  //! Offset of the event payload within the message (excluding any batched event header)
+  size_t data_offset;
+} sMemfaultEventStorageReadCursor;
+
+#if (MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED != 0) && \
+    (MEMFAULT_EVENT_STORAGE_READ_BATCHING_INDEX_ENTRIES > 0)
+#define MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED 1
+#else
+#define MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED 0
+#endif
+
+#if MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED
+//! A sparse index of event positions within a batched message. An entry is recorded every
+//! "stride" events. When the index fills up, every other entry is dropped and the stride doubles
+//! so the index always spans the entire message.
+typedef struct {
+  size_t num_entries;
+  size_t stride;
+  sMemfaultEventStorageReadCursor entries[MEMFAULT_EVENT_STORAGE_READ_BATCHING_INDEX_ENTRIES];
+} sMemfaultEventStorageReadIndex;
+#endif
+
 typedef struct {
   size_t active_event_read_size;
+  //! Total size of the event payloads as they appear in the message (i.e once decompressed)
+  size_t data_size;
   size_t num_events;
   sMemfaultBatchedEventsHeader event_header;
+  //! The last event visited by a read. Sequential reads resume from here rather than walking
+  //! every event header from the start of storage.
+  sMemfaultEventStorageReadCursor cursor;
+#if MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED
+  sMemfaultEventStorageReadIndex index;
+#endif
 } sMemfaultEventStorageReadState;
 
-#define MEMFAULT_EVENT_STORAGE_WRITE_IN_PROGRESS 0xffff
+//! Tracks an event reserved via prv_event_storage_reserve() which has not been committed yet
+typedef struct {
+  bool in_use;
+  //! The reservation was rolled back but the space could not be released yet because it is
+  //! followed by other events
+  bool discarded;
+  //! Position of the event header, expressed as the number of bytes written to storage since boot
+  size_t position;
+  size_t hdr_len;
+  size_t total_size;
+  eMemfaultEventStorageClass event_class;
+  //! When the event was reserved, only tracked when MEMFAULT_EVENT_STORAGE_STATS_ENABLED is set
+  uint32_t reserve_time_ms;
+} sMemfaultEventStorageReservationState;
+
+#define MEMFAULT_EVENT_STORAGE_EVICTION_ENABLED \
+  (MEMFAULT_EVENT_STORAGE_EVICTION_POLICY != MEMFAULT_EVENT_STORAGE_EVICTION_DROP_NEWEST)
+
+//! Events written via begin_write_cb/append_data_cb don't have a class so are recorded as traces
+#define MEMFAULT_EVENT_STORAGE_DEFAULT_CLASS kMemfaultEventStorageClass_Trace
+
+//! Each event is stored as a header followed by the payload. The header is a varint holding
+//! "(payload size << 1) | write in progress flag" followed, when eviction is enabled, by the class
+//! of the event and, when stats are enabled, by the time the event was committed (little endian
+//! milliseconds since boot). A varint can be padded (i.e 0x81 0x80 0x00 encodes 1) so a header can
+//! be rewritten in place once an event has been committed.
+#define MEMFAULT_EVENT_STORAGE_WRITE_IN_PROGRESS_FLAG 0x1
+#define MEMFAULT_EVENT_STORAGE_MAX_PAYLOAD_SIZE (UINT32_MAX >> 1)
+#if MEMFAULT_EVENT_STORAGE_EVICTION_ENABLED
+#define MEMFAULT_EVENT_STORAGE_CLASS_LEN 1
+#else
+#define MEMFAULT_EVENT_STORAGE_CLASS_LEN 0
+#endif
+#if MEMFAULT_EVENT_STORAGE_STATS_ENABLED
+#define MEMFAULT_EVENT_STORAGE_TIMESTAMP_LEN 4
+#else
+#define MEMFAULT_EVENT_STORAGE_TIMESTAMP_LEN 0
+#endif
+//! The fixed size fields following the varint
+#define MEMFAULT_EVENT_STORAGE_TRAILER_LEN \
+  (MEMFAULT_EVENT_STORAGE_CLASS_LEN + MEMFAULT_EVENT_STORAGE_TIMESTAMP_LEN)
+#define MEMFAULT_EVENT_STORAGE_MAX_HEADER_LEN \
+  (MEMFAULT_UINT32_MAX_VARINT_LENGTH + MEMFAULT_EVENT_STORAGE_TRAILER_LEN)
 
-typedef MEMFAULT_PACKED_STRUCT {
-  uint16_t total_size;
+//! A decoded event header
+typedef struct {
+  //! Size of the header within storage
+  size_t hdr_len;
+  //! Size of the header and payload within storage
+  size_t total_size;
+  bool write_in_progress;
+  eMemfaultEventStorageClass event_class;
+  //! When the event was committed, only tracked when MEMFAULT_EVENT_STORAGE_STATS_ENABLED is set
+  uint32_t stored_time_ms;
 } sMemfaultEventStorageHeader;
 
-static sMfltCircularBuffer s_event_storage;
-static sMemfaultEventStorageWriteState s_event_storage_write_state;
-static sMemfaultEventStorageReadState s_event_storage_read_state;
+//! An independent region of event storage. Each partition holds the events of the classes
+//! assigned to it so a burst of one kind of event can't crowd out another.
+typedef struct {
+  const char *name;
+  //! Bitmask of the eMemfaultEventStorageClass values stored in the partition
+  uint32_t classes;
+  sMfltCircularBuffer storage;
+  sMemfaultEventStorageWriteState write_state;
+  sMemfaultEventStorageReadState read_state;
+  sMemfaultEventStorageReservationState reservations[MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES];
+  //! Total number of bytes consumed from storage since boot. Used to locate reservations.
+  size_t bytes_consumed;
+} sMemfaultEventStoragePartition;
+
+static sMemfaultEventStoragePartition
+    s_event_storage_partitions[MEMFAULT_EVENT_STORAGE_MAX_PARTITIONS];
+static size_t s_event_storage_num_partitions;
+//! The partition the message currently being read comes from or NULL if no read is in progress
+static sMemfaultEventStoragePartition *s_event_storage_read_partition;
+//! The partition to look for a message in first. Partitions take turns so one which is always
+//! full can't starve the others.
+static size_t s_event_storage_next_read_partition;
+//! Number of events evicted since memfault_event_storage_read_eviction_count() was last called
+static uint32_t s_event_storage_eviction_counts[kMemfaultEventStorageClass_NumClasses];
+
+//! @return the partition events of the given class are stored in. Classes which were not assigned
+//! to a partition are stored in the first one.
+static sMemfaultEventStoragePartition *prv_partition_for_class(
+    eMemfaultEventStorageClass event_class) {
+  for (size_t i = 0; i < s_event_storage_num_partitions; i++) {
+    sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[i];
+    if ((partition->classes & MEMFAULT_EVENT_STORAGE_CLASS_MASK(event_class)) != 0) {
+      return partition;
+    }
+  }
+  return &s_event_storage_partitions[0];
+}
+
+//! @return the size of the header needed for an event with a payload of up to payload_size bytes
+static size_t prv_header_len(size_t payload_size) {
+  uint8_t varint[MEMFAULT_UINT32_MAX_VARINT_LENGTH];
+  const uint32_t value =
+      ((uint32_t)payload_size << 1) | MEMFAULT_EVENT_STORAGE_WRITE_IN_PROGRESS_FLAG;
+  return memfault_encode_varint_u32(value, varint) + MEMFAULT_EVENT_STORAGE_TRAILER_LEN;
+}
+
+//! Encodes a header into buf, which must be hdr->hdr_len bytes long. The varint is padded to fill
+//! the header.
+static void prv_encode_header(const sMemfaultEventStorageHeader *hdr, uint8_t *buf) {
+  uint32_t value = (uint32_t)(hdr->total_size - hdr->hdr_len) << 1;
+  if (hdr->write_in_progress) {
+    value |= MEMFAULT_EVENT_STORAGE_WRITE_IN_PROGRESS_FLAG;
+  }
+
+  const size_t varint_len = hdr->hdr_len - MEMFAULT_EVENT_STORAGE_TRAILER_LEN;
+  for (size_t i = 0; i < varint_len; i++) {
+    buf[i] = (uint8_t)(value & 0x7f);
+    value >>= 7;
+    if ((i + 1) < varint_len) {
+      buf[i] |= 0x80;
+    }
+  }
+#if MEMFAULT_EVENT_STORAGE_EVICTION_ENABLED
+  buf[varint_len] = (uint8_t)hdr->event_class;
+#endif
+#if MEMFAULT_EVENT_STORAGE_STATS_ENABLED
+  uint8_t *timestamp = &buf[varint_len + MEMFAULT_EVENT_STORAGE_CLASS_LEN];
+  for (size_t i = 0; i < MEMFAULT_EVENT_STORAGE_TIMESTAMP_LEN; i++) {
+    timestamp[i] = (uint8_t)(hdr->stored_time_ms >> (8 * i));
+  }
+#endif
+}
+
+//! Decodes the header of the event starting storage_offset bytes into storage
+//!
+//! @return false if storage does not hold a complete header at that offset
+static bool prv_read_header(sMemfaultEventStoragePartition *partition, size_t storage_offset,
+                            sMemfaultEventStorageHeader *hdr) {
+  const size_t read_size = memfault_circular_buffer_get_read_size(&partition->storage);
+  if (storage_offset >= read_size) {
+    return false;
+  }
+
+  uint8_t buf[MEMFAULT_EVENT_STORAGE_MAX_HEADER_LEN];
+  const size_t buf_len = MEMFAULT_MIN(sizeof(buf), read_size - storage_offset);
+  if (!memfault_circular_buffer_read(&partition->storage, storage_offset, buf, buf_len)) {
+    return false;
+  }
+
+  uint32_t value;
+  const size_t varint_len = memfault_decode_varint_u32(buf, buf_len, &value);
+  const size_t hdr_len = varint_len + MEMFAULT_EVENT_STORAGE_TRAILER_LEN;
+  if ((varint_len == 0) || (hdr_len > buf_len)) {
+    return false;
+  }
+
+  *hdr = (sMemfaultEventStorageHeader) {
+    .hdr_len = hdr_len,
+    .total_size = hdr_len + (value >> 1),
+    .write_in_progress = ((value & MEMFAULT_EVENT_STORAGE_WRITE_IN_PROGRESS_FLAG) != 0),
+#if MEMFAULT_EVENT_STORAGE_EVICTION_ENABLED
+    .event_class = (eMemfaultEventStorageClass)buf[varint_len],
+#else
+    .event_class = MEMFAULT_EVENT_STORAGE_DEFAULT_CLASS,
+#endif
+  };
+#if MEMFAULT_EVENT_STORAGE_STATS_ENABLED
+  const uint8_t *timestamp = &buf[varint_len + MEMFAULT_EVENT_STORAGE_CLASS_LEN];
+  for (size_t i = 0; i < MEMFAULT_EVENT_STORAGE_TIMESTAMP_LEN; i++) {
+    hdr->stored_time_ms |= (uint32_t)timestamp[i] << (8 * i);
+  }
+#endif
+  return true;
+}
+
+static size_t prv_storage_end_position(const sMemfaultEventStoragePartition *partition) {
+  return partition->bytes_consumed + memfault_circular_buffer_get_read_size(&partition->storage);
+}
+
+static void prv_storage_consume(sMemfaultEventStoragePartition *partition, size_t num_bytes) {
+  if (memfault_circular_buffer_consume(&partition->storage, num_bytes)) {
+    partition->bytes_consumed += num_bytes;
+  }
+}
+
+static sMemfaultEventStorageReservationState *prv_find_reservation(
+    sMemfaultEventStoragePartition *partition, size_t position) {
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(partition->reservations); i++) {
+    sMemfaultEventStorageReservationState *reservation = &partition->reservations[i];
+    if (reservation->in_use && (reservation->position == position)) {
+      return reservation;
+    }
+  }
+  return NULL;
+}
+
+//! Releases the space held by rolled back reservations at the start of storage
+//!
+//! @note Must be called with memfault_lock() held and no read in progress
+static void prv_release_discarded_from_start(sMemfaultEventStoragePartition *partition) {
+  while (1) {
+    sMemfaultEventStorageReservationState *reservation =
+        prv_find_reservation(partition, partition->bytes_consumed);
+    if ((reservation == NULL) || !reservation->discarded) {
+      return;
+    }
+    prv_storage_consume(partition, reservation->total_size);
+    *reservation = (sMemfaultEventStorageReservationState) { 0 };
+  }
+}
+
+//! Releases the space held by rolled back reservations at the end of storage
+//!
+//! @note Must be called with memfault_lock() held
+static void prv_release_discarded_from_end(sMemfaultEventStoragePartition *partition) {
+  if (partition->write_state.write_in_progress) {
+    // the event being written starts at the current end of storage so it can't be moved. Any
+    // discarded reservations will be released once the write completes.
+    return;
+  }
+
+  bool released;
+  do {
+    released = false;
+    const size_t end_position = prv_storage_end_position(partition);
+    for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(partition->reservations); i++) {
+      sMemfaultEventStorageReservationState *reservation = &partition->reservations[i];
+      if (reservation->in_use && reservation->discarded &&
+          ((reservation->position + reservation->total_size) == end_position)) {
+        memfault_circular_buffer_consume_from_end(&partition->storage, reservation->total_size);
+        *reservation = (sMemfaultEventStorageReservationState) { 0 };
+        released = true;
+        break;
+      }
+    }
+  } while (released);
+}
+
+//! Sums up the utilization of all the partitions
+//!
+//! @note Must be called with memfault_lock() held
+static sMemfaultEventStorageInfo prv_get_info_locked(void) {
+  sMemfaultEventStorageInfo info = { 0 };
+  for (size_t i = 0; i < s_event_storage_num_partitions; i++) {
+    const sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[i];
+    info.bytes_used += memfault_circular_buffer_get_read_size(&partition->storage);
+    info.bytes_free += memfault_circular_buffer_get_write_size(&partition->storage);
+  }
+  return info;
+}
+
+#if MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED
+typedef struct {
+  //! Set once a persist has been requested. No further requests are made until
+  //! memfault_event_storage_persist() brings the usage down to the low watermark.
+  bool requested;
+  //! Set while there are events in RAM which have not been persisted
+  bool events_waiting;
+  //! When the oldest of the events waiting was stored
+  uint64_t oldest_event_time_ms;
+} sMemfaultEventStoragePersistState;
+
+static sMemfaultEventStoragePersistState s_event_storage_persist_state;
+
+static uint32_t prv_percent_used(const sMemfaultEventStorageInfo *info) {
+  const uint64_t total = (uint64_t)info->bytes_used + info->bytes_free;
+  return (total == 0) ? 0 : (uint32_t)(((uint64_t)info->bytes_used * 100) / total);
+}
+
+//! Decides whether the events waiting are worth persisting yet
+static bool prv_persist_window_check_locked(const sMemfaultEventStorageInfo *info,
+                                            uint64_t now_ms) {
+  sMemfaultEventStoragePersistState *state = &s_event_storage_persist_state;
+  if (!state->events_waiting || state->requested) {
+    return false;
+  }
+
+  const bool window_elapsed = (now_ms - state->oldest_event_time_ms) >=
+      MEMFAULT_EVENT_STORAGE_PERSIST_COALESCE_WINDOW_MS;
+  state->requested = window_elapsed ||
+      (prv_percent_used(info) >= MEMFAULT_EVENT_STORAGE_PERSIST_HIGH_WATERMARK_PERCENT);
+  return state->requested;
+}
+
+//! Decides whether a batch of events is worth persisting yet after an event has been stored
+static bool prv_persist_request_needed_locked(const sMemfaultEventStorageInfo *info) {
+  sMemfaultEventStoragePersistState *state = &s_event_storage_persist_state;
+  const uint64_t now_ms = memfault_platform_get_time_since_boot_ms();
+  if (!state->events_waiting) {
+    state->events_waiting = true;
+    state->oldest_event_time_ms = now_ms;
+  }
+  return prv_persist_window_check_locked(info, now_ms);
+}
+
+//! Re-arms persist requests once enough of the RAM storage has been drained
+static void prv_persist_complete_locked(void) {
+  const sMemfaultEventStorageInfo info = prv_get_info_locked();
+  sMemfaultEventStoragePersistState *state = &s_event_storage_persist_state;
+  if (prv_percent_used(&info) <= MEMFAULT_EVENT_STORAGE_PERSIST_LOW_WATERMARK_PERCENT) {
+    state->requested = false;
+  }
+  state->events_waiting = (info.bytes_used != 0);
+  state->oldest_event_time_ms = memfault_platform_get_time_since_boot_ms();
+}
+#else
+static bool prv_persist_request_needed_locked(
+    MEMFAULT_UNUSED const sMemfaultEventStorageInfo *info) {
+  return true;
+}
+#endif /* MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED */
+
+//! Gathers the status passed to memfault_event_storage_request_persist_callback() after an event
+//! has been stored
+//!
+//! @note Must be called with memfault_lock() held
+//!
+//! @return true if the callback should be invoked (once the lock has been released)
+static bool prv_prepare_persist_request_locked(sMemfaultEventStoragePersistCbStatus *status) {
+  *status = (sMemfaultEventStoragePersistCbStatus) {
+    .volatile_storage = prv_get_info_locked(),
+  };
+  return prv_persist_request_needed_locked(&status->volatile_storage);
+}
 
-static void prv_invoke_request_persist_callback(void) {
+void memfault_event_storage_check_persist_window(void) {
+#if MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED
   sMemfaultEventStoragePersistCbStatus status;
+  bool request_persist;
   memfault_lock();
   {
     status = (sMemfaultEventStoragePersistCbStatus) {
-      .volatile_storage = {
-        .bytes_used = memfault_circular_buffer_get_read_size(&s_event_storage),
-        .bytes_free = memfault_circular_buffer_get_write_size(&s_event_storage),
-      },
+      .volatile_storage = prv_get_info_locked(),
     };
+    request_persist = prv_persist_window_check_locked(
+        &status.volatile_storage, memfault_platform_get_time_since_boot_ms());
   }
   memfault_unlock();
 
-  memfault_event_storage_request_persist_callback(&status);
+  if (request_persist) {
+    memfault_event_storage_request_persist_callback(&status);
+  }
+#endif
+}
+
+typedef enum {
+  kMemfaultEventStorageDropReason_StorageFull,
+  kMemfaultEventStorageDropReason_WriterCollision,
+  kMemfaultEventStorageDropReason_Rollback,
+} eMemfaultEventStorageDropReason;
+
+#if MEMFAULT_EVENT_STORAGE_STATS_ENABLED
+static sMemfaultEventStorageStats s_event_storage_stats;
+
+static uint32_t prv_stats_now_ms(void) {
+  return (uint32_t)memfault_platform_get_time_since_boot_ms();
+}
+
+static void prv_stats_update_peak_locked(void) {
+  const size_t bytes_used = prv_get_info_locked().bytes_used;
+  s_event_storage_stats.peak_bytes_used =
+      MEMFAULT_MAX(s_event_storage_stats.peak_bytes_used, bytes_used);
+}
+
+static void prv_stats_record_drop_locked(eMemfaultEventStorageDropReason reason) {
+  switch (reason) {
+    case kMemfaultEventStorageDropReason_StorageFull:
+      s_event_storage_stats.drops_storage_full++;
+      break;
+    case kMemfaultEventStorageDropReason_WriterCollision:
+      s_event_storage_stats.drops_writer_collision++;
+      break;
+    case kMemfaultEventStorageDropReason_Rollback:
+    default:
+      s_event_storage_stats.drops_rollback++;
+      break;
+  }
+}
+
+//! Records an event which was committed, write_begin_ms after the write started
+static void prv_stats_record_stored_locked(uint32_t write_begin_ms, uint32_t now_ms) {
+  const uint32_t latency_ms = now_ms - write_begin_ms;
+  size_t bucket = 0;
+  uint64_t bucket_end_ms = 1;
+  while ((latency_ms >= bucket_end_ms) &&
+         ((bucket + 1) < MEMFAULT_EVENT_STORAGE_STATS_LATENCY_BUCKETS)) {
+    bucket++;
+    bucket_end_ms *= 10;
+  }
+  s_event_storage_stats.write_latency_buckets[bucket]++;
+  s_event_storage_stats.events_stored++;
+  prv_stats_update_peak_locked();
 }
 
+//! Records how long each event in the first "num_bytes" of storage, which are about to be
+//! consumed, was stored for
+static void prv_stats_record_read_locked(sMemfaultEventStoragePartition *partition,
+                                         size_t num_bytes) {
+  const uint32_t now_ms = prv_stats_now_ms();
+  size_t storage_offset = 0;
+  while (storage_offset < num_bytes) {
+    sMemfaultEventStorageHeader hdr;
+    if (!prv_read_header(partition, storage_offset, &hdr)) {
+      break;
+    }
+    const uint32_t time_in_buffer_ms = now_ms - hdr.stored_time_ms;
+    s_event_storage_stats.events_read++;
+    s_event_storage_stats.time_in_buffer_total_ms += time_in_buffer_ms;
+    s_event_storage_stats.time_in_buffer_max_ms =
+        MEMFAULT_MAX(s_event_storage_stats.time_in_buffer_max_ms, time_in_buffer_ms);
+    storage_offset += hdr.total_size;
+  }
+}
+
+static void prv_stats_reset_locked(void) {
+  s_event_storage_stats = (sMemfaultEventStorageStats) {
+    .peak_bytes_used = prv_get_info_locked().bytes_used,
+  };
+}
+#else
+static uint32_t prv_stats_now_ms(void) {
+  return 0;
+}
+
+static void prv_stats_update_peak_locked(void) { }
+
+static void prv_stats_record_drop_locked(MEMFAULT_UNUSED eMemfaultEventStorageDropReason reason) { }
+
+static void prv_stats_record_stored_locked(MEMFAULT_UNUSED uint32_t write_begin_ms,
+                                           MEMFAULT_UNUSED uint32_t now_ms) { }
+
+static void prv_stats_record_read_locked(
+    MEMFAULT_UNUSED sMemfaultEventStoragePartition *partition,
+    MEMFAULT_UNUSED size_t num_bytes) { }
+
+static void prv_stats_reset_locked(void) { }
+#endif /* MEMFAULT_EVENT_STORAGE_STATS_ENABLED */
+
 static size_t prv_get_total_event_size(sMemfaultEventStorageReadState *state) {
   if (state->num_events == 0) {
     return 0;
   }
 
-  const size_t hdr_overhead_bytes = state->num_events * sizeof(sMemfaultEventStorageHeader);
-  return (state->active_event_read_size + state->event_header.length) - hdr_overhead_bytes;
+  return state->data_size + state->event_header.length;
+}
+
+//! Layout of an event payload within storage
+typedef struct {
+  //! Size of the payload as it appears in the message
+  size_t data_size;
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+  //! Offset of the compressed stream within the payload or 0 if the event is not compressed
+  size_t lz_stream_offset;
+#endif
+} sMemfaultEventStoragePayloadInfo;
+
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+//! Compressed events start with MEMFAULT_EVENT_STORAGE_COMPRESSED_EVENT_MARKER followed by the
+//! decompressed size, encoded as a varint
+static bool prv_read_payload_info(sMemfaultEventStoragePartition *partition,
+                                  size_t storage_offset, const sMemfaultEventStorageHeader *hdr,
+                                  sMemfaultEventStoragePayloadInfo *info) {
+  const size_t payload_size = hdr->total_size - hdr->hdr_len;
+  *info = (sMemfaultEventStoragePayloadInfo) {
+    .data_size = payload_size,
+  };
+
+  uint8_t prefix[1 + MEMFAULT_UINT32_MAX_VARINT_LENGTH];
+  const size_t prefix_len = MEMFAULT_MIN(payload_size, sizeof(prefix));
+  if ((prefix_len == 0) ||
+      !memfault_circular_buffer_read(&partition->storage, storage_offset + hdr->hdr_len, prefix,
+                                     prefix_len)) {
+    return prefix_len == 0;
+  }
+
+  if (prefix[0] != MEMFAULT_EVENT_STORAGE_COMPRESSED_EVENT_MARKER) {
+    return true;
+  }
+
+  uint32_t data_size;
+  const size_t varint_len = memfault_decode_varint_u32(&prefix[1], prefix_len - 1, &data_size);
+  if (varint_len == 0) {
+    // not possible to get here unless there is corruption
+    return false;
+  }
+
+  info->data_size = data_size;
+  info->lz_stream_offset = 1 + varint_len;
+  return true;
+}
+#else
+static bool prv_read_payload_info(MEMFAULT_UNUSED sMemfaultEventStoragePartition *partition,
+                                  MEMFAULT_UNUSED size_t storage_offset,
+                                  const sMemfaultEventStorageHeader *hdr,
+                                  sMemfaultEventStoragePayloadInfo *info) {
+  *info = (sMemfaultEventStoragePayloadInfo) {
+    .data_size = hdr->total_size - hdr->hdr_len,
+  };
+  return true;
+}
+#endif /* MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED */
+
+#if MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED
+static void prv_read_index_add(sMemfaultEventStorageReadState *state, size_t storage_offset,
+                               size_t data_offset) {
+  sMemfaultEventStorageReadIndex *index = &state->index;
+  const size_t event_idx = state->num_events - 1;
+  if (index->stride == 0) {
+    index->stride = 1;
+  }
+
+  if ((event_idx % index->stride) != 0) {
+    return;
+  }
+
+  if (index->num_entries == MEMFAULT_ARRAY_SIZE(index->entries)) {
+    // out of space, keep every other entry so the index still spans all the events
+    const size_t entries_to_keep = (index->num_entries + 1) / 2;
+    for (size_t i = 0; i < entries_to_keep; i++) {
+      index->entries[i] = index->entries[i * 2];
+    }
+    index->num_entries = entries_to_keep;
+    index->stride *= 2;
+
+    if ((event_idx % index->stride) != 0) {
+      return;
+    }
+  }
+
+  index->entries[index->num_entries] = (sMemfaultEventStorageReadCursor) {
+    .event_idx = event_idx,
+    .storage_offset = storage_offset,
+    .data_offset = data_offset,
+  };
+  index->num_entries++;
 }
+#endif /* MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED */
 
 //! Walk the ram-backed event storage and determine data to read
 //!
 //! @return true if computation was successful, false otherwise
-static void prv_compute_read_state(sMemfaultEventStorageReadState *state) {
+static void prv_compute_read_state(sMemfaultEventStoragePartition *partition,
+                                   sMemfaultEventStorageReadState *state) {
   *state = (sMemfaultEventStorageReadState) { 0 };
   while (1) {
-    sMemfaultEventStorageHeader hdr = { 0 };
-    const bool success = memfault_circular_buffer_read(
-        &s_event_storage, state->active_event_read_size, &hdr, sizeof(hdr));
-    if (!success || hdr.total_size == MEMFAULT_EVENT_STORAGE_WRITE_IN_PROGRESS) {
+    sMemfaultEventStorageHeader hdr;
+    const size_t storage_offset = state->active_event_read_size;
+    if (!prv_read_header(partition, storage_offset, &hdr) || hdr.write_in_progress) {
+      break;
+    }
+
+    sMemfaultEventStoragePayloadInfo info;
+    if (!prv_read_payload_info(partition, storage_offset, &hdr, &info)) {
       break;
     }
 
     state->num_events++;
     state->active_event_read_size += hdr.total_size;
+    state->data_size += info.data_size;
 
 #if (MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED == 0)
     // if batching is disabled, only one event will be read at a time
@@ -129,8 +687,13 @@ static void prv_compute_read_state(sMemfaultEventStorageReadState *state) {
       // more bytes than desired, so don't count this event
       state->num_events--;
       state->active_event_read_size -= hdr.total_size;
+      state->data_size -= info.data_size;
       break;
     }
+
+#if MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED
+    prv_read_index_add(state, storage_offset, state->data_size - info.data_size);
+#endif
 #endif /* MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED */
   }
 
@@ -141,10 +704,12 @@ static void prv_compute_read_state(sMemfaultEventStorageReadState *state) {
 
 static bool prv_has_data_ram(size_t *total_size) {
   // Check to see if a read is already in progress and return that size if true
-  size_t curr_read_size;
+  size_t curr_read_size = 0;
   memfault_lock();
   {
-    curr_read_size = prv_get_total_event_size(&s_event_storage_read_state);
+    if (s_event_storage_read_partition != NULL) {
+      curr_read_size = prv_get_total_event_size(&s_event_storage_read_partition->read_state);
+    }
   }
   memfault_unlock();
 
@@ -153,22 +718,145 @@ static bool prv_has_data_ram(size_t *total_size) {
     return ((*total_size) != 0);
   }
 
-  // see if there are any events to read
-  sMemfaultEventStorageReadState read_state;
+  // see if there are any events to read, starting with the partition whose turn it is
   memfault_lock();
   {
-    prv_compute_read_state(&read_state);
-    s_event_storage_read_state = read_state;
+    s_event_storage_read_partition = NULL;
+    for (size_t i = 0; i < s_event_storage_num_partitions; i++) {
+      const size_t idx =
+          (s_event_storage_next_read_partition + i) % s_event_storage_num_partitions;
+      sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[idx];
+      prv_release_discarded_from_start(partition);
+      prv_compute_read_state(partition, &partition->read_state);
+      curr_read_size = prv_get_total_event_size(&partition->read_state);
+      if (curr_read_size != 0) {
+        s_event_storage_read_partition = partition;
+        break;
+      }
+    }
   }
   memfault_unlock();
 
-
-  *total_size = prv_get_total_event_size(&s_event_storage_read_state);
+  *total_size = curr_read_size;
   return ((*total_size) != 0);
 }
 
-static bool prv_event_storage_read_ram(uint32_t offset, void *buf, size_t buf_len) {
-  const size_t total_event_size = prv_get_total_event_size(&s_event_storage_read_state);
+static void prv_read_cursor_advance(sMemfaultEventStorageReadCursor *cursor,
+                                    size_t event_total_size, size_t event_data_size) {
+  cursor->event_idx++;
+  cursor->storage_offset += event_total_size;
+  cursor->data_offset += event_data_size;
+}
+
+//! @return the closest known event position at or before the requested offset. Sequential reads
+//! will always pick up from the cursor left by the previous read.
+static sMemfaultEventStorageReadCursor prv_find_read_start(
+    const sMemfaultEventStoragePartition *partition, size_t offset) {
+  sMemfaultEventStorageReadCursor start = { 0 };
+  const sMemfaultEventStorageReadCursor *cursor = &partition->read_state.cursor;
+  if (cursor->data_offset <= offset) {
+    start = *cursor;
+  }
+
+#if MEMFAULT_EVENT_STORAGE_READ_INDEX_ENABLED
+  const sMemfaultEventStorageReadIndex *index = &partition->read_state.index;
+  for (size_t i = 0; i < index->num_entries; i++) {
+    const sMemfaultEventStorageReadCursor *entry = &index->entries[i];
+    if (entry->data_offset > offset) {
+      break;
+    }
+    if (entry->event_idx > start.event_idx) {
+      start = *entry;
+    }
+  }
+#endif
+
+  return start;
+}
+
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+typedef struct {
+  //! Number of decompressed bytes to skip before copying into buf
+  size_t bytes_to_skip;
+  uint8_t *buf;
+  size_t bytes_left;
+} sMemfaultEventStorageDecompressCtx;
+
+static void prv_decompress_write_cb(void *ctx, const void *buf, size_t buf_len) {
+  sMemfaultEventStorageDecompressCtx *decompress_ctx = (sMemfaultEventStorageDecompressCtx *)ctx;
+  const uint8_t *bytes = (const uint8_t *)buf;
+
+  const size_t bytes_to_skip = MEMFAULT_MIN(buf_len, decompress_ctx->bytes_to_skip);
+  decompress_ctx->bytes_to_skip -= bytes_to_skip;
+  bytes += bytes_to_skip;
+  buf_len -= bytes_to_skip;
+
+  const size_t bytes_to_copy = MEMFAULT_MIN(buf_len, decompress_ctx->bytes_left);
+  memcpy(decompress_ctx->buf, bytes, bytes_to_copy);
+  decompress_ctx->buf += bytes_to_copy;
+  decompress_ctx->bytes_left -= bytes_to_copy;
+}
+
+//! Decompresses part of an event. The compressed stream can only be decoded from the start so
+//! everything ahead of evt_start_offset is decoded and discarded.
+static bool prv_read_compressed_event(sMemfaultEventStoragePartition *partition,
+                                      size_t storage_offset,
+                                      const sMemfaultEventStorageHeader *hdr,
+                                      const sMemfaultEventStoragePayloadInfo *info,
+                                      size_t evt_start_offset, void *buf, size_t buf_len) {
+  uint8_t window[MEMFAULT_EVENT_STORAGE_COMPRESSION_WINDOW_SIZE];
+  sMemfaultLzConfig config = {
+    .window = window,
+    .window_size = sizeof(window),
+  };
+  config.dict = memfault_serializer_helper_get_compression_dict(&config.dict_len);
+
+  sMemfaultEventStorageDecompressCtx ctx = {
+    .bytes_to_skip = evt_start_offset,
+    .buf = (uint8_t *)buf,
+    .bytes_left = buf_len,
+  };
+  sMemfaultLzDecoder decoder;
+  memfault_lz_decoder_init(&decoder, &config, prv_decompress_write_cb, &ctx);
+
+  // the compressed stream is decoded in place, straight from storage
+  const size_t stream_offset = storage_offset + hdr->hdr_len + info->lz_stream_offset;
+  sMfltCircularBufferSpan spans[2];
+  if (!memfault_circular_buffer_get_read_range(&partition->storage, stream_offset,
+                                               storage_offset + hdr->total_size - stream_offset,
+                                               spans)) {
+    return false;
+  }
+  for (size_t i = 0; (i < MEMFAULT_ARRAY_SIZE(spans)) && (ctx.bytes_left != 0); i++) {
+    if (!memfault_lz_decode(&decoder, spans[i].ptr, spans[i].len)) {
+      return false;
+    }
+  }
+
+  return ctx.bytes_left == 0;
+}
+#endif /* MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED */
+
+static bool prv_read_event(sMemfaultEventStoragePartition *partition, size_t storage_offset,
+                           const sMemfaultEventStorageHeader *hdr,
+                           const sMemfaultEventStoragePayloadInfo *info, size_t evt_start_offset,
+                           void *buf, size_t buf_len) {
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+  if (info->lz_stream_offset != 0) {
+    return prv_read_compressed_event(partition, storage_offset, hdr, info, evt_start_offset, buf,
+                                     buf_len);
+  }
+#else
+  (void)info;
+#endif
+  return memfault_circular_buffer_read(&partition->storage,
+                                       storage_offset + hdr->hdr_len + evt_start_offset, buf,
+                                       buf_len);
+}
+
+static bool prv_event_storage_read_ram_locked(sMemfaultEventStoragePartition *partition,
+                                              uint32_t offset, void *buf, size_t buf_len) {
+  const size_t total_event_size = prv_get_total_event_size(&partition->read_state);
   if ((offset + buf_len) > total_event_size) {
     return false;
   }
@@ -176,164 +864,495 @@ static bool prv_event_storage_read_ram(uint32_t offset, void *buf, size_t buf_le
   // header_length != 0 when we encode multiple events in a single read so
   // first check to see if we need to copy any of that
   uint8_t *bufp = (uint8_t *)buf;
-  if (offset < s_event_storage_read_state.event_header.length) {
+  if (offset < partition->read_state.event_header.length) {
     const size_t bytes_to_copy = MEMFAULT_MIN(
-        buf_len, s_event_storage_read_state.event_header.length - offset);
-    memcpy(bufp, &s_event_storage_read_state.event_header.data[offset], bytes_to_copy);
+        buf_len, partition->read_state.event_header.length - offset);
+    memcpy(bufp, &partition->read_state.event_header.data[offset], bytes_to_copy);
     buf_len -= bytes_to_copy;
 
     offset = 0;
     bufp += bytes_to_copy;
   } else {
-    offset -= s_event_storage_read_state.event_header.length;
+    offset -= partition->read_state.event_header.length;
   }
 
-  uint32_t curr_offset = 0;
-  uint32_t read_offset = 0;
-
+  sMemfaultEventStorageReadCursor cursor = prv_find_read_start(partition, offset);
   while (buf_len > 0) {
-    sMemfaultEventStorageHeader hdr = { 0 };
-    const bool success = memfault_circular_buffer_read(
-        &s_event_storage, read_offset, &hdr, sizeof(hdr));
-    if (!success) {
+    sMemfaultEventStorageHeader hdr;
+    if (!prv_read_header(partition, cursor.storage_offset, &hdr)) {
       // not possible to get here unless there is corruption
       return false;
     }
 
-    read_offset += sizeof(hdr);
-    const size_t event_size = hdr.total_size - sizeof(hdr);
+    sMemfaultEventStoragePayloadInfo info;
+    if (!prv_read_payload_info(partition, cursor.storage_offset, &hdr, &info)) {
+      return false;
+    }
+    const size_t event_size = info.data_size;
 
-    if ((curr_offset + event_size) < offset) {
+    if ((cursor.data_offset + event_size) <= offset) {
       // we haven't reached the offset we were trying to read from
-      curr_offset += event_size;
-      read_offset += event_size;
+      prv_read_cursor_advance(&cursor, hdr.total_size, event_size);
       continue;
     }
 
     // offset within the event to start reading at
-    const size_t evt_start_offset = offset - curr_offset;
+    const size_t evt_start_offset = offset - cursor.data_offset;
 
     const size_t bytes_to_read = MEMFAULT_MIN(event_size - evt_start_offset, buf_len);
-    if (!memfault_circular_buffer_read(&s_event_storage, read_offset + evt_start_offset,
-                                       bufp, bytes_to_read)) {
+    if (!prv_read_event(partition, cursor.storage_offset, &hdr, &info, evt_start_offset, bufp,
+                        bytes_to_read)) {
       // not possible to get here unless there is corruption
       return false;
     }
 
     bufp += bytes_to_read;
-    curr_offset += event_size;
-    read_offset += event_size;
     buf_len -= bytes_to_read;
     offset += bytes_to_read;
+
+    if ((evt_start_offset + bytes_to_read) == event_size) {
+      prv_read_cursor_advance(&cursor, hdr.total_size, event_size);
+    }
   }
 
+  partition->read_state.cursor = cursor;
   return true;
 }
 
+static bool prv_event_storage_read_ram(uint32_t offset, void *buf, size_t buf_len) {
+  // Note: the lock is held because evicting an event can move the events being read within storage
+  bool success = false;
+  memfault_lock();
+  {
+    if (s_event_storage_read_partition != NULL) {
+      success = prv_event_storage_read_ram_locked(s_event_storage_read_partition, offset, buf,
+                                                  buf_len);
+    }
+  }
+  memfault_unlock();
+  return success;
+}
+
 static void prv_event_storage_mark_event_read_ram(void) {
-  if (s_event_storage_read_state.active_event_read_size == 0) {
+  sMemfaultEventStoragePartition *partition = s_event_storage_read_partition;
+  if ((partition == NULL) || (partition->read_state.active_event_read_size == 0)) {
     // no active event to clear
     return;
   }
 
   memfault_lock();
   {
-    memfault_circular_buffer_consume(
-        &s_event_storage, s_event_storage_read_state.active_event_read_size);
-    s_event_storage_read_state = (sMemfaultEventStorageReadState) { 0 };
+    prv_stats_record_read_locked(partition, partition->read_state.active_event_read_size);
+    prv_storage_consume(partition, partition->read_state.active_event_read_size);
+    partition->read_state = (sMemfaultEventStorageReadState) { 0 };
+
+    // the next partition gets the first chance to provide a message
+    const size_t idx = (size_t)(partition - s_event_storage_partitions);
+    s_event_storage_next_read_partition = (idx + 1) % s_event_storage_num_partitions;
+    s_event_storage_read_partition = NULL;
   }
   memfault_unlock();
 }
 
+//! Copies data into the uncommitted space past the end of storage
+//!
+//! @note Must be called with memfault_lock() held
+static bool prv_write_uncommitted(sMemfaultEventStoragePartition *partition, size_t offset,
+                                  const void *data, size_t data_len) {
+  sMfltCircularBufferSpan spans[2];
+  return memfault_circular_buffer_get_write_range(&partition->storage, offset, data_len, spans) &&
+         memfault_circular_buffer_copy_to_spans(spans, 0, data, data_len);
+}
+
 // "begin" to write event data & return the space available
+//
+// The event is assembled in the free space past the end of storage and only committed (made
+// visible to readers) by prv_event_storage_storage_finish_write()
 static size_t prv_event_storage_storage_begin_write(void) {
-  if (s_event_storage_write_state.write_in_progress) {
-    return 0;
-  }
-
-  const sMemfaultEventStorageHeader hdr = {
-    .total_size = MEMFAULT_EVENT_STORAGE_WRITE_IN_PROGRESS,
-  };
-  bool success;
+  sMemfaultEventStoragePartition *partition =
+      prv_partition_for_class(MEMFAULT_EVENT_STORAGE_DEFAULT_CLASS);
+  size_t space_available = 0;
   memfault_lock();
   {
-    success = memfault_circular_buffer_write(&s_event_storage, &hdr, sizeof(hdr));
+    const size_t write_size = memfault_circular_buffer_get_write_size(&partition->storage);
+    const size_t hdr_len =
+        prv_header_len(MEMFAULT_MIN(write_size, MEMFAULT_EVENT_STORAGE_MAX_PAYLOAD_SIZE));
+    if (partition->write_state.write_in_progress) {
+      prv_stats_record_drop_locked(kMemfaultEventStorageDropReason_WriterCollision);
+    } else if (write_size < hdr_len) {
+      prv_stats_record_drop_locked(kMemfaultEventStorageDropReason_StorageFull);
+    } else {
+      partition->write_state = (sMemfaultEventStorageWriteState) {
+        .write_in_progress = true,
+        .hdr_len = hdr_len,
+        .bytes_written = hdr_len,
+        .begin_time_ms = prv_stats_now_ms(),
+      };
+      space_available =
+          MEMFAULT_MIN(write_size - hdr_len, MEMFAULT_EVENT_STORAGE_MAX_PAYLOAD_SIZE);
+    }
   }
   memfault_unlock();
-  if (!success) {
-    return 0;
-  }
 
-  s_event_storage_write_state = (sMemfaultEventStorageWriteState) {
-    .write_in_progress = true,
-    .bytes_written = sizeof(hdr),
-  };
-
-  return memfault_circular_buffer_get_write_size(&s_event_storage);
+  return space_available;
 }
 
 static bool prv_event_storage_storage_append_data(const void *bytes, size_t num_bytes) {
+  sMemfaultEventStoragePartition *partition =
+      prv_partition_for_class(MEMFAULT_EVENT_STORAGE_DEFAULT_CLASS);
   bool success;
 
   memfault_lock();
   {
-    success = memfault_circular_buffer_write(&s_event_storage, bytes, num_bytes);
+    success = prv_write_uncommitted(partition, partition->write_state.bytes_written, bytes,
+                                    num_bytes);
+    if (!success) {
+      partition->write_state.overflowed = true;
+    }
   }
   memfault_unlock();
   if (success) {
-    s_event_storage_write_state.bytes_written += num_bytes;
+    partition->write_state.bytes_written += num_bytes;
   }
   return success;
 }
 
 static void prv_event_storage_storage_finish_write(bool rollback) {
-  if (!s_event_storage_write_state.write_in_progress) {
+  sMemfaultEventStoragePartition *partition =
+      prv_partition_for_class(MEMFAULT_EVENT_STORAGE_DEFAULT_CLASS);
+  if (!partition->write_state.write_in_progress) {
     return;
   }
 
+  sMemfaultEventStoragePersistCbStatus status;
+  bool request_persist;
   memfault_lock();
   {
     if (rollback) {
-      memfault_circular_buffer_consume_from_end(&s_event_storage,
-                                                s_event_storage_write_state.bytes_written);
+      prv_stats_record_drop_locked(partition->write_state.overflowed ?
+                                       kMemfaultEventStorageDropReason_StorageFull :
+                                       kMemfaultEventStorageDropReason_Rollback);
     } else {
+      const uint32_t now_ms = prv_stats_now_ms();
       const sMemfaultEventStorageHeader hdr = {
-        .total_size = (uint16_t)s_event_storage_write_state.bytes_written,
+        .hdr_len = partition->write_state.hdr_len,
+        .total_size = partition->write_state.bytes_written,
+        .event_class = MEMFAULT_EVENT_STORAGE_DEFAULT_CLASS,
+        .stored_time_ms = now_ms,
       };
-      memfault_circular_buffer_write_at_offset(&s_event_storage,
-                                               s_event_storage_write_state.bytes_written,
-                                               &hdr, sizeof(hdr));
+      uint8_t hdr_buf[MEMFAULT_EVENT_STORAGE_MAX_HEADER_LEN];
+      prv_encode_header(&hdr, hdr_buf);
+      prv_write_uncommitted(partition, 0, hdr_buf, hdr.hdr_len);
+      memfault_circular_buffer_commit_write(&partition->storage,
+                                            partition->write_state.bytes_written);
+      prv_stats_record_stored_locked(partition->write_state.begin_time_ms, now_ms);
+    }
+
+    // reset the write state
+    partition->write_state = (sMemfaultEventStorageWriteState) { 0 };
+    prv_release_discarded_from_end(partition);
+    request_persist = !rollback && prv_prepare_persist_request_locked(&status);
+  }
+  memfault_unlock();
+
+  if (request_persist) {
+    memfault_event_storage_request_persist_callback(&status);
+  }
+}
+
+#if MEMFAULT_EVENT_STORAGE_EVICTION_ENABLED
+//! Removes a committed event from storage. The events ahead of it are shifted forward over it and
+//! the space they used to start at is released, so the offsets of the events ahead of it, relative
+//! to the start of storage, don't change. Neither do the positions of any events after it.
+//!
+//! @note Must be called with memfault_lock() held
+static void prv_evict_event_locked(sMemfaultEventStoragePartition *partition,
+                                   size_t storage_offset, const sMemfaultEventStorageHeader *hdr) {
+  const size_t read_size = memfault_circular_buffer_get_read_size(&partition->storage);
+  uint8_t chunk[32];
+  size_t bytes_left = storage_offset;
+  while (bytes_left > 0) {
+    const size_t chunk_len = MEMFAULT_MIN(bytes_left, sizeof(chunk));
+    bytes_left -= chunk_len;
+    memfault_circular_buffer_read(&partition->storage, bytes_left, chunk, chunk_len);
+    const size_t dst_offset = bytes_left + hdr->total_size;
+    memfault_circular_buffer_write_at_offset(&partition->storage, read_size - dst_offset, chunk,
+                                             chunk_len);
+  }
+
+  prv_storage_consume(partition, hdr->total_size);
+  if (hdr->event_class < kMemfaultEventStorageClass_NumClasses) {
+    s_event_storage_eviction_counts[hdr->event_class]++;
+  }
+}
+
+//! Walks the events which can be evicted, oldest first, and evicts those whose class matches until
+//! at least "bytes_needed" bytes have been freed.
+//!
+//! @param evict_class The class of events to evict or kMemfaultEventStorageClass_NumClasses to
+//!  evict events of any class
+//! @param dry_run When true, nothing is evicted and only the space which would be freed is returned
+//!
+//! @return The number of bytes freed
+//!
+//! @note Must be called with memfault_lock() held
+static size_t prv_evict_events_locked(sMemfaultEventStoragePartition *partition,
+                                      eMemfaultEventStorageClass evict_class, size_t bytes_needed,
+                                      bool dry_run) {
+  // Events which are being read out can't be evicted
+  size_t storage_offset = partition->read_state.active_event_read_size;
+  size_t bytes_freed = 0;
+  while (bytes_freed < bytes_needed) {
+    sMemfaultEventStorageHeader hdr;
+    if (!prv_read_header(partition, storage_offset, &hdr) || hdr.write_in_progress) {
+      // Nothing at or after a reservation which hasn't been committed can be moved
+      break;
+    }
+
+    if ((evict_class != kMemfaultEventStorageClass_NumClasses) &&
+        (hdr.event_class != evict_class)) {
+      storage_offset += hdr.total_size;
+      continue;
+    }
+
+    bytes_freed += hdr.total_size;
+    if (dry_run) {
+      storage_offset += hdr.total_size;
+    } else {
+      // the next event now starts at storage_offset
+      prv_evict_event_locked(partition, storage_offset, &hdr);
+    }
+  }
+  return bytes_freed;
+}
+
+//! Evicts events, according to MEMFAULT_EVENT_STORAGE_EVICTION_POLICY, so an event of
+//! "total_size" bytes fits in the partition. Nothing is evicted if it wouldn't fit anyway.
+//!
+//! @note Must be called with memfault_lock() held
+static void prv_make_room_locked(sMemfaultEventStoragePartition *partition, size_t total_size,
+                                 eMemfaultEventStorageClass event_class) {
+  if (partition->read_state.active_event_read_size == 0) {
+    prv_release_discarded_from_start(partition);
+  }
+
+  const size_t write_size = memfault_circular_buffer_get_write_size(&partition->storage);
+  if (write_size >= total_size) {
+    return;
+  }
+  const size_t bytes_needed = total_size - write_size;
+
+#if MEMFAULT_EVENT_STORAGE_EVICTION_POLICY == MEMFAULT_EVENT_STORAGE_EVICTION_DROP_OLDEST
+  (void)event_class;
+  if (prv_evict_events_locked(partition, kMemfaultEventStorageClass_NumClasses, bytes_needed,
+                              true) >= bytes_needed) {
+    prv_evict_events_locked(partition, kMemfaultEventStorageClass_NumClasses, bytes_needed, false);
+  }
+#else
+  size_t bytes_available = 0;
+  for (int i = 0; (i < (int)event_class) && (bytes_available < bytes_needed); i++) {
+    bytes_available += prv_evict_events_locked(partition, (eMemfaultEventStorageClass)i,
+                                               bytes_needed - bytes_available, true);
+  }
+  if (bytes_available < bytes_needed) {
+    return;
+  }
+
+  size_t bytes_freed = 0;
+  for (int i = 0; (i < (int)event_class) && (bytes_freed < bytes_needed); i++) {
+    bytes_freed += prv_evict_events_locked(partition, (eMemfaultEventStorageClass)i,
+                                           bytes_needed - bytes_freed, false);
+  }
+#endif
+}
+#endif /* MEMFAULT_EVENT_STORAGE_EVICTION_ENABLED */
+
+static eMemfaultEventStorageReserveStatus prv_reserve_locked(
+    sMemfaultEventStoragePartition *partition, const sMemfaultEventStorageHeader *hdr,
+    sMemfaultEventStorageReservation *reservation) {
+  if (partition->write_state.write_in_progress) {
+    // an event of unknown size is being appended to the end of storage
+    return kMemfaultEventStorageReserveStatus_Busy;
+  }
+
+  size_t slot;
+  for (slot = 0; slot < MEMFAULT_ARRAY_SIZE(partition->reservations); slot++) {
+    if (!partition->reservations[slot].in_use) {
+      break;
+    }
+  }
+  if (slot == MEMFAULT_ARRAY_SIZE(partition->reservations)) {
+    return kMemfaultEventStorageReserveStatus_Busy;
+  }
+
+#if MEMFAULT_EVENT_STORAGE_EVICTION_ENABLED
+  prv_make_room_locked(partition, hdr->total_size, hdr->event_class);
+#endif
+
+  if (memfault_circular_buffer_get_write_size(&partition->storage) < hdr->total_size) {
+    return kMemfaultEventStorageReserveStatus_NoSpace;
+  }
+
+  const size_t position = prv_storage_end_position(partition);
+  uint8_t hdr_buf[MEMFAULT_EVENT_STORAGE_MAX_HEADER_LEN];
+  prv_encode_header(hdr, hdr_buf);
+  sMfltCircularBufferSpan spans[2];
+  if (!memfault_circular_buffer_write(&partition->storage, hdr_buf, hdr->hdr_len) ||
+      !memfault_circular_buffer_reserve(&partition->storage, hdr->total_size - hdr->hdr_len,
+                                        spans)) {
+    // not possible to get here unless there is corruption
+    return kMemfaultEventStorageReserveStatus_NoSpace;
+  }
+
+  partition->reservations[slot] = (sMemfaultEventStorageReservationState) {
+    .in_use = true,
+    .position = position,
+    .hdr_len = hdr->hdr_len,
+    .total_size = hdr->total_size,
+    .event_class = hdr->event_class,
+    .reserve_time_ms = prv_stats_now_ms(),
+  };
+  prv_stats_update_peak_locked();
+
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(spans); i++) {
+    reservation->regions[i].ptr = spans[i].ptr;
+    reservation->regions[i].len = spans[i].len;
+  }
+  const size_t partition_idx = (size_t)(partition - s_event_storage_partitions);
+  reservation->handle = (partition_idx * MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES) + slot;
+  return kMemfaultEventStorageReserveStatus_Ok;
+}
+
+static eMemfaultEventStorageReserveStatus prv_event_storage_reserve(
+    size_t num_bytes, eMemfaultEventStorageClass event_class,
+    sMemfaultEventStorageReservation *reservation) {
+  if ((reservation == NULL) || (num_bytes > MEMFAULT_EVENT_STORAGE_MAX_PAYLOAD_SIZE) ||
+      (event_class >= kMemfaultEventStorageClass_NumClasses)) {
+    return kMemfaultEventStorageReserveStatus_NoSpace;
+  }
+
+  const size_t hdr_len = prv_header_len(num_bytes);
+  const sMemfaultEventStorageHeader hdr = {
+    .hdr_len = hdr_len,
+    .total_size = hdr_len + num_bytes,
+    .write_in_progress = true,
+    .event_class = event_class,
+  };
+
+  eMemfaultEventStorageReserveStatus status;
+  memfault_lock();
+  {
+    status = prv_reserve_locked(prv_partition_for_class(event_class), &hdr, reservation);
+    if (status != kMemfaultEventStorageReserveStatus_Ok) {
+      prv_stats_record_drop_locked((status == kMemfaultEventStorageReserveStatus_Busy) ?
+                                       kMemfaultEventStorageDropReason_WriterCollision :
+                                       kMemfaultEventStorageDropReason_StorageFull);
+    }
+  }
+  memfault_unlock();
+  return status;
+}
+
+static void prv_event_storage_commit(const sMemfaultEventStorageReservation *reservation,
+                                     bool rollback) {
+  if ((reservation == NULL) ||
+      (reservation->handle >=
+       (s_event_storage_num_partitions * MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES))) {
+    return;
+  }
+
+  const size_t partition_idx = reservation->handle / MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES;
+  const size_t slot = reservation->handle % MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES;
+  sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[partition_idx];
+  sMemfaultEventStoragePersistCbStatus status;
+  bool request_persist = false;
+  memfault_lock();
+  {
+    sMemfaultEventStorageReservationState *state = &partition->reservations[slot];
+    if (state->in_use && !state->discarded) {
+      if (rollback) {
+        // The space can only be handed back if nothing was written after the reservation.
+        // Otherwise it is released once all the events ahead of it have been read.
+        state->discarded = true;
+        prv_release_discarded_from_end(partition);
+        prv_stats_record_drop_locked(kMemfaultEventStorageDropReason_Rollback);
+      } else {
+        const uint32_t now_ms = prv_stats_now_ms();
+        prv_stats_record_stored_locked(state->reserve_time_ms, now_ms);
+        const sMemfaultEventStorageHeader hdr = {
+          .hdr_len = state->hdr_len,
+          .total_size = state->total_size,
+          .event_class = state->event_class,
+          .stored_time_ms = now_ms,
+        };
+        uint8_t hdr_buf[MEMFAULT_EVENT_STORAGE_MAX_HEADER_LEN];
+        prv_encode_header(&hdr, hdr_buf);
+        const size_t offset_from_end = prv_storage_end_position(partition) - state->position;
+        memfault_circular_buffer_write_at_offset(&partition->storage, offset_from_end, hdr_buf,
+                                                 hdr.hdr_len);
+        *state = (sMemfaultEventStorageReservationState) { 0 };
+        request_persist = prv_prepare_persist_request_locked(&status);
+      }
     }
   }
   memfault_unlock();
 
-  // reset the write state
-  s_event_storage_write_state = (sMemfaultEventStorageWriteState) { 0 };
-  if (!rollback) {
-    prv_invoke_request_persist_callback();
+  if (request_persist) {
+    memfault_event_storage_request_persist_callback(&status);
   }
 }
 
 static size_t prv_get_size_cb(void) {
-  return memfault_circular_buffer_get_read_size(&s_event_storage) +
-      memfault_circular_buffer_get_write_size(&s_event_storage);
+  size_t size = 0;
+  for (size_t i = 0; i < s_event_storage_num_partitions; i++) {
+    const sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[i];
+    size += memfault_circular_buffer_get_read_size(&partition->storage) +
+        memfault_circular_buffer_get_write_size(&partition->storage);
+  }
+  return size;
 }
 
-const sMemfaultEventStorageImpl *memfault_events_storage_boot(void *buf, size_t buf_len) {
-  memfault_circular_buffer_init(&s_event_storage, buf, buf_len);
+const sMemfaultEventStorageImpl *memfault_events_storage_boot_partitions(
+    const sMemfaultEventStoragePartitionConfig *partitions, size_t num_partitions) {
+  if ((partitions == NULL) || (num_partitions == 0) ||
+      (num_partitions > MEMFAULT_EVENT_STORAGE_MAX_PARTITIONS)) {
+    return NULL;
+  }
 
-  s_event_storage_write_state = (sMemfaultEventStorageWriteState) { 0 };
-  s_event_storage_read_state = (sMemfaultEventStorageReadState) { 0 };
+  memset(s_event_storage_partitions, 0x0, sizeof(s_event_storage_partitions));
+  for (size_t i = 0; i < num_partitions; i++) {
+    sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[i];
+    partition->name = partitions[i].name;
+    partition->classes = partitions[i].classes;
+    memfault_circular_buffer_init(&partition->storage, partitions[i].buf, partitions[i].buf_len);
+  }
+  s_event_storage_num_partitions = num_partitions;
+  s_event_storage_read_partition = NULL;
+  s_event_storage_next_read_partition = 0;
+  memset(s_event_storage_eviction_counts, 0x0, sizeof(s_event_storage_eviction_counts));
+  prv_stats_reset_locked();
 
   static const sMemfaultEventStorageImpl s_event_storage_impl = {
     .begin_write_cb = &prv_event_storage_storage_begin_write,
     .append_data_cb = &prv_event_storage_storage_append_data,
     .finish_write_cb = &prv_event_storage_storage_finish_write,
     .get_storage_size_cb = &prv_get_size_cb,
+    .reserve_cb = &prv_event_storage_reserve,
+    .commit_cb = &prv_event_storage_commit,
   };
   return &s_event_storage_impl;
 }
 
+const sMemfaultEventStorageImpl *memfault_events_storage_boot(void *buf, size_t buf_len) {
+  const sMemfaultEventStoragePartitionConfig partition = {
+    .name = "events",
+    .buf = buf,
+    .buf_len = buf_len,
+    .classes = MEMFAULT_EVENT_STORAGE_ALL_CLASSES,
+  };
+  return memfault_events_storage_boot_partitions(&partition, 1);
+}
+
 static bool prv_save_event_to_persistent_storage(void) {
   size_t total_size;
   if (!prv_has_data_ram(&total_size)) {
@@ -356,7 +1375,10 @@ static bool prv_nv_event_storage_enabled(void) {
   if (s_nv_event_storage_enabled && !enabled) {
     // This shouldn't happen and is indicative of a failure in nv storage. Let's reset the read
     // state in case we were in the middle of a read() trying to copy data into nv storage.
-    s_event_storage_read_state = (sMemfaultEventStorageReadState) { 0 };
+    if (s_event_storage_read_partition != NULL) {
+      s_event_storage_read_partition->read_state = (sMemfaultEventStorageReadState) { 0 };
+      s_event_storage_read_partition = NULL;
+    }
   }
   if (enabled) {
     // if nonvolatile storage is enabled, it is a configuration error if all the
@@ -382,7 +1404,20 @@ int memfault_event_storage_persist(void) {
     events_saved++;
   }
 
-  return events_saved;
+  // commit everything which was written as a single transaction
+  const bool flushed = (events_saved == 0) ||
+                       (g_memfault_platform_nv_event_storage_impl.flush == NULL) ||
+                       g_memfault_platform_nv_event_storage_impl.flush();
+
+#if MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED
+  memfault_lock();
+  {
+    prv_persist_complete_locked();
+  }
+  memfault_unlock();
+#endif
+
+  return flushed ? events_saved : -1;
 }
 
 #if MEMFAULT_EVENT_STORAGE_NV_SUPPORT_ENABLED
@@ -394,7 +1429,22 @@ static void prv_nv_event_storage_mark_read_cb(void) {
     return;
   }
 
-  prv_invoke_request_persist_callback();
+  // Space was freed up in non-volatile storage so events in RAM which didn't fit before may fit
+  // now
+  sMemfaultEventStoragePersistCbStatus status;
+  bool request_persist;
+  memfault_lock();
+  {
+#if MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED
+    s_event_storage_persist_state.requested = false;
+#endif
+    request_persist = prv_prepare_persist_request_locked(&status);
+  }
+  memfault_unlock();
+
+  if (request_persist) {
+    memfault_event_storage_request_persist_callback(&status);
+  }
 }
 #endif /* MEMFAULT_EVENT_STORAGE_NV_SUPPORT_ENABLED */
 
@@ -435,11 +1485,84 @@ static void prv_event_storage_mark_event_read(void) {
   impl->mark_msg_read_cb();
 }
 
+//! Adds the message a batch of events is read as to the stats
+static void prv_pending_stats_add_batch(size_t batch_events, size_t batch_data_size,
+                                        size_t *num_msgs, size_t *num_bytes) {
+  if (batch_events == 0) {
+    return;
+  }
+
+  (*num_msgs)++;
+  *num_bytes += batch_data_size;
+#if (MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED != 0)
+  sMemfaultBatchedEventsHeader event_header = { 0 };
+  memfault_batched_events_build_header(batch_events, &event_header);
+  *num_bytes += event_header.length;
+#endif
+}
+
+//! Walks the event headers, which are held in RAM, and groups the events into the messages
+//! prv_compute_read_state() would read them as. Sizes are those of the events once decompressed,
+//! taken from the size recorded ahead of each compressed stream.
+static void prv_event_storage_get_pending_stats(size_t *num_msgs, size_t *num_bytes) {
+  *num_msgs = 0;
+  *num_bytes = 0;
+
+  memfault_lock();
+  {
+    for (size_t i = 0; i < s_event_storage_num_partitions; i++) {
+      sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[i];
+      size_t batch_events = 0;
+      size_t batch_data_size = 0;
+      sMemfaultEventStorageHeader hdr;
+      for (size_t storage_offset = 0; prv_read_header(partition, storage_offset, &hdr);
+           storage_offset += hdr.total_size) {
+        sMemfaultEventStoragePayloadInfo info;
+        if (hdr.write_in_progress ||
+            !prv_read_payload_info(partition, storage_offset, &hdr, &info)) {
+          // a read stops at an event which isn't complete yet
+          prv_pending_stats_add_batch(batch_events, batch_data_size, num_msgs, num_bytes);
+          batch_events = 0;
+          batch_data_size = 0;
+          continue;
+        }
+
+#if (MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED != 0)
+        const bool batch_full = (batch_events > 0) &&
+            ((batch_data_size + info.data_size) > MEMFAULT_EVENT_STORAGE_READ_BATCHING_MAX_BYTES);
+#else
+        const bool batch_full = true;
+#endif
+        if (batch_full) {
+          prv_pending_stats_add_batch(batch_events, batch_data_size, num_msgs, num_bytes);
+          batch_events = 0;
+          batch_data_size = 0;
+        }
+        batch_events++;
+        batch_data_size += info.data_size;
+      }
+      prv_pending_stats_add_batch(batch_events, batch_data_size, num_msgs, num_bytes);
+    }
+  }
+  memfault_unlock();
+
+#if MEMFAULT_EVENT_STORAGE_NV_SUPPORT_ENABLED
+  // only the next message in non-volatile storage can be looked up
+  size_t event_size;
+  if (prv_nv_event_storage_enabled() &&
+      g_memfault_platform_nv_event_storage_impl.has_event(&event_size)) {
+    (*num_msgs)++;
+    *num_bytes += event_size;
+  }
+#endif
+}
+
 //! Expose a data source for use by the Memfault Packetizer
 const sMemfaultDataSourceImpl g_memfault_event_data_source  = {
   .has_more_msgs_cb = prv_has_event,
   .read_msg_cb = prv_event_storage_read,
   .mark_msg_read_cb = prv_event_storage_mark_event_read,
+  .get_pending_stats_cb = prv_event_storage_get_pending_stats,
 };
 
 // These getters provide the information that user doesn't have. The user knows the total size
@@ -449,7 +1572,7 @@ size_t memfault_event_storage_bytes_used(void) {
 
   memfault_lock();
   {
-    bytes_used = memfault_circular_buffer_get_read_size(&s_event_storage);
+    bytes_used = prv_get_info_locked().bytes_used;
   }
   memfault_unlock();
 
@@ -461,9 +1584,77 @@ size_t memfault_event_storage_bytes_free(void) {
 
   memfault_lock();
   {
-    bytes_free = memfault_circular_buffer_get_write_size(&s_event_storage);
+    bytes_free = prv_get_info_locked().bytes_free;
   }
   memfault_unlock();
 
   return bytes_free;
 }
+
+bool memfault_event_storage_get_partition_info(const char *name,
+                                               sMemfaultEventStorageInfo *info) {
+  if ((name == NULL) || (info == NULL)) {
+    return false;
+  }
+
+  bool found = false;
+  memfault_lock();
+  {
+    for (size_t i = 0; i < s_event_storage_num_partitions; i++) {
+      const sMemfaultEventStoragePartition *partition = &s_event_storage_partitions[i];
+      if ((partition->name != NULL) && (strcmp(partition->name, name) == 0)) {
+        *info = (sMemfaultEventStorageInfo) {
+          .bytes_used = memfault_circular_buffer_get_read_size(&partition->storage),
+          .bytes_free = memfault_circular_buffer_get_write_size(&partition->storage),
+        };
+        found = true;
+        break;
+      }
+    }
+  }
+  memfault_unlock();
+
+  return found;
+}
+
+uint32_t memfault_event_storage_read_eviction_count(eMemfaultEventStorageClass event_class) {
+  if (event_class >= kMemfaultEventStorageClass_NumClasses) {
+    return 0;
+  }
+
+  uint32_t eviction_count;
+  memfault_lock();
+  {
+    eviction_count = s_event_storage_eviction_counts[event_class];
+    s_event_storage_eviction_counts[event_class] = 0;
+  }
+  memfault_unlock();
+
+  return eviction_count;
+}
+
+bool memfault_event_storage_get_stats(sMemfaultEventStorageStats *stats) {
+#if MEMFAULT_EVENT_STORAGE_STATS_ENABLED
+  if (stats == NULL) {
+    return false;
+  }
+
+  memfault_lock();
+  {
+    *stats = s_event_storage_stats;
+  }
+  memfault_unlock();
+  return true;
+#else
+  (void)stats;
+  return false;
+#endif
+}
+
+void memfault_event_storage_reset_stats(void) {
+  memfault_lock();
+  {
+    prv_stats_reset_locked();
+  }
+  memfault_unlock();
+}
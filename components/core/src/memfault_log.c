@@ -323,14 +323,17 @@ void memfault_log_save_preformatted(eMemfaultPlatformLogLevel level,
   {
     sMfltCircularBuffer *circ_bufp = &s_memfault_ram_logger.circ_buffer;
     const bool space_free = prv_try_free_space(circ_bufp, bytes_needed);
-    if (space_free) {
-        sMfltRamLogEntry entry = {
-          .len = (uint8_t)truncated_log_len,
-          .hdr = prv_build_header(level, kMemfaultLogRecordType_Preformatted),
-        };
-        memfault_circular_buffer_write(circ_bufp, &entry, sizeof(entry));
-        memfault_circular_buffer_write(circ_bufp, log, truncated_log_len);
-        log_written = true;
+    // place the entry directly in the free space of the buffer and publish it in one go
+    sMfltCircularBufferSpan spans[2];
+    if (space_free &&
+        memfault_circular_buffer_get_write_range(circ_bufp, 0, bytes_needed, spans)) {
+      const sMfltRamLogEntry entry = {
+        .len = (uint8_t)truncated_log_len,
+        .hdr = prv_build_header(level, kMemfaultLogRecordType_Preformatted),
+      };
+      memfault_circular_buffer_copy_to_spans(spans, 0, &entry, sizeof(entry));
+      memfault_circular_buffer_copy_to_spans(spans, sizeof(entry), log, truncated_log_len);
+      log_written = memfault_circular_buffer_commit_write(circ_bufp, bytes_needed);
     }
   }
   memfault_unlock();
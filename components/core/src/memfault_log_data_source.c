@@ -28,6 +28,9 @@ typedef struct {
   bool triggered;
   size_t num_logs;
   sMemfaultCurrentTime trigger_time;
+  //! The size of the message holding the logs, 0 until it has been computed. Logs can't expire
+  //! once collection has been triggered so the size doesn't change until they are sent.
+  size_t msg_size;
 } sMfltLogDataSourceCtx;
 
 static sMfltLogDataSourceCtx s_memfault_log_data_source_ctx;
@@ -155,6 +158,11 @@ static bool prv_has_logs(size_t *total_size) {
     return false;
   }
 
+  if (s_memfault_log_data_source_ctx.msg_size != 0) {
+    *total_size = s_memfault_log_data_source_ctx.msg_size;
+    return true;
+  }
+
   sMfltLogEncodingCtx ctx;
   prv_init_encoding_ctx(&ctx);
 
@@ -164,9 +172,19 @@ static bool prv_has_logs(size_t *total_size) {
   };
 
   *total_size = memfault_serializer_helper_compute_size(&ctx.encoder, prv_encode, &iter);
+  s_memfault_log_data_source_ctx.msg_size = *total_size;
   return true;
 }
 
+static void prv_logs_get_pending_stats(size_t *num_msgs, size_t *num_bytes) {
+  *num_msgs = 0;
+  *num_bytes = 0;
+  // logs are only sent once collection has been triggered and then all go in one message
+  if (prv_has_logs(num_bytes)) {
+    *num_msgs = 1;
+  }
+}
+
 typedef struct {
   uint32_t offset;
   uint8_t *buf;
@@ -250,6 +268,7 @@ const sMemfaultDataSourceImpl g_memfault_log_data_source  = {
   .has_more_msgs_cb = prv_has_logs,
   .read_msg_cb = prv_logs_read,
   .mark_msg_read_cb = prv_logs_mark_sent,
+  .get_pending_stats_cb = prv_logs_get_pending_stats,
 };
 
 void memfault_log_data_source_reset(void) {
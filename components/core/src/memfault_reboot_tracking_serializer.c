@@ -93,7 +93,7 @@ int memfault_reboot_tracking_collect_reset_info(const sMemfaultEventStorageImpl
 
   sMemfaultCborEncoder encoder = { 0 };
   const bool success = memfault_serializer_helper_encode_to_storage(
-      &encoder, impl, prv_encode_cb, &info);
+      &encoder, impl, kMemfaultEventStorageClass_Reboot, prv_encode_cb, &info);
 
   if (!success) {
     const size_t storage_max_size = impl->get_storage_size_cb();
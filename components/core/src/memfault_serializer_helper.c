@@ -9,15 +9,24 @@
 #include "memfault/core/serializer_helper.h"
 
 #include <inttypes.h>
+#include <string.h>
 
 #include "memfault/config.h"
 #include "memfault/core/compiler.h"
 #include "memfault/core/debug_log.h"
 #include "memfault/core/event_storage_implementation.h"
+#include "memfault/core/math.h"
 #include "memfault/core/platform/device_info.h"
+#include "memfault/core/platform/overrides.h"
 #include "memfault/core/platform/system_time.h"
 #include "memfault/core/serializer_key_ids.h"
 #include "memfault/util/cbor.h"
+#include "memfault/util/circular_buffer.h"
+
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+#include "memfault/util/lz.h"
+#include "memfault/util/varint.h"
+#endif
 
 #if MEMFAULT_EVENT_INCLUDE_BUILD_ID
 #include "memfault/core/build_info.h"
@@ -40,6 +49,9 @@ static uint32_t s_num_storage_drops = 0;
 //! A running sum of total messages dropped since memfault_serializer_helper_read_drop_count() was
 //! last called
 static uint32_t s_last_drop_count = 0;
+//! The number of messages dropped because too many writes to storage were in flight at once
+//! since memfault_serializer_helper_read_write_collision_count() was last called
+static uint32_t s_num_write_collisions = 0;
 
 static const sMemfaultSerializerOptions s_memfault_serializer_options = {
   .encode_device_serial = (MEMFAULT_EVENT_INCLUDE_DEVICE_SERIAL != 0),
@@ -215,7 +227,41 @@ static void prv_encoder_write_cb(void *ctx, MEMFAULT_UNUSED uint32_t offset, con
   storage_impl->append_data_cb(buf, buf_len);
 }
 
-bool memfault_serializer_helper_encode_to_storage(sMemfaultCborEncoder *encoder,
+static void prv_encoder_reservation_write_cb(void *ctx, uint32_t offset, const void *buf,
+                                             size_t buf_len) {
+  const sMemfaultEventStorageReservation *reservation =
+      (const sMemfaultEventStorageReservation *)ctx;
+  memfault_circular_buffer_copy_to_spans(reservation->regions, offset, buf, buf_len);
+}
+
+//! Serializes an event directly into a reserved region of storage. The size of the event is
+//! computed up front so no locks need to be held while the event is encoded and other tasks can
+//! record events at the same time.
+static bool prv_encode_to_reservation(sMemfaultCborEncoder *encoder,
+    const sMemfaultEventStorageImpl *storage_impl, eMemfaultEventStorageClass event_class,
+    MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx, bool *collision) {
+  const size_t event_size = memfault_serializer_helper_compute_size(encoder, encode_callback, ctx);
+
+  sMemfaultEventStorageReservation reservation;
+  const eMemfaultEventStorageReserveStatus status =
+      storage_impl->reserve_cb(event_size, event_class, &reservation);
+  if (status != kMemfaultEventStorageReserveStatus_Ok) {
+    *collision = (status == kMemfaultEventStorageReserveStatus_Busy);
+    return false;
+  }
+
+  memfault_cbor_encoder_init(encoder, prv_encoder_reservation_write_cb, &reservation, event_size);
+  // Note: The event is encoded a second time so the contents could differ (i.e a timestamp could
+  // roll over to a value that takes more bytes to encode). In that case, the event is dropped
+  const bool success = encode_callback(encoder, ctx) &&
+      (memfault_cbor_encoder_deinit(encoder) == event_size);
+
+  const bool rollback = !success;
+  storage_impl->commit_cb(&reservation, rollback);
+  return success;
+}
+
+static bool prv_encode_to_write_session(sMemfaultCborEncoder *encoder,
     const sMemfaultEventStorageImpl *storage_impl,
     MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx) {
   const size_t space_available = storage_impl->begin_write_cb();
@@ -230,29 +276,244 @@ bool memfault_serializer_helper_encode_to_storage(sMemfaultCborEncoder *encoder,
   }
   const bool rollback = !success;
   storage_impl->finish_write_cb(rollback);
+  return success;
+}
+
+static bool prv_encode_uncompressed_to_storage(sMemfaultCborEncoder *encoder,
+    const sMemfaultEventStorageImpl *storage_impl, eMemfaultEventStorageClass event_class,
+    MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx, bool *collision) {
+  return (storage_impl->reserve_cb != NULL) ?
+      prv_encode_to_reservation(encoder, storage_impl, event_class, encode_callback, ctx,
+                                collision) :
+      prv_encode_to_write_session(encoder, storage_impl, encode_callback, ctx);
+}
+
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+
+static struct {
+  bool initialized;
+  size_t len;
+  uint8_t data[MEMFAULT_EVENT_STORAGE_COMPRESSION_DICT_MAX_LEN];
+} s_compression_dict;
+
+static void prv_compression_dict_write_cb(MEMFAULT_UNUSED void *ctx, uint32_t offset,
+                                          const void *buf, size_t buf_len) {
+  memcpy(&s_compression_dict.data[offset], buf, buf_len);
+}
 
-  if (!success) {
-    if (s_num_storage_drops == 0) {
+static bool prv_encode_compression_dict(sMemfaultCborEncoder *encoder) {
+  // The content of memfault_serializer_helper_encode_metadata() which doesn't change between
+  // events. If it doesn't all fit, whatever did is used.
+  if (!memfault_serializer_helper_encode_uint32_kv_pair(
+          encoder, kMemfaultEventKey_CborSchemaVersion, MEMFAULT_CBOR_SCHEMA_VERSION_V1) ||
+      !prv_encode_device_version_info(encoder)) {
+    return false;
+  }
+
+#if MEMFAULT_EVENT_INCLUDE_BUILD_ID
+  sMemfaultBuildInfo info;
+  if (memfault_build_info_read(&info)) {
+    return memfault_serializer_helper_encode_byte_string_kv_pair(
+        encoder, kMemfaultEventKey_BuildId, info.build_id,
+        MEMFAULT_EVENT_INCLUDED_BUILD_ID_SIZE_BYTES);
+  }
+#endif
+  return true;
+}
+
+const void *memfault_serializer_helper_get_compression_dict(size_t *dict_len) {
+  memfault_lock();
+  {
+    if (!s_compression_dict.initialized) {
+      sMemfaultCborEncoder encoder;
+      memfault_cbor_encoder_init(&encoder, prv_compression_dict_write_cb, NULL,
+                                 sizeof(s_compression_dict.data));
+      prv_encode_compression_dict(&encoder);
+      s_compression_dict.len = memfault_cbor_encoder_deinit(&encoder);
+      s_compression_dict.initialized = true;
+    }
+  }
+  memfault_unlock();
+
+  *dict_len = s_compression_dict.len;
+  return s_compression_dict.data;
+}
+
+//! Where a compressed event is written to
+typedef struct {
+  const sMemfaultEventStorageImpl *storage_impl;
+  //! The space reserved for the event or NULL if it is written via begin_write_cb/append_data_cb
+  const sMemfaultEventStorageReservation *reservation;
+  size_t offset;
+} sMemfaultSerializerHelperCompressedSink;
+
+static void prv_compressed_sink_write_cb(void *ctx, const void *buf, size_t buf_len) {
+  sMemfaultSerializerHelperCompressedSink *sink = (sMemfaultSerializerHelperCompressedSink *)ctx;
+  if (sink->reservation != NULL) {
+    memfault_circular_buffer_copy_to_spans(sink->reservation->regions, sink->offset, buf,
+                                           buf_len);
+  } else {
+    sink->storage_impl->append_data_cb(buf, buf_len);
+  }
+  sink->offset += buf_len;
+}
+
+static void prv_encoder_lz_write_cb(void *ctx, MEMFAULT_UNUSED uint32_t offset, const void *buf,
+                                    size_t buf_len) {
+  memfault_lz_encode((sMemfaultLzEncoder *)ctx, buf, buf_len);
+}
+
+typedef struct {
+  size_t uncompressed_size;
+  size_t compressed_size;
+} sMemfaultSerializerHelperCompressedSize;
+
+//! Encodes an event and compresses it on the fly. If write_cb is NULL, only the sizes are computed.
+static bool prv_encode_compressed(sMemfaultCborEncoder *encoder,
+    MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx,
+    MemfaultLzWriteCallback write_cb, void *write_cb_ctx,
+    sMemfaultSerializerHelperCompressedSize *size) {
+  uint8_t window[MEMFAULT_EVENT_STORAGE_COMPRESSION_WINDOW_SIZE];
+  sMemfaultLzConfig config = {
+    .window = window,
+    .window_size = sizeof(window),
+  };
+  config.dict = memfault_serializer_helper_get_compression_dict(&config.dict_len);
+
+  sMemfaultLzEncoder lz_encoder;
+  memfault_lz_encoder_init(&lz_encoder, &config, write_cb, write_cb_ctx);
+  memfault_cbor_encoder_init(encoder, prv_encoder_lz_write_cb, &lz_encoder, SIZE_MAX);
+  const bool success = encode_callback(encoder, ctx);
+  size->uncompressed_size = memfault_cbor_encoder_deinit(encoder);
+  size->compressed_size = memfault_lz_encoder_finish(&lz_encoder);
+  return success;
+}
+
+//! Compresses an event and writes it to storage. Like the uncompressed path, the event is encoded
+//! twice: once to find out how much space it needs and a second time to write it out.
+static bool prv_encode_compressed_to_storage(sMemfaultCborEncoder *encoder,
+    const sMemfaultEventStorageImpl *storage_impl, eMemfaultEventStorageClass event_class,
+    MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx, bool *collision) {
+  sMemfaultSerializerHelperCompressedSize size;
+  if (!prv_encode_compressed(encoder, encode_callback, ctx, NULL, NULL, &size)) {
+    return false;
+  }
+
+  uint8_t hdr[1 + MEMFAULT_UINT32_MAX_VARINT_LENGTH] = {
+    MEMFAULT_EVENT_STORAGE_COMPRESSED_EVENT_MARKER,
+  };
+  const size_t hdr_len = 1 + memfault_encode_varint_u32((uint32_t)size.uncompressed_size, &hdr[1]);
+  const size_t event_size = hdr_len + size.compressed_size;
+  if (event_size >= size.uncompressed_size) {
+    // nothing to gain, store the event as is
+    return prv_encode_uncompressed_to_storage(encoder, storage_impl, event_class,
+                                              encode_callback, ctx, collision);
+  }
+
+  sMemfaultEventStorageReservation reservation;
+  sMemfaultSerializerHelperCompressedSink sink = {
+    .storage_impl = storage_impl,
+  };
+  if (storage_impl->reserve_cb != NULL) {
+    const eMemfaultEventStorageReserveStatus status =
+        storage_impl->reserve_cb(event_size, event_class, &reservation);
+    if (status != kMemfaultEventStorageReserveStatus_Ok) {
+      *collision = (status == kMemfaultEventStorageReserveStatus_Busy);
+      return false;
+    }
+    sink.reservation = &reservation;
+  } else if (storage_impl->begin_write_cb() < event_size) {
+    storage_impl->finish_write_cb(true);
+    return false;
+  }
+
+  prv_compressed_sink_write_cb(&sink, hdr, hdr_len);
+  sMemfaultSerializerHelperCompressedSize final_size;
+  // Note: if the event encodes differently the second time around, it is dropped
+  const bool success =
+      prv_encode_compressed(encoder, encode_callback, ctx, prv_compressed_sink_write_cb, &sink,
+                            &final_size) &&
+      (final_size.uncompressed_size == size.uncompressed_size) &&
+      (final_size.compressed_size == size.compressed_size);
+
+  const bool rollback = !success;
+  if (sink.reservation != NULL) {
+    storage_impl->commit_cb(&reservation, rollback);
+  } else {
+    storage_impl->finish_write_cb(rollback);
+  }
+  return success;
+}
+
+#endif /* MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED */
+
+bool memfault_serializer_helper_encode_to_storage(sMemfaultCborEncoder *encoder,
+    const sMemfaultEventStorageImpl *storage_impl, eMemfaultEventStorageClass event_class,
+    MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx) {
+  bool collision = false;
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+  const bool success = prv_encode_compressed_to_storage(encoder, storage_impl, event_class,
+                                                        encode_callback, ctx, &collision);
+#else
+  const bool success = prv_encode_uncompressed_to_storage(encoder, storage_impl, event_class,
+                                                          encode_callback, ctx, &collision);
+#endif
+
+  uint32_t num_storage_drops;
+  memfault_lock();
+  {
+    if (collision) {
+      // storage wasn't full so this is not counted against the storage drop count
+      s_num_write_collisions++;
+    } else if (!success) {
+      s_num_storage_drops++;
+    } else if (s_num_storage_drops != 0) {
+      s_last_drop_count += s_num_storage_drops;
+    }
+    num_storage_drops = s_num_storage_drops;
+    if (success) {
+      s_num_storage_drops = 0;
+    }
+  }
+  memfault_unlock();
+
+  if (collision) {
+    MEMFAULT_LOG_WARN("Event dropped, too many concurrent writes");
+  } else if (!success) {
+    if (num_storage_drops == 1) {
       MEMFAULT_LOG_ERROR("Event storage full");
     }
-    s_num_storage_drops++;
-  } else if (s_num_storage_drops != 0) {
+  } else if (num_storage_drops != 0) {
     MEMFAULT_LOG_INFO("Event saved successfully after %d drops",
-                      (int)s_num_storage_drops);
-    s_last_drop_count += s_num_storage_drops;
-    s_num_storage_drops = 0;
+                      (int)num_storage_drops);
   }
 
   return success;
 }
 
 uint32_t memfault_serializer_helper_read_drop_count(void) {
-  const uint32_t drop_count = s_last_drop_count + s_num_storage_drops;
-  s_last_drop_count = 0;
-  s_num_storage_drops = 0;
+  uint32_t drop_count;
+  memfault_lock();
+  {
+    drop_count = s_last_drop_count + s_num_storage_drops;
+    s_last_drop_count = 0;
+    s_num_storage_drops = 0;
+  }
+  memfault_unlock();
   return drop_count;
 }
 
+uint32_t memfault_serializer_helper_read_write_collision_count(void) {
+  uint32_t collision_count;
+  memfault_lock();
+  {
+    collision_count = s_num_write_collisions;
+    s_num_write_collisions = 0;
+  }
+  memfault_unlock();
+  return collision_count;
+}
+
 size_t memfault_serializer_helper_compute_size(sMemfaultCborEncoder *encoder,
     MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx) {
   memfault_cbor_encoder_size_only_init(encoder);
@@ -141,7 +141,8 @@ static int prv_trace_event_capture_from_isr(sMemfaultTraceEventInfo *trace_info)
 static int prv_trace_event_capture(sMemfaultTraceEventInfo *info) {
   sMemfaultCborEncoder encoder = { 0 };
   const bool success = memfault_serializer_helper_encode_to_storage(
-      &encoder, s_memfault_trace_event_ctx.storage_impl, prv_encode_cb, info);
+      &encoder, s_memfault_trace_event_ctx.storage_impl, kMemfaultEventStorageClass_Trace,
+      prv_encode_cb, info);
 
   if (!success) {
     return MEMFAULT_TRACE_EVENT_STORAGE_OUT_OF_SPACE;
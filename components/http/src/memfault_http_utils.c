@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "memfault/core/compiler.h"
+#include "memfault/core/data_packetizer.h"
 #include "memfault/core/platform/device_info.h"
 #include "memfault/http/http_client.h"
 
@@ -70,14 +71,15 @@ static bool prv_write_project_key_hdr(MfltHttpClientSendCb write_callback, void
   return prv_write_crlf(write_callback, ctx);
 }
 
-bool memfault_http_start_chunk_post(
-    MfltHttpClientSendCb write_callback, void *ctx, size_t content_body_length) {
+static bool prv_start_chunk_post(MfltHttpClientSendCb write_callback, void *ctx,
+                                 const char *content_type_hdr, size_t content_type_hdr_len,
+                                 size_t content_body_length) {
   // Request built will look like this:
   //  POST /api/v0/chunks/<device_serial> HTTP/1.1\r\n
   //  Host:chunks.memfault.com\r\n
   //  User-Agent: MemfaultSDK/0.4.2\r\n
   //  Memfault-Project-Key:<PROJECT_KEY>\r\n
-  //  Content-Type:application/octet-stream\r\n
+  //  Content-Type:<content type>\r\n
   //  Content-Length:<content_body_length>\r\n
   //  \r\n
 
@@ -107,9 +109,7 @@ bool memfault_http_start_chunk_post(
     return false;
   }
 
-  #define CONTENT_TYPE "Content-Type:application/octet-stream\r\n"
-  const size_t content_type_len = MEMFAULT_STATIC_STRLEN(CONTENT_TYPE);
-  if (!write_callback(CONTENT_TYPE, content_type_len, ctx)) {
+  if (!write_callback(content_type_hdr, content_type_hdr_len, ctx)) {
     return false;
   }
 
@@ -120,6 +120,77 @@ bool memfault_http_start_chunk_post(
       prv_write_crlf(write_callback, ctx);
 }
 
+bool memfault_http_start_chunk_post(
+    MfltHttpClientSendCb write_callback, void *ctx, size_t content_body_length) {
+  #define CONTENT_TYPE "Content-Type:application/octet-stream\r\n"
+  const size_t content_type_len = MEMFAULT_STATIC_STRLEN(CONTENT_TYPE);
+  return prv_start_chunk_post(write_callback, ctx, CONTENT_TYPE, content_type_len,
+                              content_body_length);
+}
+
+#define CHUNK_BATCH_BOUNDARY "mflt-chunk-batch"
+
+static bool prv_write_or_count(MfltHttpClientSendCb write_callback, void *ctx,
+                               const void *data, size_t data_len, size_t *body_len) {
+  *body_len += data_len;
+  return (write_callback == NULL) || write_callback(data, data_len, ctx);
+}
+
+//! Writes the multipart body holding the chunks in a batch, one chunk per part:
+//!  --<boundary>\r\n
+//!  Content-Length:<chunk length>\r\n
+//!  \r\n
+//!  <chunk>\r\n
+//!  ...
+//!  --<boundary>--\r\n
+//!
+//! @param write_callback When NULL, nothing is written and only the length is computed
+//! @param[out] body_len Populated with the length of the body
+static bool prv_write_chunk_batch_body(MfltHttpClientSendCb write_callback, void *ctx,
+                                       const void *batch, size_t batch_len, size_t *body_len) {
+  #define PART_DELIMITER "--" CHUNK_BATCH_BOUNDARY "\r\n"
+  #define CLOSE_DELIMITER "--" CHUNK_BATCH_BOUNDARY "--\r\n"
+
+  *body_len = 0;
+  size_t offset = 0;
+  const void *chunk;
+  size_t chunk_len;
+  while (memfault_packetizer_chunk_batch_next(batch, batch_len, &offset, &chunk, &chunk_len)) {
+    char buffer[30];
+    const size_t msg_len = (size_t)snprintf(buffer, sizeof(buffer), "Content-Length:%d\r\n\r\n",
+                                            (int)chunk_len);
+    if (!prv_write_or_count(write_callback, ctx, PART_DELIMITER,
+                            MEMFAULT_STATIC_STRLEN(PART_DELIMITER), body_len) ||
+        !prv_write_or_count(write_callback, ctx, buffer, msg_len, body_len) ||
+        !prv_write_or_count(write_callback, ctx, chunk, chunk_len, body_len) ||
+        !prv_write_or_count(write_callback, ctx, "\r\n", 2, body_len)) {
+      return false;
+    }
+  }
+
+  if ((*body_len == 0) || (offset != batch_len)) {
+    // no chunks or a malformed batch
+    return false;
+  }
+
+  return prv_write_or_count(write_callback, ctx, CLOSE_DELIMITER,
+                            MEMFAULT_STATIC_STRLEN(CLOSE_DELIMITER), body_len);
+}
+
+bool memfault_http_post_chunk_batch(MfltHttpClientSendCb write_callback, void *ctx,
+                                    const void *batch, size_t batch_len) {
+  size_t body_len;
+  if (!prv_write_chunk_batch_body(NULL, NULL, batch, batch_len, &body_len)) {
+    return false;
+  }
+
+  #define BATCH_CONTENT_TYPE "Content-Type:multipart/mixed; boundary=" CHUNK_BATCH_BOUNDARY "\r\n"
+  const size_t content_type_len = MEMFAULT_STATIC_STRLEN(BATCH_CONTENT_TYPE);
+  return prv_start_chunk_post(write_callback, ctx, BATCH_CONTENT_TYPE, content_type_len,
+                              body_len) &&
+      prv_write_chunk_batch_body(write_callback, ctx, batch, batch_len, &body_len);
+}
+
 static bool prv_write_qparam(MfltHttpClientSendCb write_callback, void *ctx,
                              const void *name, size_t name_strlen, const char *value) {
   return write_callback("&", 1, ctx) &&
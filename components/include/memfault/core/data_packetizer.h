@@ -16,6 +16,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "memfault/config.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -35,6 +37,100 @@ extern "C" {
 //! @return true if the buffer was filled, false otherwise
 bool memfault_packetizer_get_chunk(void *buf, size_t *buf_len);
 
+//! Fills buffer with as many chunks as fit
+//!
+//! This lets a backlog of small messages, such as heartbeats, go out in one transmission (i.e one
+//! radio wake-up or one HTTP request, see memfault_http_post_chunk_batch()). Each chunk is
+//! preceded by its length, encoded as a varint, so the batch can be split back into chunks with
+//! memfault_packetizer_chunk_batch_next() before being sent to the Memfault cloud.
+//!
+//! @param[out] buf The buffer to copy the batch into
+//! @param[in,out] buf_len The size of the buffer to copy data into. On return, populated with the
+//!  length of the batch
+//!
+//! @return true if at least one chunk was copied into the buffer, false otherwise
+bool memfault_packetizer_get_chunk_batch(void *buf, size_t *buf_len);
+
+//! Finds the next chunk in a batch populated by memfault_packetizer_get_chunk_batch()
+//!
+//! @param batch The batch of chunks
+//! @param batch_len The length of the batch
+//! @param[in,out] offset The offset of the next chunk within the batch. Should be 0 for the first
+//!  call and is advanced past the chunk returned.
+//! @param[out] chunk Populated with a pointer to the chunk within the batch
+//! @param[out] chunk_len Populated with the length of the chunk
+//!
+//! @return true if a chunk was found, false when the end of the batch has been reached or it is
+//!  malformed
+bool memfault_packetizer_chunk_batch_next(const void *batch, size_t batch_len, size_t *offset,
+                                          const void **chunk, size_t *chunk_len);
+
+//! Invoked when a chunk is ready to be sent
+//!
+//! The transport should start sending the chunk, or queue it up behind the chunks already being
+//! sent, and return right away. Once the chunk has been sent, the transport must give the buffer
+//! back with memfault_packetizer_async_chunk_sent(). Chunks must be sent in the order they are
+//! handed over.
+//!
+//! @param buf The chunk, which is one of the buffers from the pool
+//! @param buf_len The length of the chunk
+//! @param ctx The ctx from sMemfaultPacketizerAsyncConfig
+typedef void (*MemfaultPacketizerChunkReadyCb)(void *buf, size_t buf_len, void *ctx);
+
+typedef struct {
+  //! A pool of num_bufs buffers, each chunk_buf_len bytes long, laid out back to back
+  void *buf_pool;
+  size_t chunk_buf_len;
+  //! At most MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS
+  size_t num_bufs;
+  MemfaultPacketizerChunkReadyCb chunk_ready_cb;
+  void *ctx;
+  //! When false, a message is deleted from its data source as soon as its last chunk has been
+  //! produced, so a message whose last chunk fails to send is lost
+  //!
+  //! When true, a message is only deleted once the buffer holding its last chunk has been given
+  //! back as sent, see sPacketizerConfig.require_ack
+  bool require_ack;
+} sMemfaultPacketizerAsyncConfig;
+
+//! Sets up the asynchronous packetizer API
+//!
+//! This API is intended for transports which send data in the background, i.e using DMA. With two
+//! or more buffers, the next chunk is produced while the previous one is being sent, rather than
+//! the transport idling while memfault_packetizer_get_chunk() runs and vice versa.
+//!
+//! @note Must not be called while chunks are still in flight
+//!
+//! @return true if the configuration is valid, false otherwise
+bool memfault_packetizer_async_start(const sMemfaultPacketizerAsyncConfig *cfg);
+
+//! Produces chunks into every free buffer in the pool, in order, and hands each one over via
+//! the chunk_ready_cb
+//!
+//! Should be called from the task draining data once the asynchronous API has been started and
+//! whenever a buffer is given back.
+//!
+//! @note With sMemfaultPacketizerAsyncConfig.require_ack set, the next message on a chunk
+//!  transport channel is only started once the buffer holding the last chunk of the previous one
+//!  has been given back as sent. Chunks of different messages then only overlap with
+//!  MEMFAULT_PACKETIZER_NUM_CHANNELS > 1. Leave require_ack unset to keep every buffer busy, at
+//!  the cost of losing a message whose last chunk fails to send.
+//!
+//! @return The number of chunks handed over to the transport
+size_t memfault_packetizer_async_fill(void);
+
+//! Gives a buffer handed over via the chunk_ready_cb back to the pool
+//!
+//! Safe to call from an interrupt, i.e when a DMA transfer completes.
+//!
+//! @param buf The buffer holding the chunk
+//! @param success false if the chunk could not be sent. In that case, the chunks still queued
+//!  should be given back without being sent, also with success set to false. Once all of them
+//!  are back, the messages in flight are sent again from the start, as with
+//!  memfault_packetizer_abort(). With sMemfaultPacketizerAsyncConfig.require_ack set, that
+//!  includes any message whose last chunk was not sent.
+void memfault_packetizer_async_chunk_sent(const void *buf, bool success);
+
 typedef enum {
   //! Indicates there is no more data to be sent at this time
   kMemfaultPacketizerStatus_NoMoreData = 0,
@@ -60,6 +156,52 @@ typedef enum {
 //! underlying transport to the internet
 bool memfault_packetizer_data_available(void);
 
+typedef struct {
+  //! The bytes of chunks produced for each kind of data, including the chunk overhead
+  uint32_t coredump_bytes;
+  uint32_t event_bytes;
+  uint32_t log_bytes;
+  //! The bytes still available to send logs, which is negative when coredumps & events have used
+  //! up more than the budget. Always 0 unless MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED is set.
+  int32_t byte_budget;
+} sMemfaultPacketizerByteStats;
+
+//! Reports the bytes the packetizer produced since boot or since the last call to
+//! memfault_packetizer_reset_byte_stats()
+//!
+//! @return true if the stats were populated, false otherwise
+bool memfault_packetizer_get_byte_stats(sMemfaultPacketizerByteStats *stats);
+
+//! Starts a new accounting period, i.e at the start of a billing cycle
+void memfault_packetizer_reset_byte_stats(void);
+
+typedef struct {
+  //! The number of coredumps, events or logs waiting to be sent. With
+  //! MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED, a batch of events sent in one message counts as
+  //! one.
+  uint32_t count;
+  //! An estimate of the bytes the messages hold, before packetizer compression (RLE / LZ) &
+  //! chunk overhead. Events compressed in storage are counted at their decompressed size.
+  uint32_t bytes;
+} sMemfaultPacketizerPendingSourceStats;
+
+typedef struct {
+  sMemfaultPacketizerPendingSourceStats coredumps;
+  sMemfaultPacketizerPendingSourceStats events;
+  sMemfaultPacketizerPendingSourceStats logs;
+  uint32_t total_bytes;
+} sMemfaultPacketizerPendingStats;
+
+//! Estimates how much data is waiting to be sent, i.e to decide whether it is worth powering up
+//! a modem
+//!
+//! Unlike memfault_packetizer_begin(), this doesn't compute the size of the messages the data
+//! will be sent in so no pass is made over the data in flash. Messages already in flight are
+//! included in full.
+//!
+//! @return true if the stats were populated, false otherwise
+bool memfault_packetizer_get_pending_stats(sMemfaultPacketizerPendingStats *stats);
+
 typedef struct {
   //! When false, memfault_packetizer_get_next() will always return a single "chunk"
   //! when data is available that can be pushed directly to the Memfault cloud
@@ -73,6 +215,15 @@ typedef struct {
   //! @note In this mode, it's the API users responsibility to make sure they push the chunk data
   //! only when a kMemfaultPacketizerStatus_EndOfChunk is received
   bool enable_multi_packet_chunk;
+
+  //! When false, a message is deleted from its data source as soon as its last chunk has been
+  //! returned by memfault_packetizer_get_next()
+  //!
+  //! When true, the message is kept until the chunks have been delivered and the transport calls
+  //! memfault_packetizer_ack(). Until then, memfault_packetizer_seek() can still rewind it and
+  //! memfault_packetizer_abort() sends it again from the start. No further message is sent on
+  //! the channel of a message waiting to be acknowledged.
+  bool require_ack;
 } sPacketizerConfig;
 
 typedef struct {
@@ -125,6 +276,87 @@ eMemfaultPacketizerStatus memfault_packetizer_get_next(void *buf, size_t *buf_le
 //! entirety (i.e coredump)
 void memfault_packetizer_abort(void);
 
+//! The progress of a message in flight, see sMemfaultPacketizerCheckpoint
+typedef struct {
+  //! The type of the message, 0 if no message was in flight
+  uint8_t msg_type;
+  bool use_rle;
+  uint32_t total_size;
+  //! The offset chunks have been sent up to & the CRC16 of the message up to that offset
+  uint32_t read_offset;
+  uint16_t crc16;
+} sMemfaultPacketizerCheckpointMsg;
+
+//! A snapshot of how far the packetizer has gotten through the messages it is sending, which can
+//! be used to pick up where it left off after a reboot instead of sending those messages again
+//! from the start.
+typedef struct {
+  uint32_t magic;
+  //! Indexed by chunk transport channel
+  sMemfaultPacketizerCheckpointMsg msgs[MEMFAULT_PACKETIZER_NUM_CHANNELS];
+  //! Guards against restoring a checkpoint which was never saved or has been corrupted
+  uint16_t crc16;
+} sMemfaultPacketizerCheckpoint;
+
+//! Captures the packetizer progress so it can be restored after a reboot
+//!
+//! This should be called once the chunks returned by memfault_packetizer_get_next() have been
+//! delivered. The checkpoint can be kept in a region of RAM which is not initialized on bootup
+//! (see memfault_reboot_tracking_boot() for an example) or written to non-volatile storage.
+//!
+//! @note A chunk spanning multiple memfault_packetizer_get_next() calls (enable_multi_packet_chunk)
+//! can't be resumed part way through so messages sent that way are not checkpointed.
+//!
+//! @param[out] checkpoint Populated with the current progress
+void memfault_packetizer_get_checkpoint(sMemfaultPacketizerCheckpoint *checkpoint);
+
+//! Resumes sending the messages in a checkpoint from where they left off
+//!
+//! Must be called on bootup before memfault_packetizer_begin(). Each message is only resumed if
+//! the data source still has the same message queued up, which is verified by reading it back up
+//! to the checkpointed offset and comparing the CRC16. This is the case for data sources backed
+//! by non-volatile storage, such as coredumps. Any other message is sent again from the start.
+//!
+//! @param checkpoint A checkpoint populated by memfault_packetizer_get_checkpoint()
+//!
+//! @return true if at least one message will be resumed, false otherwise
+bool memfault_packetizer_restore_checkpoint(const sMemfaultPacketizerCheckpoint *checkpoint);
+
+//! Rewinds the message in flight on a channel so chunks are sent again from an earlier offset
+//!
+//! Over a lossy link, this lets the receiver ask for the data it missed rather than the whole
+//! message being sent again after memfault_packetizer_abort(). The offset is the one CONTINUATION
+//! chunks are tagged with, i.e the number of bytes of the message the receiver has gotten, and
+//! can be anywhere before the offset sent up to. Seeking to one of the last
+//! MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN chunk boundaries is cheapest. Otherwise the message is
+//! read back up to the offset to recompute its CRC16.
+//!
+//! @note Unless sPacketizerConfig.require_ack is set, a message is deleted from its data source
+//!   once its last chunk has been returned so it can't be rewound anymore. Chunks spanning
+//!   multiple memfault_packetizer_get_next() calls (enable_multi_packet_chunk) can't be rewound
+//!   either.
+//!
+//! @param channel_id The chunk transport channel of the message, 0 unless
+//!   MEMFAULT_PACKETIZER_NUM_CHANNELS > 1
+//! @param offset The offset to send chunks from next
+//!
+//! @return true if the next chunk for the channel starts at offset, false otherwise
+bool memfault_packetizer_seek(uint8_t channel_id, uint32_t offset);
+
+//! @param channel_id The chunk transport channel of the message
+//!
+//! @return true if every chunk of the message on the channel has been returned and it is waiting
+//!   for memfault_packetizer_ack(), false otherwise
+bool memfault_packetizer_ack_pending(uint8_t channel_id);
+
+//! Deletes a message sent with sPacketizerConfig.require_ack set from its data source once the
+//! receiver has gotten all of it, so the next message on the channel can be sent
+//!
+//! @param channel_id The chunk transport channel of the message
+//!
+//! @return true if a message was waiting to be acknowledged on the channel, false otherwise
+bool memfault_packetizer_ack(uint8_t channel_id);
+
 #ifdef __cplusplus
 }
 #endif
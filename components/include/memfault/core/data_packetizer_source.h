@@ -10,6 +10,7 @@
 //! Memfault SDK into payloads that can be sent over the transport used up to the cloud
 //!
 //! @note A data source must implement three functions which are documented in the function typedefs below
+//! and can optionally implement a fourth, MemfaultDataSourceGetPendingStatsCallback
 //!
 //! @note A weak function implementation of all the provider functions is defined within the
 //! memfault data packetizer. This way a user can easily add or remove provider functionality by
@@ -52,10 +53,30 @@ typedef bool (MemfaultDataSourceReadMessageCallback)(uint32_t offset, void *buf,
 //! a info about a new message or nothing if there are no more messages to read
 typedef void (MemfaultDataSourceMarkMessageReadCallback)(void);
 
+//! Estimate how much data is waiting to be read from the data source
+//!
+//! @note Must be cheap to call, i.e not require a pass over the data in flash. When not
+//! implemented, the packetizer falls back to MemfaultDataSourceHasMoreMessagesCallback.
+//!
+//! @param num_msgs Populated with the number of items (i.e events or logs) waiting to be read.
+//!  Items which will be read back together in one message (i.e a batch of events) count as one.
+//! @param num_bytes Populated with an estimate of the bytes they will be read back as, i.e once
+//!  decompressed. This can differ from the space they take up in storage.
+typedef void (MemfaultDataSourceGetPendingStatsCallback)(size_t *num_msgs, size_t *num_bytes);
+
+//! Check whether the message queued up was run length encoded when it was saved
+//!
+//! @return true if the message is already RLE encoded and should be sent as is
+typedef bool (MemfaultDataSourceIsRleEncodedCallback)(void);
+
 typedef struct MemfaultDataSourceImpl {
   MemfaultDataSourceHasMoreMessagesCallback *has_more_msgs_cb;
   MemfaultDataSourceReadMessageCallback *read_msg_cb;
   MemfaultDataSourceMarkMessageReadCallback *mark_msg_read_cb;
+  //! Optional, may be NULL
+  MemfaultDataSourceGetPendingStatsCallback *get_pending_stats_cb;
+  //! Optional, may be NULL if messages are never saved RLE encoded
+  MemfaultDataSourceIsRleEncodedCallback *is_rle_encoded_cb;
 } sMemfaultDataSourceImpl;
 
 //! "Coredump" data source provided as part of "panics" component
@@ -0,0 +1,44 @@
+#pragma once
+
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+
+//! A generic data source implementation that can wrap a pre-existing data source
+//! (e.g. g_memfault_coredump_data_source) and compress the stream with the LZ77 style codec in
+//! memfault/util/lz.h.
+//!
+//! Unlike RLE, which only collapses runs of the same byte, back references also pick up the
+//! pointers, small integers and repeated struct layouts which make up most of a coredump. The
+//! price is a window of MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE bytes of RAM and slower encoding.
+//!
+//! The feature is disabled by default. When MEMFAULT_DATA_SOURCE_LZ_ENABLED=1, the packetizer
+//! compresses the messages it would otherwise have RLE encoded with it instead and flags them
+//! with their own bit in the message type.
+//!
+//! @note Like the RLE data source, this is not compatible with accessing data sources
+//! asynchronously (https://mflt.io/data-to-cloud-async-mode).
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "memfault/core/data_packetizer_source.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+bool memfault_data_source_lz_encoder_set_active(const sMemfaultDataSourceImpl *active_source);
+bool memfault_data_source_lz_has_more_msgs(size_t *total_size);
+bool memfault_data_source_lz_read_msg(uint32_t offset, void *buf, size_t buf_len);
+void memfault_data_source_lz_mark_msg_read(void);
+
+extern const sMemfaultDataSourceImpl g_memfault_data_lz_source;
+
+#ifdef __cplusplus
+}
+#endif
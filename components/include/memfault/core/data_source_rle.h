@@ -21,6 +21,7 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "memfault/config.h"
 #include "memfault/core/data_packetizer_source.h"
 
 #ifdef __cplusplus
@@ -32,6 +33,54 @@ bool memfault_data_source_rle_has_more_msgs(size_t *total_size);
 bool memfault_data_source_rle_read_msg(uint32_t offset, void *buf, size_t buf_len);
 void memfault_data_source_rle_mark_msg_read(void);
 
+//! The state of the encoder at the end of a sequence in the encoded stream, from which the stream
+//! can be read without encoding the message from the beginning
+typedef struct {
+  //! The offset in the encoded stream
+  uint32_t encoded_offset;
+  //! The offset in the original message and the internals of sMemfaultRleCtx at that point
+  uint32_t curr_offset;
+  uint32_t seq_start_offset;
+  uint32_t seq_count;
+  uint32_t num_repeats;
+  uint8_t last_byte;
+  uint8_t state;
+} sMemfaultDataSourceRleIndexEntry;
+
+//! The encoded size of the message being sent and a sparse index of the run boundaries in it,
+//! computed with one pass over the message the first time it is checked for.
+//!
+//! The cache is kept across memfault_packetizer_abort() so sending the message again only
+//! reads back the start of the message to check it is the same one.
+typedef struct {
+  uint32_t magic;
+  uint32_t original_size;
+  uint32_t rle_size;
+  //! The CRC16 of the start of the message, to tell it apart from another of the same size
+  uint16_t fingerprint;
+  uint16_t num_entries;
+  sMemfaultDataSourceRleIndexEntry entries[MEMFAULT_DATA_SOURCE_RLE_INDEX_LEN];
+  //! Guards against restoring a cache which was never saved or has been corrupted
+  uint16_t crc16;
+} sMemfaultDataSourceRleCache;
+
+//! Captures the encoded size & index of the message being sent
+//!
+//! Like sMemfaultPacketizerCheckpoint, the cache can be kept in a region of RAM which is not
+//! initialized on bootup or written to non-volatile storage so the message does not need to be
+//! read twice after a reboot.
+//!
+//! @param[out] cache Populated with the cache, or zeroed if nothing has been computed yet
+void memfault_data_source_rle_get_cache(sMemfaultDataSourceRleCache *cache);
+
+//! Restores a cache populated by memfault_data_source_rle_get_cache()
+//!
+//! Must be called on bootup before any data is sent. The cache is only used if the message
+//! queued up has the same size and starts with the same data.
+//!
+//! @return true if the cache was restored, false if it is invalid
+bool memfault_data_source_rle_restore_cache(const sMemfaultDataSourceRleCache *cache);
+
 extern const sMemfaultDataSourceImpl g_memfault_data_rle_source;
 
 #ifdef __cplusplus
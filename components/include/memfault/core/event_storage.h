@@ -22,6 +22,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "memfault/config.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -54,11 +56,59 @@ typedef struct MemfaultEventStorageImpl sMemfaultEventStorageImpl;
 //!  This handle will need to be provided to modules which use the event store on initialization
 const sMemfaultEventStorageImpl *memfault_events_storage_boot(void *buf, size_t buf_len);
 
+//! The kind of event being stored. When event storage is full, the class decides which events
+//! are evicted to make room for a new one (see MEMFAULT_EVENT_STORAGE_EVICTION_POLICY). Classes
+//! are listed from lowest to highest priority.
+typedef enum MemfaultEventStorageClass {
+  kMemfaultEventStorageClass_Heartbeat = 0,
+  kMemfaultEventStorageClass_Trace,
+  kMemfaultEventStorageClass_Reboot,
+
+  kMemfaultEventStorageClass_NumClasses,
+} eMemfaultEventStorageClass;
+
 typedef struct MemfaultEventStorageInfo {
   size_t bytes_used;
   size_t bytes_free;
 } sMemfaultEventStorageInfo;
 
+//! Converts an eMemfaultEventStorageClass into a bit for sMemfaultEventStoragePartitionConfig
+#define MEMFAULT_EVENT_STORAGE_CLASS_MASK(event_class) (1u << (event_class))
+#define MEMFAULT_EVENT_STORAGE_ALL_CLASSES \
+  ((1u << kMemfaultEventStorageClass_NumClasses) - 1)
+
+typedef struct MemfaultEventStoragePartitionConfig {
+  //! Identifies the partition in memfault_event_storage_get_partition_info()
+  const char *name;
+  //! The buffer holding the events stored in the partition
+  void *buf;
+  size_t buf_len;
+  //! The classes of events stored in the partition, built with
+  //! MEMFAULT_EVENT_STORAGE_CLASS_MASK(). Each class should be assigned to at most one partition.
+  //! Classes which aren't assigned to any partition are stored in the first one.
+  uint32_t classes;
+} sMemfaultEventStoragePartitionConfig;
+
+//! Alternative to memfault_events_storage_boot() which splits event storage into independent
+//! partitions, each with its own buffer.
+//!
+//! Events are routed to a partition based on their class. A partition filling up only causes events
+//! of the classes it holds to be dropped (or evicted, see MEMFAULT_EVENT_STORAGE_EVICTION_POLICY),
+//! so a burst of trace events can't starve heartbeats, for example. Events recorded without a
+//! class are stored with trace events.
+//!
+//! All partitions are drained through g_memfault_event_data_source. When more than one partition
+//! holds events, they take turns providing the next message.
+//!
+//! @param partitions The partitions to create. The array only needs to remain valid for the
+//!  duration of the call but the buffers & names it references must stay valid
+//! @param num_partitions The number of partitions, at most MEMFAULT_EVENT_STORAGE_MAX_PARTITIONS
+//!
+//! @return a handle to the event storage implementation on success & NULL on failure. The handle
+//!  is shared by all the partitions.
+const sMemfaultEventStorageImpl *memfault_events_storage_boot_partitions(
+    const sMemfaultEventStoragePartitionConfig *partitions, size_t num_partitions);
+
 typedef struct MemfaultEventStoragePersistCbStatus {
   //! Summarizes the utilization of the RAM buffer passed in memfault_events_storage_boot()
   sMemfaultEventStorageInfo volatile_storage;
@@ -79,25 +129,88 @@ typedef struct MemfaultEventStoragePersistCbStatus {
 //!  - is consumed from non-volatile storage _and_ there are still events in
 //!    volatile storage. (i.e If non-volatile storage is full, reading events will free up space
 //!    and then events residing in RAM can be persisted into the new freed up space)
+//!  When MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED is set, it is only invoked once a batch of
+//!  events is worth persisting (see default_config.h for details).
 //!
 //! @note It is safe to call "memfault_event_storage_persist()" both synchronously and
 //!  asynchronously from this callback
 void memfault_event_storage_request_persist_callback(
     const sMemfaultEventStoragePersistCbStatus *status);
 
+//! Re-evaluates the MEMFAULT_EVENT_STORAGE_PERSIST_COALESCE_WINDOW_MS window for events waiting
+//! in RAM and invokes memfault_event_storage_request_persist_callback() once it has elapsed
+//!
+//! When MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED is set, storing an event only checks the
+//! window at that moment, so a lone event (or the last one of a burst) needs this to be called
+//! periodically. The metrics heartbeat timer calls it automatically. Applications which do not
+//! use metrics should call it from one of their own timers. It is a no-op when batching is
+//! disabled.
+void memfault_event_storage_check_persist_window(void);
+
 //! Saves events which have been collected into non-volatile storage
 //!
+//! All the events waiting in RAM are written and then committed together with the optional
+//! non-volatile storage flush() dependency.
+//!
 //! @return number of events saved or <0 for unexpected errors
 int memfault_event_storage_persist(void);
 
 //! Simple API call to retrieve the number of bytes used in the allocated event storage buffer.
+//! When event storage is split into partitions, the total across all partitions is returned.
 //! Returns zero if the storage has not been allocated.
 size_t memfault_event_storage_bytes_used(void);
 
 //! Simple API call to retrieve the number of bytes free (unused) in the allocated event storage buffer.
+//! When event storage is split into partitions, the total across all partitions is returned.
 //! Returns zero if the storage has not been allocated.
 size_t memfault_event_storage_bytes_free(void);
 
+//! Retrieves the utilization of a single partition created with
+//! memfault_events_storage_boot_partitions()
+//!
+//! @return false if there is no partition with the given name
+bool memfault_event_storage_get_partition_info(const char *name, sMemfaultEventStorageInfo *info);
+
+//! Returns the number of events of the given class which were evicted from event storage to make
+//! room for newer events since the last time this function was called.
+//!
+//! @note Events are only ever evicted when MEMFAULT_EVENT_STORAGE_EVICTION_POLICY is not
+//!  MEMFAULT_EVENT_STORAGE_EVICTION_DROP_NEWEST
+uint32_t memfault_event_storage_read_eviction_count(eMemfaultEventStorageClass event_class);
+
+//! Health statistics collected when MEMFAULT_EVENT_STORAGE_STATS_ENABLED is set. All the values
+//! cover the period since boot or since memfault_event_storage_reset_stats() was last called.
+typedef struct MemfaultEventStorageStats {
+  //! The most bytes in use across all partitions at any point, including space reserved for
+  //! events which had not been committed yet
+  size_t peak_bytes_used;
+  //! Events committed to storage
+  uint32_t events_stored;
+  //! Events dropped because there was not enough space left to store them
+  uint32_t drops_storage_full;
+  //! Events dropped because another writer was using the storage (a streaming write was in
+  //! progress or MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES events were reserved already)
+  uint32_t drops_writer_collision;
+  //! Events the writer discarded by rolling back the write
+  uint32_t drops_rollback;
+  //! Events read out (or moved to non-volatile storage) & how long they were stored before that
+  uint32_t events_read;
+  uint64_t time_in_buffer_total_ms;
+  uint32_t time_in_buffer_max_ms;
+  //! Histogram of the time between beginning a write (begin_write_cb or reserve_cb) and finishing
+  //! it. See MEMFAULT_EVENT_STORAGE_STATS_LATENCY_BUCKETS for the bucket boundaries.
+  uint32_t write_latency_buckets[MEMFAULT_EVENT_STORAGE_STATS_LATENCY_BUCKETS];
+} sMemfaultEventStorageStats;
+
+//! Retrieves the event storage health statistics
+//!
+//! @return false if MEMFAULT_EVENT_STORAGE_STATS_ENABLED is not set or stats is NULL
+bool memfault_event_storage_get_stats(sMemfaultEventStorageStats *stats);
+
+//! Starts a new statistics interval. Counters are cleared & the peak utilization restarts from
+//! the current utilization.
+void memfault_event_storage_reset_stats(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,11 +14,37 @@
 #include <stdint.h>
 
 #include "memfault/core/event_storage.h"
+#include "memfault/util/circular_buffer.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+//! The first byte of the payload of an event stored compressed (see
+//! MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED). It is followed by the decompressed size of the
+//! event, encoded as a varint, and then the LZ stream (see memfault/util/lz.h).
+//!
+//! The value is reserved in CBOR (major type 0, additional information 28) so it can never be the
+//! first byte of an uncompressed event.
+#define MEMFAULT_EVENT_STORAGE_COMPRESSED_EVENT_MARKER 0x1c
+
+//! Storage claimed for a single event via "reserve_cb"
+typedef struct MemfaultEventStorageReservation {
+  //! Where the event should be written. The second region is only used when the reservation
+  //! wraps around the end of the backing storage (regions[1].len is 0 otherwise)
+  sMfltCircularBufferSpan regions[2];
+  //! Identifies the reservation to the storage implementation
+  size_t handle;
+} sMemfaultEventStorageReservation;
+
+typedef enum {
+  kMemfaultEventStorageReserveStatus_Ok = 0,
+  //! There is not enough free space in storage to hold the event
+  kMemfaultEventStorageReserveStatus_NoSpace,
+  //! Too many writes are in flight at once
+  kMemfaultEventStorageReserveStatus_Busy,
+} eMemfaultEventStorageReserveStatus;
+
 struct MemfaultEventStorageImpl {
   //! Opens a session to begin writing a heartbeat event to storage
   //!
@@ -47,6 +73,28 @@ struct MemfaultEventStorageImpl {
 
   //! Returns the _total_ size that can be used by event storage
   size_t (*get_storage_size_cb)(void);
+
+  //! (Optional) Reserves space for an event whose size is known up front
+  //!
+  //! Unlike the begin/append/finish session above, several reservations can be outstanding at
+  //! once. The reserved regions can be populated without holding memfault_lock() and
+  //! reservations can be committed in any order. An event only becomes visible to readers once
+  //! it and all events reserved before it have been committed.
+  //!
+  //! @param num_bytes The exact size of the event to store
+  //! @param event_class The kind of event being stored. Used to pick which events to evict when
+  //!  storage is full.
+  //! @param reservation Populated with the regions to write the event to on success
+  //!
+  //! @return kMemfaultEventStorageReserveStatus_Ok if the space was reserved
+  eMemfaultEventStorageReserveStatus (*reserve_cb)(size_t num_bytes,
+                                                   eMemfaultEventStorageClass event_class,
+                                                   sMemfaultEventStorageReservation *reservation);
+
+  //! Closes a reservation opened with "reserve_cb"
+  //!
+  //! @param rollback If false, the event is committed. If true, the reserved space is discarded
+  void (*commit_cb)(const sMemfaultEventStorageReservation *reservation, bool rollback);
 };
 
 #ifdef __cplusplus
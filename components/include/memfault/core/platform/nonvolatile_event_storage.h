@@ -53,6 +53,12 @@ typedef struct MemfaultNonVolatileEventStorageImpl {
   //! @param total_size The total size of the event to save
   bool (*write)(MemfaultEventReadCallback reader_callback, size_t total_size);
 
+  //! (Optional) Invoked once "memfault_event_storage_persist" has written every event which was
+  //! waiting in RAM. An implementation which buffers writes can use this to commit the whole batch
+  //! to storage in one operation.
+  //!
+  //! @return true if all the events written are now saved, false otherwise
+  bool (*flush)(void);
 } sMemfaultNonVolatileEventStorageImpl;
 
 //! By default a weak definition of this structure is provided and the feature is disabled
@@ -53,9 +53,11 @@ typedef bool (MemfaultSerializerHelperEncodeCallback)(sMemfaultCborEncoder *enco
 //! Helper to initialize a CBOR encoder, prepare the storage for writing, call the encoder_callback
 //! to encode and write any data and finally commit the write to the storage (or rollback in case
 //! of an error).
+//! @param event_class The kind of event being encoded. Used by storage to pick which events to
+//!  evict when it is full.
 //! @return the value returned from encode_callback
 bool memfault_serializer_helper_encode_to_storage(sMemfaultCborEncoder *encoder,
-    const sMemfaultEventStorageImpl *storage_impl,
+    const sMemfaultEventStorageImpl *storage_impl, eMemfaultEventStorageClass event_class,
     MemfaultSerializerHelperEncodeCallback encode_callback, void *ctx);
 
 //! Helper to compute the size of encoding operations performed by encode_callback.
@@ -66,11 +68,25 @@ size_t memfault_serializer_helper_compute_size(
 bool memfault_serializer_helper_check_storage_size(
     const sMemfaultEventStorageImpl *storage_impl, size_t (compute_worst_case_size)(void), const char *event_type);
 
-//! Return the number of events that were dropped since last call
+//! Return the number of events that were dropped since last call because event storage was full
 //!
 //! @note Calling this function resets the counters.
 uint32_t memfault_serializer_helper_read_drop_count(void);
 
+//! Return the number of events that were dropped since last call because too many events were
+//! being written to event storage at the same time (see MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES)
+//!
+//! @note Calling this function resets the counter.
+uint32_t memfault_serializer_helper_read_write_collision_count(void);
+
+//! Returns the preset dictionary events are compressed against when
+//! MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED is set. It holds the metadata which is encoded in
+//! every event (i.e device info & build id) so it doesn't change while the firmware is running.
+//!
+//! @param[out] dict_len Populated with the length of the dictionary
+//! @return the dictionary
+const void *memfault_serializer_helper_get_compression_dict(size_t *dict_len);
+
 #ifdef __cplusplus
 }
 #endif
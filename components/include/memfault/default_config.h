@@ -83,6 +83,34 @@ extern "C" {
 #define MEMFAULT_DATA_SOURCE_RLE_ENABLED 1
 #endif
 
+//! The number of run boundaries recorded while computing the RLE size of a message. Reading the
+//! encoded message from an earlier offset (i.e after memfault_packetizer_seek()) starts from the
+//! closest boundary instead of the beginning of the message. Each entry uses 24 bytes of RAM.
+#ifndef MEMFAULT_DATA_SOURCE_RLE_INDEX_LEN
+#define MEMFAULT_DATA_SOURCE_RLE_INDEX_LEN 4
+#endif
+
+#if MEMFAULT_DATA_SOURCE_RLE_INDEX_LEN < 1
+#error "MEMFAULT_DATA_SOURCE_RLE_INDEX_LEN must be at least 1"
+#endif
+
+//! Compresses coredumps with the LZ77 style codec in memfault/util/lz.h instead of RLE. Typically
+//! yields much smaller coredumps than RLE at the cost of MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE bytes
+//! of RAM and more CPU time to encode. See memfault/core/data_source_lz.h for more details.
+#ifndef MEMFAULT_DATA_SOURCE_LZ_ENABLED
+#define MEMFAULT_DATA_SOURCE_LZ_ENABLED 0
+#endif
+
+//! How far back the LZ encoder looks for repeated data. Larger windows find more matches but
+//! encoding time grows with the window size.
+#ifndef MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE
+#define MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE 512
+#endif
+
+#if (MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE < 256) || (MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE > 2048)
+#error "MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE must be between 256 and 2048"
+#endif
+
 //! Controls default log level that will be saved to https://mflt.io/logging
 #ifndef MEMFAULT_RAM_LOGGER_DEFAULT_MIN_LOG_LEVEL
 #define MEMFAULT_RAM_LOGGER_DEFAULT_MIN_LOG_LEVEL kMemfaultPlatformLogLevel_Info
@@ -136,6 +164,128 @@ extern "C" {
 #define MEMFAULT_EVENT_STORAGE_NV_SUPPORT_ENABLED 1
 #endif
 
+//! By default, memfault_event_storage_request_persist_callback() is invoked every time an event
+//! is stored. When enabled, requests are batched up instead. A request is only made once the RAM
+//! event storage is MEMFAULT_EVENT_STORAGE_PERSIST_HIGH_WATERMARK_PERCENT full or the oldest event
+//! waiting has been there for MEMFAULT_EVENT_STORAGE_PERSIST_COALESCE_WINDOW_MS. No further
+//! requests are made until memfault_event_storage_persist() has drained the RAM event storage
+//! down to MEMFAULT_EVENT_STORAGE_PERSIST_LOW_WATERMARK_PERCENT.
+//!
+//! @note The coalescing window is checked when an event is stored and each time
+//! memfault_event_storage_check_persist_window() is called. The metrics heartbeat calls it; without
+//! metrics, call it periodically from an application timer so that a lone event is still
+//! persisted. It relies on memfault_platform_get_time_since_boot_ms().
+#ifndef MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED
+#define MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED 0
+#endif
+
+#if MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED != 0
+
+#ifndef MEMFAULT_EVENT_STORAGE_PERSIST_HIGH_WATERMARK_PERCENT
+#define MEMFAULT_EVENT_STORAGE_PERSIST_HIGH_WATERMARK_PERCENT 50
+#endif
+
+#ifndef MEMFAULT_EVENT_STORAGE_PERSIST_LOW_WATERMARK_PERCENT
+#define MEMFAULT_EVENT_STORAGE_PERSIST_LOW_WATERMARK_PERCENT 0
+#endif
+
+#ifndef MEMFAULT_EVENT_STORAGE_PERSIST_COALESCE_WINDOW_MS
+#define MEMFAULT_EVENT_STORAGE_PERSIST_COALESCE_WINDOW_MS (60 * 1000)
+#endif
+
+#endif /* MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED */
+
+//! Enables health statistics about event storage, retrieved with
+//! memfault_event_storage_get_stats(): the peak utilization, events dropped (broken down by
+//! reason), how long events sat in storage before being read out & a histogram of how long
+//! streaming writes took.
+//!
+//! @note When enabled, every event is stored with the time it was committed so 4 extra bytes of
+//! storage are used per event. The times rely on memfault_platform_get_time_since_boot_ms().
+#ifndef MEMFAULT_EVENT_STORAGE_STATS_ENABLED
+#define MEMFAULT_EVENT_STORAGE_STATS_ENABLED 0
+#endif
+
+//! The number of buckets in the write latency histogram. The first bucket counts writes which took
+//! less than 1ms, bucket N counts writes which took [10^(N-1), 10^N) ms and the last bucket counts
+//! every write slower than that.
+#ifndef MEMFAULT_EVENT_STORAGE_STATS_LATENCY_BUCKETS
+#define MEMFAULT_EVENT_STORAGE_STATS_LATENCY_BUCKETS 5
+#endif
+
+//! When enabled, the event storage statistics are recorded as built-in heartbeat metrics (see
+//! memfault/metrics/heartbeat_config.def) and reset every heartbeat interval. Requires
+//! MEMFAULT_EVENT_STORAGE_STATS_ENABLED.
+#ifndef MEMFAULT_EVENT_STORAGE_STATS_HEARTBEAT_METRICS_ENABLED
+#define MEMFAULT_EVENT_STORAGE_STATS_HEARTBEAT_METRICS_ENABLED 0
+#endif
+
+#if (MEMFAULT_EVENT_STORAGE_STATS_HEARTBEAT_METRICS_ENABLED != 0) && \
+    (MEMFAULT_EVENT_STORAGE_STATS_ENABLED == 0)
+#error "Event storage heartbeat metrics require MEMFAULT_EVENT_STORAGE_STATS_ENABLED"
+#endif
+
+//! The maximum number of events which can be reserved in event storage but not yet committed at
+//! any given time. Events are reserved when they are serialized so this bounds the number of
+//! tasks which can record an event concurrently without it being dropped.
+//!
+//! Each slot costs 3 words of RAM.
+#ifndef MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES
+#define MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES 4
+#endif
+
+//! Possible values for MEMFAULT_EVENT_STORAGE_EVICTION_POLICY
+//!
+//! DROP_NEWEST: A new event which doesn't fit in event storage is dropped
+//! DROP_OLDEST: The oldest events are evicted until the new event fits
+//! PRIORITY: Events of a lower eMemfaultEventStorageClass than the new event are evicted, lowest
+//!  class and then oldest first. An event is dropped if it doesn't fit after that.
+#define MEMFAULT_EVENT_STORAGE_EVICTION_DROP_NEWEST 0
+#define MEMFAULT_EVENT_STORAGE_EVICTION_DROP_OLDEST 1
+#define MEMFAULT_EVENT_STORAGE_EVICTION_PRIORITY 2
+
+//! What to do when an event doesn't fit in event storage. Events which are being read out or
+//! which are still being written are never evicted.
+//!
+//! With any policy other than DROP_NEWEST, one extra byte is stored per event to record its class
+//! and evicting an event moves the events stored ahead of it so it is O(bytes stored).
+#ifndef MEMFAULT_EVENT_STORAGE_EVICTION_POLICY
+#define MEMFAULT_EVENT_STORAGE_EVICTION_POLICY MEMFAULT_EVENT_STORAGE_EVICTION_DROP_NEWEST
+#endif
+
+//! The maximum number of partitions which can be passed to
+//! memfault_events_storage_boot_partitions(). Each partition costs roughly
+//! (MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES * 5) + 20 words of RAM.
+#ifndef MEMFAULT_EVENT_STORAGE_MAX_PARTITIONS
+#define MEMFAULT_EVENT_STORAGE_MAX_PARTITIONS 1
+#endif
+
+//! Compresses events before they are written to event storage so more of them fit in the buffer
+//! passed to memfault_events_storage_boot() while a device is offline. Events are decompressed
+//! again as they are read out, so the data sent is unchanged.
+//!
+//! Most of an event is the same device info & build id strings, so events are compressed against
+//! a preset dictionary holding them. Encoding an event uses roughly
+//! MEMFAULT_EVENT_STORAGE_COMPRESSION_WINDOW_SIZE + 100 bytes of stack.
+#ifndef MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED
+#define MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED 0
+#endif
+
+#if MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED != 0
+
+//! How far back, in bytes, a compressed event can refer to earlier content of the same event.
+#ifndef MEMFAULT_EVENT_STORAGE_COMPRESSION_WINDOW_SIZE
+#define MEMFAULT_EVENT_STORAGE_COMPRESSION_WINDOW_SIZE 64
+#endif
+
+//! The maximum size of the preset dictionary. It is held in RAM and built the first time an event
+//! is compressed.
+#ifndef MEMFAULT_EVENT_STORAGE_COMPRESSION_DICT_MAX_LEN
+#define MEMFAULT_EVENT_STORAGE_COMPRESSION_DICT_MAX_LEN 128
+#endif
+
+#endif /* MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED */
+
 #if MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED != 0
 
 //! When batching is enabled, controls the maximum amount of event data bytes
@@ -149,6 +299,15 @@ extern "C" {
 #define MEMFAULT_EVENT_STORAGE_READ_BATCHING_MAX_BYTES UINT32_MAX
 #endif
 
+//! Sequential reads of a batched message always resume from the last event visited. When
+//! set, a small sparse index of event offsets is also maintained so random reads (i.e a read
+//! at an offset before the last one) don't need to walk the message from the beginning.
+//!
+//! Each entry costs 3 words of RAM. By default, the index is disabled.
+#ifndef MEMFAULT_EVENT_STORAGE_READ_BATCHING_INDEX_ENTRIES
+#define MEMFAULT_EVENT_STORAGE_READ_BATCHING_INDEX_ENTRIES 0
+#endif
+
 #endif /* MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED */
 
 //! The max size of a chunk. Should be a size suitable to write to transport
@@ -157,10 +316,125 @@ extern "C" {
 #define MEMFAULT_DATA_EXPORT_CHUNK_MAX_LEN 80
 #endif
 
+//! Possible values for MEMFAULT_PACKETIZER_SCHEDULER
+//!
+//! STRICT_PRIORITY: Coredumps are sent first, then events and then logs
+//! ROUND_ROBIN: The data sources take turns, one message at a time
+//! WEIGHTED_FAIR: The data sources share the transport in proportion to their weights, by bytes
+//!  sent. A source which has been idle does not get to make up for lost time.
+#define MEMFAULT_PACKETIZER_SCHEDULER_STRICT_PRIORITY 0
+#define MEMFAULT_PACKETIZER_SCHEDULER_ROUND_ROBIN 1
+#define MEMFAULT_PACKETIZER_SCHEDULER_WEIGHTED_FAIR 2
+
+//! How the packetizer picks the data source the next message is read from. Messages are never
+//! split up so sources are only interleaved at message boundaries.
+#ifndef MEMFAULT_PACKETIZER_SCHEDULER
+#define MEMFAULT_PACKETIZER_SCHEDULER MEMFAULT_PACKETIZER_SCHEDULER_STRICT_PRIORITY
+#endif
+
+#if MEMFAULT_PACKETIZER_SCHEDULER == MEMFAULT_PACKETIZER_SCHEDULER_WEIGHTED_FAIR
+
+//! Relative share of the transport each data source gets. Must be non-zero.
+#ifndef MEMFAULT_PACKETIZER_SCHEDULER_COREDUMP_WEIGHT
+#define MEMFAULT_PACKETIZER_SCHEDULER_COREDUMP_WEIGHT 1
+#endif
+
+#ifndef MEMFAULT_PACKETIZER_SCHEDULER_EVENT_WEIGHT
+#define MEMFAULT_PACKETIZER_SCHEDULER_EVENT_WEIGHT 4
+#endif
+
+#ifndef MEMFAULT_PACKETIZER_SCHEDULER_LOG_WEIGHT
+#define MEMFAULT_PACKETIZER_SCHEDULER_LOG_WEIGHT 1
+#endif
+
+#endif /* MEMFAULT_PACKETIZER_SCHEDULER_WEIGHTED_FAIR */
+
+//! When enabled, events (i.e heartbeats & reboots) which become available while a coredump is
+//! being sent are sent right away, at the next chunk boundary, instead of waiting for the coredump
+//! to finish.
+//!
+//! @note The coredump transfer is aborted and starts over once the events have been sent. To
+//! guarantee the coredump makes progress, a coredump is only preempted once.
+#ifndef MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+#define MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP 0
+#endif
+
+//! The number of chunk transport channels the packetizer sends messages over concurrently, up to
+//! 8. Chunks from the messages in flight are interleaved one at a time so, for example, a small
+//! event is sent alongside a large coredump rather than behind it.
+//!
+//! Data sources are assigned channels in priority order: coredumps on channel 0, events on
+//! channel 1 and logs on channel 2. Sources share the last channel when there are fewer channels.
+//!
+//! @note The receiver must reassemble the chunks of each channel independently
+#ifndef MEMFAULT_PACKETIZER_NUM_CHANNELS
+#define MEMFAULT_PACKETIZER_NUM_CHANNELS 1
+#endif
+
+#if (MEMFAULT_PACKETIZER_NUM_CHANNELS < 1) || (MEMFAULT_PACKETIZER_NUM_CHANNELS > 8)
+#error "MEMFAULT_PACKETIZER_NUM_CHANNELS must be between 1 and 8"
+#endif
+
+#if (MEMFAULT_PACKETIZER_NUM_CHANNELS > 1) && MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+#error "Events never wait behind a coredump when MEMFAULT_PACKETIZER_NUM_CHANNELS > 1"
+#endif
+
+//! The maximum number of chunk buffers which can be passed to memfault_packetizer_async_start()
+#ifndef MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS
+#define MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS 2
+#endif
+
+//! When enabled, the packetizer output is rate limited by a token bucket. Logs are only sent
+//! while there is budget left. Coredumps & events are always sent but use up the budget too.
+//!
+//! @note Requires memfault_platform_get_time_since_boot_ms() to refill the bucket
+#ifndef MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED
+#define MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED 0
+#endif
+
+#if MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED
+
+//! The most bytes which can be sent in a burst. The bucket starts out full at boot.
+#ifndef MEMFAULT_PACKETIZER_BYTE_BUDGET_BURST_BYTES
+#define MEMFAULT_PACKETIZER_BYTE_BUDGET_BURST_BYTES (16 * 1024)
+#endif
+
+//! The rate at which the bucket refills. For example, a 1MB monthly data cap is roughly 1400
+//! bytes per hour.
+#ifndef MEMFAULT_PACKETIZER_BYTE_BUDGET_BYTES_PER_HOUR
+#define MEMFAULT_PACKETIZER_BYTE_BUDGET_BYTES_PER_HOUR 1024
+#endif
+
+#endif /* MEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED */
+
+//! The number of chunks per channel whose starting offset & CRC16 are remembered for
+//! memfault_packetizer_seek(). Seeking back to the start of one of these chunks doesn't require
+//! re-reading the message.
+#ifndef MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN
+#define MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN 4
+#endif
+
+#if MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN < 1
+#error "MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN must be at least 1"
+#endif
+
 #ifndef MEMFAULT_COREDUMP_COLLECT_LOG_REGIONS
 #define MEMFAULT_COREDUMP_COLLECT_LOG_REGIONS 0
 #endif
 
+//! Run length encode coredumps as they are saved rather than when they are sent
+//!
+//! Memory with repeated patterns takes up a fraction of the storage space so far larger regions
+//! can be captured before a coredump is truncated. Regions which might not fit are saved in
+//! pieces sized to the space left. The coredump is sent as it is stored, without the pass over
+//! storage needed to RLE encode it at upload time.
+//!
+//! @note The coredump can then only be read out through the Memfault packetizer. It is not
+//! supported by ports which export the raw coredump storage, such as the esp-idf port.
+#ifndef MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+#define MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE 0
+#endif
+
 #ifndef MEMFAULT_TRACE_REASON_USER_DEFS_FILE
 #define MEMFAULT_TRACE_REASON_USER_DEFS_FILE \
   "memfault_trace_reason_user_config.def"
@@ -330,6 +604,32 @@ extern "C" {
 #define MEMFAULT_CRC16_LOOKUP_TABLE_ENABLE 1
 #endif
 
+// The number of bytes the lookup table implementation processes per iteration: 1, 4 or 8
+//
+// Slicing by 4 or 8 bytes is several times faster for large buffers but costs 3 or 7 additional
+// 512 byte tables
+#ifndef MEMFAULT_CRC16_SLICE_BY
+#define MEMFAULT_CRC16_SLICE_BY 1
+#endif
+
+#if (MEMFAULT_CRC16_SLICE_BY != 1) && (MEMFAULT_CRC16_SLICE_BY != 4) && \
+    (MEMFAULT_CRC16_SLICE_BY != 8)
+#error "MEMFAULT_CRC16_SLICE_BY must be 1, 4 or 8"
+#endif
+
+#if (MEMFAULT_CRC16_SLICE_BY != 1) && !MEMFAULT_CRC16_LOOKUP_TABLE_ENABLE
+#error "MEMFAULT_CRC16_SLICE_BY requires MEMFAULT_CRC16_LOOKUP_TABLE_ENABLE"
+#endif
+
+// When the storage handed to memfault_circular_buffer_init() is a power of 2 in size, wrap
+// offsets with a mask instead of a modulo. This matters on cores without a hardware divider
+// (i.e Cortex-M0/M0+) where every modulo is a call into a software division routine.
+//
+// Disabling it saves a branch per access when a power of 2 storage size is never used
+#ifndef MEMFAULT_CIRCULAR_BUFFER_POW2_FAST_PATH_ENABLE
+#define MEMFAULT_CIRCULAR_BUFFER_POW2_FAST_PATH_ENABLE 1
+#endif
+
 //
 // Demo Configuration Options
 //
@@ -45,6 +45,20 @@ typedef bool(*MfltHttpClientSendCb)(const void *data, size_t data_len, void *ctx
 bool memfault_http_start_chunk_post(
     MfltHttpClientSendCb callback, void *ctx, size_t content_body_length);
 
+//! Sends a batch of chunks to the Memfault Chunk Endpoint in a single POST
+//!
+//! The whole request is written, with every chunk in its own part of a multipart/mixed body, so
+//! a backlog of messages only costs one HTTP round trip.
+//!
+//! @param callback The callback invoked to send post request data.
+//! @param ctx A user specific context that gets passed to 'callback' invocations.
+//! @param batch A batch of chunks populated by memfault_packetizer_get_chunk_batch()
+//! @param batch_len The length of the batch
+//!
+//! @return true if the post was successful, false otherwise
+bool memfault_http_post_chunk_batch(MfltHttpClientSendCb callback, void *ctx,
+                                    const void *batch, size_t batch_len);
+
 //! Builds the HTTP GET request to query the Memfault cloud to see if a new OTA Payload is available
 //!
 //! For more details about release management and OTA payloads in general, check out:
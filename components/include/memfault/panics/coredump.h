@@ -74,6 +74,11 @@ size_t memfault_coredump_storage_compute_size_required(void);
 //! @param total_size_out Upon returning from the function, the size of the coredump
 //! in bytes has been written to the variable.
 //! @return true when a valid coredump is present in the storage.
+//!
+//! @note With MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE, the size written is that of the RLE encoded
+//! coredump, which is stored after a 12 byte header. The coredump storage then no longer holds
+//! a coredump image which can be read from offset 0 and it can only be extracted with the
+//! Memfault packetizer.
 bool memfault_coredump_has_valid_coredump(size_t *total_size_out);
 
 //
@@ -54,6 +54,9 @@ typedef struct MfltCachedBlock {
 
 //! Computes the amount of space that will be required to save a coredump
 //!
+//! @note With MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE, this is the encoded size of the memory as it
+//!   is at the time of the call so it is only an estimate of the space a coredump will take up
+//!
 //! @param save_info The platform specific information to save as part of the coredump
 //! @return The space required to save the coredump or 0 on error
 size_t memfault_coredump_get_save_size(const sMemfaultCoredumpSaveInfo *save_info);
@@ -0,0 +1,152 @@
+#pragma once
+
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! Reassembles the messages chunked up by memfault_chunk_transport_get_next_chunk(). Intended for
+//! gateways (i.e a Linux host relaying chunks from many BLE devices) which want to validate
+//! and inspect messages before forwarding them.
+//!
+//! Chunks are fed in per device. Each device has one message in flight per chunk transport
+//! channel and the CRC16 is checked as the chunks come in. Retransmitted chunks are recognized as
+//! duplicates and a missing chunk drops the message in flight.
+//!
+//! All the memory used is passed in by the caller at init time, which bounds the memory used per
+//! device. When every device slot is in use, the device which was active least recently is evicted
+//! to make room for a new one.
+//!
+//! Note: a reassembler does not have any locking. To process chunks on several threads, create
+//! one reassembler per thread and route each device to a thread with
+//! memfault_chunk_reassembler_get_shard().
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+  //! The chunk was added to the message in flight. More chunks are needed to complete it.
+  kMfltChunkReassemblerStatus_MoreData = 0,
+  //! The chunk completed a message and its CRC matched
+  kMfltChunkReassemblerStatus_MsgComplete,
+  //! The chunk has been received before and was ignored
+  kMfltChunkReassemblerStatus_Duplicate,
+  //! One or more chunks were missed. The message in flight was dropped.
+  kMfltChunkReassemblerStatus_Gap,
+  //! The chunk completed a message but the CRC did not match. The message was dropped.
+  kMfltChunkReassemblerStatus_CrcMismatch,
+  //! The message is larger than max_msg_size and was dropped
+  kMfltChunkReassemblerStatus_MsgTooLarge,
+  //! The chunk could not be decoded or uses a channel beyond num_channels
+  kMfltChunkReassemblerStatus_Malformed,
+} eMfltChunkReassemblerStatus;
+
+typedef struct {
+  //! The maximum number of devices chunks are reassembled for at the same time
+  size_t max_devices;
+  //! The number of chunk transport channels reassembled per device
+  //! (1 - MEMFAULT_CHUNK_TRANSPORT_MAX_CHANNELS)
+  size_t num_channels;
+  //! The size of the largest message which can be reassembled from several chunks. Messages
+  //! sent in a single chunk are not copied and are not subject to this limit.
+  size_t max_msg_size;
+} sMfltChunkReassemblerConfig;
+
+typedef struct {
+  uint64_t chunks;
+  uint64_t msgs_complete;
+  uint64_t duplicate_chunks;
+  uint64_t gaps;
+  uint64_t crc_errors;
+  uint64_t msgs_too_large;
+  uint64_t malformed_chunks;
+  //! Messages which were in flight when they were dropped by a gap, a new message starting on
+  //! the same channel or the eviction of the device
+  uint64_t msgs_dropped;
+  uint64_t devices_evicted;
+} sMfltChunkReassemblerStats;
+
+//! A message reassembled from one or more chunks
+typedef struct {
+  uint8_t channel_id;
+  //! Points into the chunk passed in for single chunk messages and into the reassembler storage
+  //! otherwise. Only valid until the next chunk is added for the same device.
+  const uint8_t *data;
+  uint32_t len;
+} sMfltChunkReassemblerMsg;
+
+//! Structure tracking reassembler state. In header for convenient static allocation but it
+//! should never be accessed directly!
+typedef struct {
+  sMfltChunkReassemblerConfig cfg;
+  void *devices;
+  //! Open addressed hash table of device indices + 1 (0 for an empty slot)
+  uint32_t *index;
+  size_t index_mask;
+  uint8_t *msg_bufs;
+  size_t num_devices;
+  //! Head of the list of unused devices
+  uint32_t free_device_idx;
+  //! The device the last chunk was for. Chunks for a device tend to arrive back to back.
+  uint32_t last_device_idx;
+  uint64_t activity_counter;
+  sMfltChunkReassemblerStats stats;
+} sMfltChunkReassembler;
+
+//! @return The number of bytes of storage a reassembler with the given configuration needs or 0
+//!   if the configuration is invalid
+size_t memfault_chunk_reassembler_get_storage_size(const sMfltChunkReassemblerConfig *cfg);
+
+//! Called to initialize a reassembler
+//!
+//! @param reassembler Allocated context for reassembler tracking
+//! @param cfg The configuration to use
+//! @param storage Storage area used by the reassembler. Must be aligned to 8 bytes.
+//! @param storage_len Size of the storage area. Must be at least
+//!   memfault_chunk_reassembler_get_storage_size(cfg)
+//!
+//! @return true if successfully configured, else false
+bool memfault_chunk_reassembler_init(sMfltChunkReassembler *reassembler,
+                                     const sMfltChunkReassemblerConfig *cfg, void *storage,
+                                     size_t storage_len);
+
+//! Adds a chunk received from a device
+//!
+//! @note A message sent in a single chunk is reported every time the chunk is received since a
+//!   retransmission can't be told apart from the same message being sent again
+//!
+//! @param reassembler The reassembler to add the chunk to
+//! @param device_key Identifies the device which sent the chunk (i.e its BLE address)
+//! @param chunk The chunk, as produced by memfault_chunk_transport_get_next_chunk()
+//! @param chunk_len The length of the chunk
+//! @param[out] msg Populated with the message when kMfltChunkReassemblerStatus_MsgComplete is
+//!   returned
+//!
+//! @return The outcome of adding the chunk
+eMfltChunkReassemblerStatus memfault_chunk_reassembler_add_chunk(
+    sMfltChunkReassembler *reassembler, uint64_t device_key, const void *chunk, size_t chunk_len,
+    sMfltChunkReassemblerMsg *msg);
+
+//! Forgets a device, dropping any messages in flight (i.e when it disconnects)
+//!
+//! @return true if the device was known, false otherwise
+bool memfault_chunk_reassembler_remove_device(sMfltChunkReassembler *reassembler,
+                                              uint64_t device_key);
+
+//! Populates stats with the counters accumulated since the reassembler was initialized
+void memfault_chunk_reassembler_get_stats(const sMfltChunkReassembler *reassembler,
+                                          sMfltChunkReassemblerStats *stats);
+
+//! @return The shard (0 - num_shards - 1) the chunks of a device should be routed to when they are
+//!   reassembled by several reassemblers
+size_t memfault_chunk_reassembler_get_shard(uint64_t device_key, size_t num_shards);
+
+#ifdef __cplusplus
+}
+#endif
@@ -23,6 +23,10 @@ extern "C" {
 //! The minimum buffer size required to generate a chunk.
 #define MEMFAULT_MIN_CHUNK_BUF_LEN 9
 
+//! The number of channels messages can be multiplexed over. Chunks from different channels can be
+//! interleaved and the receiver reassembles each channel independently.
+#define MEMFAULT_CHUNK_TRANSPORT_MAX_CHANNELS 8
+
 //! Callback invoked by the chunking transport to read a piece of a message
 //!
 //! By using a callback, we avoid requiring that the entire message ever need to be allocated in
@@ -48,6 +52,9 @@ typedef struct {
   //! this API. This is an optimization that allows us to send messages across "one" chunk if the
   //! transport does not have any size restrictions
   bool enable_multi_call_chunk;
+  //! The channel (0 - MEMFAULT_CHUNK_TRANSPORT_MAX_CHANNELS - 1) the message is sent over. Each
+  //! channel can only have one message in flight at a time.
+  uint8_t channel_id;
 
   // Output Arguments
 
@@ -25,11 +25,22 @@ typedef struct {
   size_t read_offset;
   size_t read_size;
   size_t total_space;
+  //! total_space - 1 when total_space is a power of 2, 0 otherwise
+  size_t index_mask;
   uint8_t *storage;
 } sMfltCircularBuffer;
 
+//! A contiguous region of circular buffer storage
+typedef struct {
+  uint8_t *ptr;
+  size_t len;
+} sMfltCircularBufferSpan;
+
 //! Called to initialize circular buffer context
 //!
+//! @note When storage_len is a power of 2, offsets are wrapped with a mask rather than a modulo,
+//! which avoids a division on every access (see MEMFAULT_CIRCULAR_BUFFER_POW2_FAST_PATH_ENABLE)
+//!
 //! @param circular_buffer Allocated context for circular buffer tracking
 //! @param storage_buf storage area that will be used by circular buffer
 //! @param storage_len Size of storage area
@@ -65,6 +76,23 @@ bool memfault_circular_buffer_read(sMfltCircularBuffer *circular_buf, size_t off
 bool memfault_circular_buffer_get_read_pointer(sMfltCircularBuffer *circular_buf, size_t offset,
                                                uint8_t **read_ptr, size_t *read_ptr_len);
 
+//! Locates a range of readable bytes without copying them
+//!
+//! This is the scatter/gather equivalent of "memfault_circular_buffer_read". The caller can copy
+//! the data straight to its final destination (or consume it in place) instead of first staging it
+//! in a temporary buffer.
+//!
+//! @param circular_buf The buffer to read from
+//! @param offset The offset within the buffer of the first byte of the range
+//! @param data_len The length of the range
+//! @param spans Populated with the location of the range. If it wraps around the end of the
+//!  storage, spans[1] holds the remainder. Otherwise spans[1].len is 0.
+//!
+//! @return true if the spans were populated, false otherwise (i.e the range extends past the end
+//!  of the available bytes)
+bool memfault_circular_buffer_get_read_range(sMfltCircularBuffer *circular_buf, size_t offset,
+                                             size_t data_len, sMfltCircularBufferSpan spans[2]);
+
 //! Callback invoked when "memfault_circular_buffer_read_with_callback" is called.
 //!
 //! @param ctx User defined context as passed into "memfault_circular_buffer_read_with_callback".
@@ -136,6 +164,88 @@ bool memfault_circular_buffer_write(sMfltCircularBuffer *circular_buf, const voi
 bool memfault_circular_buffer_write_at_offset(
     sMfltCircularBuffer *circular_buf, size_t offset_from_end, const void *data, size_t data_len);
 
+//! Populates write_ptr with a set of contiguous free bytes which can be written to.
+//!
+//! This is the write-side equivalent of "memfault_circular_buffer_get_read_pointer". Data can be
+//! placed directly in the buffer (i.e by an encoder) instead of being staged in a temporary buffer
+//! and copied in with "memfault_circular_buffer_write". Nothing becomes readable until
+//! "memfault_circular_buffer_commit_write" is called.
+//!
+//! @param circular_buf The buffer to write to
+//! @param offset The offset within the free space to start writing at (must be less than or equal
+//!  to memfault_circular_buffer_get_write_size()). Useful when an uncommitted write is populated
+//!  across several calls.
+//! @param write_ptr Populated with the pointer to write to
+//! @param write_ptr_len The length which can be written. This is the largest contiguous span, so
+//!  it may be less than the total amount of free space if the free space wraps around the end of
+//!  the storage
+//!
+//! @return true if a write pointer was successfully populated
+bool memfault_circular_buffer_get_write_pointer(sMfltCircularBuffer *circular_buf, size_t offset,
+                                                uint8_t **write_ptr, size_t *write_ptr_len);
+
+//! Same as "memfault_circular_buffer_get_write_pointer" but returns all of the free space
+//!
+//! @param circular_buf The buffer to write to
+//! @param spans Populated with the location of the free space. If it wraps around the end of the
+//!  storage, spans[1] holds the remainder. Otherwise spans[1].len is 0.
+//!
+//! @return true if the spans were populated
+bool memfault_circular_buffer_get_write_spans(sMfltCircularBuffer *circular_buf,
+                                              sMfltCircularBufferSpan spans[2]);
+
+//! Same as "memfault_circular_buffer_get_write_spans" but only returns the data_len bytes of free
+//! space starting offset bytes into it
+//!
+//! @param circular_buf The buffer to write to
+//! @param offset The offset within the free space of the first byte of the range
+//! @param data_len The length of the range
+//! @param spans Populated with the location of the range. If it wraps around the end of the
+//!  storage, spans[1] holds the remainder. Otherwise spans[1].len is 0.
+//!
+//! @return true if the spans were populated, false otherwise (i.e the range extends past the end
+//!  of the free space)
+bool memfault_circular_buffer_get_write_range(sMfltCircularBuffer *circular_buf, size_t offset,
+                                              size_t data_len, sMfltCircularBufferSpan spans[2]);
+
+//! Copies data into a range of storage, i.e one returned by
+//! "memfault_circular_buffer_get_write_range"
+//!
+//! @param spans The range to copy to. spans[1] continues where spans[0] ends.
+//! @param offset The offset within the range of the first byte to copy
+//! @param data The data to copy
+//! @param data_len Length of the data to copy
+//!
+//! @return true if the _entire_ buffer was copied, false if it extends past the end of the range
+//!  (only the bytes which fit are copied)
+bool memfault_circular_buffer_copy_to_spans(const sMfltCircularBufferSpan spans[2], size_t offset,
+                                            const void *data, size_t data_len);
+
+//! Makes data placed via the write pointer API available to readers
+//!
+//! @param circular_buf The buffer which was written to
+//! @param data_len The number of bytes, starting at the beginning of the free space, to commit
+//!
+//! @return true if the bytes were committed, false otherwise (i.e trying to commit more bytes than
+//!  there is free space)
+bool memfault_circular_buffer_commit_write(sMfltCircularBuffer *circular_buf, size_t data_len);
+
+//! Claims space at the end of the circular buffer without copying any data into it
+//!
+//! The claimed bytes are accounted for exactly as if they had been written (i.e they are
+//! included in memfault_circular_buffer_get_read_size()) and can be populated directly through
+//! the returned spans. This is useful when the space needs to be claimed up front (while holding
+//! a lock) and filled in later.
+//!
+//! @param circular_buf The buffer to claim space from
+//! @param data_len The number of bytes to claim
+//! @param spans Populated with the location of the claimed bytes. If the region wraps around the
+//!  end of the storage, spans[1] holds the remainder. Otherwise spans[1].len is 0.
+//!
+//! @return true if there was enough space and the bytes were claimed, false otherwise
+bool memfault_circular_buffer_reserve(sMfltCircularBuffer *circular_buf, size_t data_len,
+                                      sMfltCircularBufferSpan spans[2]);
+
 //! @return Amount of bytes available to read
 size_t memfault_circular_buffer_get_read_size(const sMfltCircularBuffer *circular_buf);
 
@@ -11,6 +11,7 @@
 //! More details:
 //!   http://reveng.sourceforge.net/crc-catalogue/16.htm#crc.cat.crc-16-xmodem
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
@@ -33,6 +34,18 @@ extern "C" {
 uint16_t memfault_crc16_ccitt_compute(
     uint16_t crc_initial_value, const void *data, size_t data_len_bytes);
 
+//! Hook to compute the CRC16-CCITT with a hardware CRC unit
+//!
+//! The default implementation is weak and returns false so the software implementation is used.
+//! An override must compute the same CRC (polynomial 0x1021, no reflection, no final xor) starting
+//! from crc_initial_value. See ports/stm32cube/l4/crc_crc16_ccitt.c for an example.
+//!
+//! @param crc_out Populated with the CRC when true is returned
+//!
+//! @return true if the CRC was computed, false to fall back to the software implementation
+bool memfault_platform_crc16_ccitt_compute(uint16_t crc_initial_value, const void *data,
+                                           size_t data_len_bytes, uint16_t *crc_out);
+
 #ifdef __cplusplus
 }
 #endif
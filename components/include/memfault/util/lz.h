@@ -0,0 +1,128 @@
+#pragma once
+
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! A small LZ77 style compressor suited to short payloads (i.e events) on RAM constrained devices
+//!
+//! The compressed stream is a sequence of tokens:
+//!  0b0LLLLLLL                 : (L + 1) literal bytes follow
+//!  0b1MMMMMMM Varint(distance): copy (M + MEMFAULT_LZ_MIN_MATCH_LEN) bytes, starting "distance"
+//!                               bytes before the current position
+//!
+//! The encoder and decoder can be seeded with the same preset dictionary. The dictionary logically
+//! precedes the data, so matches can refer to it. This is what makes compressing short payloads
+//! which share a lot of content (i.e strings repeated in every event) worthwhile.
+//!
+//! Back references into the data itself are limited to the size of a caller provided window
+//! buffer, which bounds the RAM needed by both the encoder and the decoder.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MEMFAULT_LZ_MIN_MATCH_LEN 3
+#define MEMFAULT_LZ_MAX_MATCH_LEN (MEMFAULT_LZ_MIN_MATCH_LEN + 0x7f)
+#define MEMFAULT_LZ_MAX_LITERAL_RUN 0x80
+
+//! The number of bytes the encoder buffers before deciding how to encode them. This is also the
+//! longest match the encoder will emit so it covers the longest match a token can encode, which
+//! matters for the long runs of the same bytes found in RAM.
+#define MEMFAULT_LZ_ENCODER_LOOKAHEAD_LEN MEMFAULT_LZ_MAX_MATCH_LEN
+//! The longest literal run the encoder will emit
+#define MEMFAULT_LZ_ENCODER_MAX_LITERAL_RUN 32
+
+//! Invoked with data produced by the encoder or decoder
+typedef void (*MemfaultLzWriteCallback)(void *ctx, const void *buf, size_t buf_len);
+
+typedef struct {
+  //! (Optional) Preset dictionary. The encoder and decoder must use the same one.
+  const void *dict;
+  size_t dict_len;
+  //! Scratch space holding the most recently processed bytes. Back references into the data are
+  //! limited to this many bytes so the decoder window must be at least as large as the encoder's.
+  void *window;
+  size_t window_size;
+} sMemfaultLzConfig;
+
+//! Structure tracking encoder state. In header for convenient allocation but it should never be
+//! accessed directly!
+typedef struct {
+  sMemfaultLzConfig config;
+  MemfaultLzWriteCallback write_cb;
+  void *write_cb_ctx;
+  //! Number of input bytes which have been encoded (excluding the ones still in lookahead)
+  size_t bytes_in;
+  //! Number of compressed bytes produced
+  size_t bytes_out;
+  size_t lookahead_len;
+  uint8_t lookahead[MEMFAULT_LZ_ENCODER_LOOKAHEAD_LEN];
+  size_t literals_len;
+  uint8_t literals[MEMFAULT_LZ_ENCODER_MAX_LITERAL_RUN];
+} sMemfaultLzEncoder;
+
+typedef enum {
+  kMemfaultLzDecoderState_Token = 0,
+  kMemfaultLzDecoderState_Literals,
+  kMemfaultLzDecoderState_Distance,
+  kMemfaultLzDecoderState_Error,
+} eMemfaultLzDecoderState;
+
+//! Structure tracking decoder state. In header for convenient allocation but it should never be
+//! accessed directly!
+typedef struct {
+  sMemfaultLzConfig config;
+  MemfaultLzWriteCallback write_cb;
+  void *write_cb_ctx;
+  //! Number of decompressed bytes produced
+  size_t bytes_out;
+  eMemfaultLzDecoderState state;
+  //! Literals left to copy or length of the match whose distance is being decoded
+  size_t count;
+  uint32_t distance;
+  uint8_t distance_shift;
+} sMemfaultLzDecoder;
+
+//! Prepares an encoder
+//!
+//! @param encoder The encoder to initialize
+//! @param config The dictionary & window to use. The window buffer must remain valid until
+//!  memfault_lz_encoder_finish() is called.
+//! @param write_cb Invoked with the compressed stream as it is produced. If NULL, the encoder only
+//!  computes the size of the compressed stream.
+//! @param ctx User provided context passed to write_cb
+void memfault_lz_encoder_init(sMemfaultLzEncoder *encoder, const sMemfaultLzConfig *config,
+                              MemfaultLzWriteCallback write_cb, void *ctx);
+
+//! Feeds data to be compressed to the encoder. Can be called as many times as needed.
+void memfault_lz_encode(sMemfaultLzEncoder *encoder, const void *buf, size_t buf_len);
+
+//! Flushes any data still buffered by the encoder
+//!
+//! @return The total size of the compressed stream
+size_t memfault_lz_encoder_finish(sMemfaultLzEncoder *encoder);
+
+//! Prepares a decoder
+//!
+//! @param decoder The decoder to initialize
+//! @param config The dictionary & window to use
+//! @param write_cb Invoked with the decompressed data as it is produced
+//! @param ctx User provided context passed to write_cb
+void memfault_lz_decoder_init(sMemfaultLzDecoder *decoder, const sMemfaultLzConfig *config,
+                              MemfaultLzWriteCallback write_cb, void *ctx);
+
+//! Feeds compressed data to the decoder. Can be called as many times as needed.
+//!
+//! @return false if the compressed stream is malformed
+bool memfault_lz_decode(sMemfaultLzDecoder *decoder, const void *buf, size_t buf_len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -40,6 +40,16 @@ size_t memfault_encode_varint_u32(uint32_t value, void *buf);
 //!   hold the encoding. The maximum encoding length is MEMFAULT_UINT32_MAX_VARINT_LENGTH
 size_t memfault_encode_varint_si32(int32_t value, void *buf);
 
+//! Decodes a Varint encoding of a uint32_t
+//!
+//! @note Encodings which are longer than necessary (i.e padded with 0x80 bytes) are accepted
+//! @param[in] buf The buffer holding the encoding
+//! @param[in] buf_len The number of bytes available in buf
+//! @param[out] value Populated with the decoded value on success
+//! @return The number of bytes the encoding spans or 0 if buf does not start with a complete
+//!   encoding of a uint32_t
+size_t memfault_decode_varint_u32(const void *buf, size_t buf_len, uint32_t *value);
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,7 @@
 
 #include "memfault/core/compiler.h"
 #include "memfault/core/debug_log.h"
+#include "memfault/core/event_storage.h"
 #include "memfault/core/event_storage_implementation.h"
 #include "memfault/core/math.h"
 #include "memfault/core/platform/core.h"
@@ -359,15 +360,49 @@ static bool prv_tally_and_update_timer_cb(MEMFAULT_UNUSED void *ctx,
   return true;
 }
 
+#if MEMFAULT_EVENT_STORAGE_STATS_HEARTBEAT_METRICS_ENABLED
+//! Records the event storage health over the heartbeat interval and starts a new interval
+static void prv_collect_event_storage_stats(void) {
+  sMemfaultEventStorageStats stats;
+  if (!memfault_event_storage_get_stats(&stats)) {
+    return;
+  }
+  memfault_event_storage_reset_stats();
+
+  memfault_metrics_heartbeat_set_unsigned(
+      MEMFAULT_METRICS_KEY(MemfaultSdkMetric_EventStoragePeakBytesUsed),
+      (uint32_t)stats.peak_bytes_used);
+  memfault_metrics_heartbeat_set_unsigned(
+      MEMFAULT_METRICS_KEY(MemfaultSdkMetric_EventStorageDropsStorageFull),
+      stats.drops_storage_full);
+  memfault_metrics_heartbeat_set_unsigned(
+      MEMFAULT_METRICS_KEY(MemfaultSdkMetric_EventStorageDropsWriterCollision),
+      stats.drops_writer_collision);
+  memfault_metrics_heartbeat_set_unsigned(
+      MEMFAULT_METRICS_KEY(MemfaultSdkMetric_EventStorageDropsRollback), stats.drops_rollback);
+  memfault_metrics_heartbeat_set_unsigned(
+      MEMFAULT_METRICS_KEY(MemfaultSdkMetric_EventStorageMaxTimeInBufferMs),
+      stats.time_in_buffer_max_ms);
+}
+#endif
+
 static void prv_heartbeat_timer(void) {
   // force an update of the timer value for any actively running timers
   prv_metric_iterator(NULL, prv_tally_and_update_timer_cb);
+#if MEMFAULT_EVENT_STORAGE_STATS_HEARTBEAT_METRICS_ENABLED
+  prv_collect_event_storage_stats();
+#endif
   memfault_metrics_heartbeat_collect_data();
 
   memfault_metrics_heartbeat_serialize(s_memfault_metrics_ctx.storage_impl);
 
   // reset metric values
   memset(s_memfault_heartbeat_values, 0, sizeof(s_memfault_heartbeat_values));
+
+#if MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED
+  // make sure events which arrived at the tail end of a burst still get persisted
+  memfault_event_storage_check_persist_window();
+#endif
 }
 
 static int prv_find_key_and_add(MemfaultMetricId key, int32_t amount) {
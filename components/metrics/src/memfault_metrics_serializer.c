@@ -107,7 +107,7 @@ bool memfault_metrics_heartbeat_serialize(const sMemfaultEventStorageImpl *stora
   // avoiding the need to serialize the data twice
   sMemfaultSerializerState state = { 0 };
   const bool success = memfault_serializer_helper_encode_to_storage(
-      &state.encoder, storage_impl, prv_encode_cb, &state);
+      &state.encoder, storage_impl, kMemfaultEventStorageClass_Heartbeat, prv_encode_cb, &state);
 
   return success;
 }
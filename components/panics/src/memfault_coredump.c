@@ -12,15 +12,21 @@
 #include <string.h>
 #include <stdbool.h>
 
+#include "memfault/config.h"
 #include "memfault/core/build_info.h"
 #include "memfault/core/compiler.h"
 #include "memfault/core/data_packetizer_source.h"
 #include "memfault/core/math.h"
 #include "memfault/core/platform/device_info.h"
 #include "memfault/panics/platform/coredump.h"
+#include "memfault/util/varint.h"
 
 #define MEMFAULT_COREDUMP_MAGIC 0x45524f43
 
+//! Marks a coredump saved with MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE. The header is followed by
+//! the RLE encoded coredump, which is what gets sent, and its total_size is the encoded size.
+#define MEMFAULT_COREDUMP_RLE_MAGIC 0x5a524f43
+
 //! Version 2
 //!  - If there is not enough storage space for memory regions,
 //!    coredumps will now be truncated instead of failing completely
@@ -84,10 +90,31 @@ typedef MEMFAULT_PACKED_STRUCT MfltMachineTypeBlock {
   uint32_t machine_type;
 } sMfltMachineTypeBlock;
 
+//! The longest literal sequence the encoder emits. Its length encodes to a 1 byte varint.
+#define MEMFAULT_COREDUMP_RLE_MAX_LITERAL_LEN 64
+
+//! The shortest run of repeated bytes which is encoded as a repeat sequence
+#define MEMFAULT_COREDUMP_RLE_MIN_RUN_LEN 3
+
+//! The smallest piece a memory region is split into when it might not fit in the space left
+#define MEMFAULT_COREDUMP_RLE_MIN_PIECE_LEN 64
+
+//! A streaming encoder producing the same format as memfault_rle_encode(): a zigzag varint length
+//! (negative for a literal sequence, positive for a repeated byte) followed by the data
+typedef struct {
+  // the offset within storage the next encoded bytes are written to
+  uint32_t storage_offset;
+  uint8_t literal[MEMFAULT_COREDUMP_RLE_MAX_LITERAL_LEN];
+  uint32_t literal_len;
+  uint8_t run_byte;
+  uint32_t run_len;
+} sMfltCoredumpRleEncoder;
+
 typedef struct {
   // the space available for saving a coredump
   uint32_t storage_size;
-  // the offset within storage currently being written to
+  // the offset within the coredump currently being written to. When RLE encoding, this is the
+  // offset before encoding.
   uint32_t offset;
   // set to true when no writes should be performed and only the total size of the write should be
   // computed
@@ -96,6 +123,9 @@ typedef struct {
   bool truncated;
   // set to true if a call to "memfault_platform_coredump_storage_write" failed
   bool write_error;
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  sMfltCoredumpRleEncoder rle;
+#endif
 } sMfltCoredumpWriteCtx;
 
 // Checks to see if the block is a cached region and applies
@@ -129,7 +159,116 @@ static bool prv_fixup_if_cached_block(sMfltCoredumpRegion *region, uint32_t *cac
   return true;
 }
 
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+
+static bool prv_rle_storage_write(const void *data, size_t len, sMfltCoredumpWriteCtx *write_ctx) {
+  sMfltCoredumpRleEncoder *rle = &write_ctx->rle;
+  if (!write_ctx->compute_size_only &&
+      !memfault_platform_coredump_storage_write(rle->storage_offset, data, len)) {
+    write_ctx->write_error = true;
+    return false;
+  }
+
+  rle->storage_offset += len;
+  return true;
+}
+
+static bool prv_rle_write_sequence(int32_t rle_size, const uint8_t *data, size_t len,
+                                   sMfltCoredumpWriteCtx *write_ctx) {
+  uint8_t header[MEMFAULT_UINT32_MAX_VARINT_LENGTH];
+  const size_t header_len = memfault_encode_varint_si32(rle_size, header);
+  return prv_rle_storage_write(header, header_len, write_ctx) &&
+      prv_rle_storage_write(data, len, write_ctx);
+}
+
+static bool prv_rle_flush_literal(sMfltCoredumpWriteCtx *write_ctx) {
+  sMfltCoredumpRleEncoder *rle = &write_ctx->rle;
+  if (rle->literal_len == 0) {
+    return true;
+  }
+
+  const uint32_t literal_len = rle->literal_len;
+  rle->literal_len = 0;
+  return prv_rle_write_sequence(-(int32_t)literal_len, rle->literal, literal_len, write_ctx);
+}
+
+static bool prv_rle_flush_run(sMfltCoredumpWriteCtx *write_ctx) {
+  sMfltCoredumpRleEncoder *rle = &write_ctx->rle;
+  const uint32_t run_len = rle->run_len;
+  rle->run_len = 0;
+
+  if (run_len >= MEMFAULT_COREDUMP_RLE_MIN_RUN_LEN) {
+    return prv_rle_flush_literal(write_ctx) &&
+        prv_rle_write_sequence((int32_t)run_len, &rle->run_byte, 1, write_ctx);
+  }
+
+  // too short to be worth a sequence of its own
+  for (uint32_t i = 0; i < run_len; i++) {
+    rle->literal[rle->literal_len++] = rle->run_byte;
+    if ((rle->literal_len == sizeof(rle->literal)) && !prv_rle_flush_literal(write_ctx)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool prv_rle_encode(const void *data, size_t len, sMfltCoredumpWriteCtx *write_ctx) {
+  sMfltCoredumpRleEncoder *rle = &write_ctx->rle;
+  const uint8_t *bytes = data;
+  for (size_t i = 0; i < len; i++) {
+    if ((rle->run_len != 0) && (bytes[i] == rle->run_byte)) {
+      rle->run_len++;
+      continue;
+    }
+
+    if (!prv_rle_flush_run(write_ctx)) {
+      return false;
+    }
+    rle->run_byte = bytes[i];
+    rle->run_len = 1;
+  }
+  return true;
+}
+
+static bool prv_rle_encode_finalize(sMfltCoredumpWriteCtx *write_ctx) {
+  return prv_rle_flush_run(write_ctx) && prv_rle_flush_literal(write_ctx);
+}
+
+//! @return The number of bytes which can be written before encoding with a guarantee they fit
+static size_t prv_storage_bytes_free(const sMfltCoredumpWriteCtx *write_ctx) {
+  const sMfltCoredumpRleEncoder *rle = &write_ctx->rle;
+  if (write_ctx->storage_size <= rle->storage_offset) {
+    return 0;
+  }
+
+  // A run costs at most one byte less than its length once it splits a literal sequence, so in
+  // the worst case the bytes encoded grow by one byte per full literal sequence plus one for the
+  // last one. The bytes held by the encoder have not been written out yet but however long the
+  // pending run gets, it costs no more than a short one.
+  const size_t bytes_free = write_ctx->storage_size - rle->storage_offset;
+  const size_t bytes_pending =
+      rle->literal_len + MEMFAULT_MIN(rle->run_len, MEMFAULT_UINT32_MAX_VARINT_LENGTH + 2);
+  const size_t bytes_encodable =
+      ((bytes_free - 1) * MEMFAULT_COREDUMP_RLE_MAX_LITERAL_LEN) /
+      (MEMFAULT_COREDUMP_RLE_MAX_LITERAL_LEN + 1);
+  return (bytes_encodable > bytes_pending) ? bytes_encodable - bytes_pending : 0;
+}
+
+#else
+
+static size_t prv_storage_bytes_free(const sMfltCoredumpWriteCtx *write_ctx) {
+  return write_ctx->storage_size > write_ctx->offset ?
+      write_ctx->storage_size - write_ctx->offset : 0;
+}
+
+#endif /* MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE */
+
 static bool prv_platform_coredump_write(const void *data, size_t len, sMfltCoredumpWriteCtx *write_ctx) {
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  if (!prv_rle_encode(data, len, write_ctx)) {
+    return false;
+  }
+#else
   // if we are just computing the size needed, don't write any data but keep
   // a count of how many bytes would be written.
   if (!write_ctx->compute_size_only &&
@@ -137,11 +276,41 @@ static bool prv_platform_coredump_write(const void *data, size_t len, sMfltCored
     write_ctx->write_error = true;
     return false;
   }
+#endif
 
   write_ctx->offset += len;
   return true;
 }
 
+static bool prv_write_block_with_address(
+    eMfltCoredumpBlockType block_type, const void *block_payload, size_t block_payload_size,
+    uint32_t address, sMfltCoredumpWriteCtx *write_ctx, bool word_aligned_reads_only);
+
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+//! Saves the start of a memory region which might not fit in the space left as a block of its own.
+//! The space left is computed for the worst case so once the block has been encoded, there is
+//! usually room for more of the region.
+//!
+//! @return The number of bytes of the region saved
+static size_t prv_write_memory_region_piece(const void *block_payload, size_t block_payload_size,
+                                            uint32_t address, sMfltCoredumpWriteCtx *write_ctx,
+                                            bool word_aligned_reads_only) {
+  const size_t storage_bytes_free = prv_storage_bytes_free(write_ctx);
+  if (write_ctx->compute_size_only ||
+      (storage_bytes_free >= (sizeof(sMfltCoredumpBlock) + block_payload_size)) ||
+      (storage_bytes_free < (sizeof(sMfltCoredumpBlock) + MEMFAULT_COREDUMP_RLE_MIN_PIECE_LEN))) {
+    return 0;
+  }
+
+  const size_t piece_size = MEMFAULT_FLOOR(storage_bytes_free - sizeof(sMfltCoredumpBlock), 4);
+  if (!prv_write_block_with_address(kMfltCoredumpBlockType_MemoryRegion, block_payload,
+                                    piece_size, address, write_ctx, word_aligned_reads_only)) {
+    return 0;
+  }
+  return piece_size;
+}
+#endif
+
 static bool prv_write_block_with_address(
     eMfltCoredumpBlockType block_type, const void *block_payload, size_t block_payload_size,
     uint32_t address, sMfltCoredumpWriteCtx *write_ctx, bool word_aligned_reads_only) {
@@ -150,9 +319,23 @@ static bool prv_write_block_with_address(
     return true;
   }
 
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  if (block_type == kMfltCoredumpBlockType_MemoryRegion) {
+    size_t piece_size;
+    while ((piece_size = prv_write_memory_region_piece(block_payload, block_payload_size, address,
+                                                       write_ctx, word_aligned_reads_only)) != 0) {
+      block_payload = (const uint8_t *)block_payload + piece_size;
+      block_payload_size -= piece_size;
+      address += piece_size;
+    }
+    if (write_ctx->write_error) {
+      return false;
+    }
+  }
+#endif
+
   const size_t total_length = sizeof(sMfltCoredumpBlock) + block_payload_size;
-  const size_t storage_bytes_free =
-      write_ctx->storage_size > write_ctx->offset ?  write_ctx->storage_size - write_ctx->offset : 0;
+  const size_t storage_bytes_free = prv_storage_bytes_free(write_ctx);
 
   if (!write_ctx->compute_size_only && storage_bytes_free < total_length) {
     // We are trying to write a new block in the coredump and there is not enough
@@ -287,15 +470,50 @@ static bool prv_write_device_info_blocks(sMfltCoredumpWriteCtx *ctx) {
                                     &machine_block, sizeof(machine_block), ctx);
 }
 
-static bool prv_write_coredump_header(size_t total_coredump_size, sMfltCoredumpWriteCtx *ctx) {
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+
+//! Space is left at the start of storage for the header marking the coredump valid followed by
+//! the coredump header, encoded as a literal sequence of its own since it is written last
+#define MEMFAULT_COREDUMP_RLE_HEADERS_SIZE ((2 * sizeof(sMfltCoredumpHeader)) + 1)
+
+//! @return The size of the coredump in storage
+static size_t prv_write_coredump_header(size_t total_coredump_size, sMfltCoredumpWriteCtx *ctx) {
+  const size_t total_storage_size = ctx->rle.storage_offset;
+  const sMfltCoredumpHeader storage_hdr = {
+    .magic = MEMFAULT_COREDUMP_RLE_MAGIC,
+    .version = MEMFAULT_COREDUMP_VERSION,
+    .total_size = total_storage_size - sizeof(storage_hdr),
+  };
+  const sMfltCoredumpHeader hdr = {
+    .magic = MEMFAULT_COREDUMP_MAGIC,
+    .version = MEMFAULT_COREDUMP_VERSION,
+    .total_size = total_coredump_size,
+  };
+
+  uint8_t headers[MEMFAULT_COREDUMP_RLE_HEADERS_SIZE];
+  memcpy(headers, &storage_hdr, sizeof(storage_hdr));
+  memfault_encode_varint_si32(-(int32_t)sizeof(hdr), &headers[sizeof(storage_hdr)]);
+  memcpy(&headers[sizeof(storage_hdr) + 1], &hdr, sizeof(hdr));
+
+  ctx->rle.storage_offset = 0;
+  return prv_rle_storage_write(headers, sizeof(headers), ctx) ? total_storage_size : 0;
+}
+
+#else
+
+//! @return The size of the coredump in storage
+static size_t prv_write_coredump_header(size_t total_coredump_size, sMfltCoredumpWriteCtx *ctx) {
   sMfltCoredumpHeader hdr = (sMfltCoredumpHeader) {
     .magic = MEMFAULT_COREDUMP_MAGIC,
     .version = MEMFAULT_COREDUMP_VERSION,
     .total_size = total_coredump_size,
   };
-  return prv_platform_coredump_write(&hdr, sizeof(hdr), ctx);
+  ctx->offset = 0;
+  return prv_platform_coredump_write(&hdr, sizeof(hdr), ctx) ? total_coredump_size : 0;
 }
 
+#endif /* MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE */
+
 static bool prv_write_trace_reason(sMfltCoredumpWriteCtx *ctx, uint32_t trace_reason) {
   sMfltTraceReasonBlock trace_info = {
     .reason = trace_reason,
@@ -356,6 +574,11 @@ static bool prv_coredump_get_header(sMfltCoredumpHeader *hdr_out,
 }
 
 static bool prv_coredump_header_is_valid(const sMfltCoredumpHeader *hdr) {
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  if (hdr && hdr->magic == MEMFAULT_COREDUMP_RLE_MAGIC) {
+    return true;
+  }
+#endif
   return (hdr && hdr->magic == MEMFAULT_COREDUMP_MAGIC);
 }
 
@@ -429,9 +652,15 @@ static bool prv_write_coredump_sections(const sMemfaultCoredumpSaveInfo *save_in
     .storage_size = info.size,
   };
 
-  if (write_ctx.storage_size > sizeof(sMfltCoredumpFooter)) {
-    // always leave space for footer
-    write_ctx.storage_size -= sizeof(sMfltCoredumpFooter);
+  // always leave space for footer
+  size_t footer_space = sizeof(sMfltCoredumpFooter);
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  write_ctx.rle.storage_offset = MEMFAULT_COREDUMP_RLE_HEADERS_SIZE;
+  // the worst case growth of the encoded footer
+  footer_space += 2;
+#endif
+  if (write_ctx.storage_size > footer_space) {
+    write_ctx.storage_size -= footer_space;
   }
 
   const void *regs = save_info->regs;
@@ -475,15 +704,15 @@ static bool prv_write_coredump_sections(const sMemfaultCoredumpSaveInfo *save_in
   if (!prv_platform_coredump_write(&footer, sizeof(footer), &write_ctx)) {
     return false;
   }
-
-  const size_t end_offset = write_ctx.offset;
-  write_ctx.offset = 0; // we are writing the header so reset our write offset
-  const bool success = prv_write_coredump_header(end_offset, &write_ctx);
-  if (success) {
-    *total_size = end_offset;
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  if (!prv_rle_encode_finalize(&write_ctx)) {
+    return false;
   }
+#endif
 
-  return success;
+  // we write the header last to mark the coredump valid
+  *total_size = prv_write_coredump_header(write_ctx.offset, &write_ctx);
+  return *total_size != 0;
 }
 
 MEMFAULT_WEAK
@@ -504,6 +733,12 @@ bool memfault_coredump_save(const sMemfaultCoredumpSaveInfo *save_info) {
   return prv_write_coredump_sections(save_info, compute_size_only, &total_size);
 }
 
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+//! The offset in storage of the message sent for the coredump saved. An RLE encoded coredump is
+//! preceded by a header which is not sent. Updated every time the coredump header is checked.
+static uint32_t s_coredump_msg_offset;
+#endif
+
 bool memfault_coredump_has_valid_coredump(size_t *total_size_out) {
   sMfltCoredumpHeader hdr = { 0 };
   // This routine is only called while the system is running so _always_ use the
@@ -512,6 +747,9 @@ bool memfault_coredump_has_valid_coredump(size_t *total_size_out) {
   if (!prv_coredump_get_header(&hdr, coredump_read_cb)) {
     return false;
   }
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  s_coredump_msg_offset = (hdr.magic == MEMFAULT_COREDUMP_RLE_MAGIC) ? sizeof(hdr) : 0;
+#endif
   if (!prv_coredump_header_is_valid(&hdr)) {
     return false;
   }
@@ -526,9 +764,24 @@ bool memfault_coredump_read(uint32_t offset, void *buf, size_t buf_len) {
   return memfault_platform_coredump_storage_read(offset, buf, buf_len);
 }
 
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+static bool prv_coredump_read_msg(uint32_t offset, void *buf, size_t buf_len) {
+  return memfault_coredump_read(s_coredump_msg_offset + offset, buf, buf_len);
+}
+
+static bool prv_coredump_is_rle_encoded(void) {
+  return memfault_coredump_has_valid_coredump(NULL) && (s_coredump_msg_offset != 0);
+}
+#endif
+
 //! Expose a data source for use by the Memfault Packetizer
 const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
   .has_more_msgs_cb = memfault_coredump_has_valid_coredump,
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+  .read_msg_cb = prv_coredump_read_msg,
+  .is_rle_encoded_cb = prv_coredump_is_rle_encoded,
+#else
   .read_msg_cb = memfault_coredump_read,
+#endif
   .mark_msg_read_cb = memfault_platform_coredump_storage_clear,
 };
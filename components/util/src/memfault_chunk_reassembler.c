@@ -0,0 +1,471 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! See header for more details. The chunk format is described in memfault_chunk_transport.c.
+//!
+//! Storage layout:
+//!   sMfltReassemblerDevice[max_devices] || uint32_t index[index_len] ||
+//!     uint8_t msg_bufs[max_devices][num_channels][max_msg_size]
+
+#include "memfault/util/chunk_reassembler.h"
+
+#include <string.h>
+
+#include "memfault/util/chunk_transport.h"
+#include "memfault/util/crc16_ccitt.h"
+#include "memfault/util/varint.h"
+
+// Chunk header bits
+#define MFLT_CHUNK_HDR_CONTINUATION 0x80
+#define MFLT_CHUNK_HDR_MD 0x40
+#define MFLT_CHUNK_HDR_CFG_MASK 0x38
+#define MFLT_CHUNK_HDR_CHANNEL_MASK 0x07
+//! The only configuration an INIT chunk is written with: the CRC16 follows the last chunk
+#define MFLT_CHUNK_HDR_CFG_INIT 0x08
+
+#define MFLT_CHUNK_CRC16_LEN 2
+
+//! Marks the end of the free device list
+#define MFLT_NO_DEVICE UINT32_MAX
+
+typedef struct {
+  bool in_progress;
+  uint16_t crc16;
+  //! The size of the message in flight
+  uint32_t total_size;
+  //! The number of bytes of the message in flight received so far
+  uint32_t write_offset;
+  //! The size of the last message completed so chunks retransmitted after it are recognized as
+  //! duplicates. 0 when there is no such message.
+  uint32_t last_msg_size;
+} sMfltReassemblerChannel;
+
+typedef struct {
+  uint64_t key;
+  uint64_t last_active;
+  uint32_t next_free_idx;
+  sMfltReassemblerChannel channels[MEMFAULT_CHUNK_TRANSPORT_MAX_CHANNELS];
+} sMfltReassemblerDevice;
+
+//! A finalizer with good avalanche behavior (from MurmurHash3) so keys which only differ in a few
+//! bits (i.e sequential addresses) spread over the whole table
+static uint64_t prv_hash(uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  key *= 0xc4ceb9fe1a85ec53ULL;
+  key ^= key >> 33;
+  return key;
+}
+
+//! The hash table is kept at most half full so probe sequences stay short
+static size_t prv_index_len(size_t max_devices) {
+  size_t index_len = 1;
+  while (index_len < (2 * max_devices)) {
+    index_len <<= 1;
+  }
+  return index_len;
+}
+
+static bool prv_config_valid(const sMfltChunkReassemblerConfig *cfg) {
+  return (cfg != NULL) && (cfg->max_devices != 0) && (cfg->max_devices < (UINT32_MAX / 4)) &&
+         (cfg->num_channels != 0) && (cfg->num_channels <= MEMFAULT_CHUNK_TRANSPORT_MAX_CHANNELS) &&
+         (cfg->max_msg_size <= UINT32_MAX);
+}
+
+size_t memfault_chunk_reassembler_get_storage_size(const sMfltChunkReassemblerConfig *cfg) {
+  if (!prv_config_valid(cfg)) {
+    return 0;
+  }
+
+  const size_t max_devices = cfg->max_devices;
+  const size_t buf_len_per_device = cfg->num_channels * cfg->max_msg_size;
+  if ((cfg->max_msg_size != 0) && (buf_len_per_device / cfg->max_msg_size != cfg->num_channels)) {
+    return 0;
+  }
+  // the index holds at most 4 entries per device
+  const size_t fixed_len = sizeof(sMfltReassemblerDevice) + (4 * sizeof(uint32_t));
+  if ((SIZE_MAX / max_devices) < (fixed_len + buf_len_per_device)) {
+    return 0;
+  }
+
+  return (max_devices * sizeof(sMfltReassemblerDevice)) +
+         (prv_index_len(max_devices) * sizeof(uint32_t)) + (max_devices * buf_len_per_device);
+}
+
+bool memfault_chunk_reassembler_init(sMfltChunkReassembler *reassembler,
+                                     const sMfltChunkReassemblerConfig *cfg, void *storage,
+                                     size_t storage_len) {
+  const size_t storage_needed = memfault_chunk_reassembler_get_storage_size(cfg);
+  if ((reassembler == NULL) || (storage == NULL) || (storage_needed == 0) ||
+      (storage_len < storage_needed) || (((uintptr_t)storage % sizeof(uint64_t)) != 0)) {
+    return false;
+  }
+
+  uint8_t *storage_bytes = storage;
+  const size_t index_len = prv_index_len(cfg->max_devices);
+  const size_t devices_len = cfg->max_devices * sizeof(sMfltReassemblerDevice);
+  *reassembler = (sMfltChunkReassembler) {
+    .cfg = *cfg,
+    .devices = storage_bytes,
+    .index = (uint32_t *)(void *)&storage_bytes[devices_len],
+    .index_mask = index_len - 1,
+    .msg_bufs = &storage_bytes[devices_len + (index_len * sizeof(uint32_t))],
+    .free_device_idx = 0,
+    .last_device_idx = MFLT_NO_DEVICE,
+  };
+
+  sMfltReassemblerDevice *devices = reassembler->devices;
+  for (size_t i = 0; i < cfg->max_devices; i++) {
+    devices[i] = (sMfltReassemblerDevice) {
+      .next_free_idx = ((i + 1) < cfg->max_devices) ? (uint32_t)(i + 1) : MFLT_NO_DEVICE,
+    };
+  }
+  memset(reassembler->index, 0, index_len * sizeof(uint32_t));
+  return true;
+}
+
+static sMfltReassemblerDevice *prv_get_device(sMfltChunkReassembler *reassembler, uint32_t idx) {
+  sMfltReassemblerDevice *devices = reassembler->devices;
+  return &devices[idx];
+}
+
+static uint8_t *prv_get_msg_buf(sMfltChunkReassembler *reassembler, uint32_t device_idx,
+                                size_t channel_id) {
+  const size_t buf_idx = (device_idx * reassembler->cfg.num_channels) + channel_id;
+  return &reassembler->msg_bufs[buf_idx * reassembler->cfg.max_msg_size];
+}
+
+//! @return The slot in the index holding the device or the empty slot where it would go
+static size_t prv_find_slot(const sMfltChunkReassembler *reassembler, uint64_t device_key) {
+  const sMfltReassemblerDevice *devices = reassembler->devices;
+  size_t slot = (size_t)prv_hash(device_key) & reassembler->index_mask;
+  while (reassembler->index[slot] != 0) {
+    if (devices[reassembler->index[slot] - 1].key == device_key) {
+      break;
+    }
+    slot = (slot + 1) & reassembler->index_mask;
+  }
+  return slot;
+}
+
+//! Empties a slot of the index, moving back the entries after it in the probe sequence so no
+//! tombstones are needed
+static void prv_clear_slot(sMfltChunkReassembler *reassembler, size_t slot) {
+  const sMfltReassemblerDevice *devices = reassembler->devices;
+  const size_t mask = reassembler->index_mask;
+  size_t next_slot = slot;
+  while (true) {
+    next_slot = (next_slot + 1) & mask;
+    const uint32_t entry = reassembler->index[next_slot];
+    if (entry == 0) {
+      break;
+    }
+
+    // an entry can only move back if the slot being emptied is between its home slot and where
+    // it is now
+    const size_t home_slot = (size_t)prv_hash(devices[entry - 1].key) & mask;
+    const size_t dist_from_home = (next_slot - home_slot) & mask;
+    const size_t dist_from_empty = (next_slot - slot) & mask;
+    if (dist_from_home >= dist_from_empty) {
+      reassembler->index[slot] = entry;
+      slot = next_slot;
+    }
+  }
+  reassembler->index[slot] = 0;
+}
+
+static void prv_release_device(sMfltChunkReassembler *reassembler, uint32_t device_idx) {
+  sMfltReassemblerDevice *device = prv_get_device(reassembler, device_idx);
+  for (size_t i = 0; i < reassembler->cfg.num_channels; i++) {
+    if (device->channels[i].in_progress) {
+      reassembler->stats.msgs_dropped++;
+    }
+  }
+
+  prv_clear_slot(reassembler, prv_find_slot(reassembler, device->key));
+  *device = (sMfltReassemblerDevice) {
+    .next_free_idx = reassembler->free_device_idx,
+  };
+  reassembler->free_device_idx = device_idx;
+  reassembler->num_devices--;
+  if (reassembler->last_device_idx == device_idx) {
+    reassembler->last_device_idx = MFLT_NO_DEVICE;
+  }
+}
+
+static uint32_t prv_least_recently_active_device(const sMfltChunkReassembler *reassembler) {
+  const sMfltReassemblerDevice *devices = reassembler->devices;
+  uint32_t lru_idx = 0;
+  for (uint32_t i = 1; i < reassembler->cfg.max_devices; i++) {
+    if (devices[i].last_active < devices[lru_idx].last_active) {
+      lru_idx = i;
+    }
+  }
+  return lru_idx;
+}
+
+//! @return The device with the given key, adding it if it isn't known yet
+static sMfltReassemblerDevice *prv_lookup_or_add_device(sMfltChunkReassembler *reassembler,
+                                                       uint64_t device_key) {
+  sMfltReassemblerDevice *device;
+  if (reassembler->last_device_idx != MFLT_NO_DEVICE) {
+    device = prv_get_device(reassembler, reassembler->last_device_idx);
+    if (device->key == device_key) {
+      device->last_active = ++reassembler->activity_counter;
+      return device;
+    }
+  }
+
+  size_t slot = prv_find_slot(reassembler, device_key);
+  uint32_t device_idx;
+  if (reassembler->index[slot] != 0) {
+    device_idx = reassembler->index[slot] - 1;
+  } else {
+    if (reassembler->free_device_idx == MFLT_NO_DEVICE) {
+      prv_release_device(reassembler, prv_least_recently_active_device(reassembler));
+      reassembler->stats.devices_evicted++;
+      // entries may have moved
+      slot = prv_find_slot(reassembler, device_key);
+    }
+
+    device_idx = reassembler->free_device_idx;
+    device = prv_get_device(reassembler, device_idx);
+    reassembler->free_device_idx = device->next_free_idx;
+    *device = (sMfltReassemblerDevice) {
+      .key = device_key,
+      .next_free_idx = MFLT_NO_DEVICE,
+    };
+    reassembler->index[slot] = device_idx + 1;
+    reassembler->num_devices++;
+  }
+
+  reassembler->last_device_idx = device_idx;
+  device = prv_get_device(reassembler, device_idx);
+  device->last_active = ++reassembler->activity_counter;
+  return device;
+}
+
+static uint16_t prv_read_crc16(const uint8_t *buf) {
+  return (uint16_t)(buf[0] | (buf[1] << 8));
+}
+
+static void prv_drop_msg(sMfltChunkReassembler *reassembler, sMfltReassemblerChannel *channel) {
+  if (channel->in_progress) {
+    reassembler->stats.msgs_dropped++;
+  }
+  channel->in_progress = false;
+  channel->last_msg_size = 0;
+}
+
+static eMfltChunkReassemblerStatus prv_add_init_chunk(
+    sMfltChunkReassembler *reassembler, sMfltReassemblerChannel *channel, uint8_t *msg_buf,
+    bool more_data, const uint8_t *payload, size_t payload_len, sMfltChunkReassemblerMsg *msg) {
+  if (!more_data) {
+    // the whole message is in this chunk so it can be checked in place
+    if (payload_len < MFLT_CHUNK_CRC16_LEN) {
+      return kMfltChunkReassemblerStatus_Malformed;
+    }
+    prv_drop_msg(reassembler, channel);
+    const size_t msg_len = payload_len - MFLT_CHUNK_CRC16_LEN;
+    const uint16_t crc16 =
+        memfault_crc16_ccitt_compute(MEMFAULT_CRC16_CCITT_INITIAL_VALUE, payload, msg_len);
+    if (crc16 != prv_read_crc16(&payload[msg_len])) {
+      return kMfltChunkReassemblerStatus_CrcMismatch;
+    }
+    channel->last_msg_size = (uint32_t)msg_len;
+    msg->data = payload;
+    msg->len = (uint32_t)msg_len;
+    return kMfltChunkReassemblerStatus_MsgComplete;
+  }
+
+  uint32_t total_size;
+  const size_t varint_len = memfault_decode_varint_u32(payload, payload_len, &total_size);
+  const size_t data_len = payload_len - varint_len;
+  if ((varint_len == 0) || (data_len > total_size)) {
+    return kMfltChunkReassemblerStatus_Malformed;
+  }
+  const uint8_t *data = &payload[varint_len];
+
+  if (channel->in_progress && (channel->total_size == total_size) &&
+      (channel->write_offset >= data_len) && (memcmp(msg_buf, data, data_len) == 0)) {
+    return kMfltChunkReassemblerStatus_Duplicate;
+  }
+
+  prv_drop_msg(reassembler, channel);
+  if (total_size > reassembler->cfg.max_msg_size) {
+    return kMfltChunkReassemblerStatus_MsgTooLarge;
+  }
+
+  memcpy(msg_buf, data, data_len);
+  *channel = (sMfltReassemblerChannel) {
+    .in_progress = true,
+    .crc16 = memfault_crc16_ccitt_compute(MEMFAULT_CRC16_CCITT_INITIAL_VALUE, data, data_len),
+    .total_size = total_size,
+    .write_offset = (uint32_t)data_len,
+  };
+  return kMfltChunkReassemblerStatus_MoreData;
+}
+
+static eMfltChunkReassemblerStatus prv_add_continuation_chunk(
+    sMfltChunkReassembler *reassembler, sMfltReassemblerChannel *channel, uint8_t *msg_buf,
+    bool more_data, const uint8_t *payload, size_t payload_len, sMfltChunkReassemblerMsg *msg) {
+  uint32_t offset;
+  const size_t varint_len = memfault_decode_varint_u32(payload, payload_len, &offset);
+  if (varint_len == 0) {
+    return kMfltChunkReassemblerStatus_Malformed;
+  }
+  const uint8_t *data = &payload[varint_len];
+  const size_t rem_len = payload_len - varint_len;
+
+  if (!channel->in_progress) {
+    return (offset < channel->last_msg_size) ? kMfltChunkReassemblerStatus_Duplicate :
+                                               kMfltChunkReassemblerStatus_Gap;
+  }
+
+  if (offset > channel->total_size) {
+    return kMfltChunkReassemblerStatus_Malformed;
+  }
+
+  // The last chunk holds the rest of the message followed by the CRC16. It may be padded out.
+  size_t data_len = rem_len;
+  if (!more_data) {
+    data_len = channel->total_size - offset;
+    if (rem_len < (data_len + MFLT_CHUNK_CRC16_LEN)) {
+      return kMfltChunkReassemblerStatus_Malformed;
+    }
+  } else if (data_len > (channel->total_size - offset)) {
+    return kMfltChunkReassemblerStatus_Malformed;
+  }
+
+  if (offset > channel->write_offset) {
+    prv_drop_msg(reassembler, channel);
+    return kMfltChunkReassemblerStatus_Gap;
+  }
+
+  const size_t end_offset = offset + data_len;
+  if (more_data && (end_offset <= channel->write_offset)) {
+    return kMfltChunkReassemblerStatus_Duplicate;
+  }
+
+  // only the part of the chunk which hasn't been received yet is used
+  const size_t overlap_len = channel->write_offset - offset;
+  const size_t new_len = end_offset - channel->write_offset;
+  memcpy(&msg_buf[channel->write_offset], &data[overlap_len], new_len);
+  channel->crc16 = memfault_crc16_ccitt_compute(channel->crc16, &data[overlap_len], new_len);
+  channel->write_offset += (uint32_t)new_len;
+  if (more_data) {
+    return kMfltChunkReassemblerStatus_MoreData;
+  }
+
+  channel->in_progress = false;
+  if (channel->crc16 != prv_read_crc16(&data[data_len])) {
+    channel->last_msg_size = 0;
+    return kMfltChunkReassemblerStatus_CrcMismatch;
+  }
+  channel->last_msg_size = channel->total_size;
+  msg->data = msg_buf;
+  msg->len = channel->total_size;
+  return kMfltChunkReassemblerStatus_MsgComplete;
+}
+
+static void prv_update_stats(sMfltChunkReassemblerStats *stats,
+                             eMfltChunkReassemblerStatus status) {
+  stats->chunks++;
+  switch (status) {
+    case kMfltChunkReassemblerStatus_MsgComplete:
+      stats->msgs_complete++;
+      break;
+    case kMfltChunkReassemblerStatus_Duplicate:
+      stats->duplicate_chunks++;
+      break;
+    case kMfltChunkReassemblerStatus_Gap:
+      stats->gaps++;
+      break;
+    case kMfltChunkReassemblerStatus_CrcMismatch:
+      stats->crc_errors++;
+      break;
+    case kMfltChunkReassemblerStatus_MsgTooLarge:
+      stats->msgs_too_large++;
+      break;
+    case kMfltChunkReassemblerStatus_Malformed:
+      stats->malformed_chunks++;
+      break;
+    case kMfltChunkReassemblerStatus_MoreData:
+    default:
+      break;
+  }
+}
+
+static eMfltChunkReassemblerStatus prv_add_chunk(sMfltChunkReassembler *reassembler,
+                                                 uint64_t device_key, const uint8_t *chunk,
+                                                 size_t chunk_len, sMfltChunkReassemblerMsg *msg) {
+  if (chunk_len < 1) {
+    return kMfltChunkReassemblerStatus_Malformed;
+  }
+
+  const uint8_t hdr = chunk[0];
+  const bool continuation = (hdr & MFLT_CHUNK_HDR_CONTINUATION) != 0;
+  const bool more_data = (hdr & MFLT_CHUNK_HDR_MD) != 0;
+  const uint8_t cfg = hdr & MFLT_CHUNK_HDR_CFG_MASK;
+  const uint8_t channel_id = hdr & MFLT_CHUNK_HDR_CHANNEL_MASK;
+  if ((channel_id >= reassembler->cfg.num_channels) ||
+      (cfg != (continuation ? 0 : MFLT_CHUNK_HDR_CFG_INIT))) {
+    return kMfltChunkReassemblerStatus_Malformed;
+  }
+
+  sMfltReassemblerDevice *device = prv_lookup_or_add_device(reassembler, device_key);
+  const uint32_t device_idx = (uint32_t)(device - (sMfltReassemblerDevice *)reassembler->devices);
+  sMfltReassemblerChannel *channel = &device->channels[channel_id];
+  uint8_t *msg_buf = prv_get_msg_buf(reassembler, device_idx, channel_id);
+  msg->channel_id = channel_id;
+
+  if (continuation) {
+    return prv_add_continuation_chunk(reassembler, channel, msg_buf, more_data, &chunk[1],
+                                      chunk_len - 1, msg);
+  }
+  return prv_add_init_chunk(reassembler, channel, msg_buf, more_data, &chunk[1], chunk_len - 1,
+                            msg);
+}
+
+eMfltChunkReassemblerStatus memfault_chunk_reassembler_add_chunk(
+    sMfltChunkReassembler *reassembler, uint64_t device_key, const void *chunk, size_t chunk_len,
+    sMfltChunkReassemblerMsg *msg) {
+  if ((reassembler == NULL) || (chunk == NULL) || (msg == NULL)) {
+    return kMfltChunkReassemblerStatus_Malformed;
+  }
+
+  const eMfltChunkReassemblerStatus status =
+      prv_add_chunk(reassembler, device_key, chunk, chunk_len, msg);
+  prv_update_stats(&reassembler->stats, status);
+  return status;
+}
+
+bool memfault_chunk_reassembler_remove_device(sMfltChunkReassembler *reassembler,
+                                              uint64_t device_key) {
+  if (reassembler == NULL) {
+    return false;
+  }
+
+  const size_t slot = prv_find_slot(reassembler, device_key);
+  if (reassembler->index[slot] == 0) {
+    return false;
+  }
+  prv_release_device(reassembler, reassembler->index[slot] - 1);
+  return true;
+}
+
+void memfault_chunk_reassembler_get_stats(const sMfltChunkReassembler *reassembler,
+                                          sMfltChunkReassemblerStats *stats) {
+  *stats = reassembler->stats;
+}
+
+size_t memfault_chunk_reassembler_get_shard(uint64_t device_key, size_t num_shards) {
+  if (num_shards == 0) {
+    return 0;
+  }
+  // use the upper bits since the lower ones pick the slot in the index
+  return (size_t)(prv_hash(device_key) >> 32) % num_shards;
+}
@@ -30,11 +30,13 @@
 typedef struct {
   bool md;
   bool continuation;
+  uint8_t channel_id;
 } sMemfaultHeaderSettings;
 
 static uint8_t prv_build_hdr(const sMemfaultHeaderSettings *settings) {
-  // bits 0-2: channel id (0 - 7) Always 0 at the moment but reserved for future where we want
-  //           prioritization
+  // bits 0-2: channel id (0 - 7) Messages on different channels can be in flight at the same
+  //           time, i.e a small event doesn't have to wait behind a large coredump. The
+  //           consumer reassembles the chunks of each channel independently.
   // bit 3-5:  CFG - Protocol configuration settings
   //           For INIT Packet
   //            0b000 indicates crc16 is written in the init chunk
@@ -52,7 +54,8 @@ static uint8_t prv_build_hdr(const sMemfaultHeaderSettings *settings) {
   // bit 7:    CONT: 0 for INIT, 1 for CONTINUATION
   //           The first chunk in a sequence of chunks must use INIT and following chunks must
   //           use CONTINUATION.
-  uint8_t hdr = ((uint8_t)(settings->continuation << 7) | (uint8_t)(settings->md << 6));
+  uint8_t hdr = ((uint8_t)(settings->continuation << 7) | (uint8_t)(settings->md << 6) |
+                 (settings->channel_id & 0x7));
   if (!settings->continuation) {
     hdr |= 1 << 3;
   }
@@ -94,7 +97,8 @@ bool memfault_chunk_transport_get_next_chunk(sMfltChunkTransportCtx *ctx,
 
     const sMemfaultHeaderSettings init_settings = {
       .md = more_data && !ctx->enable_multi_call_chunk,
-      .continuation = false
+      .continuation = false,
+      .channel_id = ctx->channel_id,
     };
     ctx->single_chunk_message_length = single_msg_size;
 
@@ -124,6 +128,7 @@ bool memfault_chunk_transport_get_next_chunk(sMfltChunkTransportCtx *ctx,
     const sMemfaultHeaderSettings cont_settings = {
       .md = more_data,
       .continuation = true,
+      .channel_id = ctx->channel_id,
     };
     chunk_msg[0] = prv_build_hdr(&cont_settings);
     chunk_msg_start_offset = 1 /* hdr */ + varint_len;
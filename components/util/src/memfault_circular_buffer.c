@@ -13,8 +13,35 @@
 #include <stdint.h>
 #include <string.h>
 
+#include "memfault/config.h"
 #include "memfault/core/math.h"
 
+//! Maps a position to an index within storage. When the storage size is a power of 2, the
+//! (potentially software emulated) division is replaced by a mask.
+static size_t prv_wrap_index(const sMfltCircularBuffer *circular_buf, size_t position) {
+#if MEMFAULT_CIRCULAR_BUFFER_POW2_FAST_PATH_ENABLE
+  if (circular_buf->index_mask != 0) {
+    return position & circular_buf->index_mask;
+  }
+#endif
+  return position % circular_buf->total_space;
+}
+
+//! Describes the data_len bytes of storage starting at index idx, which wrap around the end of
+//! the storage into spans[1] if needed
+static void prv_get_spans(const sMfltCircularBuffer *circular_buf, size_t idx, size_t data_len,
+                          sMfltCircularBufferSpan spans[2]) {
+  const size_t first_span_len = MEMFAULT_MIN(circular_buf->total_space - idx, data_len);
+  spans[0] = (sMfltCircularBufferSpan) {
+    .ptr = &circular_buf->storage[idx],
+    .len = first_span_len,
+  };
+  spans[1] = (sMfltCircularBufferSpan) {
+    .ptr = &circular_buf->storage[0],
+    .len = data_len - first_span_len,
+  };
+}
+
 bool memfault_circular_buffer_init(sMfltCircularBuffer *circular_buf,
                                    void *storage_buf, size_t storage_len) {
   if ((circular_buf == NULL) || (storage_buf == NULL) || (storage_len == 0)) {
@@ -24,9 +51,11 @@ bool memfault_circular_buffer_init(sMfltCircularBuffer *circular_buf,
   // doesn't really matter but put buffer in a clean state for easier debug
   memset(storage_buf, 0x0, storage_len);
 
+  const bool is_pow2 = (storage_len & (storage_len - 1)) == 0;
   *circular_buf = (sMfltCircularBuffer){.read_offset = 0,
                                         .read_size = 0,
                                         .total_space = storage_len,
+                                        .index_mask = is_pow2 ? (storage_len - 1) : 0,
                                         .storage = storage_buf};
 
   return true;
@@ -38,25 +67,32 @@ bool memfault_circular_buffer_read(sMfltCircularBuffer *circular_buf,
     return false;
   }
 
-  if (circular_buf->read_size < (offset + data_len)) {
+  sMfltCircularBufferSpan spans[2];
+  if (!memfault_circular_buffer_get_read_range(circular_buf, offset, data_len, spans)) {
     return false;
   }
 
-  size_t read_idx =
-      (circular_buf->read_offset + offset) % circular_buf->total_space;
-  size_t contiguous_space_available = circular_buf->total_space - read_idx;
-  size_t bytes_to_read = (contiguous_space_available > data_len)
-                             ? data_len
-                             : contiguous_space_available;
-
   uint8_t *buf = data;
-  memcpy(buf, &circular_buf->storage[read_idx], bytes_to_read);
-  buf += bytes_to_read;
-  size_t bytes_rem = data_len - bytes_to_read;
-  if (bytes_rem != 0) {
-    memcpy(buf, &circular_buf->storage[0], bytes_rem);
+  memcpy(buf, spans[0].ptr, spans[0].len);
+  if (spans[1].len != 0) {
+    memcpy(&buf[spans[0].len], spans[1].ptr, spans[1].len);
+  }
+
+  return true;
+}
+
+bool memfault_circular_buffer_get_read_range(sMfltCircularBuffer *circular_buf, size_t offset,
+                                             size_t data_len, sMfltCircularBufferSpan spans[2]) {
+  if ((circular_buf == NULL) || (spans == NULL)) {
+    return false;
   }
 
+  if (circular_buf->read_size < (offset + data_len)) {
+    return false;
+  }
+
+  prv_get_spans(circular_buf, prv_wrap_index(circular_buf, circular_buf->read_offset + offset),
+                data_len, spans);
   return true;
 }
 
@@ -71,7 +107,7 @@ bool memfault_circular_buffer_get_read_pointer(sMfltCircularBuffer *circular_buf
   }
 
   const size_t read_idx =
-      (circular_buf->read_offset + offset) % circular_buf->total_space;
+      prv_wrap_index(circular_buf, circular_buf->read_offset + offset);
   const size_t max_bytes_to_read = circular_buf->read_size - offset;
   const size_t contiguous_space_available = circular_buf->total_space - read_idx;
 
@@ -89,27 +125,20 @@ bool memfault_circular_buffer_read_with_callback(sMfltCircularBuffer *circular_b
   if (callback == NULL) {
     return false;
   }
-  if (circular_buf->read_size < (offset + data_len)) {
+  sMfltCircularBufferSpan spans[2];
+  if (!memfault_circular_buffer_get_read_range(circular_buf, offset, data_len, spans)) {
     return false;
   }
 
-  size_t bytes_left = data_len;
-  uint8_t *read_ptr = NULL;
-  size_t read_ptr_len = 0;
-  while (bytes_left) {
-    const size_t dst_offset = data_len - bytes_left;
-    if (!memfault_circular_buffer_get_read_pointer(
-      circular_buf, offset + dst_offset, &read_ptr, &read_ptr_len)) {
-      // Note: At this point, the memfault_circular_buffer_get_read_pointer() calls should never fail. A
-      // failure is indicative of memory corruption (e.g calls taking place from multiple tasks without
-      // having implemented memfault_lock() / memfault_unlock())
-      return false;
+  size_t dst_offset = 0;
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(spans); i++) {
+    if (spans[i].len == 0) {
+      continue;
     }
-    const size_t bytes_to_read = MEMFAULT_MIN(bytes_left, read_ptr_len);
-    if (!callback(ctx, dst_offset, read_ptr, bytes_to_read)) {
+    if (!callback(ctx, dst_offset, spans[i].ptr, spans[i].len)) {
       return false;
     }
-    bytes_left -= bytes_to_read;
+    dst_offset += spans[i].len;
   }
   return true;
 }
@@ -124,7 +153,7 @@ bool memfault_circular_buffer_consume(sMfltCircularBuffer *circular_buf, size_t
   }
 
   circular_buf->read_offset =
-      (circular_buf->read_offset + consume_len) % circular_buf->total_space;
+      prv_wrap_index(circular_buf, circular_buf->read_offset + consume_len);
   circular_buf->read_size -= consume_len;
   return true;
 }
@@ -171,20 +200,15 @@ static bool prv_write_at_offset_from_end(sMfltCircularBuffer *circular_buf, size
     return false;
   }
 
-  size_t write_idx = (circular_buf->read_offset + circular_buf->read_size - offset_from_end) %
-                     circular_buf->total_space;
-  size_t contiguous_space_available = circular_buf->total_space - write_idx;
-
-  size_t bytes_to_write = (contiguous_space_available > data_len)
-                              ? data_len
-                              : contiguous_space_available;
+  const size_t write_idx = prv_wrap_index(
+      circular_buf, circular_buf->read_offset + circular_buf->read_size - offset_from_end);
+  sMfltCircularBufferSpan spans[2];
+  prv_get_spans(circular_buf, write_idx, data_len, spans);
 
   const uint8_t *buf = data;
-  memcpy(&circular_buf->storage[write_idx], buf, bytes_to_write);
-  buf += bytes_to_write;
-  size_t bytes_rem = data_len - bytes_to_write;
-  if (bytes_rem != 0) {
-    memcpy(&circular_buf->storage[0], buf, bytes_rem);
+  memcpy(spans[0].ptr, buf, spans[0].len);
+  if (spans[1].len != 0) {
+    memcpy(spans[1].ptr, &buf[spans[0].len], spans[1].len);
   }
 
   circular_buf->read_size += new_bytes_to_write;
@@ -201,6 +225,102 @@ bool memfault_circular_buffer_write_at_offset(
   return prv_write_at_offset_from_end(circular_buf, offset_from_end, data, data_len);
 }
 
+static size_t prv_get_write_idx(const sMfltCircularBuffer *circular_buf, size_t offset) {
+  return prv_wrap_index(circular_buf, circular_buf->read_offset + circular_buf->read_size + offset);
+}
+
+bool memfault_circular_buffer_get_write_pointer(sMfltCircularBuffer *circular_buf, size_t offset,
+                                                uint8_t **write_ptr, size_t *write_ptr_len) {
+  if ((circular_buf == NULL) || (write_ptr == NULL) || (write_ptr_len == NULL)) {
+    return false;
+  }
+
+  const size_t space_available = prv_get_space_available(circular_buf);
+  if (space_available < offset) {
+    return false;
+  }
+
+  const size_t write_idx = prv_get_write_idx(circular_buf, offset);
+  const size_t max_bytes_to_write = space_available - offset;
+  const size_t contiguous_space_available = circular_buf->total_space - write_idx;
+
+  *write_ptr = &circular_buf->storage[write_idx];
+  *write_ptr_len = MEMFAULT_MIN(contiguous_space_available, max_bytes_to_write);
+  return true;
+}
+
+bool memfault_circular_buffer_get_write_spans(sMfltCircularBuffer *circular_buf,
+                                              sMfltCircularBufferSpan spans[2]) {
+  if ((circular_buf == NULL) || (spans == NULL)) {
+    return false;
+  }
+
+  return memfault_circular_buffer_get_write_range(
+      circular_buf, 0, prv_get_space_available(circular_buf), spans);
+}
+
+bool memfault_circular_buffer_get_write_range(sMfltCircularBuffer *circular_buf, size_t offset,
+                                              size_t data_len, sMfltCircularBufferSpan spans[2]) {
+  if ((circular_buf == NULL) || (spans == NULL)) {
+    return false;
+  }
+
+  if (prv_get_space_available(circular_buf) < (offset + data_len)) {
+    return false;
+  }
+
+  prv_get_spans(circular_buf, prv_get_write_idx(circular_buf, offset), data_len, spans);
+  return true;
+}
+
+bool memfault_circular_buffer_copy_to_spans(const sMfltCircularBufferSpan spans[2], size_t offset,
+                                            const void *data, size_t data_len) {
+  if ((spans == NULL) || ((data == NULL) && (data_len != 0))) {
+    return false;
+  }
+
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; (i < 2) && (data_len > 0); i++) {
+    if (offset >= spans[i].len) {
+      offset -= spans[i].len;
+      continue;
+    }
+
+    const size_t bytes_to_copy = MEMFAULT_MIN(spans[i].len - offset, data_len);
+    memcpy(&spans[i].ptr[offset], bytes, bytes_to_copy);
+    bytes += bytes_to_copy;
+    data_len -= bytes_to_copy;
+    offset = 0;
+  }
+  return data_len == 0;
+}
+
+bool memfault_circular_buffer_commit_write(sMfltCircularBuffer *circular_buf, size_t data_len) {
+  if (circular_buf == NULL) {
+    return false;
+  }
+
+  if (prv_get_space_available(circular_buf) < data_len) {
+    return false;
+  }
+
+  circular_buf->read_size += data_len;
+  return true;
+}
+
+bool memfault_circular_buffer_reserve(sMfltCircularBuffer *circular_buf, size_t data_len,
+                                      sMfltCircularBufferSpan spans[2]) {
+  if ((circular_buf == NULL) || (spans == NULL)) {
+    return false;
+  }
+
+  if (!memfault_circular_buffer_get_write_range(circular_buf, 0, data_len, spans)) {
+    return false;
+  }
+
+  return memfault_circular_buffer_commit_write(circular_buf, data_len);
+}
+
 size_t memfault_circular_buffer_get_read_size(const sMfltCircularBuffer *circular_buf) {
   if (circular_buf == NULL) {
     return 0;
@@ -0,0 +1,316 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! See header for more details
+
+#include "memfault/util/lz.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/core/math.h"
+#include "memfault/util/varint.h"
+
+#define MEMFAULT_LZ_MATCH_TOKEN_FLAG 0x80
+
+//! Copies the most recently processed byte into the window
+static void prv_window_push(const sMemfaultLzConfig *config, size_t position, uint8_t byte) {
+  if (config->window_size != 0) {
+    ((uint8_t *)config->window)[position % config->window_size] = byte;
+  }
+}
+
+//! Looks up the byte "distance" bytes before "position" in the virtual stream made up of the
+//! dictionary followed by the data processed so far
+//!
+//! @return false if the byte is no longer (or was never) available
+static bool prv_lookup(const sMemfaultLzConfig *config, size_t position, size_t distance,
+                       uint8_t *byte) {
+  if (distance <= position) {
+    // a reference into the data itself must still be in the window
+    if (distance > config->window_size) {
+      return false;
+    }
+    *byte = ((const uint8_t *)config->window)[(position - distance) % config->window_size];
+    return true;
+  }
+
+  const size_t dict_back = distance - position;
+  if (dict_back > config->dict_len) {
+    return false;
+  }
+  *byte = ((const uint8_t *)config->dict)[config->dict_len - dict_back];
+  return true;
+}
+
+//
+// Encoder
+//
+
+static void prv_encoder_write(sMemfaultLzEncoder *encoder, const void *buf, size_t buf_len) {
+  if (encoder->write_cb != NULL) {
+    encoder->write_cb(encoder->write_cb_ctx, buf, buf_len);
+  }
+  encoder->bytes_out += buf_len;
+}
+
+static void prv_encoder_flush_literals(sMemfaultLzEncoder *encoder) {
+  if (encoder->literals_len == 0) {
+    return;
+  }
+
+  const uint8_t token = (uint8_t)(encoder->literals_len - 1);
+  prv_encoder_write(encoder, &token, sizeof(token));
+  prv_encoder_write(encoder, encoder->literals, encoder->literals_len);
+  encoder->literals_len = 0;
+}
+
+//! Moves bytes from the front of the lookahead into the window
+static void prv_encoder_consume_lookahead(sMemfaultLzEncoder *encoder, size_t num_bytes) {
+  for (size_t i = 0; i < num_bytes; i++) {
+    prv_window_push(&encoder->config, encoder->bytes_in, encoder->lookahead[i]);
+    encoder->bytes_in++;
+  }
+  encoder->lookahead_len -= num_bytes;
+  memmove(&encoder->lookahead[0], &encoder->lookahead[num_bytes], encoder->lookahead_len);
+}
+
+//! @return the number of bytes at the front of the lookahead which match the bytes starting
+//! "distance" bytes back
+static size_t prv_encoder_match_len(const sMemfaultLzEncoder *encoder, size_t distance) {
+  size_t len = 0;
+  for (; len < encoder->lookahead_len; len++) {
+    // The decoder resolves every byte of a match "distance" bytes behind its current position so
+    // any byte sourced from the data (rather than the dictionary) must be within a window of it
+    const bool source_in_data = (encoder->bytes_in + len) >= distance;
+    if (source_in_data && (distance > encoder->config.window_size)) {
+      break;
+    }
+
+    uint8_t byte;
+    if (len >= distance) {
+      // the match overlaps the bytes being encoded (i.e a run)
+      byte = encoder->lookahead[len - distance];
+    } else if (!prv_lookup(&encoder->config, encoder->bytes_in, distance - len, &byte)) {
+      break;
+    }
+
+    if (byte != encoder->lookahead[len]) {
+      break;
+    }
+  }
+  return len;
+}
+
+//! prv_encoder_match_len() for a distance within the window, which starts at window_idx. Steps
+//! through the window rather than looking up every byte as this is where encoding spends its time.
+static size_t prv_encoder_window_match_len(const sMemfaultLzEncoder *encoder, size_t distance,
+                                           size_t window_idx) {
+  const uint8_t *window = (const uint8_t *)encoder->config.window;
+  const size_t window_len = MEMFAULT_MIN(distance, encoder->lookahead_len);
+  size_t len = 0;
+  for (; len < window_len; len++) {
+    if (window[window_idx] != encoder->lookahead[len]) {
+      return len;
+    }
+    window_idx = ((window_idx + 1) == encoder->config.window_size) ? 0 : (window_idx + 1);
+  }
+
+  // the rest of the match overlaps the bytes being encoded (i.e a run)
+  for (; len < encoder->lookahead_len; len++) {
+    if (encoder->lookahead[len - distance] != encoder->lookahead[len]) {
+      break;
+    }
+  }
+  return len;
+}
+
+static void prv_encoder_record_match(size_t len, size_t distance, size_t *best_len,
+                                     size_t *best_distance) {
+  if (len > *best_len) {
+    *best_len = len;
+    *best_distance = distance;
+  }
+}
+
+//! Encodes the token at the front of the lookahead
+static void prv_encoder_process(sMemfaultLzEncoder *encoder) {
+  size_t best_len = 0;
+  size_t best_distance = 0;
+
+  // Search the window first so closer (cheaper to encode) matches win ties
+  const size_t history_len = MEMFAULT_MIN(encoder->bytes_in, encoder->config.window_size);
+  const uint8_t *window = (const uint8_t *)encoder->config.window;
+  size_t window_idx =
+      (history_len != 0) ? ((encoder->bytes_in - 1) % encoder->config.window_size) : 0;
+  for (size_t distance = 1;
+       (distance <= history_len) && (best_len < encoder->lookahead_len); distance++) {
+    // most candidates don't even match the first byte so rule those out before comparing in full
+    if (window[window_idx] == encoder->lookahead[0]) {
+      prv_encoder_record_match(prv_encoder_window_match_len(encoder, distance, window_idx),
+                               distance, &best_len, &best_distance);
+    }
+    window_idx = (window_idx == 0) ? (encoder->config.window_size - 1) : (window_idx - 1);
+  }
+  for (size_t i = 0; (i < encoder->config.dict_len) && (best_len < encoder->lookahead_len); i++) {
+    const size_t distance = encoder->bytes_in + encoder->config.dict_len - i;
+    prv_encoder_record_match(prv_encoder_match_len(encoder, distance), distance, &best_len,
+                             &best_distance);
+  }
+
+  uint8_t token[1 + MEMFAULT_UINT32_MAX_VARINT_LENGTH];
+  const size_t token_len = 1 + memfault_encode_varint_u32((uint32_t)best_distance, &token[1]);
+  if ((best_len >= MEMFAULT_LZ_MIN_MATCH_LEN) && (best_len > token_len)) {
+    best_len = MEMFAULT_MIN(best_len, MEMFAULT_LZ_MAX_MATCH_LEN);
+    prv_encoder_flush_literals(encoder);
+    token[0] = (uint8_t)(MEMFAULT_LZ_MATCH_TOKEN_FLAG | (best_len - MEMFAULT_LZ_MIN_MATCH_LEN));
+    prv_encoder_write(encoder, token, token_len);
+    prv_encoder_consume_lookahead(encoder, best_len);
+    return;
+  }
+
+  encoder->literals[encoder->literals_len++] = encoder->lookahead[0];
+  if (encoder->literals_len == sizeof(encoder->literals)) {
+    prv_encoder_flush_literals(encoder);
+  }
+  prv_encoder_consume_lookahead(encoder, 1);
+}
+
+void memfault_lz_encoder_init(sMemfaultLzEncoder *encoder, const sMemfaultLzConfig *config,
+                              MemfaultLzWriteCallback write_cb, void *ctx) {
+  *encoder = (sMemfaultLzEncoder) {
+    .config = *config,
+    .write_cb = write_cb,
+    .write_cb_ctx = ctx,
+  };
+}
+
+void memfault_lz_encode(sMemfaultLzEncoder *encoder, const void *buf, size_t buf_len) {
+  const uint8_t *bytes = (const uint8_t *)buf;
+  while (buf_len > 0) {
+    const size_t bytes_to_copy =
+        MEMFAULT_MIN(buf_len, sizeof(encoder->lookahead) - encoder->lookahead_len);
+    memcpy(&encoder->lookahead[encoder->lookahead_len], bytes, bytes_to_copy);
+    encoder->lookahead_len += bytes_to_copy;
+    bytes += bytes_to_copy;
+    buf_len -= bytes_to_copy;
+
+    // only encode once the lookahead is full so the longest possible matches can be found
+    while (encoder->lookahead_len == sizeof(encoder->lookahead)) {
+      prv_encoder_process(encoder);
+    }
+  }
+}
+
+size_t memfault_lz_encoder_finish(sMemfaultLzEncoder *encoder) {
+  while (encoder->lookahead_len > 0) {
+    prv_encoder_process(encoder);
+  }
+  prv_encoder_flush_literals(encoder);
+  return encoder->bytes_out;
+}
+
+//
+// Decoder
+//
+
+static void prv_decoder_write(sMemfaultLzDecoder *decoder, const uint8_t *buf, size_t buf_len) {
+  for (size_t i = 0; i < buf_len; i++) {
+    prv_window_push(&decoder->config, decoder->bytes_out + i, buf[i]);
+  }
+  decoder->bytes_out += buf_len;
+  decoder->write_cb(decoder->write_cb_ctx, buf, buf_len);
+}
+
+static bool prv_decoder_copy_match(sMemfaultLzDecoder *decoder) {
+  uint8_t chunk[16];
+  size_t bytes_left = decoder->count;
+  while (bytes_left > 0) {
+    // a match can overlap the bytes it produces so resolve each byte after the previous one has
+    // been added to the window
+    const size_t chunk_len = MEMFAULT_MIN(bytes_left, sizeof(chunk));
+    for (size_t i = 0; i < chunk_len; i++) {
+      if (!prv_lookup(&decoder->config, decoder->bytes_out, decoder->distance, &chunk[i])) {
+        return false;
+      }
+      prv_window_push(&decoder->config, decoder->bytes_out, chunk[i]);
+      decoder->bytes_out++;
+    }
+    decoder->write_cb(decoder->write_cb_ctx, chunk, chunk_len);
+    bytes_left -= chunk_len;
+  }
+  return true;
+}
+
+void memfault_lz_decoder_init(sMemfaultLzDecoder *decoder, const sMemfaultLzConfig *config,
+                              MemfaultLzWriteCallback write_cb, void *ctx) {
+  *decoder = (sMemfaultLzDecoder) {
+    .config = *config,
+    .write_cb = write_cb,
+    .write_cb_ctx = ctx,
+    .state = kMemfaultLzDecoderState_Token,
+  };
+}
+
+bool memfault_lz_decode(sMemfaultLzDecoder *decoder, const void *buf, size_t buf_len) {
+  const uint8_t *bytes = (const uint8_t *)buf;
+  while ((buf_len > 0) && (decoder->state != kMemfaultLzDecoderState_Error)) {
+    switch (decoder->state) {
+      case kMemfaultLzDecoderState_Token: {
+        const uint8_t token = *bytes;
+        bytes++;
+        buf_len--;
+        if ((token & MEMFAULT_LZ_MATCH_TOKEN_FLAG) != 0) {
+          decoder->count = (token & ~MEMFAULT_LZ_MATCH_TOKEN_FLAG) + MEMFAULT_LZ_MIN_MATCH_LEN;
+          decoder->distance = 0;
+          decoder->distance_shift = 0;
+          decoder->state = kMemfaultLzDecoderState_Distance;
+        } else {
+          decoder->count = token + 1;
+          decoder->state = kMemfaultLzDecoderState_Literals;
+        }
+        break;
+      }
+      case kMemfaultLzDecoderState_Literals: {
+        const size_t bytes_to_copy = MEMFAULT_MIN(buf_len, decoder->count);
+        prv_decoder_write(decoder, bytes, bytes_to_copy);
+        bytes += bytes_to_copy;
+        buf_len -= bytes_to_copy;
+        decoder->count -= bytes_to_copy;
+        if (decoder->count == 0) {
+          decoder->state = kMemfaultLzDecoderState_Token;
+        }
+        break;
+      }
+      case kMemfaultLzDecoderState_Distance: {
+        const uint8_t byte = *bytes;
+        bytes++;
+        buf_len--;
+        if (decoder->distance_shift >= (7 * MEMFAULT_UINT32_MAX_VARINT_LENGTH)) {
+          decoder->state = kMemfaultLzDecoderState_Error;
+          break;
+        }
+        decoder->distance |= (uint32_t)(byte & 0x7f) << decoder->distance_shift;
+        decoder->distance_shift += 7;
+        if ((byte & 0x80) != 0) {
+          break;
+        }
+
+        const bool success = (decoder->distance != 0) && prv_decoder_copy_match(decoder);
+        decoder->state =
+            success ? kMemfaultLzDecoderState_Token : kMemfaultLzDecoderState_Error;
+        break;
+      }
+      case kMemfaultLzDecoderState_Error:
+      default:
+        break;
+    }
+  }
+
+  return decoder->state != kMemfaultLzDecoderState_Error;
+}
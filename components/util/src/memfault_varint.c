@@ -27,3 +27,22 @@ size_t memfault_encode_varint_si32(int32_t value, void *buf) {
   uint32_t u32_repr = (uint32_t)(value << 1) ^ (uint32_t)(value >> 31);
   return memfault_encode_varint_u32(u32_repr, buf);
 }
+
+size_t memfault_decode_varint_u32(const void *buf, size_t buf_len, uint32_t *value) {
+  const uint8_t *bytes = buf;
+  uint32_t result = 0;
+  for (size_t i = 0; (i < buf_len) && (i < MEMFAULT_UINT32_MAX_VARINT_LENGTH); i++) {
+    const uint8_t byte = bytes[i];
+    if ((i == (MEMFAULT_UINT32_MAX_VARINT_LENGTH - 1)) && (byte > 0x0f)) {
+      // the encoding holds more than 32 bits
+      return 0;
+    }
+
+    result |= (uint32_t)(byte & 0x7f) << (7 * i);
+    if ((byte & 0x80) == 0) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
@@ -20,11 +20,12 @@ COMPONENT_ADD_INCLUDEDIRS += \
 
 # Notes:
 #  1. We --wrap the panicHandler so we can install a coredump collection routine
-#  2. We add the .o for the RLE encoder directly because components get built as
+#  2. We add the .o for the RLE & LZ encoders directly because components get built as
 #     a static library and we want to guarantee the weak functions get loaded
 COMPONENT_ADD_LDFLAGS +=					\
   -Wl,--wrap=panicHandler					\
-  build/memfault/components/core/src/memfault_data_source_rle.o
+  build/memfault/components/core/src/memfault_data_source_rle.o	\
+  build/memfault/components/core/src/memfault_data_source_lz.o
 
 CFLAGS += \
   -DMEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED=1 \
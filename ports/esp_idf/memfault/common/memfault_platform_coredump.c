@@ -32,6 +32,12 @@
 #error "Memfault SDK integration requires CONFIG_ESP32_ENABLE_COREDUMP_TO_FLASH=y sdkconfig setting"
 #endif
 
+// __wrap_esp_core_dump_image_get() hands out the raw coredump partition. A coredump RLE encoded
+// on save starts after a storage header and cannot be decoded without the Memfault packetizer
+#if MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE
+#error "MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE is not supported by the esp-idf port"
+#endif
+
 #define ESP_IDF_COREDUMP_PART_INIT_MAGIC 0x45524f43
 
 // If there is no coredump partition defined or one cannot be defined
@@ -0,0 +1,110 @@
+#pragma once
+
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! A reference implementation of the non-volatile event storage dependencies
+//! (g_memfault_platform_nv_event_storage_impl) which keeps events in a log spread across the
+//! sectors of a NOR flash region.
+//!
+//! To use:
+//!
+//! 1. Add ports/nv_event_storage/src/memfault_flash_nv_event_storage.c to your build
+//! 2. Implement a sMemfaultFlashBackend for the flash region to use
+//! 3. Call memfault_flash_nv_event_storage_boot() before memfault_events_storage_boot()
+//! 4. Call memfault_event_storage_persist() periodically (i.e from
+//!    memfault_event_storage_request_persist_callback())
+//!
+//! Design:
+//!  - The first page of every sector holds a header with a sequence number & erase count. The
+//!    rest of the sector holds log records. Sectors are used in order so every sector gets erased
+//!    the same number of times.
+//!  - Writes are collected in a RAM page buffer and a page is only programmed once it is full (or
+//!    memfault_flash_nv_event_storage_flush() is called) so a page is never programmed twice.
+//!  - Every time an event is consumed, a checkpoint holding the position of the next unread event
+//!    is appended to the log. On boot, the log is replayed to find the most recent checkpoint.
+//!  - Records never straddle two sectors so a sector which was only partially erased when power
+//!    was lost can be skipped without losing track of the records which follow.
+//!
+//! Usage Notes:
+//!  - Events which have not been flushed are lost if the device reboots. Every
+//!    memfault_event_storage_persist() call ends with a flush but events consumed afterwards are
+//!    only recorded once a page fills up. Call memfault_flash_nv_event_storage_flush() before an
+//!    orderly shutdown.
+//!  - If the log is full, the checkpoint for a consumed event is not written so the event may be
+//!    read out a second time after a reboot.
+//!  - A single event can be no larger than a sector minus its header page & the record overhead.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! The flash operations the storage is built on top of. Addresses are relative to the start of
+//! the region used for storage.
+typedef struct MemfaultFlashBackend {
+  //! User provided context passed to each operation
+  void *ctx;
+  size_t sector_size;
+  //! Must be at least 2
+  size_t num_sectors;
+  //! The unit of programming. Must evenly divide sector_size.
+  size_t page_size;
+
+  //! @return true if the read was successful, false otherwise
+  bool (*read)(void *ctx, uint32_t addr, void *buf, size_t buf_len);
+  //! Programs a whole page. addr is always page aligned and buf_len is always page_size.
+  //! @return true if the write was successful, false otherwise
+  bool (*program)(void *ctx, uint32_t addr, const void *buf, size_t buf_len);
+  //! Erases the sector starting at addr, setting all its bytes to 0xff
+  //! @return true if the erase was successful, false otherwise
+  bool (*erase)(void *ctx, uint32_t addr);
+} sMemfaultFlashBackend;
+
+typedef struct {
+  const sMemfaultFlashBackend *flash;
+  //! Scratch buffer of flash->page_size bytes used to coalesce writes. Must remain valid for as
+  //! long as the storage is in use.
+  void *page_buf;
+} sMemfaultFlashNvEventStorageConfig;
+
+typedef struct {
+  //! Number of events which have not been consumed yet
+  uint32_t events_pending;
+  //! Log space in use by unconsumed events & the records interleaved with them
+  size_t bytes_used;
+  //! Log space which can be written before an unconsumed sector would need to be erased
+  size_t bytes_free;
+  //! Range of the erase counts held in the sector headers
+  uint32_t min_erase_count;
+  uint32_t max_erase_count;
+} sMemfaultFlashNvEventStorageInfo;
+
+//! Recovers the log from flash (or formats the region if no log is found) and enables the
+//! non-volatile event storage
+//!
+//! @note The backend is copied but the page buffer is used in place.
+//!
+//! @return false if the config is invalid or the flash could not be accessed
+bool memfault_flash_nv_event_storage_boot(const sMemfaultFlashNvEventStorageConfig *config);
+
+//! Programs any data still held in the page buffer to flash
+//!
+//! @note The rest of the page is left unused so calling this after every event defeats the
+//! write coalescing.
+//!
+//! @return true if all data written so far is in flash, false otherwise
+bool memfault_flash_nv_event_storage_flush(void);
+
+//! @return false if the storage has not been booted, true otherwise
+bool memfault_flash_nv_event_storage_get_info(sMemfaultFlashNvEventStorageInfo *info);
+
+#ifdef __cplusplus
+}
+#endif
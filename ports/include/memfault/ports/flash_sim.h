@@ -0,0 +1,71 @@
+#pragma once
+
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! A RAM backed simulation of a NOR flash part which implements sMemfaultFlashBackend. This makes
+//! it possible to exercise and benchmark flash based storage (i.e the flash NV event storage port)
+//! on a host machine.
+//!
+//! Like real NOR flash, programming can only clear bits and an erase sets every byte of a sector
+//! back to 0xff. The contents can be saved to / loaded from a file to emulate a reboot across
+//! processes and a power cut can be injected after a given number of operations.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "memfault/ports/flash_nv_event_storage.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  //! Backend to hand to the storage. ctx points back to this structure.
+  sMemfaultFlashBackend backend;
+  uint8_t *storage;
+
+  //! When >= 0, the number of program & erase operations which will complete before power is
+  //! cut. The operation during which power is lost only completes half of its work and every
+  //! operation afterwards fails until memfault_flash_sim_power_on() is called.
+  int32_t ops_until_power_cut;
+  bool powered_off;
+
+  //! Operation counters, can be reset by the user at any time
+  uint32_t num_reads;
+  uint32_t num_programs;
+  uint32_t num_erases;
+  //! Number of programs which tried to flip a bit from 0 to 1, something real flash can't do
+  uint32_t num_program_errors;
+} sMemfaultFlashSim;
+
+//! Initializes a simulated flash
+//!
+//! @param storage Buffer of sector_size * num_sectors bytes backing the flash. Its contents are
+//!  left as is so a buffer which persists across "reboots" can be reused.
+void memfault_flash_sim_init(sMemfaultFlashSim *sim, void *storage, size_t sector_size,
+                             size_t num_sectors, size_t page_size);
+
+//! Sets every byte of the simulated flash to 0xff, as if it was new
+void memfault_flash_sim_erase_all(sMemfaultFlashSim *sim);
+
+//! Restores power after a simulated power cut & disables further power cuts
+void memfault_flash_sim_power_on(sMemfaultFlashSim *sim);
+
+//! Saves the contents of the simulated flash to a file
+//!
+//! @return true if the file was written successfully, false otherwise
+bool memfault_flash_sim_save(const sMemfaultFlashSim *sim, const char *path);
+
+//! Loads the contents of the simulated flash from a file saved with memfault_flash_sim_save()
+//!
+//! @return true if the file was read and matches the size of the simulated flash, false otherwise
+bool memfault_flash_sim_load(sMemfaultFlashSim *sim, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,676 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! A log-structured implementation of the non-volatile event storage dependencies on top of NOR
+//! flash. See header for more details.
+//!
+//! Positions in the log are "logical" addresses which only ever increase. The data area of a
+//! sector (everything after its header page) holds the log bytes [seq * data_per_sector,
+//! (seq + 1) * data_per_sector) where "seq" is the sequence number found in the sector header.
+//! Sequence number "seq" always lives in physical sector "seq % num_sectors".
+//!
+//! Sector header: magic (u32) | seq (u32) | erase count (u32) | crc16 of the preceding bytes
+//! Event record:  0xe1 | length (u32) | crc16 of data | crc16 of the preceding bytes | data
+//! Checkpoint:    0xc1 | read position (u64) | crc16 of the preceding bytes
+//!
+//! All integers are little endian. A 0xff byte where a record is expected means the rest of the
+//! page is unused and a fully erased page means the rest of the sector is unused.
+
+#include "memfault/ports/flash_nv_event_storage.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/core/math.h"
+#include "memfault/core/platform/nonvolatile_event_storage.h"
+#include "memfault/core/platform/overrides.h"
+#include "memfault/util/crc16_ccitt.h"
+
+#define MEMFAULT_FLASH_NV_SECTOR_MAGIC 0x564e464d // "MFNV"
+#define MEMFAULT_FLASH_NV_SECTOR_HDR_LEN 14
+
+#define MEMFAULT_FLASH_NV_RECORD_EVENT 0xe1
+#define MEMFAULT_FLASH_NV_EVENT_HDR_LEN 9
+#define MEMFAULT_FLASH_NV_RECORD_CHECKPOINT 0xc1
+#define MEMFAULT_FLASH_NV_CHECKPOINT_LEN 11
+#define MEMFAULT_FLASH_NV_MAX_RECORD_HDR_LEN MEMFAULT_FLASH_NV_CHECKPOINT_LEN
+
+#define MEMFAULT_FLASH_NV_ERASED_BYTE 0xff
+#define MEMFAULT_FLASH_NV_NO_POS UINT64_MAX
+
+typedef struct {
+  uint32_t seq;
+  uint32_t erase_count;
+} sMemfaultFlashNvSectorHeader;
+
+typedef enum {
+  kMemfaultFlashNvRecord_Event,
+  kMemfaultFlashNvRecord_Checkpoint,
+} eMemfaultFlashNvRecordType;
+
+typedef struct {
+  eMemfaultFlashNvRecordType type;
+  //! Total size of the record, including its header
+  size_t len;
+  //! Event records only
+  size_t data_len;
+  uint16_t data_crc;
+  //! Checkpoint records only
+  uint64_t checkpoint;
+} sMemfaultFlashNvRecord;
+
+typedef struct {
+  bool booted;
+  //! Set when a flash operation fails. The storage is disabled until it is booted again.
+  bool failed;
+  sMemfaultFlashBackend flash;
+  uint8_t *page_buf;
+  size_t data_per_sector;
+  //! Sequence number of the most recently prepared sector
+  uint32_t head_seq;
+  //! Position of the oldest record which may still hold an unconsumed event
+  uint64_t read_pos;
+  //! Position the next record will be written at
+  uint64_t write_pos;
+  //! Position of the page held in page_buf. Everything before it is in flash.
+  uint64_t page_pos;
+  //! Position of the most recent checkpoint record if it is still in page_buf
+  uint64_t last_checkpoint_pos;
+  uint32_t events_pending;
+  //! The event found by has_event() which read() & consume() operate on
+  bool event_found;
+  uint64_t event_data_pos;
+  size_t event_len;
+} sMemfaultFlashNvEventStorageState;
+
+static sMemfaultFlashNvEventStorageState s_nv;
+
+//
+// Helpers
+//
+
+static void prv_put_le(uint8_t *buf, uint64_t value, size_t num_bytes) {
+  for (size_t i = 0; i < num_bytes; i++) {
+    buf[i] = (uint8_t)(value >> (8 * i));
+  }
+}
+
+static uint64_t prv_get_le(const uint8_t *buf, size_t num_bytes) {
+  uint64_t value = 0;
+  for (size_t i = 0; i < num_bytes; i++) {
+    value |= (uint64_t)buf[i] << (8 * i);
+  }
+  return value;
+}
+
+static uint16_t prv_crc16(const void *data, size_t data_len) {
+  return memfault_crc16_ccitt_compute(MEMFAULT_CRC16_CCITT_INITIAL_VALUE, data, data_len);
+}
+
+static uint64_t prv_sector_start(uint64_t pos) {
+  return pos - (pos % s_nv.data_per_sector);
+}
+
+static uint64_t prv_next_page(uint64_t pos) {
+  return pos - (pos % s_nv.flash.page_size) + s_nv.flash.page_size;
+}
+
+static uint32_t prv_sector_addr(uint64_t seq) {
+  return (uint32_t)((seq % s_nv.flash.num_sectors) * s_nv.flash.sector_size);
+}
+
+static uint32_t prv_flash_addr(uint64_t pos) {
+  const uint64_t seq = pos / s_nv.data_per_sector;
+  return prv_sector_addr(seq) + (uint32_t)(s_nv.flash.page_size + (pos % s_nv.data_per_sector));
+}
+
+//! @return the position the log can grow up to without erasing a sector holding unread data
+static uint64_t prv_write_limit(void) {
+  return prv_sector_start(s_nv.read_pos) + (s_nv.flash.num_sectors * s_nv.data_per_sector);
+}
+
+//
+// Flash access
+//
+
+//! Reads bytes from the log. The range must be within a single sector and is served from the page
+//! buffer for anything which has not been programmed yet.
+static bool prv_log_read(uint64_t pos, void *buf, size_t buf_len) {
+  uint8_t *bytes = (uint8_t *)buf;
+  if (pos < s_nv.page_pos) {
+    const size_t flash_len = (size_t)MEMFAULT_MIN((uint64_t)buf_len, s_nv.page_pos - pos);
+    if (!s_nv.flash.read(s_nv.flash.ctx, prv_flash_addr(pos), bytes, flash_len)) {
+      s_nv.failed = true;
+      return false;
+    }
+    pos += flash_len;
+    bytes += flash_len;
+    buf_len -= flash_len;
+  }
+
+  if (buf_len > 0) {
+    memcpy(bytes, &s_nv.page_buf[pos - s_nv.page_pos], buf_len);
+  }
+  return true;
+}
+
+static bool prv_page_erased(uint64_t pos, bool *erased) {
+  uint8_t chunk[32];
+  for (size_t offset = 0; offset < s_nv.flash.page_size; offset += sizeof(chunk)) {
+    const size_t chunk_len = MEMFAULT_MIN(sizeof(chunk), s_nv.flash.page_size - offset);
+    if (!prv_log_read(pos + offset, chunk, chunk_len)) {
+      return false;
+    }
+    for (size_t i = 0; i < chunk_len; i++) {
+      if (chunk[i] != MEMFAULT_FLASH_NV_ERASED_BYTE) {
+        *erased = false;
+        return true;
+      }
+    }
+  }
+  *erased = true;
+  return true;
+}
+
+static bool prv_read_sector_header(size_t sector, sMemfaultFlashNvSectorHeader *hdr) {
+  uint8_t buf[MEMFAULT_FLASH_NV_SECTOR_HDR_LEN];
+  const uint32_t addr = (uint32_t)(sector * s_nv.flash.sector_size);
+  if (!s_nv.flash.read(s_nv.flash.ctx, addr, buf, sizeof(buf))) {
+    s_nv.failed = true;
+    return false;
+  }
+
+  const size_t crc_offset = sizeof(buf) - sizeof(uint16_t);
+  if ((prv_get_le(&buf[0], 4) != MEMFAULT_FLASH_NV_SECTOR_MAGIC) ||
+      (prv_get_le(&buf[crc_offset], 2) != prv_crc16(buf, crc_offset))) {
+    return false;
+  }
+
+  *hdr = (sMemfaultFlashNvSectorHeader) {
+    .seq = (uint32_t)prv_get_le(&buf[4], 4),
+    .erase_count = (uint32_t)prv_get_le(&buf[8], 4),
+  };
+  // a sector holding a sequence number which doesn't belong there is stale
+  return (hdr->seq % s_nv.flash.num_sectors) == sector;
+}
+
+//! Erases the sector which will hold sequence number "seq" and writes its header
+//!
+//! @note Only called when the page buffer is empty so it can be used to stage the header
+static bool prv_prepare_sector(uint32_t seq) {
+  const size_t sector = seq % s_nv.flash.num_sectors;
+  sMemfaultFlashNvSectorHeader old_hdr;
+  const uint32_t erase_count =
+      prv_read_sector_header(sector, &old_hdr) ? (old_hdr.erase_count + 1) : 1;
+  if (s_nv.failed) {
+    return false;
+  }
+
+  const uint32_t addr = prv_sector_addr(seq);
+  uint8_t *hdr = s_nv.page_buf;
+  prv_put_le(&hdr[0], MEMFAULT_FLASH_NV_SECTOR_MAGIC, 4);
+  prv_put_le(&hdr[4], seq, 4);
+  prv_put_le(&hdr[8], erase_count, 4);
+  prv_put_le(&hdr[12], prv_crc16(hdr, 12), 2);
+  const bool success = s_nv.flash.erase(s_nv.flash.ctx, addr) &&
+                       s_nv.flash.program(s_nv.flash.ctx, addr, hdr, s_nv.flash.page_size);
+  memset(s_nv.page_buf, MEMFAULT_FLASH_NV_ERASED_BYTE, s_nv.flash.page_size);
+  if (!success) {
+    s_nv.failed = true;
+    return false;
+  }
+
+  s_nv.head_seq = seq;
+  return true;
+}
+
+//! Programs the page buffer, leaving any bytes which haven't been written to erased
+static bool prv_program_page(void) {
+  if (!s_nv.flash.program(s_nv.flash.ctx, prv_flash_addr(s_nv.page_pos), s_nv.page_buf,
+                          s_nv.flash.page_size)) {
+    s_nv.failed = true;
+    return false;
+  }
+  memset(s_nv.page_buf, MEMFAULT_FLASH_NV_ERASED_BYTE, s_nv.flash.page_size);
+  s_nv.page_pos += s_nv.flash.page_size;
+  s_nv.write_pos = s_nv.page_pos;
+  return true;
+}
+
+static bool prv_flush(void) {
+  if (s_nv.write_pos == s_nv.page_pos) {
+    return true;
+  }
+  return prv_program_page();
+}
+
+//! Makes sure a record of "len" bytes can be appended, moving to the next sector if it doesn't
+//! fit in the current one
+static bool prv_reserve(size_t len) {
+  uint64_t pos = s_nv.write_pos;
+  if (((pos % s_nv.data_per_sector) + len) > s_nv.data_per_sector) {
+    pos = prv_sector_start(pos) + s_nv.data_per_sector;
+  }
+  if ((pos + len) > prv_write_limit()) {
+    return false;
+  }
+
+  if (pos != s_nv.write_pos) {
+    if (!prv_flush()) {
+      return false;
+    }
+    s_nv.write_pos = pos;
+    s_nv.page_pos = pos;
+  }
+  return true;
+}
+
+static bool prv_append(const void *data, size_t data_len) {
+  const uint8_t *bytes = (const uint8_t *)data;
+  while (data_len > 0) {
+    const uint64_t seq = s_nv.write_pos / s_nv.data_per_sector;
+    if ((seq > s_nv.head_seq) && !prv_prepare_sector((uint32_t)seq)) {
+      return false;
+    }
+
+    const size_t offset = (size_t)(s_nv.write_pos - s_nv.page_pos);
+    const size_t bytes_to_copy = MEMFAULT_MIN(data_len, s_nv.flash.page_size - offset);
+    memcpy(&s_nv.page_buf[offset], bytes, bytes_to_copy);
+    s_nv.write_pos += bytes_to_copy;
+    bytes += bytes_to_copy;
+    data_len -= bytes_to_copy;
+
+    if (((s_nv.write_pos - s_nv.page_pos) == s_nv.flash.page_size) && !prv_program_page()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+//
+// Records
+//
+
+static bool prv_parse_record(const uint8_t *hdr, size_t hdr_len, size_t bytes_left,
+                             sMemfaultFlashNvRecord *record) {
+  switch (hdr[0]) {
+    case MEMFAULT_FLASH_NV_RECORD_EVENT: {
+      const size_t crc_offset = MEMFAULT_FLASH_NV_EVENT_HDR_LEN - sizeof(uint16_t);
+      if ((hdr_len < MEMFAULT_FLASH_NV_EVENT_HDR_LEN) ||
+          (prv_get_le(&hdr[crc_offset], 2) != prv_crc16(hdr, crc_offset))) {
+        return false;
+      }
+      const uint64_t data_len = prv_get_le(&hdr[1], 4);
+      if ((MEMFAULT_FLASH_NV_EVENT_HDR_LEN + data_len) > bytes_left) {
+        return false;
+      }
+      *record = (sMemfaultFlashNvRecord) {
+        .type = kMemfaultFlashNvRecord_Event,
+        .len = MEMFAULT_FLASH_NV_EVENT_HDR_LEN + (size_t)data_len,
+        .data_len = (size_t)data_len,
+        .data_crc = (uint16_t)prv_get_le(&hdr[5], 2),
+      };
+      return true;
+    }
+    case MEMFAULT_FLASH_NV_RECORD_CHECKPOINT: {
+      const size_t crc_offset = MEMFAULT_FLASH_NV_CHECKPOINT_LEN - sizeof(uint16_t);
+      if ((hdr_len < MEMFAULT_FLASH_NV_CHECKPOINT_LEN) ||
+          (prv_get_le(&hdr[crc_offset], 2) != prv_crc16(hdr, crc_offset))) {
+        return false;
+      }
+      *record = (sMemfaultFlashNvRecord) {
+        .type = kMemfaultFlashNvRecord_Checkpoint,
+        .len = MEMFAULT_FLASH_NV_CHECKPOINT_LEN,
+        .checkpoint = prv_get_le(&hdr[1], 8),
+      };
+      return true;
+    }
+    default:
+      return false;
+  }
+}
+
+//! Finds the first record at or after *pos, skipping over unused space as well as anything which
+//! can't be parsed (i.e a record torn by a power loss). Records written after such a failure always
+//! start on a page boundary so the search resumes at the next page.
+//!
+//! @return true if a record was found before "limit", in which case *pos is its position
+static bool prv_find_record(uint64_t *pos, uint64_t limit, sMemfaultFlashNvRecord *record) {
+  while (*pos < limit) {
+    const size_t bytes_left = s_nv.data_per_sector - (size_t)(*pos % s_nv.data_per_sector);
+    const size_t hdr_len = (size_t)MEMFAULT_MIN(
+        MEMFAULT_MIN((uint64_t)MEMFAULT_FLASH_NV_MAX_RECORD_HDR_LEN, bytes_left), limit - *pos);
+    uint8_t hdr[MEMFAULT_FLASH_NV_MAX_RECORD_HDR_LEN];
+    if (!prv_log_read(*pos, hdr, hdr_len)) {
+      return false;
+    }
+
+    if (prv_parse_record(hdr, hdr_len, bytes_left, record)) {
+      return true;
+    }
+
+    if ((hdr[0] == MEMFAULT_FLASH_NV_ERASED_BYTE) && ((*pos % s_nv.flash.page_size) == 0)) {
+      bool erased;
+      if (!prv_page_erased(*pos, &erased)) {
+        return false;
+      }
+      if (erased) {
+        *pos = MEMFAULT_MIN(prv_sector_start(*pos) + s_nv.data_per_sector, limit);
+        continue;
+      }
+    }
+    *pos = MEMFAULT_MIN(prv_next_page(*pos), limit);
+  }
+  return false;
+}
+
+static bool prv_event_data_valid(uint64_t data_pos, const sMemfaultFlashNvRecord *record) {
+  uint16_t crc = MEMFAULT_CRC16_CCITT_INITIAL_VALUE;
+  uint8_t chunk[32];
+  for (size_t offset = 0; offset < record->data_len; offset += sizeof(chunk)) {
+    const size_t chunk_len = MEMFAULT_MIN(sizeof(chunk), record->data_len - offset);
+    if (!prv_log_read(data_pos + offset, chunk, chunk_len)) {
+      return false;
+    }
+    crc = memfault_crc16_ccitt_compute(crc, chunk, chunk_len);
+  }
+  return crc == record->data_crc;
+}
+
+static bool prv_enabled(void) {
+  return s_nv.booted && !s_nv.failed;
+}
+
+//! Locates the next unread event. Each event's data is validated the first time it is found so
+//! repeated calls only cost a comparison.
+static bool prv_find_next_event(void) {
+  sMemfaultFlashNvRecord record;
+  while (!s_nv.event_found && prv_enabled() &&
+         prv_find_record(&s_nv.read_pos, s_nv.write_pos, &record)) {
+    if (record.type != kMemfaultFlashNvRecord_Event) {
+      s_nv.read_pos += record.len;
+      continue;
+    }
+
+    const uint64_t data_pos = s_nv.read_pos + MEMFAULT_FLASH_NV_EVENT_HDR_LEN;
+    if (prv_event_data_valid(data_pos, &record)) {
+      s_nv.event_found = true;
+      s_nv.event_data_pos = data_pos;
+      s_nv.event_len = record.data_len;
+      break;
+    }
+
+    // the event was only partially written, drop it
+    s_nv.read_pos += record.len;
+    s_nv.events_pending -= (s_nv.events_pending > 0) ? 1 : 0;
+  }
+  return s_nv.event_found && prv_enabled();
+}
+
+static void prv_write_checkpoint(void) {
+  uint8_t checkpoint[MEMFAULT_FLASH_NV_CHECKPOINT_LEN];
+  checkpoint[0] = MEMFAULT_FLASH_NV_RECORD_CHECKPOINT;
+  prv_put_le(&checkpoint[1], s_nv.read_pos, 8);
+  prv_put_le(&checkpoint[9], prv_crc16(checkpoint, 9), 2);
+
+  // A checkpoint which hasn't made it to flash yet can simply be updated in place
+  if ((s_nv.last_checkpoint_pos != MEMFAULT_FLASH_NV_NO_POS) &&
+      (s_nv.last_checkpoint_pos >= s_nv.page_pos) &&
+      ((s_nv.last_checkpoint_pos + sizeof(checkpoint)) == s_nv.write_pos)) {
+    memcpy(&s_nv.page_buf[s_nv.last_checkpoint_pos - s_nv.page_pos], checkpoint,
+           sizeof(checkpoint));
+    return;
+  }
+
+  // If there's no space, the checkpoint is skipped. Worst case, events get read a second time
+  // after a reboot.
+  if (!prv_reserve(sizeof(checkpoint))) {
+    return;
+  }
+  const uint64_t pos = s_nv.write_pos;
+  if (prv_append(checkpoint, sizeof(checkpoint))) {
+    s_nv.last_checkpoint_pos = pos;
+  }
+}
+
+//
+// sMemfaultNonVolatileEventStorageImpl
+//
+
+static bool prv_nv_event_storage_enabled(void) {
+  return prv_enabled();
+}
+
+static bool prv_nv_event_storage_has_event(size_t *event_length_out) {
+  memfault_lock();
+  const bool found = prv_find_next_event();
+  if (found) {
+    *event_length_out = s_nv.event_len;
+  }
+  memfault_unlock();
+  return found;
+}
+
+static bool prv_nv_event_storage_read(uint32_t offset, void *buf, size_t buf_len) {
+  memfault_lock();
+  const bool success = prv_find_next_event() && ((offset + buf_len) <= s_nv.event_len) &&
+                       prv_log_read(s_nv.event_data_pos + offset, buf, buf_len);
+  memfault_unlock();
+  return success;
+}
+
+static void prv_nv_event_storage_consume(void) {
+  memfault_lock();
+  if (prv_find_next_event()) {
+    s_nv.read_pos = s_nv.event_data_pos + s_nv.event_len;
+    s_nv.event_found = false;
+    s_nv.events_pending -= (s_nv.events_pending > 0) ? 1 : 0;
+    prv_write_checkpoint();
+  }
+  memfault_unlock();
+}
+
+static bool prv_nv_event_storage_write(MemfaultEventReadCallback reader_callback,
+                                       size_t total_size) {
+  if (!prv_enabled() ||
+      ((MEMFAULT_FLASH_NV_EVENT_HDR_LEN + total_size) > s_nv.data_per_sector)) {
+    return false;
+  }
+
+  // The event is read twice, first to compute its crc, then to write it. This way the header
+  // (which holds the crc) can be written first and the event can be streamed straight to flash.
+  uint8_t chunk[32];
+  uint16_t data_crc = MEMFAULT_CRC16_CCITT_INITIAL_VALUE;
+  for (size_t offset = 0; offset < total_size; offset += sizeof(chunk)) {
+    const size_t chunk_len = MEMFAULT_MIN(sizeof(chunk), total_size - offset);
+    if (!reader_callback((uint32_t)offset, chunk, chunk_len)) {
+      return false;
+    }
+    data_crc = memfault_crc16_ccitt_compute(data_crc, chunk, chunk_len);
+  }
+
+  uint8_t hdr[MEMFAULT_FLASH_NV_EVENT_HDR_LEN];
+  hdr[0] = MEMFAULT_FLASH_NV_RECORD_EVENT;
+  prv_put_le(&hdr[1], total_size, 4);
+  prv_put_le(&hdr[5], data_crc, 2);
+  prv_put_le(&hdr[7], prv_crc16(hdr, 7), 2);
+
+  memfault_lock();
+  bool success = prv_reserve(MEMFAULT_FLASH_NV_EVENT_HDR_LEN + total_size) &&
+                 prv_append(hdr, sizeof(hdr));
+  bool read_ok = true;
+  for (size_t offset = 0; success && (offset < total_size); offset += sizeof(chunk)) {
+    const size_t chunk_len = MEMFAULT_MIN(sizeof(chunk), total_size - offset);
+    if (read_ok && !reader_callback((uint32_t)offset, chunk, chunk_len)) {
+      // Space has already been claimed so fill it. The crc won't match so the event is dropped
+      // when it is read back.
+      read_ok = false;
+    }
+    if (!read_ok) {
+      memset(chunk, 0x0, chunk_len);
+    }
+    success = prv_append(chunk, chunk_len);
+  }
+  if (success) {
+    s_nv.events_pending++;
+  }
+  memfault_unlock();
+  return success && read_ok;
+}
+
+const sMemfaultNonVolatileEventStorageImpl g_memfault_platform_nv_event_storage_impl = {
+  .enabled = prv_nv_event_storage_enabled,
+  .has_event = prv_nv_event_storage_has_event,
+  .read = prv_nv_event_storage_read,
+  .consume = prv_nv_event_storage_consume,
+  .write = prv_nv_event_storage_write,
+  .flush = memfault_flash_nv_event_storage_flush,
+};
+
+//
+// Public API
+//
+
+static bool prv_config_valid(const sMemfaultFlashNvEventStorageConfig *config) {
+  if ((config == NULL) || (config->flash == NULL) || (config->page_buf == NULL)) {
+    return false;
+  }
+  const sMemfaultFlashBackend *flash = config->flash;
+  return (flash->read != NULL) && (flash->program != NULL) && (flash->erase != NULL) &&
+         (flash->num_sectors >= 2) && (flash->page_size >= MEMFAULT_FLASH_NV_SECTOR_HDR_LEN) &&
+         ((flash->sector_size % flash->page_size) == 0) &&
+         (flash->sector_size >= (2 * flash->page_size));
+}
+
+//! Replays the log to find where reading & writing left off
+static bool prv_recover(uint32_t newest_seq) {
+  uint32_t oldest_seq = newest_seq;
+  sMemfaultFlashNvSectorHeader hdr;
+  while ((oldest_seq > 0) && ((newest_seq - oldest_seq + 1) < s_nv.flash.num_sectors) &&
+         prv_read_sector_header((oldest_seq - 1) % s_nv.flash.num_sectors, &hdr) &&
+         (hdr.seq == (oldest_seq - 1))) {
+    oldest_seq--;
+  }
+
+  const uint64_t head_start = (uint64_t)newest_seq * s_nv.data_per_sector;
+  const uint64_t head_end = head_start + s_nv.data_per_sector;
+  uint64_t pos = (uint64_t)oldest_seq * s_nv.data_per_sector;
+  uint64_t read_pos = pos;
+  uint64_t log_end = pos;
+  sMemfaultFlashNvRecord record;
+  while (prv_find_record(&pos, head_end, &record)) {
+    if ((record.type == kMemfaultFlashNvRecord_Checkpoint) && (record.checkpoint > read_pos) &&
+        (record.checkpoint <= pos)) {
+      read_pos = record.checkpoint;
+    }
+    pos += record.len;
+    log_end = pos;
+  }
+  if (s_nv.failed) {
+    return false;
+  }
+
+  // Writes resume at the first erased page which follows the log. Anything in between was torn
+  // by a power loss.
+  uint64_t write_pos = MEMFAULT_MAX(log_end, head_start);
+  if ((write_pos % s_nv.flash.page_size) != 0) {
+    write_pos = prv_next_page(write_pos);
+  }
+  bool erased = false;
+  while ((write_pos < head_end) && prv_page_erased(write_pos, &erased) && !erased) {
+    write_pos += s_nv.flash.page_size;
+  }
+  if (s_nv.failed) {
+    return false;
+  }
+
+  s_nv.head_seq = newest_seq;
+  s_nv.write_pos = write_pos;
+  s_nv.page_pos = write_pos;
+  s_nv.read_pos = MEMFAULT_MIN(read_pos, write_pos);
+
+  pos = s_nv.read_pos;
+  while (prv_find_record(&pos, s_nv.write_pos, &record)) {
+    if (record.type == kMemfaultFlashNvRecord_Event) {
+      s_nv.events_pending++;
+    }
+    pos += record.len;
+  }
+  return !s_nv.failed;
+}
+
+bool memfault_flash_nv_event_storage_boot(const sMemfaultFlashNvEventStorageConfig *config) {
+  memfault_lock();
+  s_nv = (sMemfaultFlashNvEventStorageState) { 0 };
+  if (!prv_config_valid(config)) {
+    memfault_unlock();
+    return false;
+  }
+
+  s_nv.flash = *config->flash;
+  s_nv.page_buf = (uint8_t *)config->page_buf;
+  s_nv.data_per_sector = s_nv.flash.sector_size - s_nv.flash.page_size;
+  s_nv.last_checkpoint_pos = MEMFAULT_FLASH_NV_NO_POS;
+  // nothing is buffered yet so serve every read from flash
+  s_nv.page_pos = MEMFAULT_FLASH_NV_NO_POS;
+  memset(s_nv.page_buf, MEMFAULT_FLASH_NV_ERASED_BYTE, s_nv.flash.page_size);
+
+  bool found = false;
+  uint32_t newest_seq = 0;
+  for (size_t sector = 0; sector < s_nv.flash.num_sectors; sector++) {
+    sMemfaultFlashNvSectorHeader hdr;
+    if (prv_read_sector_header(sector, &hdr) && (!found || (hdr.seq > newest_seq))) {
+      newest_seq = hdr.seq;
+      found = true;
+    }
+  }
+
+  bool success;
+  if (s_nv.failed) {
+    success = false;
+  } else if (found) {
+    success = prv_recover(newest_seq);
+  } else {
+    s_nv.page_pos = 0;
+    success = prv_prepare_sector(0);
+  }
+
+  s_nv.booted = success;
+  memfault_unlock();
+  return success;
+}
+
+bool memfault_flash_nv_event_storage_flush(void) {
+  memfault_lock();
+  const bool success = prv_enabled() && prv_flush();
+  memfault_unlock();
+  return success;
+}
+
+bool memfault_flash_nv_event_storage_get_info(sMemfaultFlashNvEventStorageInfo *info) {
+  memfault_lock();
+  if (!s_nv.booted) {
+    memfault_unlock();
+    return false;
+  }
+
+  *info = (sMemfaultFlashNvEventStorageInfo) {
+    .events_pending = s_nv.events_pending,
+    .bytes_used = (size_t)(s_nv.write_pos - s_nv.read_pos),
+    .bytes_free = (size_t)(prv_write_limit() - s_nv.write_pos),
+    .min_erase_count = UINT32_MAX,
+  };
+  for (size_t sector = 0; sector < s_nv.flash.num_sectors; sector++) {
+    sMemfaultFlashNvSectorHeader hdr;
+    const uint32_t erase_count = prv_read_sector_header(sector, &hdr) ? hdr.erase_count : 0;
+    info->min_erase_count = MEMFAULT_MIN(info->min_erase_count, erase_count);
+    info->max_erase_count = MEMFAULT_MAX(info->max_erase_count, erase_count);
+  }
+  memfault_unlock();
+  return true;
+}
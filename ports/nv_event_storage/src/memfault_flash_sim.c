@@ -0,0 +1,129 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! See header for more details
+
+#include "memfault/ports/flash_sim.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static size_t prv_flash_size(const sMemfaultFlashSim *sim) {
+  return sim->backend.sector_size * sim->backend.num_sectors;
+}
+
+//! @return the number of bytes the current operation gets to modify, 0 if power is off
+static size_t prv_begin_op(sMemfaultFlashSim *sim, size_t len) {
+  if (sim->powered_off) {
+    return 0;
+  }
+  if (sim->ops_until_power_cut < 0) {
+    return len;
+  }
+  if (sim->ops_until_power_cut == 0) {
+    sim->powered_off = true;
+    return len / 2;
+  }
+  sim->ops_until_power_cut--;
+  return len;
+}
+
+static bool prv_read(void *ctx, uint32_t addr, void *buf, size_t buf_len) {
+  sMemfaultFlashSim *sim = (sMemfaultFlashSim *)ctx;
+  if (sim->powered_off || ((addr + buf_len) > prv_flash_size(sim))) {
+    return false;
+  }
+  sim->num_reads++;
+  memcpy(buf, &sim->storage[addr], buf_len);
+  return true;
+}
+
+static bool prv_program(void *ctx, uint32_t addr, const void *buf, size_t buf_len) {
+  sMemfaultFlashSim *sim = (sMemfaultFlashSim *)ctx;
+  if ((addr + buf_len) > prv_flash_size(sim)) {
+    return false;
+  }
+  const size_t len = prv_begin_op(sim, buf_len);
+  if (len == 0) {
+    return false;
+  }
+
+  sim->num_programs++;
+  const uint8_t *bytes = (const uint8_t *)buf;
+  for (size_t i = 0; i < len; i++) {
+    if ((bytes[i] & ~sim->storage[addr + i]) != 0) {
+      sim->num_program_errors++;
+    }
+    sim->storage[addr + i] &= bytes[i];
+  }
+  return len == buf_len;
+}
+
+static bool prv_erase(void *ctx, uint32_t addr) {
+  sMemfaultFlashSim *sim = (sMemfaultFlashSim *)ctx;
+  const size_t sector_size = sim->backend.sector_size;
+  if (((addr % sector_size) != 0) || (addr >= prv_flash_size(sim))) {
+    return false;
+  }
+  const size_t len = prv_begin_op(sim, sector_size);
+  if (len == 0) {
+    return false;
+  }
+
+  sim->num_erases++;
+  memset(&sim->storage[addr], 0xff, len);
+  return len == sector_size;
+}
+
+void memfault_flash_sim_init(sMemfaultFlashSim *sim, void *storage, size_t sector_size,
+                             size_t num_sectors, size_t page_size) {
+  *sim = (sMemfaultFlashSim) {
+    .backend = {
+      .ctx = sim,
+      .sector_size = sector_size,
+      .num_sectors = num_sectors,
+      .page_size = page_size,
+      .read = prv_read,
+      .program = prv_program,
+      .erase = prv_erase,
+    },
+    .storage = (uint8_t *)storage,
+    .ops_until_power_cut = -1,
+  };
+}
+
+void memfault_flash_sim_erase_all(sMemfaultFlashSim *sim) {
+  memset(sim->storage, 0xff, prv_flash_size(sim));
+}
+
+void memfault_flash_sim_power_on(sMemfaultFlashSim *sim) {
+  sim->powered_off = false;
+  sim->ops_until_power_cut = -1;
+}
+
+bool memfault_flash_sim_save(const sMemfaultFlashSim *sim, const char *path) {
+  FILE *f = fopen(path, "wb");
+  if (f == NULL) {
+    return false;
+  }
+  const size_t size = prv_flash_size(sim);
+  const bool success = fwrite(sim->storage, 1, size, f) == size;
+  return (fclose(f) == 0) && success;
+}
+
+bool memfault_flash_sim_load(sMemfaultFlashSim *sim, const char *path) {
+  FILE *f = fopen(path, "rb");
+  if (f == NULL) {
+    return false;
+  }
+  const size_t size = prv_flash_size(sim);
+  // read one byte extra to catch files which are larger than the flash
+  const bool success = (fread(sim->storage, 1, size, f) == size) && (fgetc(f) == EOF);
+  fclose(f);
+  return success;
+}
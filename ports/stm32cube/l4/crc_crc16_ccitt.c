@@ -0,0 +1,51 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! Reference implementation of memfault_platform_crc16_ccitt_compute() which offloads the CRC16
+//! computed over every chunk to the CRC unit found on the STM32L4 family. The same approach works
+//! on any STM32 with a programmable polynomial (i.e F7, H7, WB).
+//!
+//! Notes:
+//!  - The CRC unit is configured for the CRC16-CCITT polynomial on first use. If the application
+//!    also uses the CRC unit with a different configuration, the two must not run concurrently.
+
+#include "memfault/util/crc16_ccitt.h"
+
+#include <stdbool.h>
+
+#include "stm32l4xx_hal.h"
+
+static CRC_HandleTypeDef s_crc_handle = {
+  .Instance = CRC,
+  .Init = {
+    .DefaultPolynomialUse = DEFAULT_POLYNOMIAL_DISABLE,
+    .DefaultInitValueUse = DEFAULT_INIT_VALUE_DISABLE,
+    .GeneratingPolynomial = 0x1021,
+    .CRCLength = CRC_POLYLENGTH_16B,
+    .InitValue = 0,
+    .InputDataInversionMode = CRC_INPUTDATA_INVERSION_NONE,
+    .OutputDataInversionMode = CRC_OUTPUTDATA_INVERSION_DISABLE,
+  },
+  .InputDataFormat = CRC_INPUTDATA_FORMAT_BYTES,
+};
+
+static bool s_crc_initialized;
+
+bool memfault_platform_crc16_ccitt_compute(uint16_t crc_initial_value, const void *data,
+                                           size_t data_len_bytes, uint16_t *crc_out) {
+  if (!s_crc_initialized) {
+    __HAL_RCC_CRC_CLK_ENABLE();
+    if (HAL_CRC_Init(&s_crc_handle) != HAL_OK) {
+      return false;
+    }
+    s_crc_initialized = true;
+  }
+
+  // HAL_CRC_Calculate() resets the data register to the INIT value before feeding in the data so
+  // an incremental computation picks up where the last one left off
+  WRITE_REG(s_crc_handle.Instance->INIT, crc_initial_value);
+  *crc_out = (uint16_t)HAL_CRC_Calculate(&s_crc_handle, (uint32_t *)data, data_len_bytes);
+  return true;
+}
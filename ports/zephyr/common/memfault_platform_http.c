@@ -215,8 +215,32 @@ static int prv_open_socket(struct addrinfo **res, const char *host, int port_num
   return sock_fd;
 }
 
+#if CONFIG_MEMFAULT_HTTP_BATCH_CHUNKS
+static bool prv_try_send_cb(const void *data, size_t data_len, void *ctx) {
+  return prv_try_send(*(int *)ctx, data, data_len);
+}
+#endif
+
 static bool prv_send_next_msg(int sock) {
-#if CONFIG_MEMFAULT_HTTP_MAX_POST_SIZE
+#if CONFIG_MEMFAULT_HTTP_BATCH_CHUNKS
+  uint8_t buf[CONFIG_MEMFAULT_HTTP_MAX_POST_SIZE];
+  size_t buf_len = sizeof(buf);
+
+  if (!memfault_packetizer_get_chunk_batch(buf, &buf_len)) {
+    MEMFAULT_LOG_DEBUG("No more data to send");
+    return false; // no more data to send
+  }
+
+  if (!memfault_http_post_chunk_batch(prv_try_send_cb, &sock, buf, buf_len)) {
+    // unexpected failure, abort in-flight transaction
+    memfault_packetizer_abort();
+    return false;
+  }
+
+  // messages sent, await response
+  return true;
+
+#elif CONFIG_MEMFAULT_HTTP_MAX_POST_SIZE
   uint8_t buf[CONFIG_MEMFAULT_HTTP_MAX_POST_SIZE];
   size_t buf_len = sizeof(buf);
 
@@ -274,7 +298,7 @@ static bool prv_send_next_msg(int sock) {
 
   // message sent, await response
   return true;
-#endif /* CONFIG_MEMFAULT_HTTP_MAX_POST_SIZE */
+#endif /* CONFIG_MEMFAULT_HTTP_BATCH_CHUNKS */
 }
 
 static int prv_read_socket_data(int sock_fd, void *buf, size_t *buf_len) {
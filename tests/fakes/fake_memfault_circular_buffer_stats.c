@@ -0,0 +1,30 @@
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! Real circular buffer implementation with call tracking layered on top
+
+#include "fakes/fake_memfault_circular_buffer_stats.h"
+
+// Pull in the real implementation under a different name so the public symbol can be wrapped
+#define memfault_circular_buffer_read prv_real_memfault_circular_buffer_read
+#include "memfault_circular_buffer.c"
+#undef memfault_circular_buffer_read
+
+static size_t s_read_count;
+
+bool memfault_circular_buffer_read(sMfltCircularBuffer *circular_buf, size_t offset,
+                                   void *data, size_t data_len) {
+  s_read_count++;
+  return prv_real_memfault_circular_buffer_read(circular_buf, offset, data, data_len);
+}
+
+size_t fake_memfault_circular_buffer_stats_get_read_count(void) {
+  return s_read_count;
+}
+
+void fake_memfault_circular_buffer_stats_reset(void) {
+  s_read_count = 0;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+//! @file
+//!
+//! Copyright (c) Memfault, Inc.
+//! See License.txt for details
+//!
+//! @brief
+//! Wraps the real circular buffer implementation and tracks how often it is accessed. Useful
+//! for checking the algorithmic cost of modules built on top of the circular buffer.
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+//! @return the number of memfault_circular_buffer_read() calls since the last reset
+size_t fake_memfault_circular_buffer_stats_get_read_count(void);
+
+//! Reset all tracked stats
+void fake_memfault_circular_buffer_stats_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,11 @@
+COMPONENT_NAME=memfault_circular_buffer_no_pow2_fast_path
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_circular_buffer.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_circular_buffer.cpp
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_CIRCULAR_BUFFER_POW2_FAST_PATH_ENABLE=0
+
+include $(CPPUTEST_MAKFILE_INFRA)
@@ -0,0 +1,19 @@
+COMPONENT_NAME=memfault_chunk_reassembler_benchmark
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_chunk_reassembler.c
+
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_chunk_transport.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_crc16_ccitt.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_chunk_reassembler_benchmark.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+# measure optimized code rather than the -O0 build used by the rest of the tests
+CPPUTEST_CFLAGS += -O2
+CPPUTEST_CXXFLAGS += -O2
+
+include $(CPPUTEST_MAKFILE_INFRA)
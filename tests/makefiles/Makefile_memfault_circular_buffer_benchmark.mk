@@ -0,0 +1,12 @@
+COMPONENT_NAME=memfault_circular_buffer_benchmark
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_circular_buffer.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_circular_buffer_benchmark.cpp
+
+# measure optimized code rather than the -O0 build used by the rest of the tests
+CPPUTEST_CFLAGS += -O2
+
+include $(CPPUTEST_MAKFILE_INFRA)
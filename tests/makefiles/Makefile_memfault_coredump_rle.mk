@@ -0,0 +1,16 @@
+COMPONENT_NAME=memfault_coredump_rle
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/panics/src/memfault_coredump.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c
+
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_coredump_storage.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_coredump_rle.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE=1
+
+include $(CPPUTEST_MAKFILE_INFRA)
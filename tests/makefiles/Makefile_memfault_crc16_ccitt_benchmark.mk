@@ -0,0 +1,13 @@
+COMPONENT_NAME=memfault_crc16_ccitt_benchmark
+
+# every variant of memfault_crc16_ccitt.c is compiled into the benchmark itself
+SRC_FILES =
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_crc16_ccitt_benchmark.cpp
+
+# measure optimized code rather than the -O0 build used by the rest of the tests
+CPPUTEST_CFLAGS += -O2
+CPPUTEST_CXXFLAGS += -O2
+
+include $(CPPUTEST_MAKFILE_INFRA)
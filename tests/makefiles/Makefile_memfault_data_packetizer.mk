@@ -4,6 +4,8 @@ SRC_FILES = \
   $(MFLT_COMPONENTS_DIR)/core/src/memfault_data_packetizer.c
 
 MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_crc16_ccitt.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
   $(MFLT_TEST_STUB_DIR)/stub_memfault_log_save.c \
 
@@ -0,0 +1,22 @@
+COMPONENT_NAME=memfault_data_packetizer_byte_budget
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_data_packetizer.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_chunk_transport.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_crc16_ccitt.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c
+
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
+  $(MFLT_TEST_STUB_DIR)/stub_memfault_log_save.c \
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_data_packetizer_byte_budget.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_PACKETIZER_BYTE_BUDGET_ENABLED=1
+CPPUTEST_CPPFLAGS += -DMEMFAULT_PACKETIZER_BYTE_BUDGET_BURST_BYTES=100
+# 1 byte per second
+CPPUTEST_CPPFLAGS += -DMEMFAULT_PACKETIZER_BYTE_BUDGET_BYTES_PER_HOUR=3600
+
+include $(CPPUTEST_MAKFILE_INFRA)
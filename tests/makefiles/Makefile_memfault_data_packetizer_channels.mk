@@ -0,0 +1,19 @@
+COMPONENT_NAME=memfault_data_packetizer_channels
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_data_packetizer.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_chunk_transport.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_crc16_ccitt.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c
+
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
+  $(MFLT_TEST_STUB_DIR)/stub_memfault_log_save.c \
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_data_packetizer_channels.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_PACKETIZER_NUM_CHANNELS=3
+
+include $(CPPUTEST_MAKFILE_INFRA)
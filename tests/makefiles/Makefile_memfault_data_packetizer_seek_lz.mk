@@ -0,0 +1,25 @@
+COMPONENT_NAME=memfault_data_packetizer_seek_lz
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_data_packetizer.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_chunk_transport.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_crc16_ccitt.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c
+
+# linked directly so the RLE & LZ encoders override the weak stubs in the packetizer
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_data_source_lz.c \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_data_source_rle.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_lz.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_rle.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
+  $(MFLT_TEST_STUB_DIR)/stub_memfault_log_save.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_chunk_reassembler.c \
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_data_packetizer_seek.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_DATA_SOURCE_LZ_ENABLED=1
+
+include $(CPPUTEST_MAKFILE_INFRA)
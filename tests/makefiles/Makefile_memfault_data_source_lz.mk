@@ -0,0 +1,14 @@
+COMPONENT_NAME=memfault_data_source_lz
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_data_source_lz.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_crc16_ccitt.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_lz.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_data_source_lz.cpp
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_DATA_SOURCE_LZ_ENABLED=1
+
+include $(CPPUTEST_MAKFILE_INFRA)
@@ -5,6 +5,7 @@ SRC_FILES = \
 
 MOCK_AND_FAKE_SRC_FILES += \
   $(MFLT_COMPONENTS_DIR)/util/src/memfault_circular_buffer.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_locking.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_sdk_assert.c \
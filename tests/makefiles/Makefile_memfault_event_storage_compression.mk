@@ -0,0 +1,30 @@
+COMPONENT_NAME=memfault_event_storage_compression
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_event_storage.c \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_serializer_helper.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_lz.c
+
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_batched_events.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_circular_buffer.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_minimal_cbor.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_build_id.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_get_device_info.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_locking.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_time.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_sdk_assert.c \
+  $(MFLT_TEST_STUB_DIR)/stub_memfault_log_save.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_event_storage_compression.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED=1
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_INCLUDE_DEVICE_SERIAL=1
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED=1
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_READ_BATCHING_INDEX_ENTRIES=4
+
+include $(CPPUTEST_MAKFILE_INFRA)
@@ -0,0 +1,23 @@
+COMPONENT_NAME=memfault_event_storage_persist_batching
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/core/src/memfault_event_storage.c
+
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_circular_buffer.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_locking.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_sdk_assert.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_event_storage_persist_batching.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED=0
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED=1
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_PERSIST_HIGH_WATERMARK_PERCENT=50
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_PERSIST_LOW_WATERMARK_PERCENT=20
+CPPUTEST_CPPFLAGS += -DMEMFAULT_EVENT_STORAGE_PERSIST_COALESCE_WINDOW_MS=1000
+
+include $(CPPUTEST_MAKFILE_INFRA)
@@ -0,0 +1,15 @@
+COMPONENT_NAME=memfault_flash_nv_event_storage
+
+SRC_FILES = \
+  $(MFLT_PORTS_DIR)/nv_event_storage/src/memfault_flash_nv_event_storage.c \
+  $(MFLT_PORTS_DIR)/nv_event_storage/src/memfault_flash_sim.c
+
+MOCK_AND_FAKE_SRC_FILES += \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_crc16_ccitt.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_locking.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_flash_nv_event_storage.cpp \
+  $(MOCK_AND_FAKE_SRC_FILES)
+
+include $(CPPUTEST_MAKFILE_INFRA)
@@ -3,6 +3,7 @@ COMPONENT_NAME=memfault_heartbeat_metrics
 SRC_FILES = \
   $(MFLT_COMPONENTS_DIR)/metrics/src/memfault_metrics.c \
   $(MFLT_COMPONENTS_DIR)/core/src/memfault_serializer_helper.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_circular_buffer.c \
   $(MFLT_COMPONENTS_DIR)/util/src/memfault_minimal_cbor.c
 
 MOCK_AND_FAKE_SRC_FILES += \
@@ -0,0 +1,10 @@
+COMPONENT_NAME=memfault_lz
+
+SRC_FILES = \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_lz.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_varint.c
+
+TEST_SRC_FILES = \
+  $(MFLT_TEST_SRC_DIR)/test_memfault_lz.cpp
+
+include $(CPPUTEST_MAKFILE_INFRA)
@@ -2,11 +2,13 @@ COMPONENT_NAME=memfault_serializer_helper
 
 SRC_FILES = \
   $(MFLT_COMPONENTS_DIR)/core/src/memfault_serializer_helper.c \
+  $(MFLT_COMPONENTS_DIR)/util/src/memfault_circular_buffer.c \
 
 MOCK_AND_FAKE_SRC_FILES += \
   $(MFLT_COMPONENTS_DIR)/util/src/memfault_minimal_cbor.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_build_id.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_debug_log.c \
+  $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_locking.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_get_device_info.c \
   $(MFLT_TEST_FAKE_DIR)/fake_memfault_platform_time.c \
   $(MFLT_TEST_STUB_DIR)/stub_memfault_log_save.c \
@@ -0,0 +1,426 @@
+//! @file
+//!
+//! @brief
+//! Feeds the chunks produced by the chunk transport back through the reassembler and checks the
+//! messages come out intact, and that duplicate, missing and corrupted chunks are caught.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/util/chunk_reassembler.h"
+#include "memfault/util/chunk_transport.h"
+
+#define TEST_MAX_DEVICES 4
+#define TEST_NUM_CHANNELS 2
+#define TEST_MAX_MSG_SIZE 300
+#define TEST_MAX_CHUNKS 64
+#define TEST_MAX_CHUNK_LEN 64
+
+typedef struct {
+  uint8_t data[TEST_MAX_CHUNK_LEN];
+  size_t len;
+} sTestChunk;
+
+static uint8_t s_msg[TEST_MAX_MSG_SIZE + 1];
+static const uint8_t *s_active_msg;
+
+static uint64_t s_storage[4096];
+static sMfltChunkReassembler s_reassembler;
+
+static const sMfltChunkReassemblerConfig s_cfg = {
+  .max_devices = TEST_MAX_DEVICES,
+  .num_channels = TEST_NUM_CHANNELS,
+  .max_msg_size = TEST_MAX_MSG_SIZE,
+};
+
+static void prv_read_msg(uint32_t offset, void *buf, size_t buf_len) {
+  memcpy(buf, &s_active_msg[offset], buf_len);
+}
+
+//! @return the number of chunks the message was split into
+static size_t prv_chunk_msg(const uint8_t *msg, size_t msg_len, size_t chunk_len,
+                            uint8_t channel_id, sTestChunk *chunks) {
+  s_active_msg = msg;
+  sMfltChunkTransportCtx ctx = {
+    .total_size = (uint32_t)msg_len,
+    .read_msg = prv_read_msg,
+    .channel_id = channel_id,
+  };
+  size_t num_chunks = 0;
+  bool more_data = true;
+  while (more_data) {
+    CHECK(num_chunks < TEST_MAX_CHUNKS);
+    sTestChunk *chunk = &chunks[num_chunks++];
+    chunk->len = chunk_len;
+    more_data = memfault_chunk_transport_get_next_chunk(&ctx, chunk->data, &chunk->len);
+  }
+  return num_chunks;
+}
+
+static eMfltChunkReassemblerStatus prv_add(uint64_t device_key, const sTestChunk *chunk,
+                                           sMfltChunkReassemblerMsg *msg) {
+  return memfault_chunk_reassembler_add_chunk(&s_reassembler, device_key, chunk->data, chunk->len,
+                                              msg);
+}
+
+static void prv_check_msg(const sMfltChunkReassemblerMsg *msg, uint8_t channel_id,
+                          const uint8_t *expected, size_t expected_len) {
+  LONGS_EQUAL(channel_id, msg->channel_id);
+  LONGS_EQUAL(expected_len, msg->len);
+  MEMCMP_EQUAL(expected, msg->data, expected_len);
+}
+
+//! Sends a whole message and checks it is reassembled on the last chunk
+static void prv_check_roundtrip(uint64_t device_key, size_t msg_len, size_t chunk_len) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  const size_t num_chunks = prv_chunk_msg(s_msg, msg_len, chunk_len, 0, chunks);
+  sMfltChunkReassemblerMsg msg;
+  for (size_t i = 0; i < num_chunks - 1; i++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(device_key, &chunks[i], &msg));
+  }
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgComplete,
+              prv_add(device_key, &chunks[num_chunks - 1], &msg));
+  prv_check_msg(&msg, 0, s_msg, msg_len);
+}
+
+static sMfltChunkReassemblerStats prv_get_stats(void) {
+  sMfltChunkReassemblerStats stats;
+  memfault_chunk_reassembler_get_stats(&s_reassembler, &stats);
+  return stats;
+}
+
+TEST_GROUP(MemfaultChunkReassembler) {
+  void setup() {
+    for (size_t i = 0; i < sizeof(s_msg); i++) {
+      s_msg[i] = (uint8_t)((i * 13) + 1);
+    }
+    CHECK(memfault_chunk_reassembler_get_storage_size(&s_cfg) <= sizeof(s_storage));
+    CHECK(memfault_chunk_reassembler_init(&s_reassembler, &s_cfg, s_storage, sizeof(s_storage)));
+  }
+  void teardown() { }
+};
+
+TEST(MemfaultChunkReassembler, Test_SingleChunkMsg) {
+  sTestChunk chunk;
+  LONGS_EQUAL(1, prv_chunk_msg(s_msg, 20, sizeof(chunk.data), 1, &chunk));
+
+  sMfltChunkReassemblerMsg msg;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgComplete, prv_add(1, &chunk, &msg));
+  prv_check_msg(&msg, 1, s_msg, 20);
+  // not copied
+  POINTERS_EQUAL(&chunk.data[1], msg.data);
+
+  // larger than max_msg_size is fine since the message isn't copied
+  s_active_msg = s_msg;
+  sMfltChunkTransportCtx ctx = {
+    .total_size = TEST_MAX_MSG_SIZE + 1,
+    .read_msg = prv_read_msg,
+    .enable_multi_call_chunk = true,
+  };
+  static uint8_t s_large_chunk[TEST_MAX_MSG_SIZE + 16];
+  size_t large_chunk_len = sizeof(s_large_chunk);
+  CHECK(!memfault_chunk_transport_get_next_chunk(&ctx, s_large_chunk, &large_chunk_len));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgComplete,
+              memfault_chunk_reassembler_add_chunk(&s_reassembler, 1, s_large_chunk,
+                                                   large_chunk_len, &msg));
+  prv_check_msg(&msg, 0, s_msg, TEST_MAX_MSG_SIZE + 1);
+
+  const sMfltChunkReassemblerStats stats = prv_get_stats();
+  LONGS_EQUAL(2, stats.chunks);
+  LONGS_EQUAL(2, stats.msgs_complete);
+}
+
+TEST(MemfaultChunkReassembler, Test_AllChunkSizes) {
+  // covers the last chunk holding just the CRC16 and messages ending on a chunk boundary
+  for (size_t chunk_len = MEMFAULT_MIN_CHUNK_BUF_LEN; chunk_len <= TEST_MAX_CHUNK_LEN;
+       chunk_len++) {
+    for (size_t msg_len = 1; msg_len <= 200; msg_len += 7) {
+      prv_check_roundtrip(1, msg_len, chunk_len);
+    }
+  }
+
+  const sMfltChunkReassemblerStats stats = prv_get_stats();
+  LONGS_EQUAL(0, stats.duplicate_chunks + stats.gaps + stats.crc_errors + stats.malformed_chunks +
+                 stats.msgs_dropped);
+}
+
+TEST(MemfaultChunkReassembler, Test_InterleavedDevicesAndChannels) {
+  static sTestChunk s_chunks[TEST_MAX_DEVICES][TEST_NUM_CHANNELS][TEST_MAX_CHUNKS];
+  size_t num_chunks[TEST_MAX_DEVICES][TEST_NUM_CHANNELS];
+  for (size_t d = 0; d < TEST_MAX_DEVICES; d++) {
+    for (size_t c = 0; c < TEST_NUM_CHANNELS; c++) {
+      const size_t msg_len = 50 + (d * 20) + (c * 7);
+      num_chunks[d][c] = prv_chunk_msg(&s_msg[d + c], msg_len, 12, (uint8_t)c, s_chunks[d][c]);
+    }
+  }
+
+  size_t num_msgs = 0;
+  for (size_t i = 0; i < TEST_MAX_CHUNKS; i++) {
+    for (size_t d = 0; d < TEST_MAX_DEVICES; d++) {
+      for (size_t c = 0; c < TEST_NUM_CHANNELS; c++) {
+        if (i >= num_chunks[d][c]) {
+          continue;
+        }
+        sMfltChunkReassemblerMsg msg;
+        const eMfltChunkReassemblerStatus status =
+            prv_add(0x1000 + d, &s_chunks[d][c][i], &msg);
+        if ((i + 1) < num_chunks[d][c]) {
+          LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, status);
+          continue;
+        }
+        LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgComplete, status);
+        prv_check_msg(&msg, (uint8_t)c, &s_msg[d + c], 50 + (d * 20) + (c * 7));
+        num_msgs++;
+      }
+    }
+  }
+  LONGS_EQUAL(TEST_MAX_DEVICES * TEST_NUM_CHANNELS, num_msgs);
+  LONGS_EQUAL(0, prv_get_stats().devices_evicted);
+}
+
+TEST(MemfaultChunkReassembler, Test_DuplicateChunks) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  const size_t num_chunks = prv_chunk_msg(s_msg, 100, 20, 0, chunks);
+  CHECK(num_chunks > 3);
+
+  sMfltChunkReassemblerMsg msg;
+  for (size_t i = 0; i < num_chunks - 1; i++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks[i], &msg));
+    // every chunk is retransmitted and so is the INIT chunk
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_Duplicate, prv_add(1, &chunks[i], &msg));
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_Duplicate, prv_add(1, &chunks[0], &msg));
+  }
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgComplete,
+              prv_add(1, &chunks[num_chunks - 1], &msg));
+  prv_check_msg(&msg, 0, s_msg, 100);
+
+  // late retransmissions once the message is complete
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Duplicate, prv_add(1, &chunks[1], &msg));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Duplicate, prv_add(1, &chunks[num_chunks - 1], &msg));
+
+  const sMfltChunkReassemblerStats stats = prv_get_stats();
+  LONGS_EQUAL(1, stats.msgs_complete);
+  LONGS_EQUAL((2 * (num_chunks - 1)) + 2, stats.duplicate_chunks);
+  LONGS_EQUAL(0, stats.msgs_dropped);
+}
+
+TEST(MemfaultChunkReassembler, Test_OverlappingChunk) {
+  // the same message re-chunked with a different MTU part way through
+  sTestChunk chunks_small[TEST_MAX_CHUNKS];
+  sTestChunk chunks_large[TEST_MAX_CHUNKS];
+  const size_t num_small = prv_chunk_msg(s_msg, 100, 20, 0, chunks_small);
+  const size_t num_large = prv_chunk_msg(s_msg, 100, 30, 0, chunks_large);
+  CHECK(num_large >= 3);
+
+  // receives [0, 18) then [28, 56) which leaves a gap
+  sMfltChunkReassemblerMsg msg;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks_small[0], &msg));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Gap, prv_add(1, &chunks_large[1], &msg));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Gap, prv_add(1, &chunks_large[2], &msg));
+
+  // receives [0, 28), [18, 36) and then the rest
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks_large[0], &msg));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks_small[1], &msg));
+  for (size_t i = 2; i < num_small - 1; i++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks_small[i], &msg));
+  }
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgComplete,
+              prv_add(1, &chunks_small[num_small - 1], &msg));
+  prv_check_msg(&msg, 0, s_msg, 100);
+}
+
+TEST(MemfaultChunkReassembler, Test_Gap) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  const size_t num_chunks = prv_chunk_msg(s_msg, 100, 20, 0, chunks);
+
+  sMfltChunkReassemblerMsg msg;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks[0], &msg));
+  // chunk 1 is lost
+  for (size_t i = 2; i < num_chunks; i++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_Gap, prv_add(1, &chunks[i], &msg));
+  }
+
+  // a continuation without the INIT chunk
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Gap, prv_add(2, &chunks[1], &msg));
+
+  // the next message goes through
+  prv_check_roundtrip(1, 100, 20);
+
+  const sMfltChunkReassemblerStats stats = prv_get_stats();
+  LONGS_EQUAL(num_chunks - 1, stats.gaps);
+  LONGS_EQUAL(1, stats.msgs_dropped);
+  LONGS_EQUAL(1, stats.msgs_complete);
+}
+
+TEST(MemfaultChunkReassembler, Test_NewMsgDropsMsgInFlight) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  prv_chunk_msg(&s_msg[1], 100, 20, 0, chunks);
+  sMfltChunkReassemblerMsg msg;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks[0], &msg));
+
+  prv_check_roundtrip(1, 100, 20);
+  LONGS_EQUAL(1, prv_get_stats().msgs_dropped);
+}
+
+TEST(MemfaultChunkReassembler, Test_CrcMismatch) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  const size_t num_chunks = prv_chunk_msg(s_msg, 100, 20, 0, chunks);
+  chunks[1].data[5] ^= 0x1;
+
+  sMfltChunkReassemblerMsg msg;
+  for (size_t i = 0; i < num_chunks - 1; i++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks[i], &msg));
+  }
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_CrcMismatch,
+              prv_add(1, &chunks[num_chunks - 1], &msg));
+
+  sTestChunk chunk;
+  prv_chunk_msg(s_msg, 20, sizeof(chunk.data), 0, &chunk);
+  chunk.data[chunk.len - 1] ^= 0x1;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_CrcMismatch, prv_add(1, &chunk, &msg));
+
+  LONGS_EQUAL(2, prv_get_stats().crc_errors);
+}
+
+TEST(MemfaultChunkReassembler, Test_MsgTooLarge) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  const size_t num_chunks = prv_chunk_msg(s_msg, TEST_MAX_MSG_SIZE + 1, TEST_MAX_CHUNK_LEN, 0,
+                                          chunks);
+  sMfltChunkReassemblerMsg msg;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgTooLarge, prv_add(1, &chunks[0], &msg));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Gap, prv_add(1, &chunks[num_chunks - 1], &msg));
+  LONGS_EQUAL(1, prv_get_stats().msgs_too_large);
+
+  prv_check_roundtrip(1, TEST_MAX_MSG_SIZE, TEST_MAX_CHUNK_LEN);
+}
+
+TEST(MemfaultChunkReassembler, Test_Malformed) {
+  sMfltChunkReassemblerMsg msg;
+  const uint8_t bad_chunks[][4] = {
+    // channel beyond num_channels
+    { 0x08 | TEST_NUM_CHANNELS, 0x1, 0x0, 0x0 },
+    // reserved configuration bits
+    { 0x18, 0x1, 0x0, 0x0 },
+    { 0x88, 0x0, 0x0, 0x0 },
+    // too short for the CRC16
+    { 0x08, 0x0, 0x0, 0x0 },
+    // unterminated varint
+    { 0x48, 0x80, 0x80, 0x80 },
+    // more data than the total length
+    { 0x48, 0x1, 0x2, 0x3 },
+  };
+  const size_t bad_chunk_lens[] = { 4, 4, 4, 2, 4, 4 };
+  for (size_t i = 0; i < sizeof(bad_chunk_lens) / sizeof(bad_chunk_lens[0]); i++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_Malformed,
+                memfault_chunk_reassembler_add_chunk(&s_reassembler, 1, bad_chunks[i],
+                                                     bad_chunk_lens[i], &msg));
+  }
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Malformed,
+              memfault_chunk_reassembler_add_chunk(&s_reassembler, 1, bad_chunks[0], 0, &msg));
+
+  // the last chunk is cut short
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  const size_t num_chunks = prv_chunk_msg(s_msg, 30, 20, 0, chunks);
+  LONGS_EQUAL(2, num_chunks);
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(1, &chunks[0], &msg));
+  chunks[1].len--;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Malformed, prv_add(1, &chunks[1], &msg));
+  chunks[1].len++;
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MsgComplete, prv_add(1, &chunks[1], &msg));
+
+  LONGS_EQUAL(8, prv_get_stats().malformed_chunks);
+}
+
+TEST(MemfaultChunkReassembler, Test_LeastRecentlyActiveDeviceEvicted) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  prv_chunk_msg(s_msg, 100, 20, 0, chunks);
+
+  sMfltChunkReassemblerMsg msg;
+  for (uint64_t key = 0; key < TEST_MAX_DEVICES; key++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(key, &chunks[0], &msg));
+  }
+  // device 0 is active again so device 1 is now the least recently active
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(0, &chunks[1], &msg));
+
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData,
+              prv_add(TEST_MAX_DEVICES, &chunks[0], &msg));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_Gap, prv_add(1, &chunks[1], &msg));
+  LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData, prv_add(0, &chunks[2], &msg));
+
+  const sMfltChunkReassemblerStats stats = prv_get_stats();
+  // device 1 was added back, evicting device 2
+  LONGS_EQUAL(2, stats.devices_evicted);
+  LONGS_EQUAL(2, stats.msgs_dropped);
+}
+
+TEST(MemfaultChunkReassembler, Test_RemoveDevice) {
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  prv_chunk_msg(s_msg, 100, 20, 0, chunks);
+
+  // enough keys to exercise probing & removing entries from the middle of a probe sequence
+  sMfltChunkReassemblerMsg msg;
+  for (uint64_t round = 0; round < 50; round++) {
+    for (uint64_t i = 0; i < TEST_MAX_DEVICES; i++) {
+      LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData,
+                  prv_add((round * 7) + i, &chunks[0], &msg));
+    }
+    for (uint64_t i = 0; i < TEST_MAX_DEVICES; i += 2) {
+      CHECK(memfault_chunk_reassembler_remove_device(&s_reassembler, (round * 7) + i));
+    }
+    for (uint64_t i = 1; i < TEST_MAX_DEVICES; i += 2) {
+      LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData,
+                  prv_add((round * 7) + i, &chunks[1], &msg));
+      CHECK(memfault_chunk_reassembler_remove_device(&s_reassembler, (round * 7) + i));
+    }
+    CHECK(!memfault_chunk_reassembler_remove_device(&s_reassembler, round * 7));
+  }
+
+  const sMfltChunkReassemblerStats stats = prv_get_stats();
+  LONGS_EQUAL(0, stats.devices_evicted);
+  LONGS_EQUAL(0, stats.gaps);
+  LONGS_EQUAL(50 * TEST_MAX_DEVICES, stats.msgs_dropped);
+}
+
+TEST(MemfaultChunkReassembler, Test_InvalidConfig) {
+  sMfltChunkReassemblerConfig cfg = s_cfg;
+  cfg.num_channels = MEMFAULT_CHUNK_TRANSPORT_MAX_CHANNELS + 1;
+  LONGS_EQUAL(0, memfault_chunk_reassembler_get_storage_size(&cfg));
+  CHECK(!memfault_chunk_reassembler_init(&s_reassembler, &cfg, s_storage, sizeof(s_storage)));
+
+  cfg = s_cfg;
+  cfg.num_channels = 0;
+  LONGS_EQUAL(0, memfault_chunk_reassembler_get_storage_size(&cfg));
+
+  cfg = s_cfg;
+  cfg.max_devices = 0;
+  LONGS_EQUAL(0, memfault_chunk_reassembler_get_storage_size(&cfg));
+  LONGS_EQUAL(0, memfault_chunk_reassembler_get_storage_size(NULL));
+
+  const size_t storage_len = memfault_chunk_reassembler_get_storage_size(&s_cfg);
+  CHECK(!memfault_chunk_reassembler_init(&s_reassembler, &s_cfg, s_storage, storage_len - 1));
+  CHECK(!memfault_chunk_reassembler_init(&s_reassembler, &s_cfg, (uint8_t *)s_storage + 1,
+                                         storage_len));
+  CHECK(!memfault_chunk_reassembler_init(&s_reassembler, &s_cfg, NULL, storage_len));
+  CHECK(memfault_chunk_reassembler_init(&s_reassembler, &s_cfg, s_storage, storage_len));
+}
+
+TEST(MemfaultChunkReassembler, Test_Shard) {
+  const size_t num_shards = 4;
+  size_t num_per_shard[4] = { 0 };
+  for (uint64_t key = 0; key < 1000; key++) {
+    const size_t shard = memfault_chunk_reassembler_get_shard(key, num_shards);
+    CHECK(shard < num_shards);
+    LONGS_EQUAL(shard, memfault_chunk_reassembler_get_shard(key, num_shards));
+    num_per_shard[shard]++;
+  }
+  // sequential keys are spread out
+  for (size_t i = 0; i < num_shards; i++) {
+    CHECK(num_per_shard[i] > 200);
+  }
+  LONGS_EQUAL(0, memfault_chunk_reassembler_get_shard(1, 0));
+}
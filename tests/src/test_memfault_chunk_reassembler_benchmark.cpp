@@ -0,0 +1,164 @@
+//! @file
+//!
+//! @brief
+//! Measures how many chunks per second one reassembler handles on one core for a gateway relaying
+//! the chunks of many BLE devices, with the chunks of every device interleaved.
+//!
+//! Absolute numbers are host dependent so only the reassembled messages are checked. Run with
+//! MEMFAULT_BENCHMARK_REPORT=1 in the environment to print the chunk rate.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "memfault/core/math.h"
+#include "memfault/util/chunk_reassembler.h"
+#include "memfault/util/chunk_transport.h"
+
+#define BENCHMARK_NUM_DEVICES 1000
+#define BENCHMARK_NUM_CHANNELS 2
+#define BENCHMARK_MAX_MSG_SIZE 1024
+//! A BLE ATT payload with the default MTU
+#define BENCHMARK_CHUNK_LEN 20
+#define BENCHMARK_MAX_CHUNKS 100000
+#define BENCHMARK_RUNS 7
+
+typedef struct {
+  uint64_t device_key;
+  size_t len;
+  uint8_t data[BENCHMARK_CHUNK_LEN];
+} sBenchmarkChunk;
+
+static uint8_t s_msg[BENCHMARK_MAX_MSG_SIZE];
+static sBenchmarkChunk s_chunks[BENCHMARK_MAX_CHUNKS];
+static size_t s_num_chunks;
+static size_t s_num_msgs;
+
+// the message buffers plus a generous allowance for the state kept per device
+static uint64_t s_storage[(BENCHMARK_NUM_DEVICES *
+                           ((BENCHMARK_NUM_CHANNELS * BENCHMARK_MAX_MSG_SIZE) + 512)) / 8];
+
+static const sMfltChunkReassemblerConfig s_cfg = {
+  .max_devices = BENCHMARK_NUM_DEVICES,
+  .num_channels = BENCHMARK_NUM_CHANNELS,
+  .max_msg_size = BENCHMARK_MAX_MSG_SIZE,
+};
+
+//! CPU time rather than wall time so a run preempted while the tests are run in parallel doesn't
+//! skew the result
+static uint64_t prv_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+static void prv_read_msg(uint32_t offset, void *buf, size_t buf_len) {
+  memcpy(buf, &s_msg[offset], buf_len);
+}
+
+static void prv_add_chunk(uint64_t device_key, sMfltChunkTransportCtx *ctx) {
+  CHECK(s_num_chunks < BENCHMARK_MAX_CHUNKS);
+  sBenchmarkChunk *chunk = &s_chunks[s_num_chunks++];
+  chunk->device_key = device_key;
+  chunk->len = sizeof(chunk->data);
+  if (!memfault_chunk_transport_get_next_chunk(ctx, chunk->data, &chunk->len)) {
+    s_num_msgs++;
+  }
+}
+
+//! Every device sends a large message on channel 1 with small events (a single chunk) on channel 0
+//! in between. The chunks of all the devices are interleaved, one chunk per device at a time.
+static void prv_generate_chunks(void) {
+  static sMfltChunkTransportCtx s_msg_ctx[BENCHMARK_NUM_DEVICES];
+  for (size_t d = 0; d < BENCHMARK_NUM_DEVICES; d++) {
+    s_msg_ctx[d] = (sMfltChunkTransportCtx) {
+      .total_size = (uint32_t)(100 + ((d * 37) % (BENCHMARK_MAX_MSG_SIZE - 100))),
+      .read_msg = prv_read_msg,
+      .channel_id = 1,
+    };
+  }
+
+  s_num_chunks = 0;
+  s_num_msgs = 0;
+  bool more_chunks = true;
+  for (size_t round = 0; more_chunks; round++) {
+    more_chunks = false;
+    for (size_t d = 0; d < BENCHMARK_NUM_DEVICES; d++) {
+      const uint64_t device_key = 0xc0ffee000000ULL + d;
+      if ((round % 8) == 0) {
+        sMfltChunkTransportCtx event_ctx = {
+          .total_size = (uint32_t)(10 + (d % 8)),
+          .read_msg = prv_read_msg,
+          .channel_id = 0,
+        };
+        prv_add_chunk(device_key, &event_ctx);
+      }
+
+      sMfltChunkTransportCtx *msg_ctx = &s_msg_ctx[d];
+      if (msg_ctx->total_size != 0) {
+        const size_t num_msgs = s_num_msgs;
+        prv_add_chunk(device_key, msg_ctx);
+        if (s_num_msgs != num_msgs) {
+          msg_ctx->total_size = 0;
+        }
+        more_chunks = true;
+      }
+    }
+  }
+}
+
+//! @return the number of chunks per second of the fastest of BENCHMARK_RUNS runs
+static double prv_run_benchmark(void) {
+  static sMfltChunkReassembler s_reassembler;
+  uint64_t best_ns = UINT64_MAX;
+  for (size_t run = 0; run < BENCHMARK_RUNS; run++) {
+    CHECK(memfault_chunk_reassembler_init(&s_reassembler, &s_cfg, s_storage, sizeof(s_storage)));
+
+    size_t num_msgs = 0;
+    size_t msg_bytes = 0;
+    const uint64_t start = prv_time_ns();
+    for (size_t i = 0; i < s_num_chunks; i++) {
+      const sBenchmarkChunk *chunk = &s_chunks[i];
+      sMfltChunkReassemblerMsg msg;
+      if (memfault_chunk_reassembler_add_chunk(&s_reassembler, chunk->device_key, chunk->data,
+                                               chunk->len, &msg) ==
+          kMfltChunkReassemblerStatus_MsgComplete) {
+        num_msgs++;
+        msg_bytes += msg.len;
+      }
+    }
+    const uint64_t elapsed = prv_time_ns() - start;
+    best_ns = MEMFAULT_MIN(best_ns, elapsed);
+
+    LONGS_EQUAL(s_num_msgs, num_msgs);
+    CHECK(msg_bytes > 0);
+  }
+  return (double)s_num_chunks / ((double)best_ns / 1e9);
+}
+
+TEST_GROUP(MfltChunkReassemblerBenchmark) {
+  void setup() {
+    for (size_t i = 0; i < sizeof(s_msg); i++) {
+      s_msg[i] = (uint8_t)((i * 151) + 17);
+    }
+    CHECK(memfault_chunk_reassembler_get_storage_size(&s_cfg) <= sizeof(s_storage));
+  }
+  void teardown() { }
+};
+
+TEST(MfltChunkReassemblerBenchmark, Test_Throughput) {
+  prv_generate_chunks();
+  const double chunks_per_sec = prv_run_benchmark();
+  if (getenv("MEMFAULT_BENCHMARK_REPORT") == NULL) {
+    return;
+  }
+  printf("\n  %zu devices, %zu chunks, %zu msgs: %.0f chunks/s\n", (size_t)BENCHMARK_NUM_DEVICES,
+         s_num_chunks, s_num_msgs, chunks_per_sec);
+}
@@ -85,6 +85,18 @@ TEST(MemfaultChunkTransport, Test_ChunkerMultiPart) {
   prv_check_chunk(&s_chunk_ctx, !md, receive_buf_size, &expected_msg_2, sizeof(expected_msg_2));
 }
 
+TEST(MemfaultChunkTransport, Test_ChunkerMultiPartChannelId) {
+  const size_t receive_buf_size = 9;
+  const bool md = true;
+  s_chunk_ctx.channel_id = 5;
+
+  const uint8_t expected_msg_1[] = { 0x4d, 0x09, 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7 };
+  prv_check_chunk(&s_chunk_ctx, md, receive_buf_size, &expected_msg_1, sizeof(expected_msg_1));
+
+  const uint8_t expected_msg_2[] = { 0x85, 0x7, 0x8, 0xa, 0x1b, 0x13 };
+  prv_check_chunk(&s_chunk_ctx, !md, receive_buf_size, &expected_msg_2, sizeof(expected_msg_2));
+}
+
 TEST(MemfaultChunkTransport, Test_ChunkerMultiPartLastMessageJustCrc) {
   static const uint8_t test_msg_long[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7,
                                            0x8, 0xa, 0xb, 0xc, 0xd, 0xe, 0xf };
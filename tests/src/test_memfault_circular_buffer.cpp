@@ -304,6 +304,313 @@ TEST(MfltCircularBufferTestGroup, Test_MfltCircularWriteAndGetReadPointer) {
   }
 }
 
+TEST(MfltCircularBufferTestGroup, Test_MfltCircularWritePointer) {
+  uint8_t storage_buf[8];
+  sMfltCircularBuffer buffer;
+  bool success = memfault_circular_buffer_init(&buffer, storage_buf, sizeof(storage_buf));
+  CHECK(success);
+
+  uint8_t *write_ptr;
+  size_t write_ptr_len;
+  success = memfault_circular_buffer_get_write_pointer(NULL, 0, &write_ptr, &write_ptr_len);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_write_pointer(&buffer, 0, NULL, &write_ptr_len);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_write_pointer(&buffer, 0, &write_ptr, NULL);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_write_pointer(&buffer, sizeof(storage_buf) + 1,
+                                                       &write_ptr, &write_ptr_len);
+  CHECK(!success);
+  success = memfault_circular_buffer_commit_write(NULL, 1);
+  CHECK(!success);
+  success = memfault_circular_buffer_commit_write(&buffer, sizeof(storage_buf) + 1);
+  CHECK(!success);
+
+  success = memfault_circular_buffer_get_write_pointer(&buffer, 0, &write_ptr, &write_ptr_len);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[0], write_ptr);
+  LONGS_EQUAL(sizeof(storage_buf), write_ptr_len);
+
+  // nothing is readable until the write is committed
+  const uint8_t seq1[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6 };
+  memcpy(write_ptr, seq1, sizeof(seq1));
+  LONGS_EQUAL(0, memfault_circular_buffer_get_read_size(&buffer));
+  success = memfault_circular_buffer_commit_write(&buffer, sizeof(seq1));
+  CHECK(success);
+  LONGS_EQUAL(sizeof(seq1), memfault_circular_buffer_get_read_size(&buffer));
+
+  uint8_t result[sizeof(storage_buf)];
+  success = memfault_circular_buffer_read(&buffer, 0, result, sizeof(seq1));
+  CHECK(success);
+  MEMCMP_EQUAL(seq1, result, sizeof(seq1));
+
+  // free space now wraps around the end of storage: [6, 8) and [0, 4)
+  success = memfault_circular_buffer_consume(&buffer, 4);
+  CHECK(success);
+  success = memfault_circular_buffer_get_write_pointer(&buffer, 0, &write_ptr, &write_ptr_len);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[6], write_ptr);
+  LONGS_EQUAL(2, write_ptr_len);
+  success = memfault_circular_buffer_get_write_pointer(&buffer, 3, &write_ptr, &write_ptr_len);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[1], write_ptr);
+  LONGS_EQUAL(3, write_ptr_len);
+  success = memfault_circular_buffer_get_write_pointer(&buffer, 6, &write_ptr, &write_ptr_len);
+  CHECK(success);
+  LONGS_EQUAL(0, write_ptr_len);
+
+  sMfltCircularBufferSpan spans[2];
+  success = memfault_circular_buffer_get_write_spans(NULL, spans);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_write_spans(&buffer, NULL);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_write_spans(&buffer, spans);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[6], spans[0].ptr);
+  LONGS_EQUAL(2, spans[0].len);
+  POINTERS_EQUAL(&storage_buf[0], spans[1].ptr);
+  LONGS_EQUAL(4, spans[1].len);
+
+  const uint8_t seq2[] = { 0x7, 0x8, 0x9 };
+  memcpy(spans[0].ptr, &seq2[0], spans[0].len);
+  memcpy(spans[1].ptr, &seq2[spans[0].len], sizeof(seq2) - spans[0].len);
+  success = memfault_circular_buffer_commit_write(&buffer, sizeof(seq2));
+  CHECK(success);
+
+  const uint8_t expected[] = { 0x5, 0x6, 0x7, 0x8, 0x9 };
+  LONGS_EQUAL(sizeof(expected), memfault_circular_buffer_get_read_size(&buffer));
+  success = memfault_circular_buffer_read(&buffer, 0, result, sizeof(expected));
+  CHECK(success);
+  MEMCMP_EQUAL(expected, result, sizeof(expected));
+}
+
+TEST(MfltCircularBufferTestGroup, Test_MfltCircularPow2StorageWrapAround) {
+  // a power of 2 sized buffer takes the masking fast path (when enabled)
+  uint8_t storage_buf[16];
+  sMfltCircularBuffer buffer;
+  bool success = memfault_circular_buffer_init(&buffer, storage_buf, sizeof(storage_buf));
+  CHECK(success);
+
+  // 5 doesn't divide 16 so reads and writes straddle the end of storage at every position
+  uint8_t seq = 0;
+  for (size_t i = 0; i < 3 * sizeof(storage_buf); i++) {
+    uint8_t data[5];
+    for (size_t j = 0; j < sizeof(data); j++) {
+      data[j] = seq++;
+    }
+    success = memfault_circular_buffer_write(&buffer, data, sizeof(data));
+    CHECK(success);
+    success = memfault_circular_buffer_write(&buffer, data, sizeof(data));
+    CHECK(success);
+
+    uint8_t result[sizeof(data)];
+    for (size_t j = 0; j < 2; j++) {
+      success = memfault_circular_buffer_read(&buffer, 0, result, sizeof(result));
+      CHECK(success);
+      MEMCMP_EQUAL(data, result, sizeof(data));
+      success = memfault_circular_buffer_consume(&buffer, sizeof(result));
+      CHECK(success);
+    }
+    LONGS_EQUAL(0, memfault_circular_buffer_get_read_size(&buffer));
+  }
+}
+
+TEST(MfltCircularBufferTestGroup, Test_MfltCircularReserve) {
+  uint8_t storage_buf[8];
+  sMfltCircularBuffer buffer;
+  bool success = memfault_circular_buffer_init(&buffer, storage_buf, sizeof(storage_buf));
+  CHECK(success);
+
+  sMfltCircularBufferSpan spans[2];
+  success = memfault_circular_buffer_reserve(NULL, 1, spans);
+  CHECK(!success);
+  success = memfault_circular_buffer_reserve(&buffer, 1, NULL);
+  CHECK(!success);
+  success = memfault_circular_buffer_reserve(&buffer, sizeof(storage_buf) + 1, spans);
+  CHECK(!success);
+
+  // contiguous reservation
+  success = memfault_circular_buffer_reserve(&buffer, 5, spans);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[0], spans[0].ptr);
+  LONGS_EQUAL(5, spans[0].len);
+  LONGS_EQUAL(0, spans[1].len);
+  LONGS_EQUAL(5, memfault_circular_buffer_get_read_size(&buffer));
+
+  const uint8_t seq1[] = { 0x1, 0x2, 0x3, 0x4, 0x5 };
+  memcpy(spans[0].ptr, seq1, sizeof(seq1));
+
+  uint8_t result[sizeof(storage_buf)];
+  success = memfault_circular_buffer_read(&buffer, 0, result, sizeof(seq1));
+  CHECK(success);
+  MEMCMP_EQUAL(seq1, result, sizeof(seq1));
+
+  // reservation wrapping around the end of storage
+  success = memfault_circular_buffer_consume(&buffer, 4);
+  CHECK(success);
+  success = memfault_circular_buffer_reserve(&buffer, 6, spans);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[5], spans[0].ptr);
+  LONGS_EQUAL(3, spans[0].len);
+  POINTERS_EQUAL(&storage_buf[0], spans[1].ptr);
+  LONGS_EQUAL(3, spans[1].len);
+  LONGS_EQUAL(7, memfault_circular_buffer_get_read_size(&buffer));
+  LONGS_EQUAL(1, memfault_circular_buffer_get_write_size(&buffer));
+
+  const uint8_t seq2[] = { 0x6, 0x7, 0x8, 0x9, 0xa, 0xb };
+  memcpy(spans[0].ptr, &seq2[0], spans[0].len);
+  memcpy(spans[1].ptr, &seq2[spans[0].len], spans[1].len);
+
+  const uint8_t expected[] = { 0x5, 0x6, 0x7, 0x8, 0x9, 0xa, 0xb };
+  success = memfault_circular_buffer_read(&buffer, 0, result, sizeof(expected));
+  CHECK(success);
+  MEMCMP_EQUAL(expected, result, sizeof(expected));
+}
+
+TEST(MfltCircularBufferTestGroup, Test_MfltCircularReadRange) {
+  uint8_t storage_buf[8];
+  sMfltCircularBuffer buffer;
+  bool success = memfault_circular_buffer_init(&buffer, storage_buf, sizeof(storage_buf));
+  CHECK(success);
+
+  sMfltCircularBufferSpan spans[2];
+  success = memfault_circular_buffer_get_read_range(NULL, 0, 0, spans);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_read_range(&buffer, 0, 0, NULL);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_read_range(&buffer, 0, 1, spans);
+  CHECK(!success);
+
+  const uint8_t seq1[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6 };
+  success = memfault_circular_buffer_write(&buffer, seq1, sizeof(seq1));
+  CHECK(success);
+
+  // contiguous range
+  success = memfault_circular_buffer_get_read_range(&buffer, 1, 4, spans);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[1], spans[0].ptr);
+  LONGS_EQUAL(4, spans[0].len);
+  LONGS_EQUAL(0, spans[1].len);
+
+  success = memfault_circular_buffer_get_read_range(&buffer, 3, 4, spans);
+  CHECK(!success);
+
+  // range wrapping around the end of storage
+  success = memfault_circular_buffer_consume(&buffer, 4);
+  CHECK(success);
+  const uint8_t seq2[] = { 0x7, 0x8, 0x9, 0xa };
+  success = memfault_circular_buffer_write(&buffer, seq2, sizeof(seq2));
+  CHECK(success);
+
+  success = memfault_circular_buffer_get_read_range(&buffer, 1, 4, spans);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[5], spans[0].ptr);
+  LONGS_EQUAL(3, spans[0].len);
+  POINTERS_EQUAL(&storage_buf[0], spans[1].ptr);
+  LONGS_EQUAL(1, spans[1].len);
+
+  const uint8_t expected[] = { 0x6, 0x7, 0x8, 0x9 };
+  MEMCMP_EQUAL(&expected[0], spans[0].ptr, spans[0].len);
+  MEMCMP_EQUAL(&expected[spans[0].len], spans[1].ptr, spans[1].len);
+
+  // range starting after the wrap
+  success = memfault_circular_buffer_get_read_range(&buffer, 4, 2, spans);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[0], spans[0].ptr);
+  LONGS_EQUAL(2, spans[0].len);
+  LONGS_EQUAL(0, spans[1].len);
+}
+
+TEST(MfltCircularBufferTestGroup, Test_MfltCircularWriteRange) {
+  uint8_t storage_buf[8];
+  sMfltCircularBuffer buffer;
+  bool success = memfault_circular_buffer_init(&buffer, storage_buf, sizeof(storage_buf));
+  CHECK(success);
+
+  sMfltCircularBufferSpan spans[2];
+  success = memfault_circular_buffer_get_write_range(NULL, 0, 1, spans);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_write_range(&buffer, 0, 1, NULL);
+  CHECK(!success);
+  success = memfault_circular_buffer_get_write_range(&buffer, 4, 5, spans);
+  CHECK(!success);
+
+  const uint8_t seq1[] = { 0x1, 0x2, 0x3, 0x4, 0x5 };
+  success = memfault_circular_buffer_write(&buffer, seq1, sizeof(seq1));
+  CHECK(success);
+  success = memfault_circular_buffer_consume(&buffer, 5);
+  CHECK(success);
+
+  // an uncommitted region past the start of the free space, wrapping around the end of storage
+  success = memfault_circular_buffer_get_write_range(&buffer, 2, 4, spans);
+  CHECK(success);
+  POINTERS_EQUAL(&storage_buf[7], spans[0].ptr);
+  LONGS_EQUAL(1, spans[0].len);
+  POINTERS_EQUAL(&storage_buf[0], spans[1].ptr);
+  LONGS_EQUAL(3, spans[1].len);
+  LONGS_EQUAL(0, memfault_circular_buffer_get_read_size(&buffer));
+
+  const uint8_t seq2[] = { 0xa, 0xb, 0xc, 0xd };
+  memcpy(spans[0].ptr, &seq2[0], spans[0].len);
+  memcpy(spans[1].ptr, &seq2[spans[0].len], spans[1].len);
+  const uint8_t prefix[] = { 0x8, 0x9 };
+  success = memfault_circular_buffer_get_write_range(&buffer, 0, sizeof(prefix), spans);
+  CHECK(success);
+  LONGS_EQUAL(0, spans[1].len);
+  memcpy(spans[0].ptr, prefix, sizeof(prefix));
+
+  success = memfault_circular_buffer_commit_write(&buffer, 6);
+  CHECK(success);
+  const uint8_t expected[] = { 0x8, 0x9, 0xa, 0xb, 0xc, 0xd };
+  uint8_t result[sizeof(expected)];
+  success = memfault_circular_buffer_read(&buffer, 0, result, sizeof(result));
+  CHECK(success);
+  MEMCMP_EQUAL(expected, result, sizeof(expected));
+}
+
+TEST(MfltCircularBufferTestGroup, Test_MfltCircularBufferCopyToSpans) {
+  uint8_t storage_buf[8];
+  sMfltCircularBuffer buffer;
+  bool success = memfault_circular_buffer_init(&buffer, storage_buf, sizeof(storage_buf));
+  CHECK(success);
+
+  const uint8_t seq1[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6 };
+  success = memfault_circular_buffer_write(&buffer, seq1, sizeof(seq1));
+  CHECK(success);
+  success = memfault_circular_buffer_consume(&buffer, sizeof(seq1));
+  CHECK(success);
+
+  sMfltCircularBufferSpan spans[2];
+  success = memfault_circular_buffer_get_write_range(&buffer, 0, 5, spans);
+  CHECK(success);
+  LONGS_EQUAL(2, spans[0].len);
+  LONGS_EQUAL(3, spans[1].len);
+
+  success = memfault_circular_buffer_copy_to_spans(NULL, 0, seq1, 1);
+  CHECK(!success);
+  success = memfault_circular_buffer_copy_to_spans(spans, 0, NULL, 1);
+  CHECK(!success);
+  // doesn't fit in what is left of the range
+  success = memfault_circular_buffer_copy_to_spans(spans, 3, seq1, 3);
+  CHECK(!success);
+
+  // the first piece fills the first span, the second starts part way in and wraps around
+  const uint8_t first[] = { 0xa };
+  success = memfault_circular_buffer_copy_to_spans(spans, 0, first, sizeof(first));
+  CHECK(success);
+  const uint8_t second[] = { 0xb, 0xc, 0xd, 0xe };
+  success = memfault_circular_buffer_copy_to_spans(spans, 1, second, sizeof(second));
+  CHECK(success);
+
+  success = memfault_circular_buffer_commit_write(&buffer, 5);
+  CHECK(success);
+  const uint8_t expected[] = { 0xa, 0xb, 0xc, 0xd, 0xe };
+  uint8_t result[sizeof(expected)];
+  success = memfault_circular_buffer_read(&buffer, 0, result, sizeof(result));
+  CHECK(success);
+  MEMCMP_EQUAL(expected, result, sizeof(expected));
+}
+
 static uint8_t s_storage_buf[10];
 static sMfltCircularBuffer s_buffer;
 static int s_ctx;
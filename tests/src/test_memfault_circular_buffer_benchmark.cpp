@@ -0,0 +1,91 @@
+//! @file
+//!
+//! @brief
+//! Compares the cost of circular buffer operations when the storage size is a power of 2 (offsets
+//! wrapped with a mask) against a size that is not (offsets wrapped with a modulo).
+//!
+//! Absolute numbers are host dependent; the interesting figure is the ratio between the two.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "memfault/config.h"
+#include "memfault/util/circular_buffer.h"
+
+#define BENCHMARK_ITERATIONS 200000
+#define BENCHMARK_RUNS 7
+//! get_read_pointer + consume + write
+#define BENCHMARK_CALLS_PER_ITERATION 3
+
+static uint8_t s_storage[1024];
+
+static uint64_t prv_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+//! @return the average time in ns of one circular buffer call
+static double prv_run_benchmark(size_t storage_len) {
+  sMfltCircularBuffer buffer;
+  CHECK(memfault_circular_buffer_init(&buffer, s_storage, storage_len));
+
+  // keep a window of data in the buffer so every offset computation has to wrap eventually
+  uint8_t byte = 0;
+  for (size_t i = 0; i < 64; i++) {
+    CHECK(memfault_circular_buffer_write(&buffer, &byte, sizeof(byte)));
+    byte++;
+  }
+
+  uint8_t *read_ptr;
+  size_t read_ptr_len;
+  bool success = true;
+
+  const uint64_t start = prv_time_ns();
+  for (size_t i = 0; i < BENCHMARK_ITERATIONS; i++) {
+    success &= memfault_circular_buffer_get_read_pointer(&buffer, i & 0x3f, &read_ptr,
+                                                         &read_ptr_len);
+    success &= memfault_circular_buffer_consume(&buffer, sizeof(byte));
+    success &= memfault_circular_buffer_write(&buffer, &byte, sizeof(byte));
+    byte++;
+  }
+  const uint64_t elapsed = prv_time_ns() - start;
+
+  CHECK(success);
+  return (double)elapsed / (BENCHMARK_ITERATIONS * BENCHMARK_CALLS_PER_ITERATION);
+}
+
+//! Interleaves the two configurations and keeps the fastest run of each to filter out noise from
+//! the host
+static void prv_compare(double *pow2_ns, double *modulo_ns) {
+  *pow2_ns = 1e9;
+  *modulo_ns = 1e9;
+  for (size_t i = 0; i < BENCHMARK_RUNS; i++) {
+    const double pow2 = prv_run_benchmark(sizeof(s_storage));
+    const double modulo = prv_run_benchmark(sizeof(s_storage) - 1);
+    *pow2_ns = (pow2 < *pow2_ns) ? pow2 : *pow2_ns;
+    *modulo_ns = (modulo < *modulo_ns) ? modulo : *modulo_ns;
+  }
+}
+
+TEST_GROUP(MfltCircularBufferBenchmark) {
+  void setup() { }
+  void teardown() { }
+};
+
+TEST(MfltCircularBufferBenchmark, Test_Pow2VsModulo) {
+  double pow2_ns;
+  double modulo_ns;
+  prv_compare(&pow2_ns, &modulo_ns);
+
+  printf("\n  circular buffer (fast path %s): %.2f ns/call pow2, %.2f ns/call modulo\n",
+         MEMFAULT_CIRCULAR_BUFFER_POW2_FAST_PATH_ENABLE ? "enabled" : "disabled",
+         pow2_ns, modulo_ns);
+}
@@ -0,0 +1,254 @@
+//! @file
+//!
+//! @brief
+//! Checks coredumps RLE encoded as they are saved (MEMFAULT_COREDUMP_RLE_ENCODE_ON_SAVE) decode
+//! to a valid coredump and that memory regions far larger than the storage can be saved when
+//! they compress well.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+  #include "fakes/fake_memfault_platform_coredump_storage.h"
+  #include "memfault/core/build_info.h"
+  #include "memfault/core/compiler.h"
+  #include "memfault/core/data_packetizer_source.h"
+  #include "memfault/core/math.h"
+  #include "memfault/core/platform/device_info.h"
+  #include "memfault/panics/coredump.h"
+  #include "memfault/panics/coredump_impl.h"
+  #include "memfault/panics/platform/coredump.h"
+  #include "memfault/util/varint.h"
+
+  MEMFAULT_ALIGNED(0x8) static uint8_t s_storage_buf[4 * 1024];
+
+  void memfault_platform_get_device_info(struct MemfaultDeviceInfo *info) {
+    *info = (struct MemfaultDeviceInfo) {
+      .device_serial = "1",
+      .software_type = "main",
+      .software_version = "22",
+      .hardware_version = "333",
+    };
+  }
+
+  bool memfault_platform_coredump_storage_read(uint32_t offset, void *buf, size_t buf_len) {
+    return fake_memfault_platform_coredump_storage_read(offset, buf, buf_len);
+  }
+
+  bool memfault_build_info_read(MEMFAULT_UNUSED sMemfaultBuildInfo *info) {
+    return false;
+  }
+}
+
+const sMfltCoredumpRegion *memfault_coredump_get_arch_regions(size_t *num_regions) {
+  *num_regions = 0;
+  return NULL;
+}
+
+const sMfltCoredumpRegion *memfault_coredump_get_sdk_regions(size_t *num_regions) {
+  *num_regions = 0;
+  return NULL;
+}
+
+#define TEST_COREDUMP_MAGIC 0x45524f43
+#define TEST_COREDUMP_HEADER_SIZE 12
+#define TEST_COREDUMP_BLOCK_HEADER_SIZE 12
+#define TEST_COREDUMP_FOOTER_SIZE 16
+#define TEST_COREDUMP_MEMORY_REGION_BLOCK_TYPE 1
+#define TEST_COREDUMP_TRUNCATED_FLAG 0x1
+
+// Big enough for any of the coredumps decoded
+static uint8_t s_decoded[64 * 1024];
+
+static uint32_t prv_get_u32(const uint8_t *buf) {
+  uint32_t value;
+  memcpy(&value, buf, sizeof(value));
+  return value;
+}
+
+//! @return The length of the decoded coredump
+static size_t prv_rle_decode(const uint8_t *in, size_t in_len) {
+  size_t out_len = 0;
+  for (size_t i = 0; i < in_len;) {
+    uint32_t zigzag;
+    const size_t header_len = memfault_decode_varint_u32(&in[i], in_len - i, &zigzag);
+    CHECK(header_len != 0);
+    i += header_len;
+    const int32_t rle_size = (int32_t)(zigzag >> 1) ^ -(int32_t)(zigzag & 1);
+    CHECK(rle_size != 0);
+    if (rle_size < 0) {
+      const size_t len = (size_t)-rle_size;
+      CHECK((i + len) <= in_len);
+      CHECK((out_len + len) <= sizeof(s_decoded));
+      memcpy(&s_decoded[out_len], &in[i], len);
+      i += len;
+      out_len += len;
+    } else {
+      CHECK(i < in_len);
+      CHECK((out_len + (size_t)rle_size) <= sizeof(s_decoded));
+      memset(&s_decoded[out_len], in[i], (size_t)rle_size);
+      i++;
+      out_len += (size_t)rle_size;
+    }
+  }
+  return out_len;
+}
+
+//! Reads the coredump saved the way the packetizer does and decodes it
+//!
+//! @return The length of the decoded coredump
+static size_t prv_read_and_decode(void) {
+  const sMemfaultDataSourceImpl *source = &g_memfault_coredump_data_source;
+  size_t total_size = 0;
+  CHECK(source->has_more_msgs_cb(&total_size));
+  CHECK(source->is_rle_encoded_cb());
+  CHECK(total_size < sizeof(s_storage_buf));
+
+  static uint8_t s_encoded[sizeof(s_storage_buf)];
+  CHECK(source->read_msg_cb(0, s_encoded, total_size));
+  return prv_rle_decode(s_encoded, total_size);
+}
+
+//! Walks the blocks of a decoded coredump, copying memory saved from region_start into region
+//!
+//! @param[out] bytes_saved The number of bytes of the region saved
+//! @return The footer flags
+static uint32_t prv_parse_coredump(size_t len, const void *region_start, uint8_t *region,
+                                   size_t region_size, size_t *bytes_saved) {
+  CHECK(len > (TEST_COREDUMP_HEADER_SIZE + TEST_COREDUMP_FOOTER_SIZE));
+  LONGS_EQUAL(TEST_COREDUMP_MAGIC, prv_get_u32(&s_decoded[0]));
+  LONGS_EQUAL(2, prv_get_u32(&s_decoded[4]));
+  LONGS_EQUAL(len, prv_get_u32(&s_decoded[8]));
+
+  const uint32_t region_addr = (uint32_t)(uintptr_t)region_start;
+  const size_t footer_offset = len - TEST_COREDUMP_FOOTER_SIZE;
+  *bytes_saved = 0;
+  size_t offset = TEST_COREDUMP_HEADER_SIZE;
+  while (offset < footer_offset) {
+    const uint8_t *block = &s_decoded[offset];
+    const uint32_t address = prv_get_u32(&block[4]);
+    const uint32_t block_len = prv_get_u32(&block[8]);
+    offset += TEST_COREDUMP_BLOCK_HEADER_SIZE;
+    CHECK((offset + block_len) <= footer_offset);
+
+    if ((block[0] == TEST_COREDUMP_MEMORY_REGION_BLOCK_TYPE) && (address >= region_addr) &&
+        (address < (region_addr + region_size))) {
+      // the pieces of the region are saved in order
+      LONGS_EQUAL(region_addr + *bytes_saved, address);
+      CHECK((*bytes_saved + block_len) <= region_size);
+      memcpy(&region[*bytes_saved], &s_decoded[offset], block_len);
+      *bytes_saved += block_len;
+    }
+    offset += block_len;
+  }
+  LONGS_EQUAL(footer_offset, offset);
+  return prv_get_u32(&s_decoded[footer_offset + 4]);
+}
+
+static bool prv_save(const sMfltCoredumpRegion *regions, size_t num_regions) {
+  static uint32_t s_regs[16];
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(s_regs); i++) {
+    s_regs[i] = 0x20000000 + (i * 4);
+  }
+  const sMemfaultCoredumpSaveInfo info = {
+    .regs = s_regs,
+    .regs_size = sizeof(s_regs),
+    .trace_reason = kMfltRebootReason_HardFault,
+    .regions = regions,
+    .num_regions = num_regions,
+  };
+  return memfault_coredump_save(&info);
+}
+
+static uint8_t s_region[32 * 1024];
+static uint8_t s_region_saved[sizeof(s_region)];
+
+TEST_GROUP(MfltCoredumpRleTestGroup) {
+  void setup() {
+    fake_memfault_platform_coredump_storage_setup(s_storage_buf, sizeof(s_storage_buf), 1024);
+    memfault_platform_coredump_storage_erase(0, sizeof(s_storage_buf));
+    memset(s_region_saved, 0, sizeof(s_region_saved));
+  }
+  void teardown() { }
+};
+
+TEST(MfltCoredumpRleTestGroup, Test_LargeRegionFitsWhenCompressed) {
+  // mostly zeroed RAM with a few structures dotted around
+  memset(s_region, 0, sizeof(s_region));
+  for (size_t i = 0; i < sizeof(s_region); i += 1024) {
+    for (size_t j = 0; j < 24; j++) {
+      s_region[i + j] = (uint8_t)((i / 1024) + (j * 7));
+    }
+  }
+  const sMfltCoredumpRegion regions[] = {
+    MEMFAULT_COREDUMP_MEMORY_REGION_INIT(s_region, sizeof(s_region)),
+  };
+
+  CHECK(prv_save(regions, MEMFAULT_ARRAY_SIZE(regions)));
+
+  const size_t len = prv_read_and_decode();
+  CHECK(len > sizeof(s_region));
+  size_t bytes_saved;
+  LONGS_EQUAL(0, prv_parse_coredump(len, s_region, s_region_saved, sizeof(s_region),
+                                    &bytes_saved));
+  LONGS_EQUAL(sizeof(s_region), bytes_saved);
+  MEMCMP_EQUAL(s_region, s_region_saved, sizeof(s_region));
+
+  // the estimate is computed with the same encoding
+  const sMemfaultCoredumpSaveInfo info = {
+    .regions = regions,
+    .num_regions = MEMFAULT_ARRAY_SIZE(regions),
+  };
+  CHECK(memfault_coredump_get_save_size(&info) < sizeof(s_storage_buf));
+}
+
+TEST(MfltCoredumpRleTestGroup, Test_IncompressibleRegionTruncated) {
+  uint32_t lcg = 1;
+  for (size_t i = 0; i < sizeof(s_region); i++) {
+    lcg = (lcg * 1103515245) + 12345;
+    s_region[i] = (uint8_t)(lcg >> 16);
+  }
+  // a compressible region first so the incompressible one is split up into several pieces
+  static uint32_t s_zeroes[4096];
+  const sMfltCoredumpRegion regions[] = {
+    MEMFAULT_COREDUMP_MEMORY_REGION_INIT(s_zeroes, sizeof(s_zeroes)),
+    {
+      .type = kMfltCoredumpRegionType_MemoryWordAccessOnly,
+      .region_start = s_region,
+      .region_size = 8 * 1024,
+    },
+  };
+
+  CHECK(prv_save(regions, MEMFAULT_ARRAY_SIZE(regions)));
+
+  const size_t len = prv_read_and_decode();
+  size_t bytes_saved;
+  LONGS_EQUAL(TEST_COREDUMP_TRUNCATED_FLAG,
+              prv_parse_coredump(len, s_region, s_region_saved, 8 * 1024, &bytes_saved));
+  // most of the space left is used up
+  CHECK(bytes_saved > (sizeof(s_storage_buf) * 3) / 4);
+  LONGS_EQUAL(0, bytes_saved % 4);
+  MEMCMP_EQUAL(s_region, s_region_saved, bytes_saved);
+}
+
+TEST(MfltCoredumpRleTestGroup, Test_NoOverwriteAndClear) {
+  memset(s_region, 0x5a, sizeof(s_region));
+  const sMfltCoredumpRegion regions[] = {
+    MEMFAULT_COREDUMP_MEMORY_REGION_INIT(s_region, sizeof(s_region)),
+  };
+  CHECK(prv_save(regions, MEMFAULT_ARRAY_SIZE(regions)));
+  size_t total_size;
+  CHECK(memfault_coredump_has_valid_coredump(&total_size));
+
+  // the first coredump is kept
+  CHECK(!prv_save(regions, MEMFAULT_ARRAY_SIZE(regions)));
+
+  g_memfault_coredump_data_source.mark_msg_read_cb();
+  CHECK(!memfault_coredump_has_valid_coredump(&total_size));
+  CHECK(!g_memfault_coredump_data_source.is_rle_encoded_cb());
+}
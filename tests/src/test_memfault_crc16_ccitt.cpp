@@ -52,3 +52,29 @@ TEST(MfltCrc16CcittGroup, Test_MfltCrc16CcittGroupComputeTestPatternIncemental)
   }
   LONGS_EQUAL(0x31C3, crc);
 }
+
+//! Bit at a time reference implementation
+static uint16_t prv_crc16_ccitt_reference(uint16_t crc, const uint8_t *data, size_t data_len) {
+  for (size_t i = 0; i < data_len; i++) {
+    crc ^= (uint16_t)(data[i] << 8);
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+    }
+  }
+  return crc;
+}
+
+TEST(MfltCrc16CcittGroup, Test_MfltCrc16CcittGroupComputeAllLengthsAndAlignments) {
+  uint8_t data[64];
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)((i * 151) + 17);
+  }
+
+  // covers whole slices, partial slices & unaligned starts for every slice size
+  for (size_t offset = 0; offset < 8; offset++) {
+    for (size_t len = 0; len <= sizeof(data) - offset; len++) {
+      const uint16_t expected = prv_crc16_ccitt_reference(0x1d0f, &data[offset], len);
+      LONGS_EQUAL(expected, memfault_crc16_ccitt_compute(0x1d0f, &data[offset], len));
+    }
+  }
+}
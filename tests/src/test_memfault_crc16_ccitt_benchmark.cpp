@@ -0,0 +1,121 @@
+//! @file
+//!
+//! @brief
+//! Compares the throughput of the CRC16-CCITT implementations: bit at a time (no lookup table),
+//! a byte at a time (lookup table) and slicing by 4 & 8 bytes.
+//!
+//! memfault_crc16_ccitt.c is compiled once per configuration, each copy in its own namespace, so
+//! all of them can be measured by a single run. Absolute numbers are host dependent; the
+//! interesting figure is the ratio between them.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "memfault/config.h"
+#include "memfault/core/compiler.h"
+#include "memfault/core/math.h"
+#include "memfault/util/crc16_ccitt.h"
+
+#undef MEMFAULT_CRC16_LOOKUP_TABLE_ENABLE
+#undef MEMFAULT_CRC16_SLICE_BY
+
+#define MEMFAULT_CRC16_LOOKUP_TABLE_ENABLE 0
+#define MEMFAULT_CRC16_SLICE_BY 1
+namespace crc16_no_lut {
+#include "memfault_crc16_ccitt.c"
+}
+#undef MEMFAULT_CRC16_LOOKUP_TABLE_ENABLE
+#undef MEMFAULT_CRC16_SLICE_BY
+
+#define MEMFAULT_CRC16_LOOKUP_TABLE_ENABLE 1
+#define MEMFAULT_CRC16_SLICE_BY 1
+namespace crc16_lut {
+#include "memfault_crc16_ccitt.c"
+}
+#undef MEMFAULT_CRC16_SLICE_BY
+
+#define MEMFAULT_CRC16_SLICE_BY 4
+namespace crc16_slice_by_4 {
+#include "memfault_crc16_ccitt.c"
+}
+#undef MEMFAULT_CRC16_SLICE_BY
+
+#define MEMFAULT_CRC16_SLICE_BY 8
+namespace crc16_slice_by_8 {
+#include "memfault_crc16_ccitt.c"
+}
+
+#define BENCHMARK_BUF_LEN 4096
+#define BENCHMARK_BYTES (8 * 1024 * 1024)
+#define BENCHMARK_RUNS 5
+
+typedef uint16_t (*Crc16ComputeFn)(uint16_t crc_initial_value, const void *data,
+                                   size_t data_len_bytes);
+
+typedef struct {
+  const char *name;
+  Crc16ComputeFn compute;
+} sBenchmarkVariant;
+
+static const sBenchmarkVariant s_variants[] = {
+  { "no lookup table", crc16_no_lut::memfault_crc16_ccitt_compute },
+  { "lookup table", crc16_lut::memfault_crc16_ccitt_compute },
+  { "slice-by-4", crc16_slice_by_4::memfault_crc16_ccitt_compute },
+  { "slice-by-8", crc16_slice_by_8::memfault_crc16_ccitt_compute },
+};
+
+static uint8_t s_buf[BENCHMARK_BUF_LEN];
+
+static uint64_t prv_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+//! @return the throughput in MB/s of the fastest of BENCHMARK_RUNS runs
+static double prv_run_benchmark(Crc16ComputeFn compute, uint16_t *crc_out) {
+  uint64_t best_ns = UINT64_MAX;
+  for (size_t run = 0; run < BENCHMARK_RUNS; run++) {
+    uint16_t crc = MEMFAULT_CRC16_CCITT_INITIAL_VALUE;
+    const uint64_t start = prv_time_ns();
+    for (size_t i = 0; i < (BENCHMARK_BYTES / BENCHMARK_BUF_LEN); i++) {
+      crc = compute(crc, s_buf, sizeof(s_buf));
+    }
+    const uint64_t elapsed = prv_time_ns() - start;
+    best_ns = MEMFAULT_MIN(best_ns, elapsed);
+    *crc_out = crc;
+  }
+  return ((double)BENCHMARK_BYTES / (1024 * 1024)) / ((double)best_ns / 1e9);
+}
+
+TEST_GROUP(MfltCrc16CcittBenchmark) {
+  void setup() {
+    for (size_t i = 0; i < sizeof(s_buf); i++) {
+      s_buf[i] = (uint8_t)((i * 151) + 17);
+    }
+  }
+  void teardown() { }
+};
+
+TEST(MfltCrc16CcittBenchmark, Test_Throughput) {
+  printf("\n");
+  uint16_t expected_crc = 0;
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(s_variants); i++) {
+    uint16_t crc;
+    const double mb_per_sec = prv_run_benchmark(s_variants[i].compute, &crc);
+    printf("  crc16 %-16s: %8.1f MB/s\n", s_variants[i].name, mb_per_sec);
+
+    // every variant must agree
+    if (i == 0) {
+      expected_crc = crc;
+    }
+    LONGS_EQUAL(expected_crc, crc);
+  }
+}
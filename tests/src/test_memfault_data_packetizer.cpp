@@ -21,6 +21,7 @@ extern "C" {
 
   static uint8_t s_fake_coredump[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0xa };
   static bool s_multi_call_chunking_enabled = false;
+  static bool s_fake_coredump_rle_encoded = false;
 
   static uint8_t s_fake_event[] = { 0xa, 0xb, 0xc, 0xd };
 
@@ -49,10 +50,15 @@ static bool prv_coredump_has_core(size_t *total_size_out) {
   return has_coredump;
 }
 
+static bool prv_coredump_is_rle_encoded(void) {
+  return s_fake_coredump_rle_encoded;
+}
+
 const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
   .has_more_msgs_cb = prv_coredump_has_core,
   .read_msg_cb = prv_coredump_read_core,
   .mark_msg_read_cb = prv_mark_core_read,
+  .is_rle_encoded_cb = prv_coredump_is_rle_encoded,
 };
 
 static bool prv_heartbeat_metric_read_event(uint32_t offset, void *buf, size_t buf_len) {
@@ -135,6 +141,7 @@ TEST_GROUP(MemfaultDataPacketizer){
     mock().checkExpectations();
     mock().clear();
     s_multi_call_chunking_enabled = false;
+    s_fake_coredump_rle_encoded = false;
     mock().strictOrder();
     mock(log_scope).disable();
   }
@@ -247,6 +254,27 @@ TEST(MemfaultDataPacketizer, Test_MessageUsesRle) {
   LONGS_EQUAL(1 | 0x80, packet[0]);
 }
 
+TEST(MemfaultDataPacketizer, Test_MessageRleEncodedOnSave) {
+  // A coredump which was RLE encoded when it was saved is sent as is with the RLE bit set
+  s_fake_coredump_rle_encoded = true;
+  uint8_t packet[16];
+
+  mock().expectOneCall("prv_coredump_has_core").andReturnValue(true);
+  mock().expectOneCall("prv_coredump_read_core");
+  mock().expectOneCall("prv_mark_core_read");
+  mock().expectOneCall("memfault_data_source_rle_encoder_set_active");
+
+  const bool data_expected = true;
+  prv_begin_transfer(data_expected, sizeof(s_fake_coredump));
+
+  size_t buf_len = sizeof(packet);
+  eMemfaultPacketizerStatus rv = memfault_packetizer_get_next(packet, &buf_len);
+  LONGS_EQUAL(kMemfaultPacketizerStatus_EndOfChunk, rv);
+  LONGS_EQUAL(sizeof(s_fake_coredump) + 1 /* hdr */, buf_len);
+  LONGS_EQUAL(1 | 0x80, packet[0]);
+  MEMCMP_EQUAL(s_fake_coredump, &packet[1], sizeof(s_fake_coredump));
+}
+
 TEST(MemfaultDataPacketizer, Test_EventMessageFitsInSinglePacket) {
   uint8_t packet[16];
 
@@ -0,0 +1,247 @@
+//! @file
+//!
+//! @brief
+//! Checks that the asynchronous packetizer API fills every free buffer in the pool, reuses the
+//! buffers in order as they are given back and starts over when a chunk fails to send. With
+//! require_ack set, a message is only deleted once its last chunk has been sent.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/config.h"
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+
+#define TEST_CHUNK_BUF_LEN 16
+#define TEST_NUM_BUFS 2
+#define TEST_MAX_CHUNKS 8
+
+// Chunk header bits
+#define TEST_HDR_INIT 0x08
+#define TEST_HDR_MD 0x40
+
+static size_t s_event_size;
+static size_t s_num_events;
+
+static bool prv_event_has_msg(size_t *total_size) {
+  *total_size = s_event_size;
+  return s_num_events != 0;
+}
+
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  CHECK((offset + buf_len) <= s_event_size);
+  memset(buf, 0xa5, buf_len);
+  return true;
+}
+
+static void prv_event_mark_read(void) {
+  CHECK(s_num_events > 0);
+  s_num_events--;
+}
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+};
+
+typedef struct {
+  void *bufs[TEST_MAX_CHUNKS];
+  uint8_t hdrs[TEST_MAX_CHUNKS];
+  size_t num_chunks;
+} sTestTransport;
+
+static sTestTransport s_transport;
+static uint8_t s_buf_pool[TEST_NUM_BUFS][TEST_CHUNK_BUF_LEN];
+
+static void prv_chunk_ready(void *buf, size_t buf_len, void *ctx) {
+  POINTERS_EQUAL(&s_transport, ctx);
+  CHECK(buf_len > 0);
+  CHECK(buf_len <= TEST_CHUNK_BUF_LEN);
+  CHECK(s_transport.num_chunks < TEST_MAX_CHUNKS);
+  s_transport.bufs[s_transport.num_chunks] = buf;
+  s_transport.hdrs[s_transport.num_chunks] = ((uint8_t *)buf)[0];
+  s_transport.num_chunks++;
+}
+
+static const sMemfaultPacketizerAsyncConfig s_async_cfg = {
+  .buf_pool = s_buf_pool,
+  .chunk_buf_len = TEST_CHUNK_BUF_LEN,
+  .num_bufs = TEST_NUM_BUFS,
+  .chunk_ready_cb = prv_chunk_ready,
+  .ctx = &s_transport,
+};
+
+static const sMemfaultPacketizerAsyncConfig s_async_require_ack_cfg = {
+  .buf_pool = s_buf_pool,
+  .chunk_buf_len = TEST_CHUNK_BUF_LEN,
+  .num_bufs = TEST_NUM_BUFS,
+  .chunk_ready_cb = prv_chunk_ready,
+  .ctx = &s_transport,
+  .require_ack = true,
+};
+
+TEST_GROUP(MemfaultDataPacketizerAsync) {
+  void setup() {
+    memfault_packetizer_abort();
+    memset(&s_transport, 0, sizeof(s_transport));
+    s_event_size = 5;
+    s_num_events = 0;
+    CHECK(memfault_packetizer_async_start(&s_async_cfg));
+  }
+  void teardown() {
+    // give back whatever is still in flight so the next test can start again
+    for (size_t i = 0; i < TEST_NUM_BUFS; i++) {
+      memfault_packetizer_async_chunk_sent(s_buf_pool[i], true);
+    }
+  }
+};
+
+TEST(MemfaultDataPacketizerAsync, Test_DoubleBuffered) {
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+
+  // the second message is produced while the first one is being sent
+  s_num_events = 3;
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+  POINTERS_EQUAL(s_buf_pool[0], s_transport.bufs[0]);
+  POINTERS_EQUAL(s_buf_pool[1], s_transport.bufs[1]);
+  LONGS_EQUAL(1, s_num_events);
+
+  // no free buffers
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], true);
+  LONGS_EQUAL(1, memfault_packetizer_async_fill());
+  POINTERS_EQUAL(s_buf_pool[0], s_transport.bufs[2]);
+  LONGS_EQUAL(0, s_num_events);
+
+  memfault_packetizer_async_chunk_sent(s_buf_pool[1], true);
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], true);
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+  LONGS_EQUAL(3, s_transport.num_chunks);
+  for (size_t i = 0; i < s_transport.num_chunks; i++) {
+    BYTES_EQUAL(TEST_HDR_INIT, s_transport.hdrs[i]);
+  }
+}
+
+TEST(MemfaultDataPacketizerAsync, Test_BuffersReusedInOrder) {
+  s_num_events = 4;
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+
+  // the second buffer comes back first but the first one is next in line
+  memfault_packetizer_async_chunk_sent(s_buf_pool[1], true);
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], true);
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+  POINTERS_EQUAL(s_buf_pool[0], s_transport.bufs[2]);
+  POINTERS_EQUAL(s_buf_pool[1], s_transport.bufs[3]);
+}
+
+TEST(MemfaultDataPacketizerAsync, Test_RequireAckWaitsForLastChunk) {
+  CHECK(memfault_packetizer_async_start(&s_async_require_ack_cfg));
+
+  // takes 3 chunks to send, the second chunk is produced while the first one is being sent
+  s_event_size = 30;
+  s_num_events = 2;
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD, s_transport.hdrs[0]);
+
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], true);
+  LONGS_EQUAL(1, memfault_packetizer_async_fill());
+  POINTERS_EQUAL(s_buf_pool[0], s_transport.bufs[2]);
+
+  // the message is kept until its last chunk has been sent so the next one has to wait
+  memfault_packetizer_async_chunk_sent(s_buf_pool[1], true);
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+  LONGS_EQUAL(2, s_num_events);
+
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], true);
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+  LONGS_EQUAL(1, s_num_events);
+  POINTERS_EQUAL(s_buf_pool[1], s_transport.bufs[3]);
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD, s_transport.hdrs[3]);
+}
+
+TEST(MemfaultDataPacketizerAsync, Test_RequireAckFinalChunkFailedResent) {
+  CHECK(memfault_packetizer_async_start(&s_async_require_ack_cfg));
+
+  s_num_events = 2;
+  LONGS_EQUAL(1, memfault_packetizer_async_fill());
+  BYTES_EQUAL(TEST_HDR_INIT, s_transport.hdrs[0]);
+
+  // the message is sent again rather than lost
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], false);
+  LONGS_EQUAL(1, memfault_packetizer_async_fill());
+  POINTERS_EQUAL(s_buf_pool[1], s_transport.bufs[1]);
+  BYTES_EQUAL(TEST_HDR_INIT, s_transport.hdrs[1]);
+  LONGS_EQUAL(2, s_num_events);
+
+  memfault_packetizer_async_chunk_sent(s_buf_pool[1], true);
+  LONGS_EQUAL(1, memfault_packetizer_async_fill());
+  LONGS_EQUAL(1, s_num_events);
+
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], true);
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+  LONGS_EQUAL(0, s_num_events);
+}
+
+TEST(MemfaultDataPacketizerAsync, Test_FailedSendStartsOver) {
+  // takes 3 chunks to send
+  s_event_size = 30;
+  s_num_events = 1;
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD, s_transport.hdrs[0]);
+
+  // nothing is sent until every chunk queued has been given back
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], false);
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+  memfault_packetizer_async_chunk_sent(s_buf_pool[1], false);
+
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD, s_transport.hdrs[2]);
+  LONGS_EQUAL(1, s_num_events);
+}
+
+TEST(MemfaultDataPacketizerAsync, Test_UnknownBufferIgnored) {
+  s_num_events = 3;
+  LONGS_EQUAL(2, memfault_packetizer_async_fill());
+
+  uint8_t buf[TEST_CHUNK_BUF_LEN];
+  memfault_packetizer_async_chunk_sent(buf, true);
+  memfault_packetizer_async_chunk_sent(&s_buf_pool[0][1], true);
+  memfault_packetizer_async_chunk_sent(NULL, true);
+  LONGS_EQUAL(0, memfault_packetizer_async_fill());
+}
+
+TEST(MemfaultDataPacketizerAsync, Test_InvalidConfig) {
+  // chunks are still in flight
+  s_num_events = 1;
+  LONGS_EQUAL(1, memfault_packetizer_async_fill());
+  CHECK(!memfault_packetizer_async_start(&s_async_cfg));
+  memfault_packetizer_async_chunk_sent(s_buf_pool[0], true);
+
+  sMemfaultPacketizerAsyncConfig cfg = s_async_cfg;
+  cfg.num_bufs = MEMFAULT_PACKETIZER_ASYNC_MAX_BUFS + 1;
+  CHECK(!memfault_packetizer_async_start(&cfg));
+
+  cfg = s_async_cfg;
+  cfg.num_bufs = 0;
+  CHECK(!memfault_packetizer_async_start(&cfg));
+
+  cfg = s_async_cfg;
+  cfg.chunk_buf_len = MEMFAULT_PACKETIZER_MIN_BUF_LEN - 1;
+  CHECK(!memfault_packetizer_async_start(&cfg));
+
+  cfg = s_async_cfg;
+  cfg.chunk_ready_cb = NULL;
+  CHECK(!memfault_packetizer_async_start(&cfg));
+
+  CHECK(!memfault_packetizer_async_start(NULL));
+  CHECK(memfault_packetizer_async_start(&s_async_cfg));
+}
@@ -0,0 +1,132 @@
+//! @file
+//!
+//! @brief
+//! Checks that memfault_packetizer_get_chunk_batch() packs as many chunks as fit into a buffer
+//! and that they can be split apart again.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+
+#define TEST_EVENT_SIZE 10
+// a chunk holding a whole event: header, message type, event & CRC16
+#define TEST_EVENT_CHUNK_LEN (1 + 1 + TEST_EVENT_SIZE + 2)
+
+// Chunk header bits
+#define TEST_HDR_INIT 0x08
+#define TEST_HDR_MD 0x40
+#define TEST_HDR_CONTINUATION 0x80
+
+static size_t s_num_events;
+
+static bool prv_event_has_msg(size_t *total_size) {
+  *total_size = TEST_EVENT_SIZE;
+  return s_num_events != 0;
+}
+
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  CHECK((offset + buf_len) <= TEST_EVENT_SIZE);
+  memset(buf, 0xa5, buf_len);
+  return true;
+}
+
+static void prv_event_mark_read(void) {
+  CHECK(s_num_events > 0);
+  s_num_events--;
+}
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+};
+
+TEST_GROUP(MemfaultDataPacketizerBatch) {
+  void setup() {
+    memfault_packetizer_abort();
+    s_num_events = 0;
+  }
+  void teardown() { }
+};
+
+TEST(MemfaultDataPacketizerBatch, Test_BatchPacksMessages) {
+  s_num_events = 5;
+  uint8_t batch[100];
+  size_t batch_len = sizeof(batch);
+  CHECK(memfault_packetizer_get_chunk_batch(batch, &batch_len));
+  LONGS_EQUAL(5 * (1 + TEST_EVENT_CHUNK_LEN), batch_len);
+  LONGS_EQUAL(0, s_num_events);
+
+  size_t offset = 0;
+  const void *chunk;
+  size_t chunk_len;
+  for (size_t i = 0; i < 5; i++) {
+    CHECK(memfault_packetizer_chunk_batch_next(batch, batch_len, &offset, &chunk, &chunk_len));
+    LONGS_EQUAL(TEST_EVENT_CHUNK_LEN, chunk_len);
+    POINTERS_EQUAL(&batch[(i * (1 + TEST_EVENT_CHUNK_LEN)) + 1], chunk);
+    BYTES_EQUAL(TEST_HDR_INIT, ((const uint8_t *)chunk)[0]);
+  }
+  CHECK(!memfault_packetizer_chunk_batch_next(batch, batch_len, &offset, &chunk, &chunk_len));
+
+  batch_len = sizeof(batch);
+  CHECK(!memfault_packetizer_get_chunk_batch(batch, &batch_len));
+  LONGS_EQUAL(0, batch_len);
+}
+
+TEST(MemfaultDataPacketizerBatch, Test_BatchFillsRemainingSpace) {
+  s_num_events = 3;
+  uint8_t batch[2 * (1 + TEST_EVENT_CHUNK_LEN) + 1 + MEMFAULT_PACKETIZER_MIN_BUF_LEN];
+  size_t batch_len = sizeof(batch);
+  CHECK(memfault_packetizer_get_chunk_batch(batch, &batch_len));
+  LONGS_EQUAL(sizeof(batch), batch_len);
+  LONGS_EQUAL(1, s_num_events);
+
+  // the last event didn't fit so it was started in the space left
+  size_t offset = 0;
+  const void *chunk;
+  size_t chunk_len;
+  for (size_t i = 0; i < 3; i++) {
+    CHECK(memfault_packetizer_chunk_batch_next(batch, batch_len, &offset, &chunk, &chunk_len));
+  }
+  LONGS_EQUAL(MEMFAULT_PACKETIZER_MIN_BUF_LEN, chunk_len);
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD, ((const uint8_t *)chunk)[0]);
+
+  batch_len = sizeof(batch);
+  CHECK(memfault_packetizer_get_chunk_batch(batch, &batch_len));
+  offset = 0;
+  CHECK(memfault_packetizer_chunk_batch_next(batch, batch_len, &offset, &chunk, &chunk_len));
+  BYTES_EQUAL(TEST_HDR_CONTINUATION, ((const uint8_t *)chunk)[0]);
+  CHECK(!memfault_packetizer_chunk_batch_next(batch, batch_len, &offset, &chunk, &chunk_len));
+  LONGS_EQUAL(0, s_num_events);
+}
+
+TEST(MemfaultDataPacketizerBatch, Test_BatchTooSmall) {
+  s_num_events = 1;
+  uint8_t batch[MEMFAULT_PACKETIZER_MIN_BUF_LEN];
+  size_t batch_len = sizeof(batch);
+  CHECK(!memfault_packetizer_get_chunk_batch(batch, &batch_len));
+  LONGS_EQUAL(0, batch_len);
+  LONGS_EQUAL(1, s_num_events);
+}
+
+TEST(MemfaultDataPacketizerBatch, Test_MalformedBatch) {
+  const uint8_t batch[] = { 3, 'a', 'b', 'c', 3, 'd', 'e' };
+  size_t offset = 0;
+  const void *chunk;
+  size_t chunk_len;
+  CHECK(memfault_packetizer_chunk_batch_next(batch, sizeof(batch), &offset, &chunk, &chunk_len));
+  LONGS_EQUAL(3, chunk_len);
+  CHECK(!memfault_packetizer_chunk_batch_next(batch, sizeof(batch), &offset, &chunk, &chunk_len));
+
+  const uint8_t empty_chunk[] = { 0 };
+  offset = 0;
+  CHECK(!memfault_packetizer_chunk_batch_next(empty_chunk, sizeof(empty_chunk), &offset, &chunk,
+                                              &chunk_len));
+}
@@ -0,0 +1,217 @@
+//! @file
+//!
+//! @brief
+//! Checks the bytes produced by the packetizer are accounted for by data source and that logs
+//! are held back while the byte budget is exhausted.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/platform/core.h"
+
+#define TEST_MSG_SIZE 10
+// a chunk holding a whole message: header, message type, message & CRC16
+#define TEST_MSG_CHUNK_LEN (1 + 1 + TEST_MSG_SIZE + 2)
+
+// MEMFAULT_PACKETIZER_BYTE_BUDGET_BURST_BYTES for the test
+#define TEST_BURST_BYTES 100
+
+// Message types as they appear in the first byte of every message
+#define TEST_TYPE_COREDUMP 1
+#define TEST_TYPE_EVENT 2
+#define TEST_TYPE_LOG 3
+
+typedef struct {
+  size_t msg_size;
+  size_t num_msgs;
+} sTestSource;
+
+static sTestSource s_coredumps;
+static sTestSource s_events;
+static sTestSource s_logs;
+
+static uint64_t s_time_since_boot_ms;
+
+uint64_t memfault_platform_get_time_since_boot_ms(void) {
+  return s_time_since_boot_ms;
+}
+
+static bool prv_has_msg(sTestSource *source, size_t *total_size) {
+  *total_size = source->msg_size;
+  return source->num_msgs != 0;
+}
+
+static bool prv_read_msg(sTestSource *source, uint32_t offset, void *buf, size_t buf_len) {
+  CHECK(source->num_msgs > 0);
+  CHECK((offset + buf_len) <= source->msg_size);
+  memset(buf, 0xa5, buf_len);
+  return true;
+}
+
+static void prv_mark_read(sTestSource *source) {
+  CHECK(source->num_msgs > 0);
+  source->num_msgs--;
+}
+
+static bool prv_coredump_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_coredumps, total_size);
+}
+static bool prv_coredump_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_coredumps, offset, buf, buf_len);
+}
+static void prv_coredump_mark_read(void) {
+  prv_mark_read(&s_coredumps);
+}
+
+static bool prv_event_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_events, total_size);
+}
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_events, offset, buf, buf_len);
+}
+static void prv_event_mark_read(void) {
+  prv_mark_read(&s_events);
+}
+
+static bool prv_log_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_logs, total_size);
+}
+static bool prv_log_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_logs, offset, buf, buf_len);
+}
+static void prv_log_mark_read(void) {
+  prv_mark_read(&s_logs);
+}
+
+const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
+  .has_more_msgs_cb = prv_coredump_has_msg,
+  .read_msg_cb = prv_coredump_read,
+  .mark_msg_read_cb = prv_coredump_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_log_data_source = {
+  .has_more_msgs_cb = prv_log_has_msg,
+  .read_msg_cb = prv_log_read,
+  .mark_msg_read_cb = prv_log_mark_read,
+};
+
+TEST_GROUP(MemfaultDataPacketizerByteBudget) {
+  void setup() {
+    memfault_packetizer_abort();
+    memfault_packetizer_reset_byte_stats();
+    s_coredumps = (sTestSource) { .msg_size = TEST_MSG_SIZE, .num_msgs = 0 };
+    s_events = (sTestSource) { .msg_size = TEST_MSG_SIZE, .num_msgs = 0 };
+    s_logs = (sTestSource) { .msg_size = TEST_MSG_SIZE, .num_msgs = 0 };
+
+    // long enough for the bucket to refill completely
+    s_time_since_boot_ms += 24 * 60 * 60 * 1000;
+  }
+  void teardown() { }
+};
+
+static sMemfaultPacketizerByteStats prv_get_stats(void) {
+  sMemfaultPacketizerByteStats stats;
+  CHECK(memfault_packetizer_get_byte_stats(&stats));
+  return stats;
+}
+
+//! @return The type of the message in the chunk sent or 0 if there was nothing to send
+static uint8_t prv_send_chunk(size_t chunk_size) {
+  uint8_t buf[64];
+  size_t buf_len = chunk_size;
+  if (!memfault_packetizer_get_chunk(buf, &buf_len)) {
+    return 0;
+  }
+  return buf[1];
+}
+
+TEST(MemfaultDataPacketizerByteBudget, Test_BytesAccountedBySource) {
+  s_coredumps.num_msgs = 1;
+  s_events.num_msgs = 2;
+  s_logs.num_msgs = 1;
+  while (prv_send_chunk(TEST_MSG_CHUNK_LEN) != 0) { }
+
+  sMemfaultPacketizerByteStats stats = prv_get_stats();
+  LONGS_EQUAL(TEST_MSG_CHUNK_LEN, stats.coredump_bytes);
+  LONGS_EQUAL(2 * TEST_MSG_CHUNK_LEN, stats.event_bytes);
+  LONGS_EQUAL(TEST_MSG_CHUNK_LEN, stats.log_bytes);
+  LONGS_EQUAL(TEST_BURST_BYTES - (4 * TEST_MSG_CHUNK_LEN), stats.byte_budget);
+
+  // a new period starts but the budget carries over
+  memfault_packetizer_reset_byte_stats();
+  stats = prv_get_stats();
+  LONGS_EQUAL(0, stats.coredump_bytes);
+  LONGS_EQUAL(0, stats.event_bytes);
+  LONGS_EQUAL(0, stats.log_bytes);
+  LONGS_EQUAL(TEST_BURST_BYTES - (4 * TEST_MSG_CHUNK_LEN), stats.byte_budget);
+
+  CHECK(!memfault_packetizer_get_byte_stats(NULL));
+}
+
+TEST(MemfaultDataPacketizerByteBudget, Test_LogsDeferredWhenBudgetExhausted) {
+  // logs are sent while there is any budget left
+  s_logs.num_msgs = 10;
+  for (size_t i = 0; i < 8; i++) {
+    LONGS_EQUAL(TEST_TYPE_LOG, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+  }
+  LONGS_EQUAL(TEST_BURST_BYTES - (8 * TEST_MSG_CHUNK_LEN), prv_get_stats().byte_budget);
+  CHECK(!memfault_packetizer_data_available());
+  LONGS_EQUAL(0, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+  LONGS_EQUAL(2, s_logs.num_msgs);
+
+  // coredumps & events still get through
+  s_coredumps.num_msgs = 1;
+  s_events.num_msgs = 1;
+  LONGS_EQUAL(TEST_TYPE_COREDUMP, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+  LONGS_EQUAL(TEST_TYPE_EVENT, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+  const int32_t byte_budget = TEST_BURST_BYTES - (10 * TEST_MSG_CHUNK_LEN);
+  LONGS_EQUAL(byte_budget, prv_get_stats().byte_budget);
+  LONGS_EQUAL(0, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+
+  // once the budget is paid back, logs can be sent again
+  s_time_since_boot_ms += (uint64_t)-byte_budget * 1000;
+  LONGS_EQUAL(0, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+  s_time_since_boot_ms += 1000;
+  CHECK(memfault_packetizer_data_available());
+  LONGS_EQUAL(TEST_TYPE_LOG, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+  LONGS_EQUAL(1 - TEST_MSG_CHUNK_LEN, prv_get_stats().byte_budget);
+}
+
+TEST(MemfaultDataPacketizerByteBudget, Test_LogInFlightCompleted) {
+  s_logs.num_msgs = 2;
+  s_logs.msg_size = TEST_BURST_BYTES;
+  uint8_t buf[TEST_BURST_BYTES / 2];
+  size_t buf_len = sizeof(buf);
+  while (memfault_packetizer_get_chunk(buf, &buf_len)) {
+    buf_len = sizeof(buf);
+  }
+
+  // the whole message is sent even though the budget ran out part way through
+  LONGS_EQUAL(1, s_logs.num_msgs);
+  CHECK(prv_get_stats().byte_budget < 0);
+}
+
+TEST(MemfaultDataPacketizerByteBudget, Test_BucketRefillCapped) {
+  s_coredumps.num_msgs = 1;
+  LONGS_EQUAL(TEST_TYPE_COREDUMP, prv_send_chunk(TEST_MSG_CHUNK_LEN));
+  LONGS_EQUAL(TEST_BURST_BYTES - TEST_MSG_CHUNK_LEN, prv_get_stats().byte_budget);
+
+  s_time_since_boot_ms += 5 * 1000;
+  LONGS_EQUAL(TEST_BURST_BYTES - TEST_MSG_CHUNK_LEN + 5, prv_get_stats().byte_budget);
+
+  s_time_since_boot_ms += 60 * 60 * 1000;
+  LONGS_EQUAL(TEST_BURST_BYTES, prv_get_stats().byte_budget);
+}
@@ -0,0 +1,188 @@
+//! @file
+//!
+//! @brief
+//! Checks that with MEMFAULT_PACKETIZER_NUM_CHANNELS > 1, the messages from different data
+//! sources are in flight at the same time on their own chunk transport channels.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/config.h"
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+
+#define TEST_CHUNK_BUF_LEN 16
+
+// Chunk header bits
+#define TEST_HDR_CHANNEL_MASK 0x7
+#define TEST_HDR_INIT 0x08
+#define TEST_HDR_MD 0x40
+#define TEST_HDR_CONTINUATION 0x80
+
+typedef struct {
+  size_t msg_size;
+  size_t num_msgs;
+} sTestSource;
+
+static sTestSource s_coredumps;
+static sTestSource s_events;
+static sTestSource s_logs;
+
+static bool prv_has_msg(sTestSource *source, size_t *total_size) {
+  *total_size = source->msg_size;
+  return source->num_msgs != 0;
+}
+
+static bool prv_read_msg(sTestSource *source, uint32_t offset, void *buf, size_t buf_len) {
+  CHECK(source->num_msgs > 0);
+  CHECK((offset + buf_len) <= source->msg_size);
+  memset(buf, 0xa5, buf_len);
+  return true;
+}
+
+static void prv_mark_read(sTestSource *source) {
+  CHECK(source->num_msgs > 0);
+  source->num_msgs--;
+}
+
+static bool prv_coredump_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_coredumps, total_size);
+}
+static bool prv_coredump_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_coredumps, offset, buf, buf_len);
+}
+static void prv_coredump_mark_read(void) {
+  prv_mark_read(&s_coredumps);
+}
+
+static bool prv_event_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_events, total_size);
+}
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_events, offset, buf, buf_len);
+}
+static void prv_event_mark_read(void) {
+  prv_mark_read(&s_events);
+}
+
+static bool prv_log_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_logs, total_size);
+}
+static bool prv_log_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_logs, offset, buf, buf_len);
+}
+static void prv_log_mark_read(void) {
+  prv_mark_read(&s_logs);
+}
+
+const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
+  .has_more_msgs_cb = prv_coredump_has_msg,
+  .read_msg_cb = prv_coredump_read,
+  .mark_msg_read_cb = prv_coredump_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_log_data_source = {
+  .has_more_msgs_cb = prv_log_has_msg,
+  .read_msg_cb = prv_log_read,
+  .mark_msg_read_cb = prv_log_mark_read,
+};
+
+TEST_GROUP(MemfaultDataPacketizerChannels) {
+  void setup() {
+    memfault_packetizer_abort();
+    memset(&s_coredumps, 0, sizeof(s_coredumps));
+    memset(&s_events, 0, sizeof(s_events));
+    memset(&s_logs, 0, sizeof(s_logs));
+  }
+  void teardown() {
+    CHECK(!memfault_packetizer_data_available());
+  }
+};
+
+//! @return The header byte of the next chunk
+static uint8_t prv_get_chunk_hdr(void) {
+  uint8_t buf[TEST_CHUNK_BUF_LEN];
+  size_t buf_len = sizeof(buf);
+  CHECK(memfault_packetizer_get_chunk(buf, &buf_len));
+  return buf[0];
+}
+
+TEST(MemfaultDataPacketizerChannels, Test_EventSentAlongsideCoredump) {
+  s_coredumps = (sTestSource) { .msg_size = 40, .num_msgs = 1 };
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD | 0, prv_get_chunk_hdr());
+
+  // the event fits in a single chunk & doesn't wait for the coredump to finish
+  s_events = (sTestSource) { .msg_size = 5, .num_msgs = 1 };
+  BYTES_EQUAL(TEST_HDR_INIT | 1, prv_get_chunk_hdr());
+  LONGS_EQUAL(0, s_events.num_msgs);
+
+  // the coredump picks up where it left off
+  BYTES_EQUAL(TEST_HDR_CONTINUATION | TEST_HDR_MD | 0, prv_get_chunk_hdr());
+  BYTES_EQUAL(TEST_HDR_CONTINUATION | TEST_HDR_MD | 0, prv_get_chunk_hdr());
+  BYTES_EQUAL(TEST_HDR_CONTINUATION | 0, prv_get_chunk_hdr());
+  LONGS_EQUAL(0, s_coredumps.num_msgs);
+}
+
+TEST(MemfaultDataPacketizerChannels, Test_ChannelsTakeTurns) {
+  // every message takes 4 chunks to send
+  s_coredumps = (sTestSource) { .msg_size = 40, .num_msgs = 1 };
+  s_events = (sTestSource) { .msg_size = 40, .num_msgs = 1 };
+  s_logs = (sTestSource) { .msg_size = 40, .num_msgs = 1 };
+
+  for (size_t i = 0; i < 4 * 3; i++) {
+    LONGS_EQUAL(i % 3, prv_get_chunk_hdr() & TEST_HDR_CHANNEL_MASK);
+  }
+
+  uint8_t buf[TEST_CHUNK_BUF_LEN];
+  size_t buf_len = sizeof(buf);
+  CHECK(!memfault_packetizer_get_chunk(buf, &buf_len));
+}
+
+TEST(MemfaultDataPacketizerChannels, Test_IdleChannelsSkipped) {
+  s_logs = (sTestSource) { .msg_size = 5, .num_msgs = 2 };
+  BYTES_EQUAL(TEST_HDR_INIT | 2, prv_get_chunk_hdr());
+  BYTES_EQUAL(TEST_HDR_INIT | 2, prv_get_chunk_hdr());
+}
+
+TEST(MemfaultDataPacketizerChannels, Test_MultiCallChunkNotInterrupted) {
+  const sPacketizerConfig cfg = {
+    .enable_multi_packet_chunk = true,
+  };
+  sPacketizerMetadata metadata;
+  uint8_t buf[TEST_CHUNK_BUF_LEN];
+  size_t buf_len = sizeof(buf);
+
+  s_coredumps = (sTestSource) { .msg_size = 40, .num_msgs = 1 };
+  CHECK(memfault_packetizer_begin(&cfg, &metadata));
+  LONGS_EQUAL(kMemfaultPacketizerStatus_MoreDataForChunk,
+              memfault_packetizer_get_next(buf, &buf_len));
+
+  // the coredump is the only thing sent until the chunk ends
+  s_events = (sTestSource) { .msg_size = 5, .num_msgs = 1 };
+  CHECK(memfault_packetizer_begin(&cfg, &metadata));
+  CHECK(metadata.send_in_progress);
+  buf_len = sizeof(buf);
+  LONGS_EQUAL(kMemfaultPacketizerStatus_MoreDataForChunk,
+              memfault_packetizer_get_next(buf, &buf_len));
+  buf_len = sizeof(buf);
+  LONGS_EQUAL(kMemfaultPacketizerStatus_EndOfChunk, memfault_packetizer_get_next(buf, &buf_len));
+  LONGS_EQUAL(0, s_coredumps.num_msgs);
+  LONGS_EQUAL(1, s_events.num_msgs);
+
+  CHECK(memfault_packetizer_begin(&cfg, &metadata));
+  CHECK(!metadata.send_in_progress);
+  buf_len = sizeof(buf);
+  LONGS_EQUAL(kMemfaultPacketizerStatus_EndOfChunk, memfault_packetizer_get_next(buf, &buf_len));
+  BYTES_EQUAL(TEST_HDR_INIT | 1, buf[0]);
+}
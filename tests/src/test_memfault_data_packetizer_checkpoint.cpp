@@ -0,0 +1,228 @@
+//! @file
+//!
+//! @brief
+//! Checks that the packetizer picks up where it left off after a reboot when its checkpoint is
+//! restored, and only when the message being sent hasn't changed.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+
+#define TEST_CHUNK_BUF_LEN 16
+#define TEST_MAX_CHUNKS 32
+
+// Chunk header bits
+#define TEST_HDR_INIT 0x08
+#define TEST_HDR_MD 0x40
+
+typedef struct {
+  uint8_t data[200];
+  size_t size;
+  bool available;
+} sTestSource;
+
+static sTestSource s_coredump;
+static sTestSource s_event;
+
+static bool prv_has_msg(sTestSource *source, size_t *total_size) {
+  *total_size = source->size;
+  return source->available;
+}
+
+static bool prv_read_msg(sTestSource *source, uint32_t offset, void *buf, size_t buf_len) {
+  CHECK(source->available);
+  CHECK((offset + buf_len) <= source->size);
+  memcpy(buf, &source->data[offset], buf_len);
+  return true;
+}
+
+static bool prv_coredump_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_coredump, total_size);
+}
+static bool prv_coredump_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_coredump, offset, buf, buf_len);
+}
+static void prv_coredump_mark_read(void) {
+  s_coredump.available = false;
+}
+
+static bool prv_event_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_event, total_size);
+}
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_event, offset, buf, buf_len);
+}
+static void prv_event_mark_read(void) {
+  s_event.available = false;
+}
+
+const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
+  .has_more_msgs_cb = prv_coredump_has_msg,
+  .read_msg_cb = prv_coredump_read,
+  .mark_msg_read_cb = prv_coredump_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+};
+
+typedef struct {
+  uint8_t data[TEST_CHUNK_BUF_LEN];
+  size_t len;
+} sTestChunk;
+
+TEST_GROUP(MemfaultDataPacketizerCheckpoint) {
+  void setup() {
+    memfault_packetizer_abort();
+
+    // a mix of literals & runs of repeated bytes for the RLE encoder
+    s_coredump.size = sizeof(s_coredump.data);
+    for (size_t i = 0; i < s_coredump.size; i++) {
+      s_coredump.data[i] = (i < 100) ? (uint8_t)(i * 7) : (uint8_t)(i / 20);
+    }
+    s_coredump.available = false;
+
+    s_event.size = 60;
+    for (size_t i = 0; i < s_event.size; i++) {
+      s_event.data[i] = (uint8_t)(i * 7);
+    }
+    s_event.available = false;
+  }
+  void teardown() {
+    memfault_packetizer_abort();
+  }
+};
+
+static size_t prv_get_chunks(sTestChunk *chunks, size_t max_chunks) {
+  size_t num_chunks = 0;
+  while (num_chunks < max_chunks) {
+    sTestChunk *chunk = &chunks[num_chunks];
+    chunk->len = sizeof(chunk->data);
+    if (!memfault_packetizer_get_chunk(chunk->data, &chunk->len)) {
+      break;
+    }
+    num_chunks++;
+  }
+  return num_chunks;
+}
+
+//! Sends the coredump with a reboot after the first num_chunks_before_reboot chunks and checks
+//! the chunks sent match those when there's no reboot
+static void prv_check_resume(sTestSource *source, size_t num_chunks_before_reboot) {
+  static sTestChunk s_expected[TEST_MAX_CHUNKS];
+  source->available = true;
+  const size_t num_expected = prv_get_chunks(s_expected, TEST_MAX_CHUNKS);
+  CHECK(num_expected > num_chunks_before_reboot);
+  CHECK(!source->available);
+  const uint8_t rle_enable_mask = 0x80;
+  LONGS_EQUAL(source == &s_coredump, (s_expected[0].data[2] & rle_enable_mask) != 0);
+
+  source->available = true;
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(num_chunks_before_reboot, prv_get_chunks(chunks, num_chunks_before_reboot));
+  sMemfaultPacketizerCheckpoint checkpoint;
+  memfault_packetizer_get_checkpoint(&checkpoint);
+
+  // reboot
+  memfault_packetizer_abort();
+  CHECK(memfault_packetizer_restore_checkpoint(&checkpoint));
+
+  const size_t num_chunks = prv_get_chunks(chunks, TEST_MAX_CHUNKS);
+  LONGS_EQUAL(num_expected - num_chunks_before_reboot, num_chunks);
+  for (size_t i = 0; i < num_chunks; i++) {
+    const sTestChunk *expected = &s_expected[num_chunks_before_reboot + i];
+    LONGS_EQUAL(expected->len, chunks[i].len);
+    MEMCMP_EQUAL(expected->data, chunks[i].data, expected->len);
+  }
+  CHECK(!source->available);
+}
+
+TEST(MemfaultDataPacketizerCheckpoint, Test_ResumeCoredump) {
+  prv_check_resume(&s_coredump, 1);
+  prv_check_resume(&s_coredump, 3);
+}
+
+TEST(MemfaultDataPacketizerCheckpoint, Test_ResumeEvent) {
+  prv_check_resume(&s_event, 2);
+}
+
+TEST(MemfaultDataPacketizerCheckpoint, Test_ChangedMessageStartsOver) {
+  s_event.available = true;
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(2, prv_get_chunks(chunks, 2));
+  sMemfaultPacketizerCheckpoint checkpoint;
+  memfault_packetizer_get_checkpoint(&checkpoint);
+  memfault_packetizer_abort();
+
+  // the contents of an event held in RAM are different after a reboot
+  s_event.data[3] ^= 0xff;
+  CHECK(!memfault_packetizer_restore_checkpoint(&checkpoint));
+  LONGS_EQUAL(1, prv_get_chunks(chunks, 1));
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD, chunks[0].data[0]);
+  memfault_packetizer_abort();
+
+  // as is its size
+  s_event.data[3] ^= 0xff;
+  s_event.size--;
+  CHECK(!memfault_packetizer_restore_checkpoint(&checkpoint));
+  LONGS_EQUAL(1, prv_get_chunks(chunks, 1));
+  BYTES_EQUAL(TEST_HDR_INIT | TEST_HDR_MD, chunks[0].data[0]);
+}
+
+TEST(MemfaultDataPacketizerCheckpoint, Test_InvalidCheckpoint) {
+  sMemfaultPacketizerCheckpoint checkpoint;
+  memset(&checkpoint, 0, sizeof(checkpoint));
+  CHECK(!memfault_packetizer_restore_checkpoint(&checkpoint));
+  CHECK(!memfault_packetizer_restore_checkpoint(NULL));
+
+  s_event.available = true;
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(2, prv_get_chunks(chunks, 2));
+  memfault_packetizer_get_checkpoint(&checkpoint);
+
+  // must be restored before anything is sent
+  CHECK(!memfault_packetizer_restore_checkpoint(&checkpoint));
+
+  memfault_packetizer_abort();
+  checkpoint.msgs[0].read_offset++;
+  CHECK(!memfault_packetizer_restore_checkpoint(&checkpoint));
+}
+
+TEST(MemfaultDataPacketizerCheckpoint, Test_NothingInFlight) {
+  sMemfaultPacketizerCheckpoint checkpoint;
+  memfault_packetizer_get_checkpoint(&checkpoint);
+  memfault_packetizer_abort();
+  CHECK(!memfault_packetizer_restore_checkpoint(&checkpoint));
+
+  s_event.available = true;
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  CHECK(prv_get_chunks(chunks, TEST_MAX_CHUNKS) > 0);
+  CHECK(!s_event.available);
+}
+
+TEST(MemfaultDataPacketizerCheckpoint, Test_MultiCallChunkNotCheckpointed) {
+  const sPacketizerConfig cfg = {
+    .enable_multi_packet_chunk = true,
+  };
+  sPacketizerMetadata metadata;
+  uint8_t buf[TEST_CHUNK_BUF_LEN];
+  size_t buf_len = sizeof(buf);
+
+  s_event.available = true;
+  CHECK(memfault_packetizer_begin(&cfg, &metadata));
+  LONGS_EQUAL(kMemfaultPacketizerStatus_MoreDataForChunk,
+              memfault_packetizer_get_next(buf, &buf_len));
+
+  sMemfaultPacketizerCheckpoint checkpoint;
+  memfault_packetizer_get_checkpoint(&checkpoint);
+  LONGS_EQUAL(0, checkpoint.msgs[0].read_offset);
+}
@@ -0,0 +1,151 @@
+//! @file
+//!
+//! @brief
+//! Checks that memfault_packetizer_get_pending_stats() reports the data waiting in every source
+//! without making a pass over the data, i.e to compute the size of an RLE encoded coredump.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+
+typedef struct {
+  size_t num_msgs;
+  size_t msg_size;
+  size_t num_reads;
+} sTestSource;
+
+static sTestSource s_coredumps;
+static sTestSource s_events;
+static sTestSource s_logs;
+
+static bool prv_has_msg(sTestSource *source, size_t *total_size) {
+  *total_size = source->msg_size;
+  return source->num_msgs != 0;
+}
+
+static bool prv_read_msg(sTestSource *source, uint32_t offset, void *buf, size_t buf_len) {
+  CHECK((offset + buf_len) <= source->msg_size);
+  memset(buf, 0xa5, buf_len);
+  source->num_reads++;
+  return true;
+}
+
+static void prv_mark_read(sTestSource *source) {
+  CHECK(source->num_msgs > 0);
+  source->num_msgs--;
+}
+
+static void prv_get_pending_stats(sTestSource *source, size_t *num_msgs, size_t *num_bytes) {
+  *num_msgs = source->num_msgs;
+  *num_bytes = source->num_msgs * source->msg_size;
+}
+
+static bool prv_coredump_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_coredumps, total_size);
+}
+static bool prv_coredump_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_coredumps, offset, buf, buf_len);
+}
+static void prv_coredump_mark_read(void) {
+  prv_mark_read(&s_coredumps);
+}
+
+static bool prv_event_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_events, total_size);
+}
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_events, offset, buf, buf_len);
+}
+static void prv_event_mark_read(void) {
+  prv_mark_read(&s_events);
+}
+static void prv_event_get_pending_stats(size_t *num_msgs, size_t *num_bytes) {
+  prv_get_pending_stats(&s_events, num_msgs, num_bytes);
+}
+
+static bool prv_log_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_logs, total_size);
+}
+static bool prv_log_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_logs, offset, buf, buf_len);
+}
+static void prv_log_mark_read(void) {
+  prv_mark_read(&s_logs);
+}
+static void prv_log_get_pending_stats(size_t *num_msgs, size_t *num_bytes) {
+  prv_get_pending_stats(&s_logs, num_msgs, num_bytes);
+}
+
+// no get_pending_stats_cb so the packetizer falls back to has_more_msgs_cb
+const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
+  .has_more_msgs_cb = prv_coredump_has_msg,
+  .read_msg_cb = prv_coredump_read,
+  .mark_msg_read_cb = prv_coredump_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+  .get_pending_stats_cb = prv_event_get_pending_stats,
+};
+
+const sMemfaultDataSourceImpl g_memfault_log_data_source = {
+  .has_more_msgs_cb = prv_log_has_msg,
+  .read_msg_cb = prv_log_read,
+  .mark_msg_read_cb = prv_log_mark_read,
+  .get_pending_stats_cb = prv_log_get_pending_stats,
+};
+
+TEST_GROUP(MemfaultDataPacketizerPendingStats) {
+  void setup() {
+    memfault_packetizer_abort();
+    memset(&s_coredumps, 0, sizeof(s_coredumps));
+    memset(&s_events, 0, sizeof(s_events));
+    memset(&s_logs, 0, sizeof(s_logs));
+  }
+  void teardown() {
+    memfault_packetizer_abort();
+  }
+};
+
+TEST(MemfaultDataPacketizerPendingStats, Test_NothingPending) {
+  sMemfaultPacketizerPendingStats stats;
+  CHECK(memfault_packetizer_get_pending_stats(&stats));
+  LONGS_EQUAL(0, stats.coredumps.count);
+  LONGS_EQUAL(0, stats.events.count);
+  LONGS_EQUAL(0, stats.logs.count);
+  LONGS_EQUAL(0, stats.total_bytes);
+
+  CHECK(!memfault_packetizer_get_pending_stats(NULL));
+}
+
+TEST(MemfaultDataPacketizerPendingStats, Test_AllSources) {
+  s_coredumps = (sTestSource) { .num_msgs = 1, .msg_size = 1000 };
+  s_events = (sTestSource) { .num_msgs = 3, .msg_size = 20 };
+  s_logs = (sTestSource) { .num_msgs = 2, .msg_size = 50 };
+
+  sMemfaultPacketizerPendingStats stats;
+  CHECK(memfault_packetizer_get_pending_stats(&stats));
+  LONGS_EQUAL(1, stats.coredumps.count);
+  LONGS_EQUAL(1000, stats.coredumps.bytes);
+  LONGS_EQUAL(3, stats.events.count);
+  LONGS_EQUAL(60, stats.events.bytes);
+  LONGS_EQUAL(2, stats.logs.count);
+  LONGS_EQUAL(100, stats.logs.bytes);
+  LONGS_EQUAL(1160, stats.total_bytes);
+
+  // the coredump size came from the coredump itself rather than the RLE encoder
+  LONGS_EQUAL(0, s_coredumps.num_reads);
+
+  // which does read the whole coredump when it is picked to be sent
+  CHECK(memfault_packetizer_data_available());
+  CHECK(s_coredumps.num_reads > 0);
+}
@@ -0,0 +1,304 @@
+//! @file
+//!
+//! @brief
+//! Checks the order in which the packetizer sends messages from the different data sources for
+//! the configured MEMFAULT_PACKETIZER_SCHEDULER, and coredump preemption.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/config.h"
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/math.h"
+#include "memfault/util/chunk_transport.h"
+
+// Message types as they appear in the first byte of every message
+#define TEST_TYPE_COREDUMP 1
+#define TEST_TYPE_EVENT 2
+#define TEST_TYPE_LOG 3
+
+#define TEST_MAX_MSGS 32
+
+typedef struct {
+  size_t msg_sizes[TEST_MAX_MSGS];
+  size_t num_msgs;
+  size_t num_reads;
+} sTestSource;
+
+static sTestSource s_coredumps;
+static sTestSource s_events;
+static sTestSource s_logs;
+
+static void prv_queue_msgs(sTestSource *source, size_t num_msgs, size_t msg_size) {
+  for (size_t i = 0; i < num_msgs; i++) {
+    CHECK(source->num_msgs < TEST_MAX_MSGS);
+    source->msg_sizes[source->num_msgs++] = msg_size;
+  }
+}
+
+static bool prv_has_msg(sTestSource *source, size_t *total_size) {
+  if (source->num_msgs == 0) {
+    return false;
+  }
+  *total_size = source->msg_sizes[0];
+  return true;
+}
+
+static bool prv_read_msg(sTestSource *source, uint32_t offset, void *buf, size_t buf_len) {
+  CHECK(source->num_msgs > 0);
+  CHECK((offset + buf_len) <= source->msg_sizes[0]);
+  // every byte holds its offset so it's easy to tell where a read started
+  uint8_t *bytes = (uint8_t *)buf;
+  for (size_t i = 0; i < buf_len; i++) {
+    bytes[i] = (uint8_t)(offset + i);
+  }
+  source->num_reads++;
+  return true;
+}
+
+static void prv_mark_read(sTestSource *source) {
+  CHECK(source->num_msgs > 0);
+  source->num_msgs--;
+  memmove(&source->msg_sizes[0], &source->msg_sizes[1], source->num_msgs * sizeof(size_t));
+}
+
+static bool prv_coredump_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_coredumps, total_size);
+}
+static bool prv_coredump_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_coredumps, offset, buf, buf_len);
+}
+static void prv_coredump_mark_read(void) {
+  prv_mark_read(&s_coredumps);
+}
+
+static bool prv_event_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_events, total_size);
+}
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_events, offset, buf, buf_len);
+}
+static void prv_event_mark_read(void) {
+  prv_mark_read(&s_events);
+}
+
+static bool prv_log_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_logs, total_size);
+}
+static bool prv_log_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_logs, offset, buf, buf_len);
+}
+static void prv_log_mark_read(void) {
+  prv_mark_read(&s_logs);
+}
+
+const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
+  .has_more_msgs_cb = prv_coredump_has_msg,
+  .read_msg_cb = prv_coredump_read,
+  .mark_msg_read_cb = prv_coredump_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_log_data_source = {
+  .has_more_msgs_cb = prv_log_has_msg,
+  .read_msg_cb = prv_log_read,
+  .mark_msg_read_cb = prv_log_mark_read,
+};
+
+// The contents of a chunk are opaque to the scheduler so the transport is faked with one that has
+// no overhead
+bool memfault_chunk_transport_get_next_chunk(sMfltChunkTransportCtx *ctx, void *buf,
+                                             size_t *buf_len) {
+  const size_t bytes_to_read = MEMFAULT_MIN(*buf_len, ctx->total_size - ctx->read_offset);
+  ctx->read_msg(ctx->read_offset, buf, bytes_to_read);
+  ctx->read_offset += bytes_to_read;
+  *buf_len = bytes_to_read;
+  return (ctx->read_offset != ctx->total_size);
+}
+
+void memfault_chunk_transport_get_chunk_info(sMfltChunkTransportCtx *ctx) {
+  ctx->single_chunk_message_length = ctx->total_size;
+}
+
+TEST_GROUP(MemfaultDataPacketizerScheduler) {
+  void setup() {
+    memfault_packetizer_abort();
+    memset(&s_coredumps, 0, sizeof(s_coredumps));
+    memset(&s_events, 0, sizeof(s_events));
+    memset(&s_logs, 0, sizeof(s_logs));
+  }
+  void teardown() {
+    // drain anything left so the scheduler starts from a clean slate in the next test
+    uint8_t buf[256];
+    size_t buf_len = sizeof(buf);
+    while (memfault_packetizer_get_chunk(buf, &buf_len)) {
+      buf_len = sizeof(buf);
+    }
+  }
+};
+
+//! Sends whole messages and records the type of each one
+static size_t prv_send_msgs(uint8_t *types, size_t max_msgs) {
+  size_t num_msgs = 0;
+  uint8_t buf[256];
+  size_t buf_len = sizeof(buf);
+  while ((num_msgs < max_msgs) && memfault_packetizer_get_chunk(buf, &buf_len)) {
+    types[num_msgs++] = buf[0];
+    buf_len = sizeof(buf);
+  }
+  return num_msgs;
+}
+
+#if MEMFAULT_PACKETIZER_SCHEDULER == MEMFAULT_PACKETIZER_SCHEDULER_ROUND_ROBIN
+//! Sends a log so the coredump source is next in line
+static void prv_round_robin_start_at_coredump(void) {
+  prv_queue_msgs(&s_logs, 1, 10);
+  uint8_t types[1];
+  LONGS_EQUAL(1, prv_send_msgs(types, sizeof(types)));
+}
+
+TEST(MemfaultDataPacketizerScheduler, Test_RoundRobin) {
+  prv_round_robin_start_at_coredump();
+  prv_queue_msgs(&s_coredumps, 2, 100);
+  prv_queue_msgs(&s_events, 3, 10);
+  prv_queue_msgs(&s_logs, 1, 20);
+
+  uint8_t types[TEST_MAX_MSGS];
+  const uint8_t expected[] = {
+    TEST_TYPE_COREDUMP, TEST_TYPE_EVENT, TEST_TYPE_LOG,
+    TEST_TYPE_COREDUMP, TEST_TYPE_EVENT, TEST_TYPE_EVENT,
+  };
+  LONGS_EQUAL(sizeof(expected), prv_send_msgs(types, sizeof(types)));
+  MEMCMP_EQUAL(expected, types, sizeof(expected));
+}
+
+TEST(MemfaultDataPacketizerScheduler, Test_RoundRobinSkipsIdleSources) {
+  prv_round_robin_start_at_coredump();
+  prv_queue_msgs(&s_events, 1, 10);
+  uint8_t types[TEST_MAX_MSGS];
+  LONGS_EQUAL(1, prv_send_msgs(types, sizeof(types)));
+
+  // the log source is next in line but has nothing to send
+  prv_queue_msgs(&s_coredumps, 1, 10);
+  prv_queue_msgs(&s_events, 1, 10);
+  const uint8_t expected[] = { TEST_TYPE_COREDUMP, TEST_TYPE_EVENT };
+  LONGS_EQUAL(sizeof(expected), prv_send_msgs(types, sizeof(types)));
+  MEMCMP_EQUAL(expected, types, sizeof(expected));
+}
+#endif
+
+#if MEMFAULT_PACKETIZER_SCHEDULER == MEMFAULT_PACKETIZER_SCHEDULER_WEIGHTED_FAIR
+TEST(MemfaultDataPacketizerScheduler, Test_WeightedFairShare) {
+  // weights are 1 (coredump), 4 (events) & 1 (logs)
+  prv_queue_msgs(&s_coredumps, 4, 40);
+  prv_queue_msgs(&s_events, 16, 40);
+  prv_queue_msgs(&s_logs, 4, 40);
+
+  uint8_t types[TEST_MAX_MSGS];
+  LONGS_EQUAL(24, prv_send_msgs(types, sizeof(types)));
+
+  // while every source is backlogged, events get 4 times the bytes of the other sources
+  size_t counts[4] = { 0 };
+  for (size_t i = 0; i < 12; i++) {
+    counts[types[i]]++;
+  }
+  LONGS_EQUAL(2, counts[TEST_TYPE_COREDUMP]);
+  LONGS_EQUAL(8, counts[TEST_TYPE_EVENT]);
+  LONGS_EQUAL(2, counts[TEST_TYPE_LOG]);
+}
+
+TEST(MemfaultDataPacketizerScheduler, Test_WeightedFairIsByBytes) {
+  // a big coredump uses up the coredump share for a while
+  prv_queue_msgs(&s_coredumps, 1, 200);
+  prv_queue_msgs(&s_coredumps, 1, 10);
+  prv_queue_msgs(&s_logs, 10, 10);
+
+  uint8_t types[TEST_MAX_MSGS];
+  LONGS_EQUAL(12, prv_send_msgs(types, sizeof(types)));
+  LONGS_EQUAL(TEST_TYPE_COREDUMP, types[0]);
+  for (size_t i = 1; i < 11; i++) {
+    LONGS_EQUAL(TEST_TYPE_LOG, types[i]);
+  }
+  LONGS_EQUAL(TEST_TYPE_COREDUMP, types[11]);
+}
+
+TEST(MemfaultDataPacketizerScheduler, Test_WeightedFairIdleSourceDoesNotCatchUp) {
+  prv_queue_msgs(&s_coredumps, 10, 10);
+  uint8_t types[TEST_MAX_MSGS];
+  LONGS_EQUAL(5, prv_send_msgs(types, 5));
+
+  // logs were idle while coredumps were sent so they don't get to send a burst now
+  prv_queue_msgs(&s_logs, 5, 10);
+  const uint8_t expected[] = {
+    TEST_TYPE_LOG, TEST_TYPE_COREDUMP, TEST_TYPE_LOG, TEST_TYPE_COREDUMP,
+  };
+  LONGS_EQUAL(sizeof(expected), prv_send_msgs(types, sizeof(expected)));
+  MEMCMP_EQUAL(expected, types, sizeof(expected));
+}
+#endif
+
+#if MEMFAULT_PACKETIZER_EVENTS_PREEMPT_COREDUMP
+//! Sends a chunk of at most chunk_size bytes and checks which message it came from
+static void prv_check_chunk(size_t chunk_size, uint8_t type, size_t msg_offset) {
+  uint8_t buf[256];
+  size_t buf_len = chunk_size;
+  CHECK(memfault_packetizer_get_chunk(buf, &buf_len));
+  if (msg_offset == 0) {
+    LONGS_EQUAL(type, buf[0]);
+  } else {
+    // the packetizer header occupies the first byte of the message
+    LONGS_EQUAL((uint8_t)(msg_offset - 1), buf[0]);
+  }
+}
+
+TEST(MemfaultDataPacketizerScheduler, Test_EventsPreemptCoredump) {
+  prv_queue_msgs(&s_coredumps, 1, 99);
+
+  // 100 bytes including the header, sent 10 bytes at a time
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 0);
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 10);
+
+  // all the events waiting are sent before the coredump starts over
+  prv_queue_msgs(&s_events, 2, 9);
+  prv_check_chunk(10, TEST_TYPE_EVENT, 0);
+  LONGS_EQUAL(1, s_events.num_msgs);
+  prv_check_chunk(10, TEST_TYPE_EVENT, 0);
+  LONGS_EQUAL(0, s_events.num_msgs);
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 0);
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 10);
+
+  // the coredump is only preempted once
+  prv_queue_msgs(&s_events, 1, 9);
+  for (size_t offset = 20; offset < 100; offset += 10) {
+    prv_check_chunk(10, TEST_TYPE_COREDUMP, offset);
+  }
+  LONGS_EQUAL(0, s_coredumps.num_msgs);
+  prv_check_chunk(10, TEST_TYPE_EVENT, 0);
+
+  // and the next coredump can be preempted again
+  prv_queue_msgs(&s_coredumps, 1, 99);
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 0);
+  prv_queue_msgs(&s_events, 1, 9);
+  prv_check_chunk(10, TEST_TYPE_EVENT, 0);
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 0);
+}
+
+TEST(MemfaultDataPacketizerScheduler, Test_LogsDontPreemptCoredump) {
+  prv_queue_msgs(&s_coredumps, 1, 19);
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 0);
+  prv_queue_msgs(&s_logs, 1, 9);
+  prv_check_chunk(10, TEST_TYPE_COREDUMP, 10);
+  prv_check_chunk(10, TEST_TYPE_LOG, 0);
+}
+#endif
@@ -0,0 +1,378 @@
+//! @file
+//!
+//! @brief
+//! Checks that after rewinding the packetizer to the offset of a chunk the receiver missed, the
+//! same chunks are sent again from there and the message still reassembles with a valid CRC16.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "memfault/config.h"
+#include "memfault/core/compiler.h"
+#include "memfault/core/data_packetizer.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/util/chunk_reassembler.h"
+#include "memfault/util/lz.h"
+#include "memfault/util/varint.h"
+
+#define TEST_CHUNK_BUF_LEN 16
+#define TEST_MAX_CHUNKS 64
+
+// Chunk header bits
+#define TEST_HDR_CONTINUATION 0x80
+
+// Message type bits
+#define TEST_MSG_TYPE_COREDUMP 0x1
+#define TEST_MSG_TYPE_RLE 0x80
+#define TEST_MSG_TYPE_LZ 0x40
+
+typedef struct {
+  uint8_t data[300];
+  size_t size;
+  bool available;
+  size_t num_reads;
+} sTestSource;
+
+static sTestSource s_coredump;
+static sTestSource s_event;
+
+static bool prv_has_msg(sTestSource *source, size_t *total_size) {
+  *total_size = source->size;
+  return source->available;
+}
+
+static bool prv_read_msg(sTestSource *source, uint32_t offset, void *buf, size_t buf_len) {
+  CHECK(source->available);
+  CHECK((offset + buf_len) <= source->size);
+  memcpy(buf, &source->data[offset], buf_len);
+  source->num_reads++;
+  return true;
+}
+
+static bool prv_coredump_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_coredump, total_size);
+}
+static bool prv_coredump_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_coredump, offset, buf, buf_len);
+}
+static void prv_coredump_mark_read(void) {
+  s_coredump.available = false;
+}
+
+static bool prv_event_has_msg(size_t *total_size) {
+  return prv_has_msg(&s_event, total_size);
+}
+static bool prv_event_read(uint32_t offset, void *buf, size_t buf_len) {
+  return prv_read_msg(&s_event, offset, buf, buf_len);
+}
+static void prv_event_mark_read(void) {
+  s_event.available = false;
+}
+
+const sMemfaultDataSourceImpl g_memfault_coredump_data_source = {
+  .has_more_msgs_cb = prv_coredump_has_msg,
+  .read_msg_cb = prv_coredump_read,
+  .mark_msg_read_cb = prv_coredump_mark_read,
+};
+
+const sMemfaultDataSourceImpl g_memfault_event_data_source = {
+  .has_more_msgs_cb = prv_event_has_msg,
+  .read_msg_cb = prv_event_read,
+  .mark_msg_read_cb = prv_event_mark_read,
+};
+
+typedef struct {
+  uint8_t data[TEST_CHUNK_BUF_LEN];
+  size_t len;
+} sTestChunk;
+
+static sTestChunk s_expected[TEST_MAX_CHUNKS];
+static size_t s_num_expected;
+
+TEST_GROUP(MemfaultDataPacketizerSeek) {
+  void setup() {
+    memfault_packetizer_abort();
+
+    // a mix of literals & runs of repeated bytes for the RLE & LZ encoders
+    s_coredump = (sTestSource) { .size = sizeof(s_coredump.data) };
+    for (size_t i = 0; i < s_coredump.size; i++) {
+      s_coredump.data[i] = (i < 150) ? (uint8_t)(i * 7) : (uint8_t)(i / 20);
+    }
+
+    s_event = (sTestSource) { .size = 150 };
+    for (size_t i = 0; i < s_event.size; i++) {
+      s_event.data[i] = (uint8_t)(i * 11);
+    }
+  }
+  void teardown() {
+    memfault_packetizer_abort();
+  }
+};
+
+static size_t prv_get_chunks(sTestChunk *chunks, size_t max_chunks) {
+  size_t num_chunks = 0;
+  while (num_chunks < max_chunks) {
+    sTestChunk *chunk = &chunks[num_chunks];
+    chunk->len = sizeof(chunk->data);
+    if (!memfault_packetizer_get_chunk(chunk->data, &chunk->len)) {
+      break;
+    }
+    num_chunks++;
+  }
+  return num_chunks;
+}
+
+//! Records the chunks the message is sent as when nothing goes wrong
+static void prv_get_expected_chunks(sTestSource *source) {
+  source->available = true;
+  s_num_expected = prv_get_chunks(s_expected, TEST_MAX_CHUNKS);
+  CHECK(s_num_expected > 8);
+  CHECK(!source->available);
+  source->available = true;
+}
+
+//! @return The message offset a chunk starts at
+static uint32_t prv_chunk_offset(const sTestChunk *chunk) {
+  if ((chunk->data[0] & TEST_HDR_CONTINUATION) == 0) {
+    return 0;
+  }
+  uint32_t offset;
+  CHECK(memfault_decode_varint_u32(&chunk->data[1], chunk->len - 1, &offset) != 0);
+  return offset;
+}
+
+//! Sends the first num_chunks_sent chunks, seeks back to the start of chunk seek_chunk_idx and
+//! checks the rest of the chunks sent match those sent when nothing goes wrong
+static void prv_check_seek(sTestSource *source, size_t num_chunks_sent, size_t seek_chunk_idx) {
+  prv_get_expected_chunks(source);
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(num_chunks_sent, prv_get_chunks(chunks, num_chunks_sent));
+
+  CHECK(memfault_packetizer_seek(0, prv_chunk_offset(&s_expected[seek_chunk_idx])));
+
+  const size_t num_chunks = prv_get_chunks(chunks, TEST_MAX_CHUNKS);
+  LONGS_EQUAL(s_num_expected - seek_chunk_idx, num_chunks);
+  for (size_t i = 0; i < num_chunks; i++) {
+    const sTestChunk *expected = &s_expected[seek_chunk_idx + i];
+    LONGS_EQUAL(expected->len, chunks[i].len);
+    MEMCMP_EQUAL(expected->data, chunks[i].data, expected->len);
+  }
+  CHECK(!source->available);
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_SeekToRecentChunk) {
+  prv_get_expected_chunks(&s_event);
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(6, prv_get_chunks(chunks, 6));
+
+  // the CRC16 at the start of the chunk is known so nothing needs to be read again
+  const size_t num_reads = s_event.num_reads;
+  CHECK(memfault_packetizer_seek(0, prv_chunk_offset(&s_expected[4])));
+  LONGS_EQUAL(num_reads, s_event.num_reads);
+
+  LONGS_EQUAL(1, prv_get_chunks(chunks, 1));
+  MEMCMP_EQUAL(s_expected[4].data, chunks[0].data, s_expected[4].len);
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_SeekEvent) {
+  // within the history
+  prv_check_seek(&s_event, 6, 6 - MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN);
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_SeekEventBeyondHistory) {
+  prv_check_seek(&s_event, 8, 8 - MEMFAULT_PACKETIZER_SEEK_HISTORY_LEN - 1);
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_SeekEventToStart) {
+  prv_check_seek(&s_event, 5, 0);
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_SeekCoredump) {
+  prv_check_seek(&s_coredump, 5, 4);
+  prv_check_seek(&s_coredump, 8, 2);
+  prv_check_seek(&s_coredump, 3, 0);
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_SeekMidChunk) {
+  static uint64_t s_storage[512];
+  static const sMfltChunkReassemblerConfig s_cfg = {
+    .max_devices = 1,
+    .num_channels = 1,
+    .max_msg_size = sizeof(s_coredump.data) + 1,
+  };
+  sMfltChunkReassembler reassembler;
+  CHECK(memfault_chunk_reassembler_init(&reassembler, &s_cfg, s_storage, sizeof(s_storage)));
+
+  // the receiver has the first 3 chunks but asks for data from part way through the third
+  prv_get_expected_chunks(&s_coredump);
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(5, prv_get_chunks(chunks, 5));
+  sMfltChunkReassemblerMsg msg;
+  for (size_t i = 0; i < 3; i++) {
+    LONGS_EQUAL(kMfltChunkReassemblerStatus_MoreData,
+                memfault_chunk_reassembler_add_chunk(&reassembler, 1, chunks[i].data,
+                                                     chunks[i].len, &msg));
+  }
+
+  const uint32_t offset = prv_chunk_offset(&chunks[3]) - 5;
+  CHECK(memfault_packetizer_seek(0, offset));
+  const size_t num_chunks = prv_get_chunks(chunks, TEST_MAX_CHUNKS);
+  LONGS_EQUAL(offset, prv_chunk_offset(&chunks[0]));
+  for (size_t i = 0; i < num_chunks; i++) {
+    const eMfltChunkReassemblerStatus status = memfault_chunk_reassembler_add_chunk(
+        &reassembler, 1, chunks[i].data, chunks[i].len, &msg);
+    LONGS_EQUAL(((i + 1) == num_chunks) ? kMfltChunkReassemblerStatus_MsgComplete :
+                                          kMfltChunkReassemblerStatus_MoreData,
+                status);
+  }
+  CHECK(!s_coredump.available);
+}
+
+#if MEMFAULT_DATA_SOURCE_LZ_ENABLED
+static uint8_t s_decoded[sizeof(s_coredump.data)];
+static size_t s_decoded_len;
+
+static void prv_decoder_write_cb(MEMFAULT_UNUSED void *ctx, const void *buf, size_t buf_len) {
+  CHECK((s_decoded_len + buf_len) <= sizeof(s_decoded));
+  memcpy(&s_decoded[s_decoded_len], buf, buf_len);
+  s_decoded_len += buf_len;
+}
+#endif
+
+TEST(MemfaultDataPacketizerSeek, Test_CoredumpCompressed) {
+  static uint64_t s_storage[512];
+  static const sMfltChunkReassemblerConfig s_cfg = {
+    .max_devices = 1,
+    .num_channels = 1,
+    .max_msg_size = sizeof(s_coredump.data) + 1,
+  };
+  sMfltChunkReassembler reassembler;
+  CHECK(memfault_chunk_reassembler_init(&reassembler, &s_cfg, s_storage, sizeof(s_storage)));
+
+  // a retransmission part way through is reassembled as well
+  prv_check_seek(&s_coredump, 6, 3);
+  sMfltChunkReassemblerMsg msg;
+  for (size_t i = 0; i < s_num_expected; i++) {
+    const eMfltChunkReassemblerStatus status = memfault_chunk_reassembler_add_chunk(
+        &reassembler, 1, s_expected[i].data, s_expected[i].len, &msg);
+    LONGS_EQUAL(((i + 1) == s_num_expected) ? kMfltChunkReassemblerStatus_MsgComplete :
+                                              kMfltChunkReassemblerStatus_MoreData,
+                status);
+  }
+  CHECK(msg.len < s_coredump.size);
+
+#if MEMFAULT_DATA_SOURCE_LZ_ENABLED
+  LONGS_EQUAL(TEST_MSG_TYPE_COREDUMP | TEST_MSG_TYPE_LZ, msg.data[0]);
+
+  static uint8_t s_window[MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE];
+  const sMemfaultLzConfig config = {
+    .window = s_window,
+    .window_size = sizeof(s_window),
+  };
+  sMemfaultLzDecoder decoder;
+  memfault_lz_decoder_init(&decoder, &config, prv_decoder_write_cb, NULL);
+  s_decoded_len = 0;
+  CHECK(memfault_lz_decode(&decoder, &msg.data[1], msg.len - 1));
+  LONGS_EQUAL(s_coredump.size, s_decoded_len);
+  MEMCMP_EQUAL(s_coredump.data, s_decoded, s_decoded_len);
+#else
+  LONGS_EQUAL(TEST_MSG_TYPE_COREDUMP | TEST_MSG_TYPE_RLE, msg.data[0]);
+#endif
+}
+
+//! Like prv_get_chunks() but the message is held until memfault_packetizer_ack()
+static size_t prv_get_chunks_require_ack(sTestChunk *chunks, size_t max_chunks) {
+  const sPacketizerConfig cfg = {
+    .enable_multi_packet_chunk = false,
+    .require_ack = true,
+  };
+  size_t num_chunks = 0;
+  sPacketizerMetadata metadata;
+  while ((num_chunks < max_chunks) && memfault_packetizer_begin(&cfg, &metadata)) {
+    sTestChunk *chunk = &chunks[num_chunks];
+    chunk->len = sizeof(chunk->data);
+    LONGS_EQUAL(kMemfaultPacketizerStatus_EndOfChunk,
+                memfault_packetizer_get_next(chunk->data, &chunk->len));
+    num_chunks++;
+  }
+  return num_chunks;
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_SeekFinalChunk) {
+  prv_get_expected_chunks(&s_coredump);
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(s_num_expected, prv_get_chunks_require_ack(chunks, TEST_MAX_CHUNKS));
+  CHECK(s_coredump.available);
+  CHECK(memfault_packetizer_ack_pending(0));
+
+  // the receiver missed the last chunk
+  const sTestChunk *final_chunk = &s_expected[s_num_expected - 1];
+  const size_t num_reads = s_coredump.num_reads;
+  CHECK(memfault_packetizer_seek(0, prv_chunk_offset(final_chunk)));
+  CHECK(!memfault_packetizer_ack_pending(0));
+  CHECK(!memfault_packetizer_ack(0));
+  LONGS_EQUAL(num_reads, s_coredump.num_reads);
+
+  LONGS_EQUAL(1, prv_get_chunks_require_ack(chunks, TEST_MAX_CHUNKS));
+  LONGS_EQUAL(final_chunk->len, chunks[0].len);
+  MEMCMP_EQUAL(final_chunk->data, chunks[0].data, final_chunk->len);
+  CHECK(s_coredump.available);
+
+  CHECK(memfault_packetizer_ack(0));
+  CHECK(!s_coredump.available);
+  CHECK(!memfault_packetizer_ack(0));
+  LONGS_EQUAL(0, prv_get_chunks_require_ack(chunks, TEST_MAX_CHUNKS));
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_NextMessageWaitsForAck) {
+  s_coredump.available = true;
+  s_event.available = true;
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  const size_t num_chunks = prv_get_chunks_require_ack(chunks, TEST_MAX_CHUNKS);
+  CHECK(num_chunks > 0);
+  CHECK(memfault_packetizer_ack_pending(0));
+  CHECK(s_event.available);
+
+  // sent again from the start, as the receiver may not have gotten it
+  memfault_packetizer_abort();
+  LONGS_EQUAL(num_chunks, prv_get_chunks_require_ack(chunks, TEST_MAX_CHUNKS));
+  CHECK(s_coredump.available);
+
+  CHECK(memfault_packetizer_ack(0));
+  CHECK(!s_coredump.available);
+  CHECK(prv_get_chunks_require_ack(chunks, TEST_MAX_CHUNKS) > 0);
+  CHECK(memfault_packetizer_ack(0));
+  CHECK(!s_event.available);
+}
+
+TEST(MemfaultDataPacketizerSeek, Test_InvalidSeek) {
+  // nothing in flight
+  CHECK(!memfault_packetizer_seek(0, 0));
+
+  s_event.available = true;
+  sTestChunk chunks[TEST_MAX_CHUNKS];
+  LONGS_EQUAL(2, prv_get_chunks(chunks, 2));
+  const uint32_t read_offset = prv_chunk_offset(&chunks[1]) + (uint32_t)chunks[1].len - 2;
+
+  // data not sent yet
+  CHECK(!memfault_packetizer_seek(0, read_offset + 1));
+  CHECK(!memfault_packetizer_seek(MEMFAULT_PACKETIZER_NUM_CHANNELS, 0));
+  CHECK(memfault_packetizer_seek(0, read_offset));
+  memfault_packetizer_abort();
+
+  const sPacketizerConfig cfg = {
+    .enable_multi_packet_chunk = true,
+  };
+  sPacketizerMetadata metadata;
+  uint8_t buf[TEST_CHUNK_BUF_LEN];
+  size_t buf_len = sizeof(buf);
+  CHECK(memfault_packetizer_begin(&cfg, &metadata));
+  LONGS_EQUAL(kMemfaultPacketizerStatus_MoreDataForChunk,
+              memfault_packetizer_get_next(buf, &buf_len));
+  CHECK(!memfault_packetizer_seek(0, 0));
+}
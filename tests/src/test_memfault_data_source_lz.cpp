@@ -0,0 +1,222 @@
+//! @file
+//!
+//! @brief
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include "memfault/core/compiler.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/math.h"
+
+extern "C" {
+  #include <stddef.h>
+  #include <stdint.h>
+  #include <string.h>
+
+  #include "memfault/config.h"
+  #include "memfault/core/data_source_lz.h"
+  #include "memfault/util/lz.h"
+
+  static const uint8_t *s_active_data = NULL;
+  static size_t s_active_data_size = 0;
+  static size_t s_bytes_read = 0;
+}
+
+static bool prv_has_msgs(size_t *total_size_out) {
+  *total_size_out = s_active_data_size;
+  return (*total_size_out != 0);
+}
+
+static bool prv_read_msg_data(uint32_t offset, void *buf, size_t buf_len) {
+  CHECK((offset + buf_len) <= s_active_data_size);
+  memcpy(buf, &s_active_data[offset], buf_len);
+  s_bytes_read += buf_len;
+  return true;
+}
+
+static void prv_mark_msg_read(void) {
+  s_active_data = NULL;
+  s_active_data_size = 0;
+}
+
+static const sMemfaultDataSourceImpl s_test_data_source = {
+  .has_more_msgs_cb = prv_has_msgs,
+  .read_msg_cb = prv_read_msg_data,
+  .mark_msg_read_cb = prv_mark_msg_read,
+};
+
+//! A task list: structures with the same layout, pointers into RAM and small integers, followed
+//! by stacks which are mostly unused
+static uint8_t s_core[3000];
+static uint8_t s_core_lz[sizeof(s_core) + 128];
+static size_t s_core_lz_size;
+
+typedef struct {
+  uint32_t next;
+  uint32_t stack_ptr;
+  uint32_t priority;
+  uint32_t state;
+  char name[8];
+} sTestTask;
+
+static void prv_setup_core(void) {
+  memset(s_core, 0, sizeof(s_core));
+  for (size_t i = 0; i < 40; i++) {
+    const sTestTask task = {
+      .next = 0x20001000 + (uint32_t)((i + 1) * sizeof(sTestTask)),
+      .stack_ptr = 0x20008000 - (uint32_t)(i * 0x200) - (uint32_t)((i * 7) % 64),
+      .priority = (uint32_t)(i % 5),
+      .state = (uint32_t)(i % 3),
+      .name = { 't', 'a', 's', 'k', (char)('0' + (i / 10)), (char)('0' + (i % 10)) },
+    };
+    memcpy(&s_core[i * sizeof(task)], &task, sizeof(task));
+  }
+  for (size_t i = 1600; i < sizeof(s_core); i += 4) {
+    const uint32_t word = ((i % 256) < 64) ? 0x08004000 + (uint32_t)((i * 37) % 0x400) :
+                                             0xa5a5a5a5;
+    memcpy(&s_core[i], &word, sizeof(word));
+  }
+
+  s_active_data = s_core;
+  s_active_data_size = sizeof(s_core);
+}
+
+static void prv_read(uint8_t *buf, size_t buf_len, size_t fill_call_size) {
+  for (size_t i = 0; i < buf_len; i += fill_call_size) {
+    const size_t bytes_to_read = MEMFAULT_MIN(fill_call_size, buf_len - i);
+    CHECK(memfault_data_source_lz_read_msg(i, &buf[i], bytes_to_read));
+  }
+}
+
+static uint8_t s_decoded[sizeof(s_core)];
+static size_t s_decoded_len;
+
+static void prv_decoder_write_cb(MEMFAULT_UNUSED void *ctx, const void *buf, size_t buf_len) {
+  CHECK((s_decoded_len + buf_len) <= sizeof(s_decoded));
+  memcpy(&s_decoded[s_decoded_len], buf, buf_len);
+  s_decoded_len += buf_len;
+}
+
+static void prv_check_decodes_to(const uint8_t *encoded, size_t encoded_len,
+                                 const uint8_t *expected, size_t expected_len) {
+  static uint8_t s_window[MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE];
+  const sMemfaultLzConfig config = {
+    .window = s_window,
+    .window_size = sizeof(s_window),
+  };
+  sMemfaultLzDecoder decoder;
+  memfault_lz_decoder_init(&decoder, &config, prv_decoder_write_cb, NULL);
+  s_decoded_len = 0;
+  CHECK(memfault_lz_decode(&decoder, encoded, encoded_len));
+  LONGS_EQUAL(expected_len, s_decoded_len);
+  MEMCMP_EQUAL(expected, s_decoded, expected_len);
+}
+
+TEST_GROUP(MemfaultDataSourceLz){
+  void setup() {
+    s_active_data = NULL;
+    s_active_data_size = 0;
+    s_bytes_read = 0;
+    memfault_data_source_lz_encoder_set_active(&s_test_data_source);
+  }
+  void teardown() {
+    memfault_data_source_lz_mark_msg_read();
+  }
+};
+
+TEST(MemfaultDataSourceLz, Test_HasMoreMsgs) {
+  size_t total_size = 0;
+  CHECK(!memfault_data_source_lz_has_more_msgs(&total_size));
+
+  prv_setup_core();
+  CHECK(memfault_data_source_lz_has_more_msgs(&s_core_lz_size));
+  CHECK(s_core_lz_size < (sizeof(s_core) / 2));
+
+  // a re-query shouldn't read more data if its already been computed
+  s_bytes_read = 0;
+  CHECK(memfault_data_source_lz_has_more_msgs(&total_size));
+  LONGS_EQUAL(s_core_lz_size, total_size);
+  LONGS_EQUAL(0, s_bytes_read);
+
+  memfault_data_source_lz_mark_msg_read();
+  CHECK(!memfault_data_source_lz_has_more_msgs(&total_size));
+}
+
+TEST(MemfaultDataSourceLz, Test_ReadAnyCallSize) {
+  prv_setup_core();
+  CHECK(memfault_data_source_lz_has_more_msgs(&s_core_lz_size));
+  prv_read(s_core_lz, s_core_lz_size, s_core_lz_size);
+  prv_check_decodes_to(s_core_lz, s_core_lz_size, s_core, sizeof(s_core));
+
+  const size_t fill_sizes[] = { 1, 3, 17, 20, 64, 200 };
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(fill_sizes); i++) {
+    memfault_data_source_lz_mark_msg_read();
+    prv_setup_core();
+    size_t total_size = 0;
+    CHECK(memfault_data_source_lz_has_more_msgs(&total_size));
+    LONGS_EQUAL(s_core_lz_size, total_size);
+
+    s_bytes_read = 0;
+    uint8_t buf[sizeof(s_core_lz)];
+    prv_read(buf, total_size, fill_sizes[i]);
+    MEMCMP_EQUAL(s_core_lz, buf, total_size);
+    // the message is streamed through the encoder once
+    CHECK(s_bytes_read <= sizeof(s_core));
+  }
+}
+
+TEST(MemfaultDataSourceLz, Test_ReadFromAnyOffset) {
+  prv_setup_core();
+  CHECK(memfault_data_source_lz_has_more_msgs(&s_core_lz_size));
+  prv_read(s_core_lz, s_core_lz_size, 20);
+
+  // i.e retransmitting chunks after memfault_packetizer_seek()
+  const size_t offsets[] = {
+    0, s_core_lz_size - 1, s_core_lz_size / 2, 5, (s_core_lz_size * 3) / 4, s_core_lz_size / 3,
+  };
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(offsets); i++) {
+    const size_t offset = offsets[i];
+    const size_t len = MEMFAULT_MIN(10, s_core_lz_size - offset);
+    uint8_t buf[10];
+    CHECK(memfault_data_source_lz_read_msg(offset, buf, len));
+    MEMCMP_EQUAL(&s_core_lz[offset], buf, len);
+  }
+
+  uint8_t buf[1];
+  CHECK(!memfault_data_source_lz_read_msg(s_core_lz_size, buf, sizeof(buf)));
+}
+
+TEST(MemfaultDataSourceLz, Test_SizeCachedAcrossAbort) {
+  prv_setup_core();
+  CHECK(memfault_data_source_lz_has_more_msgs(&s_core_lz_size));
+  LONGS_EQUAL(sizeof(s_core), s_bytes_read);
+  prv_read(s_core_lz, s_core_lz_size / 2, 20);
+
+  // i.e memfault_packetizer_abort()
+  memfault_data_source_lz_encoder_set_active(NULL);
+  memfault_data_source_lz_encoder_set_active(&s_test_data_source);
+
+  // only the start of the message is read to check it is the same one
+  s_bytes_read = 0;
+  size_t total_size = 0;
+  CHECK(memfault_data_source_lz_has_more_msgs(&total_size));
+  LONGS_EQUAL(s_core_lz_size, total_size);
+  LONGS_EQUAL(64, s_bytes_read);
+
+  uint8_t buf[sizeof(s_core_lz)];
+  prv_read(buf, total_size, 33);
+  prv_check_decodes_to(buf, total_size, s_core, sizeof(s_core));
+
+  // a different message of the same size is compressed from scratch
+  memfault_data_source_lz_encoder_set_active(NULL);
+  memfault_data_source_lz_encoder_set_active(&s_test_data_source);
+  static uint8_t s_other_core[sizeof(s_core)];
+  memset(s_other_core, 0x11, sizeof(s_other_core));
+  s_active_data = s_other_core;
+  CHECK(memfault_data_source_lz_has_more_msgs(&total_size));
+  CHECK(total_size < s_core_lz_size);
+  prv_read(buf, total_size, total_size);
+  prv_check_decodes_to(buf, total_size, s_other_core, sizeof(s_other_core));
+}
@@ -0,0 +1,273 @@
+//! @file
+//!
+//! @brief
+//! Compares how well the RLE and LZ data sources compress coredump-like RAM contents and how fast
+//! they stream it out in chunk sized reads, the way the packetizer drains them.
+//!
+//! Absolute throughput numbers are host dependent. What matters is how the two encoders compare:
+//! LZ encoding costs a search of the window for every byte so it is expected to be more than an
+//! order of magnitude slower than RLE, and slower still with a larger window (build with
+//! -DMEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE=<n> to compare). Only the compression ratios are
+//! checked; run with MEMFAULT_BENCHMARK_REPORT=1 in the environment to print the numbers.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "memfault/config.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/data_source_lz.h"
+#include "memfault/core/data_source_rle.h"
+#include "memfault/core/math.h"
+
+//! A BLE ATT payload with the default MTU
+#define BENCHMARK_READ_LEN 20
+#define BENCHMARK_RUNS 5
+
+static uint8_t s_ram[32 * 1024];
+static size_t s_ram_len;
+
+static bool prv_has_msgs(size_t *total_size_out) {
+  *total_size_out = s_ram_len;
+  return true;
+}
+
+static bool prv_read_msg(uint32_t offset, void *buf, size_t buf_len) {
+  memcpy(buf, &s_ram[offset], buf_len);
+  return true;
+}
+
+static void prv_mark_msg_read(void) { }
+
+static const sMemfaultDataSourceImpl s_ram_data_source = {
+  .has_more_msgs_cb = prv_has_msgs,
+  .read_msg_cb = prv_read_msg,
+  .mark_msg_read_cb = prv_mark_msg_read,
+};
+
+//! CPU time rather than wall time as the LZ runs are long enough to be preempted when the tests
+//! are run in parallel
+static uint64_t prv_time_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+  return ((uint64_t)ts.tv_sec * 1000000000ULL) + (uint64_t)ts.tv_nsec;
+}
+
+//
+// Fixtures
+//
+// The mixed core, task list and sparse RAM contents are the ones the RLE data source, LZ data
+// source and coredump RLE tests are run against. The RTOS RAM one is synthetic: there is no
+// capture of a real device's RAM in the tree to run on.
+//
+
+//! The mixed literal & run pattern the RLE data source tests use
+static void prv_fill_mixed_core(void) {
+  s_ram_len = 3000;
+  for (size_t i = 0; i < s_ram_len; i++) {
+    s_ram[i] = ((i % 50) < 20) ? (uint8_t)(i * 13) : (uint8_t)(i / 50);
+  }
+}
+
+typedef struct {
+  uint32_t next;
+  uint32_t stack_ptr;
+  uint32_t priority;
+  uint32_t state;
+  char name[8];
+} sBenchmarkListTask;
+
+//! The task list & mostly unused stacks the LZ data source tests use
+static void prv_fill_task_list(void) {
+  s_ram_len = 3000;
+  memset(s_ram, 0, s_ram_len);
+  for (size_t i = 0; i < 40; i++) {
+    const sBenchmarkListTask task = {
+      .next = 0x20001000 + (uint32_t)((i + 1) * sizeof(sBenchmarkListTask)),
+      .stack_ptr = 0x20008000 - (uint32_t)(i * 0x200) - (uint32_t)((i * 7) % 64),
+      .priority = (uint32_t)(i % 5),
+      .state = (uint32_t)(i % 3),
+      .name = { 't', 'a', 's', 'k', (char)('0' + (i / 10)), (char)('0' + (i % 10)) },
+    };
+    memcpy(&s_ram[i * sizeof(task)], &task, sizeof(task));
+  }
+  for (size_t i = 1600; i < s_ram_len; i += 4) {
+    const uint32_t word = ((i % 256) < 64) ? 0x08004000 + (uint32_t)((i * 37) % 0x400) :
+                                             0xa5a5a5a5;
+    memcpy(&s_ram[i], &word, sizeof(word));
+  }
+}
+
+//! Mostly zeroed RAM with a few structures dotted around, as saved by the coredump RLE tests
+static void prv_fill_sparse_ram(void) {
+  s_ram_len = sizeof(s_ram);
+  memset(s_ram, 0, s_ram_len);
+  for (size_t i = 0; i < s_ram_len; i += 1024) {
+    for (size_t j = 0; j < 24; j++) {
+      s_ram[i + j] = (uint8_t)((i / 1024) + (j * 7));
+    }
+  }
+}
+
+typedef struct {
+  uint32_t next;
+  uint32_t prev;
+  uint32_t stack_ptr;
+  uint32_t stack_base;
+  uint16_t priority;
+  uint16_t state;
+  uint32_t wake_tick;
+  char name[12];
+} sBenchmarkTask;
+
+static void prv_put_u32(size_t offset, uint32_t value) {
+  memcpy(&s_ram[offset], &value, sizeof(value));
+}
+
+//! A RTOS heap: a table of task control blocks full of pointers & small integers, heap blocks
+//! with headers, and stacks painted with a fill pattern with some frames at the top
+static void prv_fill_rtos_ram(void) {
+  s_ram_len = sizeof(s_ram);
+  memset(s_ram, 0, s_ram_len);
+  const uint32_t ram_base = 0x20000000;
+
+  const size_t num_tasks = 24;
+  for (size_t i = 0; i < num_tasks; i++) {
+    const uint32_t tcb_addr = ram_base + (uint32_t)(i * sizeof(sBenchmarkTask));
+    const uint32_t stack_base = ram_base + 0x2000 + (uint32_t)(i * 0x400);
+    sBenchmarkTask task = {
+      .next = tcb_addr + (uint32_t)sizeof(sBenchmarkTask),
+      .prev = tcb_addr - (uint32_t)sizeof(sBenchmarkTask),
+      .stack_ptr = stack_base + 0x400 - 0x40 - (uint32_t)((i * 12) % 0x80),
+      .stack_base = stack_base,
+      .priority = (uint16_t)(i % 6),
+      .state = (uint16_t)(i % 4),
+      .wake_tick = 100000 + (uint32_t)(i * 250),
+    };
+    snprintf(task.name, sizeof(task.name), "task_%zu", i);
+    memcpy(&s_ram[i * sizeof(task)], &task, sizeof(task));
+  }
+
+  // heap blocks: a size & next pointer header followed by small records
+  for (size_t offset = 0x800; offset < 0x2000; offset += 64) {
+    prv_put_u32(offset, 56);
+    prv_put_u32(offset + 4, ram_base + (uint32_t)offset + 64);
+    for (size_t j = 8; j < 64; j += 8) {
+      prv_put_u32(offset + j, (uint32_t)((offset / 64) + j));
+      prv_put_u32(offset + j + 4, ram_base + 0x800 + (uint32_t)((offset * 3 + j) % 0x1800));
+    }
+  }
+
+  // stacks: mostly the fill pattern, the in-use part holds return addresses & saved registers
+  for (size_t i = 0; i < num_tasks; i++) {
+    const size_t stack_start = 0x2000 + (i * 0x400);
+    for (size_t j = 0; j < 0x400; j += 4) {
+      const size_t depth = 0x400 - j;
+      uint32_t word = 0xa5a5a5a5;
+      if (depth <= (0x40 + ((i * 12) % 0x80))) {
+        word = ((j % 16) == 0) ? (0x08001000 + (uint32_t)(((i * 7) + j) % 0x800)) | 1 :
+                                 (uint32_t)((i + j) % 32);
+      }
+      prv_put_u32(stack_start + j, word);
+    }
+  }
+
+  // the rest is a zeroed .bss with a few counters
+  for (size_t offset = 0x8000 - 0x1000; offset < s_ram_len; offset += 128) {
+    prv_put_u32(offset, (uint32_t)(offset * 31));
+  }
+}
+
+//
+// Benchmark
+//
+
+typedef struct {
+  size_t encoded_size;
+  double bytes_per_sec;
+} sBenchmarkResult;
+
+typedef bool (*BenchmarkSetActive)(const sMemfaultDataSourceImpl *source);
+
+//! Computes the encoded size and reads the whole encoded message in BENCHMARK_READ_LEN sized
+//! reads, measuring the fastest of BENCHMARK_RUNS runs
+static sBenchmarkResult prv_run(BenchmarkSetActive set_active,
+                                const sMemfaultDataSourceImpl *encoder) {
+  sBenchmarkResult result = { 0 };
+  uint64_t best_ns = UINT64_MAX;
+  for (size_t run = 0; run < BENCHMARK_RUNS; run++) {
+    const uint64_t start = prv_time_ns();
+    set_active(&s_ram_data_source);
+    size_t total_size = 0;
+    CHECK(encoder->has_more_msgs_cb(&total_size));
+    uint8_t buf[BENCHMARK_READ_LEN];
+    for (size_t offset = 0; offset < total_size; offset += sizeof(buf)) {
+      CHECK(encoder->read_msg_cb(offset, buf, MEMFAULT_MIN(sizeof(buf), total_size - offset)));
+    }
+    // drops the cached size so the next run starts from scratch
+    encoder->mark_msg_read_cb();
+    set_active(NULL);
+    best_ns = MEMFAULT_MIN(best_ns, prv_time_ns() - start);
+    result.encoded_size = total_size;
+  }
+  result.bytes_per_sec = (double)s_ram_len / ((double)best_ns / 1e9);
+  return result;
+}
+
+static void prv_compare(const char *name, sBenchmarkResult *rle, sBenchmarkResult *lz) {
+  *rle = prv_run(memfault_data_source_rle_encoder_set_active, &g_memfault_data_rle_source);
+  *lz = prv_run(memfault_data_source_lz_encoder_set_active, &g_memfault_data_lz_source);
+  if (getenv("MEMFAULT_BENCHMARK_REPORT") == NULL) {
+    return;
+  }
+  printf("\n  %-12s %6zu bytes | RLE: %6zu bytes (%5.1f%%) %8.0f kB/s"
+         " | LZ (%d byte window): %6zu bytes (%5.1f%%) %8.0f kB/s",
+         name, s_ram_len, rle->encoded_size, (100.0 * rle->encoded_size) / s_ram_len,
+         rle->bytes_per_sec / 1024, MEMFAULT_DATA_SOURCE_LZ_WINDOW_SIZE, lz->encoded_size,
+         (100.0 * lz->encoded_size) / s_ram_len, lz->bytes_per_sec / 1024);
+}
+
+TEST_GROUP(MfltDataSourceLzBenchmark) {
+  void setup() { }
+  void teardown() {
+    if (getenv("MEMFAULT_BENCHMARK_REPORT") != NULL) {
+      printf("\n");
+    }
+  }
+};
+
+TEST(MfltDataSourceLzBenchmark, Test_MixedCore) {
+  sBenchmarkResult rle, lz;
+  prv_fill_mixed_core();
+  prv_compare("mixed core", &rle, &lz);
+  CHECK(lz.encoded_size < rle.encoded_size);
+}
+
+TEST(MfltDataSourceLzBenchmark, Test_TaskList) {
+  sBenchmarkResult rle, lz;
+  prv_fill_task_list();
+  prv_compare("task list", &rle, &lz);
+  CHECK(lz.encoded_size < rle.encoded_size);
+}
+
+TEST(MfltDataSourceLzBenchmark, Test_SparseRam) {
+  sBenchmarkResult rle, lz;
+  prv_fill_sparse_ram();
+  prv_compare("sparse RAM", &rle, &lz);
+  // long runs of zeroes are what RLE is best at, LZ needs a token for every 130 bytes of them
+  CHECK(lz.encoded_size < (rle.encoded_size * 2));
+}
+
+TEST(MfltDataSourceLzBenchmark, Test_RtosRam) {
+  sBenchmarkResult rle, lz;
+  prv_fill_rtos_ram();
+  prv_compare("RTOS RAM", &rle, &lz);
+  CHECK(lz.encoded_size < ((rle.encoded_size * 4) / 5));
+}
@@ -19,6 +19,7 @@ extern "C" {
 
   static const uint8_t *s_active_data = NULL;
   static size_t s_active_data_size = 0;
+  static size_t s_bytes_read = 0;
 }
 
 static bool prv_has_msgs(size_t *total_size_out) {
@@ -28,6 +29,7 @@ static bool prv_has_msgs(size_t *total_size_out) {
 
 static bool prv_read_msg_data(uint32_t offset, void *buf, size_t buf_len) {
   memcpy(buf, &s_active_data[offset], buf_len);
+  s_bytes_read += buf_len;
   return true;
 }
 
@@ -46,6 +48,7 @@ TEST_GROUP(MemfaultDataSourceRle){
   void setup() {
     s_active_data = NULL;
     s_active_data_size = 0;
+    s_bytes_read = 0;
     memfault_data_source_rle_encoder_set_active(&s_test_data_source);
   }
   void teardown() {
@@ -134,3 +137,124 @@ TEST(MemfaultDataSourceRle, Test_DataSourceMultiByteVarintAndEndsWithNonRepeat)
 
   prv_check_pattern(fake_core, sizeof(fake_core), expected_core_rle, sizeof(expected_core_rle));
 }
+
+//! A mix of literals & runs of repeated bytes
+static uint8_t s_mixed_core[3000];
+static uint8_t s_mixed_core_rle[sizeof(s_mixed_core)];
+static size_t s_mixed_core_rle_size;
+
+//! Queues up s_mixed_core and encodes it from start to finish
+static void prv_setup_mixed_core(void) {
+  for (size_t i = 0; i < sizeof(s_mixed_core); i++) {
+    s_mixed_core[i] = ((i % 50) < 20) ? (uint8_t)(i * 13) : (uint8_t)(i / 50);
+  }
+  s_active_data = s_mixed_core;
+  s_active_data_size = sizeof(s_mixed_core);
+
+  CHECK(memfault_data_source_rle_has_more_msgs(&s_mixed_core_rle_size));
+  CHECK(s_mixed_core_rle_size < sizeof(s_mixed_core_rle));
+  prv_get_coredump_data(s_mixed_core_rle, s_mixed_core_rle_size, 17);
+}
+
+TEST(MemfaultDataSourceRle, Test_DataSourceReadFromAnyOffset) {
+  prv_setup_mixed_core();
+
+  const size_t offsets[] = {
+    0, s_mixed_core_rle_size - 1, s_mixed_core_rle_size / 2, 5, (s_mixed_core_rle_size * 3) / 4,
+    (s_mixed_core_rle_size * 3) / 4 + 40, s_mixed_core_rle_size / 3,
+  };
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(offsets); i++) {
+    const size_t offset = offsets[i];
+    const size_t len = MEMFAULT_MIN(10, s_mixed_core_rle_size - offset);
+    uint8_t buf[10];
+    CHECK(memfault_data_source_rle_read_msg(offset, buf, len));
+    MEMCMP_EQUAL(&s_mixed_core_rle[offset], buf, len);
+  }
+
+  CHECK(!memfault_data_source_rle_read_msg(s_mixed_core_rle_size + 1, s_mixed_core_rle, 1));
+
+  // reading near the end resumes from a run boundary instead of the start of the message
+  uint8_t buf[10];
+  CHECK(memfault_data_source_rle_read_msg(0, buf, sizeof(buf)));
+  s_bytes_read = 0;
+  const size_t offset = s_mixed_core_rle_size - sizeof(buf);
+  CHECK(memfault_data_source_rle_read_msg(offset, buf, sizeof(buf)));
+  MEMCMP_EQUAL(&s_mixed_core_rle[offset], buf, sizeof(buf));
+  CHECK(s_bytes_read < (sizeof(s_mixed_core) / 2));
+}
+
+TEST(MemfaultDataSourceRle, Test_DataSourceSizeCachedAcrossAbort) {
+  prv_setup_mixed_core();
+  // one pass to compute the size and a bit more than another one to encode the message
+  CHECK(s_bytes_read < ((sizeof(s_mixed_core) * 5) / 2));
+
+  // i.e memfault_packetizer_abort()
+  memfault_data_source_rle_encoder_set_active(NULL);
+  memfault_data_source_rle_encoder_set_active(&s_test_data_source);
+
+  // only the start of the message is read to check it is the same one
+  s_bytes_read = 0;
+  size_t total_size = 0;
+  CHECK(memfault_data_source_rle_has_more_msgs(&total_size));
+  LONGS_EQUAL(s_mixed_core_rle_size, total_size);
+  LONGS_EQUAL(128, s_bytes_read);
+
+  uint8_t buf[sizeof(s_mixed_core_rle)];
+  prv_get_coredump_data(buf, total_size, 33);
+  MEMCMP_EQUAL(s_mixed_core_rle, buf, total_size);
+}
+
+TEST(MemfaultDataSourceRle, Test_DataSourceRestoreCache) {
+  sMemfaultDataSourceRleCache cache;
+  memfault_data_source_rle_get_cache(&cache);
+  LONGS_EQUAL(0, cache.magic);
+  CHECK(!memfault_data_source_rle_restore_cache(&cache));
+  CHECK(!memfault_data_source_rle_restore_cache(NULL));
+
+  prv_setup_mixed_core();
+  memfault_data_source_rle_get_cache(&cache);
+  CHECK(cache.num_entries > 0);
+  LONGS_EQUAL(s_mixed_core_rle_size, cache.rle_size);
+  // a message is already being encoded
+  CHECK(!memfault_data_source_rle_restore_cache(&cache));
+
+  // i.e a reboot
+  memfault_data_source_rle_mark_msg_read();
+  sMemfaultDataSourceRleCache corrupted = cache;
+  corrupted.entries[0].curr_offset++;
+  CHECK(!memfault_data_source_rle_restore_cache(&corrupted));
+  CHECK(memfault_data_source_rle_restore_cache(&cache));
+
+  s_active_data = s_mixed_core;
+  s_active_data_size = sizeof(s_mixed_core);
+  s_bytes_read = 0;
+  size_t total_size = 0;
+  CHECK(memfault_data_source_rle_has_more_msgs(&total_size));
+  LONGS_EQUAL(s_mixed_core_rle_size, total_size);
+  LONGS_EQUAL(128, s_bytes_read);
+
+  const size_t offset = total_size - 20;
+  uint8_t buf[20];
+  CHECK(memfault_data_source_rle_read_msg(offset, buf, sizeof(buf)));
+  MEMCMP_EQUAL(&s_mixed_core_rle[offset], buf, sizeof(buf));
+}
+
+TEST(MemfaultDataSourceRle, Test_DataSourceCacheForDifferentMsg) {
+  prv_setup_mixed_core();
+  sMemfaultDataSourceRleCache cache;
+  memfault_data_source_rle_get_cache(&cache);
+  memfault_data_source_rle_mark_msg_read();
+  CHECK(memfault_data_source_rle_restore_cache(&cache));
+
+  // a message of the same size but with different contents is encoded from scratch
+  static uint8_t s_other_core[sizeof(s_mixed_core)];
+  memset(s_other_core, 0xa5, sizeof(s_other_core));
+  s_active_data = s_other_core;
+  s_active_data_size = sizeof(s_other_core);
+  s_bytes_read = 0;
+  size_t total_size = 0;
+  CHECK(memfault_data_source_rle_has_more_msgs(&total_size));
+  LONGS_EQUAL(128 + sizeof(s_other_core), s_bytes_read);
+  // 0xa5 repeated 3000 times
+  LONGS_EQUAL(3, total_size);
+}
@@ -12,6 +12,7 @@
 #include <string.h>
 
 #include "fakes/fake_memfault_platform_metrics_locking.h"
+#include "memfault/config.h"
 #include "memfault/core/batched_events.h"
 #include "memfault/core/data_packetizer_source.h"
 #include "memfault/core/event_storage.h"
@@ -22,7 +23,7 @@
 static uint8_t s_ram_store[11];
 static const size_t s_ram_store_size = sizeof(s_ram_store);
 static const sMemfaultEventStorageImpl *s_storage_impl;
-#define MEMFAULT_STORAGE_OVERHEAD 2
+#define MEMFAULT_STORAGE_OVERHEAD 1
 
 static bool prv_fake_event_impl_has_event(size_t *total_size) {
   return g_memfault_event_data_source.has_more_msgs_cb(total_size);
@@ -113,6 +114,32 @@ TEST(MemfaultEventStorage, Test_MemfaultMetricStoreSingleEvent) {
   prv_assert_no_more_events();
 }
 
+TEST(MemfaultEventStorage, Test_PendingStats) {
+  size_t num_msgs;
+  size_t num_bytes;
+  g_memfault_event_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  LONGS_EQUAL(0, num_msgs);
+  LONGS_EQUAL(0, num_bytes);
+
+  const uint8_t payload[] = { 0x1, 0x2, 0x3 };
+  prv_write_payload(payload, sizeof(payload), false);
+  prv_write_payload(payload, 2, false);
+
+  // a write in progress isn't pending yet
+  CHECK(s_storage_impl->begin_write_cb() != 0);
+  s_storage_impl->append_data_cb(payload, 1);
+  g_memfault_event_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  LONGS_EQUAL(2, num_msgs);
+  LONGS_EQUAL(sizeof(payload) + 2, num_bytes);
+  s_storage_impl->finish_write_cb(true);
+
+  prv_assert_read((void *)payload, sizeof(payload));
+  g_memfault_event_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  LONGS_EQUAL(1, num_msgs);
+  LONGS_EQUAL(2, num_bytes);
+  prv_assert_read((void *)payload, 2);
+}
+
 TEST(MemfaultEventStorage, Test_ApiMisuse) {
   prv_assert_no_more_events();
 
@@ -125,11 +152,179 @@ TEST(MemfaultEventStorage, Test_ApiMisuse) {
 
 #if MEMFAULT_EVENT_STORAGE_READ_BATCHING_ENABLED == 0
 
+static eMemfaultEventStorageReserveStatus prv_try_reserve(
+    size_t num_bytes, sMemfaultEventStorageReservation *reservation) {
+  return s_storage_impl->reserve_cb(num_bytes, kMemfaultEventStorageClass_Trace, reservation);
+}
+
+static void prv_reserve(size_t num_bytes, sMemfaultEventStorageReservation *reservation) {
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok, prv_try_reserve(num_bytes, reservation));
+}
+
+static void prv_fill_reservation(const sMemfaultEventStorageReservation *reservation,
+                                 const void *data, size_t data_len) {
+  const uint8_t *byte = (const uint8_t *)data;
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(reservation->regions); i++) {
+    memcpy(reservation->regions[i].ptr, byte, reservation->regions[i].len);
+    byte += reservation->regions[i].len;
+  }
+  LONGS_EQUAL(data_len, byte - (const uint8_t *)data);
+}
+
+TEST(MemfaultEventStorage, Test_ReserveCommitOutOfOrder) {
+  const uint8_t event1[] = { 0x1, 0x2 };
+  const uint8_t event2[] = { 0x3 };
+  sMemfaultEventStorageReservation res1, res2;
+  prv_reserve(sizeof(event1), &res1);
+  prv_reserve(sizeof(event2), &res2);
+
+  prv_fill_reservation(&res2, event2, sizeof(event2));
+  s_storage_impl->commit_cb(&res2, false);
+
+  // event2 must not be readable until event1, which was reserved first, is committed
+  prv_assert_no_more_events();
+
+  prv_fill_reservation(&res1, event1, sizeof(event1));
+  s_storage_impl->commit_cb(&res1, false);
+
+  // a second commit of the same reservation is a no-op
+  s_storage_impl->commit_cb(&res1, false);
+
+  prv_assert_read((void *)event1, sizeof(event1));
+  prv_assert_read((void *)event2, sizeof(event2));
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStorage, Test_ReserveWraps) {
+  // move the end of the buffer close to the end of the backing storage
+  const uint8_t event1[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6 };
+  prv_write_payload(event1, sizeof(event1), false);
+  prv_assert_read((void *)event1, sizeof(event1));
+
+  const uint8_t event2[] = { 0xa, 0xb, 0xc, 0xd, 0xe };
+  sMemfaultEventStorageReservation res;
+  prv_reserve(sizeof(event2), &res);
+  CHECK(res.regions[1].len != 0);
+  LONGS_EQUAL(sizeof(event2), res.regions[0].len + res.regions[1].len);
+
+  prv_fill_reservation(&res, event2, sizeof(event2));
+  s_storage_impl->commit_cb(&res, false);
+  prv_assert_read((void *)event2, sizeof(event2));
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStorage, Test_ReserveRollback) {
+  // each two byte event takes up 3 bytes of storage
+  const uint8_t event1[] = { 0x1, 0x1 };
+  const uint8_t event2[] = { 0x2, 0x2 };
+  const uint8_t event3[] = { 0x3, 0x3 };
+  sMemfaultEventStorageReservation res1, res2, res3;
+  prv_reserve(sizeof(event1), &res1);
+  prv_reserve(sizeof(event2), &res2);
+  prv_reserve(sizeof(event3), &res3);
+
+  sMemfaultEventStorageReservation res4;
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_NoSpace, prv_try_reserve(sizeof(event3), &res4));
+
+  // rolling back the most recent reservation hands the space back right away
+  s_storage_impl->commit_cb(&res3, true);
+  prv_reserve(sizeof(event3), &res4);
+
+  // rolling back an older reservation frees the space once the events ahead of it are read
+  s_storage_impl->commit_cb(&res1, true);
+  prv_fill_reservation(&res2, event2, sizeof(event2));
+  s_storage_impl->commit_cb(&res2, false);
+  prv_fill_reservation(&res4, event3, sizeof(event3));
+  s_storage_impl->commit_cb(&res4, false);
+
+  prv_assert_read((void *)event2, sizeof(event2));
+  prv_assert_read((void *)event3, sizeof(event3));
+  prv_assert_no_more_events();
+  LONGS_EQUAL(s_ram_store_size - MEMFAULT_STORAGE_OVERHEAD, s_storage_impl->begin_write_cb());
+  s_storage_impl->finish_write_cb(true);
+}
+
+TEST(MemfaultEventStorage, Test_ReserveRollbackDuringStreamingWrite) {
+  sMemfaultEventStorageReservation res;
+  prv_reserve(1, &res);
+
+  // the streaming write is not visible until it is finished
+  const uint8_t event[] = { 0x1, 0x2 };
+  CHECK(s_storage_impl->begin_write_cb() != 0);
+  CHECK(s_storage_impl->append_data_cb(event, sizeof(event)));
+  prv_assert_no_more_events();
+
+  // the reservation sits in front of the streaming write so it can't be released yet
+  s_storage_impl->commit_cb(&res, true);
+  s_storage_impl->finish_write_cb(false);
+
+  prv_assert_read((void *)event, sizeof(event));
+  prv_assert_no_more_events();
+  LONGS_EQUAL(s_ram_store_size - MEMFAULT_STORAGE_OVERHEAD, s_storage_impl->begin_write_cb());
+  s_storage_impl->finish_write_cb(true);
+}
+
+TEST(MemfaultEventStorage, Test_ReserveBusy) {
+  sMemfaultEventStorageReservation res[MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES + 1];
+
+  // a streaming write of unknown length blocks reservations
+  CHECK(s_storage_impl->begin_write_cb() != 0);
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Busy, prv_try_reserve(0, &res[0]));
+  s_storage_impl->finish_write_cb(true);
+
+  for (size_t i = 0; i < MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES; i++) {
+    prv_reserve(0, &res[i]);
+  }
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Busy,
+              prv_try_reserve(0, &res[MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES]));
+
+  for (size_t i = 0; i < MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES; i++) {
+    s_storage_impl->commit_cb(&res[i], true);
+  }
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStorage, Test_EventsLargerThan64KB) {
+  static uint8_t s_large_ram_store[160 * 1024];
+  static uint8_t s_event[70 * 1024];
+  for (size_t i = 0; i < sizeof(s_event); i++) {
+    s_event[i] = (uint8_t)(i % 251);
+  }
+  s_storage_impl = memfault_events_storage_boot(s_large_ram_store, sizeof(s_large_ram_store));
+
+  // a streaming write can span (almost) all of storage
+  const size_t space_available = s_storage_impl->begin_write_cb();
+  CHECK(space_available > sizeof(s_event));
+  CHECK(s_storage_impl->append_data_cb(s_event, sizeof(s_event)));
+  s_storage_impl->finish_write_cb(false);
+
+  sMemfaultEventStorageReservation res;
+  prv_reserve(sizeof(s_event), &res);
+  prv_fill_reservation(&res, s_event, sizeof(s_event));
+  s_storage_impl->commit_cb(&res, false);
+
+  for (size_t i = 0; i < 2; i++) {
+    size_t total_size = 0;
+    CHECK(prv_fake_event_impl_has_event(&total_size));
+    LONGS_EQUAL(sizeof(s_event), total_size);
+
+    // read back in pieces that straddle the 64KB boundary
+    uint8_t chunk[1000];
+    for (size_t offset = 0; offset < sizeof(s_event); offset += sizeof(chunk)) {
+      const size_t read_len = MEMFAULT_MIN(sizeof(chunk), sizeof(s_event) - offset);
+      CHECK(prv_fake_event_impl_read(offset, chunk, read_len));
+      MEMCMP_EQUAL(&s_event[offset], chunk, read_len);
+    }
+    prv_fake_event_impl_mark_event_read();
+  }
+  prv_assert_no_more_events();
+}
+
 TEST(MemfaultEventStorage, Test_MemfaultMultiEvent) {
-  // queue up 3 one byte events which due to 2-byte overhead should take up 9 bytes
+  // queue up 5 one byte events which due to 1-byte overhead should take up 10 bytes
   bool rollback = false;
   size_t space_available;
-  for (uint8_t byte = 0; byte < 3; byte++) {
+  for (uint8_t byte = 0; byte < 5; byte++) {
     prv_write_payload(&byte, sizeof(byte), rollback);
   }
 
@@ -140,7 +335,7 @@ TEST(MemfaultEventStorage, Test_MemfaultMultiEvent) {
   // drain events
   bool has_event;
   size_t event_size;
-  for (uint8_t byte = 0; byte < 3; byte++) {
+  for (uint8_t byte = 0; byte < 5; byte++) {
     has_event = prv_fake_event_impl_has_event(&event_size);
     CHECK(has_event);
     LONGS_EQUAL(1, event_size);
@@ -165,7 +360,7 @@ TEST(MemfaultEventStorage, Test_MemfaultMultiEvent) {
 
   // now write a larger message 1 byte at a time, all 11 bytes of storage should be free
   // abort the first attempt and then actually do the write on the second attempt
-  const uint8_t payload[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8 };
+  const uint8_t payload[] = { 0x1, 0x2, 0x3, 0x4, 0x5, 0x6, 0x7, 0x8, 0x9 };
   for (int i = 0; i < 2; i++) {
     rollback = (i == 0);
     prv_write_payload(&payload, sizeof(payload), rollback);
@@ -204,7 +399,7 @@ void memfault_batched_events_build_header(
 }
 
 TEST(MemfaultEventStorage, Test_MemfaultMultiEvent) {
-  // queue up 2, 3 byte events which due to 2-byte overhead should take 10 bytes
+  // queue up 2, 2 byte events which due to 1-byte overhead should take 6 bytes
   bool rollback = false;
 
   const uint8_t evt1[] = { 0x1, 0x2 };
@@ -255,6 +450,13 @@ TEST(MemfaultEventStorage, Test_MemfaultMultiEventLimited) {
   prv_write_payload(&event2, sizeof(event2), rollback);
   prv_write_payload(&event3, sizeof(event3), rollback);
 
+  // the first two events are read as one message
+  size_t num_msgs;
+  size_t num_bytes;
+  g_memfault_event_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  LONGS_EQUAL(2, num_msgs);
+  LONGS_EQUAL(5 + sizeof(event3), num_bytes);
+
   bool has_event;
   size_t event_size;
   has_event = prv_fake_event_impl_has_event(&event_size);
@@ -556,7 +758,7 @@ TEST(MemfaultEventStorage, Test_PersistEvents) {
 }
 
 TEST(MemfaultEventStorage, Test_UsedFreeSizes) {
-  const size_t per_event_overhead = 2;
+  const size_t per_event_overhead = MEMFAULT_STORAGE_OVERHEAD;
   const size_t first_half = s_ram_store_size / 2; // Integer truncation is fine
   const size_t second_half = s_ram_store_size - first_half;
   const bool async = true;
@@ -0,0 +1,173 @@
+//! @file
+//!
+//! @brief
+//! Round trips events through event storage with MEMFAULT_EVENT_STORAGE_COMPRESSION_ENABLED and
+//! checks they are stored more densely than they would be uncompressed.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fakes/fake_memfault_build_id.h"
+#include "memfault/core/batched_events.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/event_storage.h"
+#include "memfault/core/event_storage_implementation.h"
+#include "memfault/core/math.h"
+#include "memfault/core/serializer_helper.h"
+#include "memfault/util/cbor.h"
+
+#define TEST_MAX_EVENTS 128
+#define TEST_MAX_EVENT_SIZE 128
+
+static uint8_t s_ram_store[1024];
+static uint8_t s_expected_msg[MEMFAULT_BATCHED_EVENTS_MAX_HEADER_LENGTH +
+                              TEST_MAX_EVENTS * TEST_MAX_EVENT_SIZE];
+static uint8_t s_actual_msg[sizeof(s_expected_msg)];
+static const sMemfaultEventStorageImpl *s_storage_impl;
+
+TEST_GROUP(MemfaultEventStorageCompression) {
+  void setup() {
+    // The compression dictionary is built once so the build id must stay the same across tests
+    fake_memfault_build_id_reset();
+    g_fake_memfault_build_id_type = kMemfaultBuildIdType_MemfaultBuildIdSha1;
+    s_storage_impl = memfault_events_storage_boot(s_ram_store, sizeof(s_ram_store));
+    memset(s_actual_msg, 0x0, sizeof(s_actual_msg));
+  }
+  void teardown() {
+    mock().checkExpectations();
+    mock().clear();
+  }
+};
+
+static bool prv_encode_trace_event(sMemfaultCborEncoder *encoder, void *ctx) {
+  const size_t i = *(const size_t *)ctx;
+  const sMemfaultTraceEventHelperInfo info = {
+    .reason_key = kMemfaultTraceInfoEventKey_Reason,
+    .reason_value = 1,
+    .pc = 0x08001234 + (uint32_t)(i * 0x1f3),
+    .lr = 0x08005678 - (uint32_t)(i * 0x2c7),
+  };
+  return memfault_serializer_helper_encode_trace_event(encoder, &info);
+}
+
+static void prv_write_cb(void *ctx, uint32_t offset, const void *buf, size_t buf_len) {
+  memcpy(&((uint8_t *)ctx)[offset], buf, buf_len);
+}
+
+static size_t prv_encode_raw(size_t i, uint8_t *buf) {
+  sMemfaultCborEncoder encoder;
+  memfault_cbor_encoder_init(&encoder, prv_write_cb, buf, TEST_MAX_EVENT_SIZE);
+  CHECK(prv_encode_trace_event(&encoder, &i));
+  return memfault_cbor_encoder_deinit(&encoder);
+}
+
+//! Saves events until storage is full and builds the message they should be read back as
+//!
+//! @return the number of events saved
+static size_t prv_fill_storage(const sMemfaultEventStorageImpl *storage_impl,
+                               size_t *expected_msg_size) {
+  uint8_t *msgp = &s_expected_msg[MEMFAULT_BATCHED_EVENTS_MAX_HEADER_LENGTH];
+  size_t num_events = 0;
+  while (num_events < TEST_MAX_EVENTS) {
+    sMemfaultCborEncoder encoder;
+    if (!memfault_serializer_helper_encode_to_storage(&encoder, storage_impl,
+                                                      kMemfaultEventStorageClass_Trace,
+                                                      prv_encode_trace_event, &num_events)) {
+      break;
+    }
+    msgp += prv_encode_raw(num_events, msgp);
+    num_events++;
+  }
+
+  sMemfaultBatchedEventsHeader header = { 0 };
+  memfault_batched_events_build_header(num_events, &header);
+  uint8_t *msg_start = &s_expected_msg[MEMFAULT_BATCHED_EVENTS_MAX_HEADER_LENGTH - header.length];
+  memcpy(msg_start, header.data, header.length);
+  *expected_msg_size = (size_t)(msgp - msg_start);
+  memmove(s_expected_msg, msg_start, *expected_msg_size);
+  return num_events;
+}
+
+static void prv_check_fill_and_drain(const sMemfaultEventStorageImpl *storage_impl) {
+  uint8_t raw_event[TEST_MAX_EVENT_SIZE];
+  const size_t raw_event_size = prv_encode_raw(0, raw_event);
+  const size_t raw_capacity = sizeof(s_ram_store) / (raw_event_size + 2);
+
+  size_t expected_msg_size;
+  const size_t num_events = prv_fill_storage(storage_impl, &expected_msg_size);
+  CHECK(num_events >= 2 * raw_capacity);
+
+  // all the events are read back in one message, at their decompressed size
+  size_t num_msgs;
+  size_t num_bytes;
+  g_memfault_event_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  LONGS_EQUAL(1, num_msgs);
+  LONGS_EQUAL(expected_msg_size, num_bytes);
+
+  size_t total_size = 0;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  LONGS_EQUAL(expected_msg_size, total_size);
+
+  // reads which start & end part way through compressed events
+  const size_t read_size = 7;
+  for (size_t offset = 0; offset < total_size; offset += read_size) {
+    const size_t bytes_to_read = MEMFAULT_MIN(read_size, total_size - offset);
+    CHECK(g_memfault_event_data_source.read_msg_cb(offset, &s_actual_msg[offset], bytes_to_read));
+  }
+  MEMCMP_EQUAL(s_expected_msg, s_actual_msg, total_size);
+
+  // and out of order reads
+  memset(s_actual_msg, 0x0, sizeof(s_actual_msg));
+  for (size_t end = total_size; end > 0;) {
+    const size_t bytes_to_read = MEMFAULT_MIN(read_size * 3, end);
+    end -= bytes_to_read;
+    CHECK(g_memfault_event_data_source.read_msg_cb(end, &s_actual_msg[end], bytes_to_read));
+  }
+  MEMCMP_EQUAL(s_expected_msg, s_actual_msg, total_size);
+  CHECK(!g_memfault_event_data_source.read_msg_cb(total_size - 1, s_actual_msg, 2));
+
+  g_memfault_event_data_source.mark_msg_read_cb();
+  CHECK(!g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+}
+
+TEST(MemfaultEventStorageCompression, Test_ReservedWrites) {
+  prv_check_fill_and_drain(s_storage_impl);
+}
+
+TEST(MemfaultEventStorageCompression, Test_StreamingWrites) {
+  sMemfaultEventStorageImpl streaming_impl = *s_storage_impl;
+  streaming_impl.reserve_cb = NULL;
+  streaming_impl.commit_cb = NULL;
+  prv_check_fill_and_drain(&streaming_impl);
+}
+
+static bool prv_encode_incompressible(sMemfaultCborEncoder *encoder, MEMFAULT_UNUSED void *ctx) {
+  uint8_t data[32];
+  uint32_t state = 0x12345678;
+  for (size_t i = 0; i < sizeof(data); i++) {
+    state = (state * 1103515245) + 12345;
+    data[i] = (uint8_t)(state >> 16);
+  }
+  return memfault_serializer_helper_encode_byte_string_kv_pair(encoder, 1, data, sizeof(data));
+}
+
+TEST(MemfaultEventStorageCompression, Test_IncompressibleEventStoredAsIs) {
+  sMemfaultCborEncoder encoder;
+  CHECK(memfault_serializer_helper_encode_to_storage(&encoder, s_storage_impl,
+                                                     kMemfaultEventStorageClass_Trace,
+                                                     prv_encode_incompressible, NULL));
+  const size_t raw_size = memfault_serializer_helper_compute_size(
+      &encoder, prv_encode_incompressible, NULL);
+  LONGS_EQUAL(raw_size + 1, memfault_event_storage_bytes_used());
+
+  size_t total_size = 0;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  LONGS_EQUAL(raw_size, total_size);
+  g_memfault_event_data_source.mark_msg_read_cb();
+}
@@ -0,0 +1,235 @@
+//! @file
+//!
+//! @brief
+//! Checks which events are evicted from a full event storage with the
+//! MEMFAULT_EVENT_STORAGE_EVICTION_DROP_OLDEST and MEMFAULT_EVENT_STORAGE_EVICTION_PRIORITY
+//! policies.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fakes/fake_memfault_platform_metrics_locking.h"
+#include "memfault/config.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/event_storage.h"
+#include "memfault/core/event_storage_implementation.h"
+#include "memfault/core/math.h"
+
+// Each event carries a 2 byte header (varint size + class) so 4 of these fill storage
+#define TEST_EVENT_SIZE 13
+#define TEST_STORAGE_OVERHEAD 2
+
+static uint8_t s_ram_store[4 * (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD)];
+static const sMemfaultEventStorageImpl *s_storage_impl;
+
+TEST_GROUP(MemfaultEventStorageEviction) {
+  void setup() {
+    fake_memfault_metrics_platorm_locking_reboot();
+    s_storage_impl = memfault_events_storage_boot(s_ram_store, sizeof(s_ram_store));
+  }
+  void teardown() {
+    CHECK(fake_memfault_platform_metrics_lock_calls_balanced());
+    mock().checkExpectations();
+    mock().clear();
+  }
+};
+
+static void prv_fill_reservation(const sMemfaultEventStorageReservation *reservation,
+                                 uint8_t id) {
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(reservation->regions); i++) {
+    memset(reservation->regions[i].ptr, id, reservation->regions[i].len);
+  }
+}
+
+//! Saves an event of "size" bytes all set to "id"
+static eMemfaultEventStorageReserveStatus prv_try_save(uint8_t id, size_t size,
+                                                       eMemfaultEventStorageClass event_class) {
+  sMemfaultEventStorageReservation reservation;
+  const eMemfaultEventStorageReserveStatus status =
+      s_storage_impl->reserve_cb(size, event_class, &reservation);
+  if (status == kMemfaultEventStorageReserveStatus_Ok) {
+    prv_fill_reservation(&reservation, id);
+    s_storage_impl->commit_cb(&reservation, false);
+  }
+  return status;
+}
+
+static void prv_save(uint8_t id, eMemfaultEventStorageClass event_class) {
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+              prv_try_save(id, TEST_EVENT_SIZE, event_class));
+}
+
+static void prv_assert_next_event(uint8_t id, size_t size) {
+  size_t total_size;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  LONGS_EQUAL(size, total_size);
+
+  uint8_t expected[sizeof(s_ram_store)];
+  uint8_t actual[sizeof(s_ram_store)];
+  memset(expected, id, size);
+  CHECK(g_memfault_event_data_source.read_msg_cb(0, actual, size));
+  MEMCMP_EQUAL(expected, actual, size);
+  g_memfault_event_data_source.mark_msg_read_cb();
+}
+
+static void prv_assert_no_more_events(void) {
+  size_t total_size;
+  CHECK(!g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+}
+
+static void prv_assert_eviction_counts(uint32_t heartbeats, uint32_t traces, uint32_t reboots) {
+  LONGS_EQUAL(heartbeats,
+              memfault_event_storage_read_eviction_count(kMemfaultEventStorageClass_Heartbeat));
+  LONGS_EQUAL(traces, memfault_event_storage_read_eviction_count(kMemfaultEventStorageClass_Trace));
+  LONGS_EQUAL(reboots,
+              memfault_event_storage_read_eviction_count(kMemfaultEventStorageClass_Reboot));
+}
+
+TEST(MemfaultEventStorageEviction, Test_EventBeingReadIsKept) {
+  for (uint8_t id = 1; id <= 4; id++) {
+    prv_save(id, kMemfaultEventStorageClass_Heartbeat);
+  }
+
+  // start reading the oldest event
+  size_t total_size;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  uint8_t partial[5];
+  CHECK(g_memfault_event_data_source.read_msg_cb(0, partial, sizeof(partial)));
+
+  // the next oldest event makes room instead
+  prv_save(5, kMemfaultEventStorageClass_Reboot);
+  prv_assert_eviction_counts(1, 0, 0);
+
+  prv_assert_next_event(1, TEST_EVENT_SIZE);
+  prv_assert_next_event(3, TEST_EVENT_SIZE);
+  prv_assert_next_event(4, TEST_EVENT_SIZE);
+  prv_assert_next_event(5, TEST_EVENT_SIZE);
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStorageEviction, Test_PendingReservationIsKept) {
+  prv_save(1, kMemfaultEventStorageClass_Heartbeat);
+  sMemfaultEventStorageReservation pending;
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+              s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Heartbeat,
+                                         &pending));
+  prv_save(3, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(4, kMemfaultEventStorageClass_Heartbeat);
+
+  prv_save(5, kMemfaultEventStorageClass_Reboot);
+  prv_assert_eviction_counts(1, 0, 0);
+
+  // nothing at or after the pending reservation can be moved
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_NoSpace,
+              prv_try_save(6, TEST_EVENT_SIZE, kMemfaultEventStorageClass_Reboot));
+  prv_assert_eviction_counts(0, 0, 0);
+
+  prv_fill_reservation(&pending, 2);
+  s_storage_impl->commit_cb(&pending, false);
+  prv_assert_next_event(2, TEST_EVENT_SIZE);
+  prv_assert_next_event(3, TEST_EVENT_SIZE);
+  prv_assert_next_event(4, TEST_EVENT_SIZE);
+  prv_assert_next_event(5, TEST_EVENT_SIZE);
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStorageEviction, Test_NothingEvictedIfEventCanNotFit) {
+  for (uint8_t id = 1; id <= 4; id++) {
+    prv_save(id, kMemfaultEventStorageClass_Heartbeat);
+  }
+
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_NoSpace,
+              prv_try_save(5, sizeof(s_ram_store), kMemfaultEventStorageClass_Reboot));
+  prv_assert_eviction_counts(0, 0, 0);
+
+  for (uint8_t id = 1; id <= 4; id++) {
+    prv_assert_next_event(id, TEST_EVENT_SIZE);
+  }
+  prv_assert_no_more_events();
+}
+
+#if MEMFAULT_EVENT_STORAGE_EVICTION_POLICY == MEMFAULT_EVENT_STORAGE_EVICTION_DROP_OLDEST
+
+TEST(MemfaultEventStorageEviction, Test_OldestEventsEvicted) {
+  prv_save(1, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(2, kMemfaultEventStorageClass_Trace);
+  prv_save(3, kMemfaultEventStorageClass_Reboot);
+  prv_save(4, kMemfaultEventStorageClass_Heartbeat);
+
+  prv_save(5, kMemfaultEventStorageClass_Heartbeat);
+  prv_assert_eviction_counts(1, 0, 0);
+
+  // an event twice as large needs two evictions
+  const size_t large_event_size = (2 * TEST_EVENT_SIZE) + TEST_STORAGE_OVERHEAD;
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+              prv_try_save(6, large_event_size, kMemfaultEventStorageClass_Heartbeat));
+  prv_assert_eviction_counts(0, 1, 1);
+
+  prv_assert_next_event(4, TEST_EVENT_SIZE);
+  prv_assert_next_event(5, TEST_EVENT_SIZE);
+  prv_assert_next_event(6, large_event_size);
+  prv_assert_no_more_events();
+}
+
+#elif MEMFAULT_EVENT_STORAGE_EVICTION_POLICY == MEMFAULT_EVENT_STORAGE_EVICTION_PRIORITY
+
+TEST(MemfaultEventStorageEviction, Test_LowerClassesEvictedFirst) {
+  prv_save(1, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(2, kMemfaultEventStorageClass_Trace);
+  prv_save(3, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(4, kMemfaultEventStorageClass_Trace);
+
+  // heartbeats go first, oldest first
+  prv_save(5, kMemfaultEventStorageClass_Reboot);
+  prv_save(6, kMemfaultEventStorageClass_Trace);
+  prv_assert_eviction_counts(2, 0, 0);
+
+  // a trace can't evict another trace
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_NoSpace,
+              prv_try_save(7, TEST_EVENT_SIZE, kMemfaultEventStorageClass_Trace));
+
+  // but a reboot can
+  prv_save(8, kMemfaultEventStorageClass_Reboot);
+  prv_assert_eviction_counts(0, 1, 0);
+
+  prv_assert_next_event(4, TEST_EVENT_SIZE);
+  prv_assert_next_event(5, TEST_EVENT_SIZE);
+  prv_assert_next_event(6, TEST_EVENT_SIZE);
+  prv_assert_next_event(8, TEST_EVENT_SIZE);
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStorageEviction, Test_LowestClassEvictedEvenIfNewer) {
+  prv_save(1, kMemfaultEventStorageClass_Trace);
+  prv_save(2, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(3, kMemfaultEventStorageClass_Trace);
+  prv_save(4, kMemfaultEventStorageClass_Heartbeat);
+
+  const size_t large_event_size = (2 * TEST_EVENT_SIZE) + TEST_STORAGE_OVERHEAD;
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+              prv_try_save(5, large_event_size, kMemfaultEventStorageClass_Reboot));
+  prv_assert_eviction_counts(2, 0, 0);
+
+  prv_assert_next_event(1, TEST_EVENT_SIZE);
+  prv_assert_next_event(3, TEST_EVENT_SIZE);
+  prv_assert_next_event(5, large_event_size);
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStorageEviction, Test_HeartbeatsNeverEvictEvents) {
+  for (uint8_t id = 1; id <= 4; id++) {
+    prv_save(id, kMemfaultEventStorageClass_Heartbeat);
+  }
+
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_NoSpace,
+              prv_try_save(5, TEST_EVENT_SIZE, kMemfaultEventStorageClass_Heartbeat));
+  prv_assert_eviction_counts(0, 0, 0);
+}
+
+#endif
@@ -0,0 +1,225 @@
+//! @file
+//!
+//! @brief
+//! Checks that event storage split up with memfault_events_storage_boot_partitions() keeps the
+//! events of each partition apart and drains the partitions fairly.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fakes/fake_memfault_platform_metrics_locking.h"
+#include "memfault/config.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/event_storage.h"
+#include "memfault/core/event_storage_implementation.h"
+#include "memfault/core/math.h"
+
+// Each event carries a 1 byte header so 3 of these fill a partition
+#define TEST_EVENT_SIZE 9
+#define TEST_STORAGE_OVERHEAD 1
+
+static uint8_t s_heartbeat_store[3 * (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD)];
+static uint8_t s_trace_store[3 * (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD)];
+static uint8_t s_reboot_store[3 * (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD)];
+static const sMemfaultEventStorageImpl *s_storage_impl;
+
+static const sMemfaultEventStoragePartitionConfig s_partitions[] = {
+  {
+    .name = "heartbeats",
+    .buf = s_heartbeat_store,
+    .buf_len = sizeof(s_heartbeat_store),
+    .classes = MEMFAULT_EVENT_STORAGE_CLASS_MASK(kMemfaultEventStorageClass_Heartbeat),
+  },
+  {
+    .name = "traces",
+    .buf = s_trace_store,
+    .buf_len = sizeof(s_trace_store),
+    .classes = MEMFAULT_EVENT_STORAGE_CLASS_MASK(kMemfaultEventStorageClass_Trace),
+  },
+  {
+    .name = "reboots",
+    .buf = s_reboot_store,
+    .buf_len = sizeof(s_reboot_store),
+    .classes = MEMFAULT_EVENT_STORAGE_CLASS_MASK(kMemfaultEventStorageClass_Reboot),
+  },
+};
+
+TEST_GROUP(MemfaultEventStoragePartitions) {
+  void setup() {
+    fake_memfault_metrics_platorm_locking_reboot();
+    s_storage_impl =
+        memfault_events_storage_boot_partitions(s_partitions, MEMFAULT_ARRAY_SIZE(s_partitions));
+    CHECK(s_storage_impl != NULL);
+  }
+  void teardown() {
+    CHECK(fake_memfault_platform_metrics_lock_calls_balanced());
+    mock().checkExpectations();
+    mock().clear();
+  }
+};
+
+//! Saves an event all set to "id"
+static eMemfaultEventStorageReserveStatus prv_try_save(uint8_t id,
+                                                       eMemfaultEventStorageClass event_class) {
+  sMemfaultEventStorageReservation reservation;
+  const eMemfaultEventStorageReserveStatus status =
+      s_storage_impl->reserve_cb(TEST_EVENT_SIZE, event_class, &reservation);
+  if (status == kMemfaultEventStorageReserveStatus_Ok) {
+    for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(reservation.regions); i++) {
+      memset(reservation.regions[i].ptr, id, reservation.regions[i].len);
+    }
+    s_storage_impl->commit_cb(&reservation, false);
+  }
+  return status;
+}
+
+static void prv_save(uint8_t id, eMemfaultEventStorageClass event_class) {
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok, prv_try_save(id, event_class));
+}
+
+static void prv_assert_next_event(uint8_t id) {
+  size_t total_size;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  LONGS_EQUAL(TEST_EVENT_SIZE, total_size);
+
+  uint8_t expected[TEST_EVENT_SIZE];
+  uint8_t actual[TEST_EVENT_SIZE];
+  memset(expected, id, sizeof(expected));
+  CHECK(g_memfault_event_data_source.read_msg_cb(0, actual, sizeof(actual)));
+  MEMCMP_EQUAL(expected, actual, sizeof(actual));
+  g_memfault_event_data_source.mark_msg_read_cb();
+}
+
+static void prv_assert_no_more_events(void) {
+  size_t total_size;
+  CHECK(!g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+}
+
+static void prv_assert_partition_bytes_used(const char *name, size_t bytes_used) {
+  sMemfaultEventStorageInfo info;
+  CHECK(memfault_event_storage_get_partition_info(name, &info));
+  LONGS_EQUAL(bytes_used, info.bytes_used);
+}
+
+TEST(MemfaultEventStoragePartitions, Test_TraceStormDoesNotStarveHeartbeats) {
+  uint8_t id = 0;
+  while (prv_try_save(id, kMemfaultEventStorageClass_Trace) ==
+         kMemfaultEventStorageReserveStatus_Ok) {
+    id++;
+  }
+  LONGS_EQUAL(3, id);
+
+  // the heartbeat & reboot partitions are untouched
+  prv_save(0x10, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(0x20, kMemfaultEventStorageClass_Reboot);
+
+  prv_assert_partition_bytes_used("heartbeats", TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD);
+  prv_assert_partition_bytes_used("traces", sizeof(s_trace_store));
+  prv_assert_partition_bytes_used("reboots", TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD);
+  LONGS_EQUAL(5 * (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD), memfault_event_storage_bytes_used());
+  LONGS_EQUAL(sizeof(s_heartbeat_store) + sizeof(s_trace_store) + sizeof(s_reboot_store),
+              s_storage_impl->get_storage_size_cb());
+}
+
+TEST(MemfaultEventStoragePartitions, Test_PartitionsTakeTurns) {
+  prv_save(0x20, kMemfaultEventStorageClass_Trace);
+  prv_save(0x21, kMemfaultEventStorageClass_Trace);
+  prv_save(0x22, kMemfaultEventStorageClass_Trace);
+  prv_save(0x10, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(0x11, kMemfaultEventStorageClass_Heartbeat);
+  prv_save(0x30, kMemfaultEventStorageClass_Reboot);
+
+  prv_assert_next_event(0x10);
+  prv_assert_next_event(0x20);
+  prv_assert_next_event(0x30);
+  prv_assert_next_event(0x11);
+  prv_assert_next_event(0x21);
+  // the reboot partition is empty so its turn is skipped
+  prv_assert_next_event(0x22);
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStoragePartitions, Test_ReadInProgressSticksToPartition) {
+  prv_save(0x10, kMemfaultEventStorageClass_Heartbeat);
+
+  size_t total_size;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+
+  // an event landing in a different partition mid-read doesn't change the message being read
+  prv_save(0x20, kMemfaultEventStorageClass_Trace);
+  prv_assert_next_event(0x10);
+  prv_assert_next_event(0x20);
+  prv_assert_no_more_events();
+}
+
+TEST(MemfaultEventStoragePartitions, Test_ReservationsInSeveralPartitions) {
+  sMemfaultEventStorageReservation heartbeat;
+  sMemfaultEventStorageReservation trace;
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+              s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Heartbeat,
+                                         &heartbeat));
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+              s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Trace,
+                                         &trace));
+
+  memset(trace.regions[0].ptr, 0x20, trace.regions[0].len);
+  s_storage_impl->commit_cb(&trace, false);
+  s_storage_impl->commit_cb(&heartbeat, true);
+
+  prv_assert_next_event(0x20);
+  prv_assert_no_more_events();
+  prv_assert_partition_bytes_used("heartbeats", 0);
+}
+
+TEST(MemfaultEventStoragePartitions, Test_StreamingWritesStoredWithTraces) {
+  const uint8_t event[TEST_EVENT_SIZE] = { 0 };
+  CHECK(s_storage_impl->begin_write_cb() != 0);
+  CHECK(s_storage_impl->append_data_cb(event, sizeof(event)));
+  s_storage_impl->finish_write_cb(false);
+
+  prv_assert_partition_bytes_used("traces", sizeof(event) + TEST_STORAGE_OVERHEAD);
+  prv_assert_partition_bytes_used("heartbeats", 0);
+}
+
+TEST(MemfaultEventStoragePartitions, Test_UnassignedClassStoredInFirstPartition) {
+  const sMemfaultEventStoragePartitionConfig partitions[] = {
+    {
+      .name = "traces",
+      .buf = s_trace_store,
+      .buf_len = sizeof(s_trace_store),
+      .classes = MEMFAULT_EVENT_STORAGE_CLASS_MASK(kMemfaultEventStorageClass_Trace),
+    },
+    {
+      .name = "heartbeats",
+      .buf = s_heartbeat_store,
+      .buf_len = sizeof(s_heartbeat_store),
+      .classes = MEMFAULT_EVENT_STORAGE_CLASS_MASK(kMemfaultEventStorageClass_Heartbeat),
+    },
+  };
+  s_storage_impl =
+      memfault_events_storage_boot_partitions(partitions, MEMFAULT_ARRAY_SIZE(partitions));
+  CHECK(s_storage_impl != NULL);
+
+  prv_save(0x30, kMemfaultEventStorageClass_Reboot);
+  prv_assert_partition_bytes_used("traces", TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD);
+  prv_assert_partition_bytes_used("heartbeats", 0);
+
+  sMemfaultEventStorageInfo info;
+  CHECK(!memfault_event_storage_get_partition_info("reboots", &info));
+}
+
+TEST(MemfaultEventStoragePartitions, Test_BadConfig) {
+  POINTERS_EQUAL(NULL, memfault_events_storage_boot_partitions(s_partitions, 0));
+  POINTERS_EQUAL(NULL, memfault_events_storage_boot_partitions(NULL, 1));
+
+  sMemfaultEventStoragePartitionConfig too_many[MEMFAULT_EVENT_STORAGE_MAX_PARTITIONS + 1];
+  memset(too_many, 0x0, sizeof(too_many));
+  POINTERS_EQUAL(NULL,
+                 memfault_events_storage_boot_partitions(too_many, MEMFAULT_ARRAY_SIZE(too_many)));
+}
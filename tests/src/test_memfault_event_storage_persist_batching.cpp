@@ -0,0 +1,225 @@
+//! @file
+//!
+//! @brief
+//! Checks that with MEMFAULT_EVENT_STORAGE_PERSIST_BATCHING_ENABLED, persist requests are only
+//! made once a batch of events is worth writing to non-volatile storage.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fakes/fake_memfault_platform_metrics_locking.h"
+#include "memfault/config.h"
+#include "memfault/core/event_storage.h"
+#include "memfault/core/event_storage_implementation.h"
+#include "memfault/core/platform/core.h"
+#include "memfault/core/platform/nonvolatile_event_storage.h"
+
+// Each event carries a 1 byte header so every event uses 10% of storage
+#define TEST_EVENT_SIZE 9
+#define TEST_STORAGE_OVERHEAD 1
+
+static uint8_t s_ram_store[10 * (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD)];
+static const sMemfaultEventStorageImpl *s_storage_impl;
+
+static uint64_t s_time_since_boot_ms;
+static size_t s_num_persist_requests;
+
+static size_t s_nv_events_written;
+static size_t s_nv_events_capacity;
+static size_t s_nv_num_flushes;
+static bool s_nv_flush_result;
+
+uint64_t memfault_platform_get_time_since_boot_ms(void) {
+  return s_time_since_boot_ms;
+}
+
+void memfault_event_storage_request_persist_callback(
+    MEMFAULT_UNUSED const sMemfaultEventStoragePersistCbStatus *status) {
+  s_num_persist_requests++;
+}
+
+static bool prv_nv_enabled(void) {
+  return true;
+}
+
+static bool prv_nv_has_event(MEMFAULT_UNUSED size_t *event_length_out) {
+  return false;
+}
+
+static bool prv_nv_read(MEMFAULT_UNUSED uint32_t offset, MEMFAULT_UNUSED void *buf,
+                        MEMFAULT_UNUSED size_t buf_len) {
+  return false;
+}
+
+static void prv_nv_consume(void) { }
+
+static bool prv_nv_write(MemfaultEventReadCallback reader_callback, size_t total_size) {
+  if (s_nv_events_written == s_nv_events_capacity) {
+    return false;
+  }
+  uint8_t buf[TEST_EVENT_SIZE];
+  LONGS_EQUAL(TEST_EVENT_SIZE, total_size);
+  CHECK(reader_callback(0, buf, sizeof(buf)));
+  s_nv_events_written++;
+  return true;
+}
+
+static bool prv_nv_flush(void) {
+  s_nv_num_flushes++;
+  return s_nv_flush_result;
+}
+
+const sMemfaultNonVolatileEventStorageImpl g_memfault_platform_nv_event_storage_impl = {
+  .enabled = prv_nv_enabled,
+  .has_event = prv_nv_has_event,
+  .read = prv_nv_read,
+  .consume = prv_nv_consume,
+  .write = prv_nv_write,
+  .flush = prv_nv_flush,
+};
+
+TEST_GROUP(MemfaultEventStoragePersistBatching) {
+  void setup() {
+    fake_memfault_metrics_platorm_locking_reboot();
+    s_storage_impl = memfault_events_storage_boot(s_ram_store, sizeof(s_ram_store));
+    s_time_since_boot_ms = 0;
+    s_num_persist_requests = 0;
+    s_nv_events_written = 0;
+    s_nv_events_capacity = SIZE_MAX;
+    s_nv_num_flushes = 0;
+    s_nv_flush_result = true;
+
+    // start from a clean slate, with requests armed
+    LONGS_EQUAL(0, memfault_event_storage_persist());
+  }
+  void teardown() {
+    CHECK(fake_memfault_platform_metrics_lock_calls_balanced());
+  }
+};
+
+static void prv_save_events(size_t num_events) {
+  for (size_t i = 0; i < num_events; i++) {
+    sMemfaultEventStorageReservation reservation;
+    LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+                s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Trace,
+                                           &reservation));
+    s_storage_impl->commit_cb(&reservation, false);
+  }
+}
+
+TEST(MemfaultEventStoragePersistBatching, Test_RequestAtHighWatermark) {
+  prv_save_events(4);
+  LONGS_EQUAL(0, s_num_persist_requests);
+
+  // 50% full
+  prv_save_events(1);
+  LONGS_EQUAL(1, s_num_persist_requests);
+
+  // a request is already outstanding
+  prv_save_events(3);
+  LONGS_EQUAL(1, s_num_persist_requests);
+
+  // everything is moved in one go
+  LONGS_EQUAL(8, memfault_event_storage_persist());
+  LONGS_EQUAL(8, s_nv_events_written);
+  LONGS_EQUAL(1, s_nv_num_flushes);
+  LONGS_EQUAL(0, memfault_event_storage_bytes_used());
+
+  // requests are armed again
+  prv_save_events(4);
+  LONGS_EQUAL(1, s_num_persist_requests);
+  prv_save_events(1);
+  LONGS_EQUAL(2, s_num_persist_requests);
+}
+
+TEST(MemfaultEventStoragePersistBatching, Test_RequestOnceWindowElapses) {
+  prv_save_events(1);
+  s_time_since_boot_ms = 999;
+  prv_save_events(1);
+  LONGS_EQUAL(0, s_num_persist_requests);
+
+  // the window is measured from the oldest event waiting
+  s_time_since_boot_ms = 1000;
+  prv_save_events(1);
+  LONGS_EQUAL(1, s_num_persist_requests);
+
+  LONGS_EQUAL(3, memfault_event_storage_persist());
+  s_time_since_boot_ms = 1999;
+  prv_save_events(1);
+  s_time_since_boot_ms = 2998;
+  prv_save_events(1);
+  LONGS_EQUAL(1, s_num_persist_requests);
+  s_time_since_boot_ms = 2999;
+  prv_save_events(1);
+  LONGS_EQUAL(2, s_num_persist_requests);
+}
+
+TEST(MemfaultEventStoragePersistBatching, Test_PeriodicCheckPersistsLoneEvent) {
+  // nothing is waiting so the window never elapses
+  s_time_since_boot_ms = 5000;
+  memfault_event_storage_check_persist_window();
+  LONGS_EQUAL(0, s_num_persist_requests);
+
+  prv_save_events(1);
+  s_time_since_boot_ms = 5999;
+  memfault_event_storage_check_persist_window();
+  LONGS_EQUAL(0, s_num_persist_requests);
+
+  s_time_since_boot_ms = 6000;
+  memfault_event_storage_check_persist_window();
+  LONGS_EQUAL(1, s_num_persist_requests);
+
+  // a request is already outstanding
+  memfault_event_storage_check_persist_window();
+  LONGS_EQUAL(1, s_num_persist_requests);
+
+  LONGS_EQUAL(1, memfault_event_storage_persist());
+  s_time_since_boot_ms = 10000;
+  memfault_event_storage_check_persist_window();
+  LONGS_EQUAL(1, s_num_persist_requests);
+}
+
+TEST(MemfaultEventStoragePersistBatching, Test_RearmedAtLowWatermark) {
+  prv_save_events(6);
+  LONGS_EQUAL(1, s_num_persist_requests);
+
+  // non-volatile storage fills up, leaving 30% of the RAM storage in use
+  s_nv_events_capacity = 3;
+  LONGS_EQUAL(3, memfault_event_storage_persist());
+  prv_save_events(3);
+  LONGS_EQUAL(1, s_num_persist_requests);
+
+  // draining down to 20% arms requests again
+  s_nv_events_capacity = 7;
+  LONGS_EQUAL(4, memfault_event_storage_persist());
+  LONGS_EQUAL(2 * (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD), memfault_event_storage_bytes_used());
+  prv_save_events(3);
+  LONGS_EQUAL(2, s_num_persist_requests);
+}
+
+TEST(MemfaultEventStoragePersistBatching, Test_FlushFailure) {
+  prv_save_events(2);
+  s_nv_flush_result = false;
+  LONGS_EQUAL(-1, memfault_event_storage_persist());
+  LONGS_EQUAL(1, s_nv_num_flushes);
+
+  // nothing written, nothing to flush
+  LONGS_EQUAL(0, memfault_event_storage_persist());
+  LONGS_EQUAL(1, s_nv_num_flushes);
+}
+
+TEST(MemfaultEventStoragePersistBatching, Test_RollbackDoesNotRequest) {
+  for (size_t i = 0; i < 6; i++) {
+    sMemfaultEventStorageReservation reservation;
+    LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+                s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Trace,
+                                           &reservation));
+    s_storage_impl->commit_cb(&reservation, true);
+  }
+  LONGS_EQUAL(0, s_num_persist_requests);
+}
@@ -0,0 +1,153 @@
+//! @file
+//!
+//! @brief
+//! Checks that the cost of draining a batched event storage message stays linear in the number
+//! of events stored, regardless of the size of the reads used to drain it.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fakes/fake_memfault_circular_buffer_stats.h"
+#include "fakes/fake_memfault_platform_metrics_locking.h"
+#include "memfault/core/batched_events.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/event_storage.h"
+#include "memfault/core/event_storage_implementation.h"
+#include "memfault/core/math.h"
+
+#define TEST_EVENT_SIZE 4
+#define TEST_MAX_EVENTS 512
+#define TEST_PACKETIZER_READ_SIZE 128
+
+static uint8_t s_ram_store[TEST_MAX_EVENTS * (TEST_EVENT_SIZE + 2)];
+static uint8_t s_expected_msg[MEMFAULT_BATCHED_EVENTS_MAX_HEADER_LENGTH +
+                              TEST_MAX_EVENTS * TEST_EVENT_SIZE];
+static uint8_t s_actual_msg[sizeof(s_expected_msg)];
+static const sMemfaultEventStorageImpl *s_storage_impl;
+
+TEST_GROUP(MemfaultEventStorageReadCursor) {
+  void setup() {
+    fake_memfault_metrics_platorm_locking_reboot();
+    s_storage_impl = memfault_events_storage_boot(s_ram_store, sizeof(s_ram_store));
+    memset(s_actual_msg, 0x0, sizeof(s_actual_msg));
+  }
+  void teardown() {
+    CHECK(fake_memfault_platform_metrics_lock_calls_balanced());
+    mock().checkExpectations();
+    mock().clear();
+  }
+};
+
+//! Fills storage with num_events events and returns the size of the expected batched message
+static size_t prv_fill_storage(size_t num_events) {
+  sMemfaultBatchedEventsHeader header = { 0 };
+  memfault_batched_events_build_header(num_events, &header);
+  memcpy(s_expected_msg, header.data, header.length);
+
+  uint8_t *msgp = &s_expected_msg[header.length];
+  for (size_t i = 0; i < num_events; i++) {
+    const uint8_t event[TEST_EVENT_SIZE] = {
+      (uint8_t)i, (uint8_t)(i >> 8), 0xA5, (uint8_t)~i,
+    };
+    CHECK(s_storage_impl->begin_write_cb() != 0);
+    CHECK(s_storage_impl->append_data_cb(event, sizeof(event)));
+    s_storage_impl->finish_write_cb(false);
+
+    memcpy(msgp, event, sizeof(event));
+    msgp += sizeof(event);
+  }
+
+  const size_t expected_msg_size = header.length + (num_events * TEST_EVENT_SIZE);
+  size_t total_size = 0;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  LONGS_EQUAL(expected_msg_size, total_size);
+  return total_size;
+}
+
+//! @return the number of circular buffer reads needed to drain the message
+static size_t prv_drain_sequential(size_t msg_size) {
+  fake_memfault_circular_buffer_stats_reset();
+  for (size_t offset = 0; offset < msg_size; offset += TEST_PACKETIZER_READ_SIZE) {
+    const size_t read_size = MEMFAULT_MIN(TEST_PACKETIZER_READ_SIZE, msg_size - offset);
+    CHECK(g_memfault_event_data_source.read_msg_cb(offset, &s_actual_msg[offset], read_size));
+  }
+  const size_t read_count = fake_memfault_circular_buffer_stats_get_read_count();
+
+  MEMCMP_EQUAL(s_expected_msg, s_actual_msg, msg_size);
+  g_memfault_event_data_source.mark_msg_read_cb();
+  return read_count;
+}
+
+TEST(MemfaultEventStorageReadCursor, Test_SequentialDrainIsLinear) {
+  const size_t batch_sizes[] = { 16, 64, 256, TEST_MAX_EVENTS };
+  for (size_t i = 0; i < MEMFAULT_ARRAY_SIZE(batch_sizes); i++) {
+    const size_t num_events = batch_sizes[i];
+    const size_t msg_size = prv_fill_storage(num_events);
+    const size_t read_count = prv_drain_sequential(msg_size);
+
+    // Every event is visited once for its header and once for its payload. An event straddling
+    // two packetizer reads needs one extra header + payload read.
+    const size_t num_packetizer_reads =
+        (msg_size + TEST_PACKETIZER_READ_SIZE - 1) / TEST_PACKETIZER_READ_SIZE;
+    CHECK(read_count <= (2 * num_events) + (2 * num_packetizer_reads));
+
+    size_t total_size = 0xab;
+    CHECK(!g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  }
+}
+
+TEST(MemfaultEventStorageReadCursor, Test_SingleByteReads) {
+  const size_t num_events = 64;
+  const size_t msg_size = prv_fill_storage(num_events);
+
+  fake_memfault_circular_buffer_stats_reset();
+  for (size_t offset = 0; offset < msg_size; offset++) {
+    CHECK(g_memfault_event_data_source.read_msg_cb(offset, &s_actual_msg[offset], 1));
+  }
+  MEMCMP_EQUAL(s_expected_msg, s_actual_msg, msg_size);
+
+  // one header + one payload read per byte
+  CHECK(fake_memfault_circular_buffer_stats_get_read_count() <= 2 * msg_size);
+  g_memfault_event_data_source.mark_msg_read_cb();
+}
+
+TEST(MemfaultEventStorageReadCursor, Test_RandomReadsUseIndex) {
+  const size_t num_events = TEST_MAX_EVENTS;
+  const size_t msg_size = prv_fill_storage(num_events);
+
+  // read the message back to front so the cursor can never be used
+  fake_memfault_circular_buffer_stats_reset();
+  size_t num_reads = 0;
+  size_t end = msg_size;
+  while (end > 0) {
+    const size_t read_size = MEMFAULT_MIN(TEST_PACKETIZER_READ_SIZE, end);
+    const size_t offset = end - read_size;
+    CHECK(g_memfault_event_data_source.read_msg_cb(offset, &s_actual_msg[offset], read_size));
+    end = offset;
+    num_reads++;
+  }
+  MEMCMP_EQUAL(s_expected_msg, s_actual_msg, msg_size);
+
+  // With 8 index entries covering 512 events, a read never has to skip over more than 64 event
+  // headers to get to its starting offset
+  const size_t max_skipped_events = num_events / 8;
+  const size_t events_per_read = TEST_PACKETIZER_READ_SIZE / TEST_EVENT_SIZE;
+  CHECK(fake_memfault_circular_buffer_stats_get_read_count() <=
+        num_reads * (max_skipped_events + 2 * (events_per_read + 1)));
+  g_memfault_event_data_source.mark_msg_read_cb();
+}
+
+TEST(MemfaultEventStorageReadCursor, Test_ReadRestartsAfterMarkRead) {
+  size_t msg_size = prv_fill_storage(3);
+  prv_drain_sequential(msg_size);
+
+  // a stale cursor from the previous message must not be used
+  msg_size = prv_fill_storage(5);
+  prv_drain_sequential(msg_size);
+}
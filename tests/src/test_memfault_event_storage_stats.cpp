@@ -0,0 +1,246 @@
+//! @file
+//!
+//! @brief
+//! Checks the health statistics collected about event storage when
+//! MEMFAULT_EVENT_STORAGE_STATS_ENABLED is set.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "fakes/fake_memfault_platform_metrics_locking.h"
+#include "memfault/config.h"
+#include "memfault/core/data_packetizer_source.h"
+#include "memfault/core/event_storage.h"
+#include "memfault/core/event_storage_implementation.h"
+#include "memfault/core/platform/core.h"
+
+// Each event carries a 1 byte varint & a 4 byte timestamp so every event uses 10% of storage
+#define TEST_EVENT_SIZE 10
+#define TEST_STORAGE_OVERHEAD 5
+#define TEST_EVENT_TOTAL_SIZE (TEST_EVENT_SIZE + TEST_STORAGE_OVERHEAD)
+
+static uint8_t s_ram_store[10 * TEST_EVENT_TOTAL_SIZE];
+static const sMemfaultEventStorageImpl *s_storage_impl;
+
+static uint64_t s_time_since_boot_ms;
+
+uint64_t memfault_platform_get_time_since_boot_ms(void) {
+  return s_time_since_boot_ms;
+}
+
+TEST_GROUP(MemfaultEventStorageStats) {
+  void setup() {
+    fake_memfault_metrics_platorm_locking_reboot();
+    s_time_since_boot_ms = 0;
+    s_storage_impl = memfault_events_storage_boot(s_ram_store, sizeof(s_ram_store));
+  }
+  void teardown() {
+    CHECK(fake_memfault_platform_metrics_lock_calls_balanced());
+  }
+};
+
+static sMemfaultEventStorageStats prv_get_stats(void) {
+  sMemfaultEventStorageStats stats;
+  CHECK(memfault_event_storage_get_stats(&stats));
+  return stats;
+}
+
+static void prv_reserve(sMemfaultEventStorageReservation *reservation) {
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Ok,
+              s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Trace,
+                                         reservation));
+  memset(reservation->regions[0].ptr, 0xa5, reservation->regions[0].len);
+}
+
+static void prv_save_events(size_t num_events) {
+  for (size_t i = 0; i < num_events; i++) {
+    sMemfaultEventStorageReservation reservation;
+    prv_reserve(&reservation);
+    s_storage_impl->commit_cb(&reservation, false);
+  }
+}
+
+static void prv_read_event(void) {
+  size_t total_size;
+  CHECK(g_memfault_event_data_source.has_more_msgs_cb(&total_size));
+  LONGS_EQUAL(TEST_EVENT_SIZE, total_size);
+
+  uint8_t buf[TEST_EVENT_SIZE];
+  CHECK(g_memfault_event_data_source.read_msg_cb(0, buf, sizeof(buf)));
+  for (size_t i = 0; i < sizeof(buf); i++) {
+    LONGS_EQUAL(0xa5, buf[i]);
+  }
+  g_memfault_event_data_source.mark_msg_read_cb();
+}
+
+TEST(MemfaultEventStorageStats, Test_PeakBytesUsed) {
+  prv_save_events(3);
+  prv_read_event();
+  prv_save_events(1);
+
+  sMemfaultEventStorageStats stats = prv_get_stats();
+  LONGS_EQUAL(3 * TEST_EVENT_TOTAL_SIZE, stats.peak_bytes_used);
+  LONGS_EQUAL(4, stats.events_stored);
+  LONGS_EQUAL(1, stats.events_read);
+
+  // a new interval starts from the current utilization
+  memfault_event_storage_reset_stats();
+  stats = prv_get_stats();
+  LONGS_EQUAL(3 * TEST_EVENT_TOTAL_SIZE, stats.peak_bytes_used);
+  LONGS_EQUAL(0, stats.events_stored);
+  LONGS_EQUAL(0, stats.events_read);
+
+  prv_read_event();
+  prv_read_event();
+  memfault_event_storage_reset_stats();
+  LONGS_EQUAL(TEST_EVENT_TOTAL_SIZE, prv_get_stats().peak_bytes_used);
+
+  // space held by a reservation which hasn't been committed counts
+  sMemfaultEventStorageReservation reservation;
+  prv_reserve(&reservation);
+  LONGS_EQUAL(2 * TEST_EVENT_TOTAL_SIZE, prv_get_stats().peak_bytes_used);
+  s_storage_impl->commit_cb(&reservation, false);
+}
+
+TEST(MemfaultEventStorageStats, Test_TimeInBuffer) {
+  s_time_since_boot_ms = 100;
+  prv_save_events(1);
+  s_time_since_boot_ms = 300;
+  prv_save_events(1);
+
+  s_time_since_boot_ms = 1000;
+  prv_read_event();
+  prv_read_event();
+
+  sMemfaultEventStorageStats stats = prv_get_stats();
+  LONGS_EQUAL(2, stats.events_read);
+  LONGS_EQUAL(900 + 700, stats.time_in_buffer_total_ms);
+  LONGS_EQUAL(900, stats.time_in_buffer_max_ms);
+
+  // the time an event is stored is when it is committed, not reserved
+  sMemfaultEventStorageReservation reservation;
+  prv_reserve(&reservation);
+  s_time_since_boot_ms = 1500;
+  s_storage_impl->commit_cb(&reservation, false);
+  s_time_since_boot_ms = 1600;
+  prv_read_event();
+  stats = prv_get_stats();
+  LONGS_EQUAL(3, stats.events_read);
+  LONGS_EQUAL(900 + 700 + 100, stats.time_in_buffer_total_ms);
+  LONGS_EQUAL(900, stats.time_in_buffer_max_ms);
+}
+
+TEST(MemfaultEventStorageStats, Test_TimeInBufferWrapsAround) {
+  s_time_since_boot_ms = UINT32_MAX - 10;
+  prv_save_events(1);
+  s_time_since_boot_ms = (uint64_t)UINT32_MAX + 20;
+  prv_read_event();
+  LONGS_EQUAL(30, prv_get_stats().time_in_buffer_max_ms);
+}
+
+TEST(MemfaultEventStorageStats, Test_ReservationDrops) {
+  // out of space
+  prv_save_events(9);
+  sMemfaultEventStorageReservation reservation;
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_NoSpace,
+              s_storage_impl->reserve_cb(TEST_EVENT_SIZE + 1, kMemfaultEventStorageClass_Trace,
+                                         &reservation));
+  for (size_t i = 0; i < 9; i++) {
+    prv_read_event();
+  }
+
+  // every reservation slot is taken
+  sMemfaultEventStorageReservation reservations[MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES];
+  for (size_t i = 0; i < MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES; i++) {
+    prv_reserve(&reservations[i]);
+  }
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Busy,
+              s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Trace,
+                                         &reservation));
+
+  // discarded by the writer
+  s_storage_impl->commit_cb(&reservations[0], true);
+  for (size_t i = 1; i < MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES; i++) {
+    s_storage_impl->commit_cb(&reservations[i], false);
+  }
+
+  const sMemfaultEventStorageStats stats = prv_get_stats();
+  LONGS_EQUAL(1, stats.drops_storage_full);
+  LONGS_EQUAL(1, stats.drops_writer_collision);
+  LONGS_EQUAL(1, stats.drops_rollback);
+  LONGS_EQUAL(9 + MEMFAULT_EVENT_STORAGE_MAX_CONCURRENT_WRITES - 1, stats.events_stored);
+}
+
+TEST(MemfaultEventStorageStats, Test_StreamingWriteDrops) {
+  const uint8_t data[TEST_EVENT_SIZE] = { 0xa5, 0xa5, 0xa5, 0xa5, 0xa5,
+                                          0xa5, 0xa5, 0xa5, 0xa5, 0xa5 };
+
+  // a reservation can't be made while a streaming write is in progress & vice versa
+  CHECK(s_storage_impl->begin_write_cb() > 0);
+  sMemfaultEventStorageReservation reservation;
+  LONGS_EQUAL(kMemfaultEventStorageReserveStatus_Busy,
+              s_storage_impl->reserve_cb(TEST_EVENT_SIZE, kMemfaultEventStorageClass_Trace,
+                                         &reservation));
+  LONGS_EQUAL(0, s_storage_impl->begin_write_cb());
+  CHECK(s_storage_impl->append_data_cb(data, sizeof(data)));
+  s_storage_impl->finish_write_cb(false);
+  prv_read_event();
+
+  // discarded by the writer
+  CHECK(s_storage_impl->begin_write_cb() > 0);
+  CHECK(s_storage_impl->append_data_cb(data, sizeof(data)));
+  s_storage_impl->finish_write_cb(true);
+
+  // rolled back because the event didn't fit
+  const size_t space_available = s_storage_impl->begin_write_cb();
+  for (size_t i = 0; i < space_available / sizeof(data); i++) {
+    CHECK(s_storage_impl->append_data_cb(data, sizeof(data)));
+  }
+  CHECK(!s_storage_impl->append_data_cb(data, sizeof(data)));
+  s_storage_impl->finish_write_cb(true);
+
+  // no space at all
+  prv_save_events(10);
+  LONGS_EQUAL(0, s_storage_impl->begin_write_cb());
+
+  const sMemfaultEventStorageStats stats = prv_get_stats();
+  LONGS_EQUAL(2, stats.drops_writer_collision);
+  LONGS_EQUAL(1, stats.drops_rollback);
+  LONGS_EQUAL(2, stats.drops_storage_full);
+  LONGS_EQUAL(11, stats.events_stored);
+}
+
+TEST(MemfaultEventStorageStats, Test_WriteLatencyHistogram) {
+  const uint32_t latencies_ms[] = { 0, 0, 1, 9, 10, 99, 100, 999, 1000, 100000 };
+  for (size_t i = 0; i < sizeof(latencies_ms) / sizeof(latencies_ms[0]); i++) {
+    sMemfaultEventStorageReservation reservation;
+    prv_reserve(&reservation);
+    s_time_since_boot_ms += latencies_ms[i];
+    s_storage_impl->commit_cb(&reservation, false);
+    prv_read_event();
+  }
+
+  // streaming writes are timed from begin_write_cb()
+  CHECK(s_storage_impl->begin_write_cb() > 0);
+  s_time_since_boot_ms += 5;
+  s_storage_impl->finish_write_cb(false);
+
+  const uint32_t expected[MEMFAULT_EVENT_STORAGE_STATS_LATENCY_BUCKETS] = { 2, 3, 2, 2, 2 };
+  const sMemfaultEventStorageStats stats = prv_get_stats();
+  MEMCMP_EQUAL(expected, stats.write_latency_buckets, sizeof(expected));
+}
+
+TEST(MemfaultEventStorageStats, Test_BootResetsStats) {
+  prv_save_events(2);
+  s_storage_impl = memfault_events_storage_boot(s_ram_store, sizeof(s_ram_store));
+
+  const sMemfaultEventStorageStats stats = prv_get_stats();
+  LONGS_EQUAL(0, stats.peak_bytes_used);
+  LONGS_EQUAL(0, stats.events_stored);
+  CHECK(!memfault_event_storage_get_stats(NULL));
+}
@@ -0,0 +1,457 @@
+//! @file
+//!
+//! @brief
+//! Exercises the log-structured flash NV event storage port on top of the simulated flash,
+//! including recovery from a power cut at every possible flash operation.
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fakes/fake_memfault_platform_metrics_locking.h"
+#include "memfault/core/platform/nonvolatile_event_storage.h"
+#include "memfault/ports/flash_nv_event_storage.h"
+#include "memfault/ports/flash_sim.h"
+
+#define TEST_SECTOR_SIZE 512
+#define TEST_NUM_SECTORS 3
+#define TEST_PAGE_SIZE 64
+//! Event header in front of every event
+#define TEST_EVENT_OVERHEAD 9
+
+static uint8_t s_flash_storage[TEST_SECTOR_SIZE * TEST_NUM_SECTORS];
+static uint8_t s_page_buf[TEST_PAGE_SIZE];
+static sMemfaultFlashSim s_flash;
+
+static uint8_t s_event[TEST_SECTOR_SIZE];
+static size_t s_event_len;
+
+static const sMemfaultNonVolatileEventStorageImpl *s_nv =
+    &g_memfault_platform_nv_event_storage_impl;
+
+static bool prv_boot(void) {
+  const sMemfaultFlashNvEventStorageConfig config = {
+    .flash = &s_flash.backend,
+    .page_buf = s_page_buf,
+  };
+  return memfault_flash_nv_event_storage_boot(&config);
+}
+
+TEST_GROUP(MemfaultFlashNvEventStorage) {
+  void setup() {
+    fake_memfault_metrics_platorm_locking_reboot();
+    memfault_flash_sim_init(&s_flash, s_flash_storage, TEST_SECTOR_SIZE, TEST_NUM_SECTORS,
+                            TEST_PAGE_SIZE);
+    memfault_flash_sim_erase_all(&s_flash);
+    CHECK(prv_boot());
+  }
+  void teardown() {
+    CHECK(fake_memfault_platform_metrics_lock_calls_balanced());
+    LONGS_EQUAL(0, s_flash.num_program_errors);
+  }
+};
+
+//! Events vary in size & content based on their id, which is held in the first 2 bytes, so they
+//! can be identified when read back
+static size_t prv_event_len(uint32_t id) {
+  return 10 + ((id * 7) % 40);
+}
+
+static void prv_fill_event(uint32_t id, uint8_t *buf, size_t buf_len) {
+  buf[0] = (uint8_t)id;
+  buf[1] = (uint8_t)(id >> 8);
+  for (size_t i = 2; i < buf_len; i++) {
+    buf[i] = (uint8_t)(id + i);
+  }
+}
+
+static bool prv_read_event_cb(uint32_t offset, void *buf, size_t buf_len) {
+  CHECK((offset + buf_len) <= s_event_len);
+  memcpy(buf, &s_event[offset], buf_len);
+  return true;
+}
+
+static bool prv_try_write(uint32_t id) {
+  s_event_len = prv_event_len(id);
+  prv_fill_event(id, s_event, s_event_len);
+  return s_nv->write(prv_read_event_cb, s_event_len);
+}
+
+static void prv_write(uint32_t id) {
+  CHECK(prv_try_write(id));
+}
+
+//! @return the id of the event or -1 if it doesn't hold the expected content
+static int32_t prv_read_event(size_t event_len) {
+  uint8_t buf[TEST_SECTOR_SIZE];
+  CHECK(s_nv->read(0, buf, event_len));
+  const uint32_t id = (uint32_t)buf[0] | ((uint32_t)buf[1] << 8);
+  uint8_t expected[TEST_SECTOR_SIZE];
+  prv_fill_event(id, expected, event_len);
+  if ((prv_event_len(id) != event_len) || (memcmp(buf, expected, event_len) != 0)) {
+    return -1;
+  }
+  return (int32_t)id;
+}
+
+static void prv_consume(uint32_t id) {
+  size_t event_len;
+  CHECK(s_nv->has_event(&event_len));
+  LONGS_EQUAL(prv_event_len(id), event_len);
+
+  // reads can start anywhere in the event
+  uint8_t byte;
+  CHECK(s_nv->read(3, &byte, sizeof(byte)));
+  LONGS_EQUAL((uint8_t)(id + 3), byte);
+  LONGS_EQUAL(id, prv_read_event(event_len));
+  s_nv->consume();
+}
+
+static void prv_assert_no_events(void) {
+  size_t event_len;
+  CHECK(!s_nv->has_event(&event_len));
+}
+
+static sMemfaultFlashNvEventStorageInfo prv_get_info(void) {
+  sMemfaultFlashNvEventStorageInfo info;
+  CHECK(memfault_flash_nv_event_storage_get_info(&info));
+  return info;
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_WriteReadConsume) {
+  CHECK(s_nv->enabled());
+  prv_assert_no_events();
+
+  for (uint32_t id = 0; id < 3; id++) {
+    prv_write(id);
+  }
+  LONGS_EQUAL(3, prv_get_info().events_pending);
+
+  // has_event() is idempotent
+  size_t event_len;
+  CHECK(s_nv->has_event(&event_len));
+  CHECK(s_nv->has_event(&event_len));
+  LONGS_EQUAL(prv_event_len(0), event_len);
+
+  // reads past the end of the event fail
+  uint8_t byte;
+  CHECK(!s_nv->read(event_len, &byte, sizeof(byte)));
+
+  for (uint32_t id = 0; id < 3; id++) {
+    prv_consume(id);
+  }
+  prv_assert_no_events();
+  LONGS_EQUAL(0, prv_get_info().events_pending);
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_WritesAreCoalesced) {
+  const uint32_t programs_at_boot = s_flash.num_programs;
+
+  size_t bytes_written = 0;
+  for (uint32_t id = 0; id < 4; id++) {
+    prv_write(id);
+    bytes_written += prv_event_len(id) + TEST_EVENT_OVERHEAD;
+  }
+  LONGS_EQUAL(bytes_written / TEST_PAGE_SIZE, s_flash.num_programs - programs_at_boot);
+
+  CHECK(memfault_flash_nv_event_storage_flush());
+  LONGS_EQUAL((bytes_written / TEST_PAGE_SIZE) + 1, s_flash.num_programs - programs_at_boot);
+  // nothing left to flush
+  CHECK(memfault_flash_nv_event_storage_flush());
+  LONGS_EQUAL((bytes_written / TEST_PAGE_SIZE) + 1, s_flash.num_programs - programs_at_boot);
+
+  // events are readable whether they have been programmed or not
+  prv_write(4);
+  for (uint32_t id = 0; id < 5; id++) {
+    prv_consume(id);
+  }
+  prv_assert_no_events();
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_RecoveredOnBoot) {
+  for (uint32_t id = 0; id < 10; id++) {
+    prv_write(id);
+  }
+  prv_consume(0);
+  prv_consume(1);
+  CHECK(memfault_flash_nv_event_storage_flush());
+
+  // data still in the page buffer is lost on a reboot
+  prv_consume(2);
+  prv_write(10);
+
+  CHECK(prv_boot());
+  LONGS_EQUAL(8, prv_get_info().events_pending);
+  for (uint32_t id = 2; id < 10; id++) {
+    prv_consume(id);
+  }
+  prv_assert_no_events();
+
+  // new events are appended after the recovered ones
+  prv_write(11);
+  CHECK(memfault_flash_nv_event_storage_flush());
+  CHECK(prv_boot());
+  prv_consume(11);
+  prv_assert_no_events();
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_FullStorage) {
+  uint32_t id = 0;
+  while (prv_try_write(id)) {
+    id++;
+  }
+  CHECK(id > 20);
+  CHECK(prv_get_info().bytes_free < (prv_event_len(id) + TEST_EVENT_OVERHEAD));
+
+  // once the oldest sector has been read out, its space can be reused
+  uint32_t next_read = 0;
+  while (prv_get_info().bytes_free < (prv_event_len(id) + TEST_EVENT_OVERHEAD)) {
+    prv_consume(next_read++);
+  }
+  // the space is only freed up once the reads move on to the next sector
+  CHECK(next_read > 5);
+  prv_write(id);
+
+  CHECK(memfault_flash_nv_event_storage_flush());
+  CHECK(prv_boot());
+  for (; next_read <= id; next_read++) {
+    prv_consume(next_read);
+  }
+  prv_assert_no_events();
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_EraseCountsStayLevel) {
+  uint32_t write_id = 0;
+  uint32_t read_id = 0;
+  for (size_t i = 0; i < 2000; i++) {
+    prv_write(write_id++);
+    // keep a few events around so sectors get recycled while holding unread data
+    if ((write_id - read_id) > 5) {
+      prv_consume(read_id++);
+    }
+    if ((i % 97) == 0) {
+      CHECK(memfault_flash_nv_event_storage_flush());
+      CHECK(prv_boot());
+    }
+  }
+
+  const sMemfaultFlashNvEventStorageInfo info = prv_get_info();
+  CHECK(info.min_erase_count > 20);
+  CHECK((info.max_erase_count - info.min_erase_count) <= 1);
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_EventTooLarge) {
+  s_event_len = TEST_SECTOR_SIZE - TEST_PAGE_SIZE - TEST_EVENT_OVERHEAD + 1;
+  CHECK(!s_nv->write(prv_read_event_cb, s_event_len));
+
+  s_event_len--;
+  memset(s_event, 0xa5, s_event_len);
+  CHECK(s_nv->write(prv_read_event_cb, s_event_len));
+  size_t event_len;
+  CHECK(s_nv->has_event(&event_len));
+  LONGS_EQUAL(s_event_len, event_len);
+}
+
+static size_t s_reads_until_failure;
+
+static bool prv_failing_read_event_cb(uint32_t offset, void *buf, size_t buf_len) {
+  if (s_reads_until_failure == 0) {
+    return false;
+  }
+  s_reads_until_failure--;
+  return prv_read_event_cb(offset, buf, buf_len);
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_EventWhichFailsToReadIsDropped) {
+  prv_write(0);
+
+  // fails while the event is being copied to flash, after space was claimed
+  s_event_len = 100;
+  s_reads_until_failure = 5;
+  CHECK(!s_nv->write(prv_failing_read_event_cb, s_event_len));
+
+  prv_write(1);
+  prv_consume(0);
+  prv_consume(1);
+  prv_assert_no_events();
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_BadConfig) {
+  CHECK(!memfault_flash_nv_event_storage_boot(NULL));
+  CHECK(!s_nv->enabled());
+
+  sMemfaultFlashBackend backend = s_flash.backend;
+  sMemfaultFlashNvEventStorageConfig config = {
+    .flash = &backend,
+    .page_buf = NULL,
+  };
+  CHECK(!memfault_flash_nv_event_storage_boot(&config));
+
+  config.page_buf = s_page_buf;
+  backend.num_sectors = 1;
+  CHECK(!memfault_flash_nv_event_storage_boot(&config));
+
+  backend = s_flash.backend;
+  backend.page_size = 48;
+  CHECK(!memfault_flash_nv_event_storage_boot(&config));
+
+  backend = s_flash.backend;
+  CHECK(memfault_flash_nv_event_storage_boot(&config));
+  CHECK(s_nv->enabled());
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_FileBackedFlash) {
+  for (uint32_t id = 0; id < 5; id++) {
+    prv_write(id);
+  }
+  prv_consume(0);
+  CHECK(memfault_flash_nv_event_storage_flush());
+
+  char path[] = "/tmp/memfault_flash_sim_XXXXXX";
+  const int fd = mkstemp(path);
+  CHECK(fd >= 0);
+  close(fd);
+  CHECK(memfault_flash_sim_save(&s_flash, path));
+
+  // start from a blank part, as if this was a new process
+  memfault_flash_sim_erase_all(&s_flash);
+  CHECK(prv_boot());
+  prv_assert_no_events();
+
+  CHECK(memfault_flash_sim_load(&s_flash, path));
+  remove(path);
+  CHECK(prv_boot());
+  for (uint32_t id = 1; id < 5; id++) {
+    prv_consume(id);
+  }
+  prv_assert_no_events();
+
+  CHECK(!memfault_flash_sim_load(&s_flash, "/tmp/memfault_flash_sim_does_not_exist"));
+}
+
+//! Runs a mix of writes, reads & flushes, tracking what must survive a reboot
+typedef struct {
+  uint32_t next_write;
+  uint32_t next_read;
+  //! Every event before this was in flash when a flush succeeded
+  uint32_t durable_write;
+  //! Every event before this had been consumed when a flush succeeded
+  uint32_t durable_read;
+} sWorkloadState;
+
+static void prv_run_workload(sWorkloadState *state) {
+  for (size_t i = 0; i < 150; i++) {
+    if (!prv_try_write(state->next_write)) {
+      return;
+    }
+    state->next_write++;
+
+    if ((state->next_write - state->next_read) > 4) {
+      size_t event_len;
+      if (!s_nv->has_event(&event_len)) {
+        return;
+      }
+      LONGS_EQUAL(state->next_read, prv_read_event(event_len));
+      s_nv->consume();
+      state->next_read++;
+    }
+
+    if (((i % 3) == 0)) {
+      if (!memfault_flash_nv_event_storage_flush()) {
+        return;
+      }
+      state->durable_write = state->next_write;
+      state->durable_read = state->next_read;
+    }
+  }
+}
+
+TEST(MemfaultFlashNvEventStorage, Test_PowerCutAtEveryOperation) {
+  for (int32_t ops_until_power_cut = 0;; ops_until_power_cut++) {
+    memfault_flash_sim_erase_all(&s_flash);
+    CHECK(prv_boot());
+
+    s_flash.ops_until_power_cut = ops_until_power_cut;
+    sWorkloadState state = { 0 };
+    prv_run_workload(&state);
+    if (!s_flash.powered_off) {
+      // the whole workload ran without reaching the power cut so every case has been covered
+      CHECK(ops_until_power_cut > 100);
+      break;
+    }
+
+    memfault_flash_sim_power_on(&s_flash);
+    CHECK(prv_boot());
+
+    // Events come back in order without gaps. Every event which was flushed and not consumed must
+    // be recovered. Events which were consumed may be read again unless a flush made that stick.
+    size_t event_len;
+    int32_t expected_id = -1;
+    while (s_nv->has_event(&event_len)) {
+      const int32_t id = prv_read_event(event_len);
+      CHECK(id >= 0);
+      if (expected_id == -1) {
+        CHECK((id >= (int32_t)state.durable_read) && (id <= (int32_t)state.next_read));
+      } else {
+        LONGS_EQUAL(expected_id, id);
+      }
+      expected_id = id + 1;
+      s_nv->consume();
+    }
+    if (state.durable_write > state.next_read) {
+      CHECK(expected_id >= (int32_t)state.durable_write);
+    }
+
+    // the storage is still usable
+    prv_write(200);
+    CHECK(memfault_flash_nv_event_storage_flush());
+    CHECK(prv_boot());
+    prv_consume(200);
+    prv_assert_no_events();
+  }
+}
+
+//! Compares the flash operations needed with write coalescing against programming every write to
+//! flash as soon as it is made. Events are written & read out in batches, like they would be by
+//! memfault_event_storage_persist() & the packetizer, on a part with typical geometry.
+TEST(MemfaultFlashNvEventStorage, Test_BenchmarkWriteCoalescing) {
+  static uint8_t s_bench_storage[4096 * 4];
+  static uint8_t s_bench_page_buf[256];
+  const uint32_t num_batches = 250;
+  const uint32_t events_per_batch = 8;
+
+  for (int flush_every_write = 0; flush_every_write <= 1; flush_every_write++) {
+    memfault_flash_sim_init(&s_flash, s_bench_storage, 4096, 4, sizeof(s_bench_page_buf));
+    memfault_flash_sim_erase_all(&s_flash);
+    const sMemfaultFlashNvEventStorageConfig config = {
+      .flash = &s_flash.backend,
+      .page_buf = s_bench_page_buf,
+    };
+    CHECK(memfault_flash_nv_event_storage_boot(&config));
+
+    size_t bytes = 0;
+    uint32_t id = 0;
+    for (uint32_t batch = 0; batch < num_batches; batch++) {
+      for (uint32_t i = 0; i < events_per_batch; i++) {
+        prv_write(id + i);
+        bytes += prv_event_len(id + i);
+        CHECK(!flush_every_write || memfault_flash_nv_event_storage_flush());
+      }
+      for (uint32_t i = 0; i < events_per_batch; i++) {
+        prv_consume(id++);
+        CHECK(!flush_every_write || memfault_flash_nv_event_storage_flush());
+      }
+    }
+
+    printf("\n%-20s: %.2f page programs/event, %.0f event bytes/sector erase\n",
+           flush_every_write ? "flush every write" : "coalesced",
+           (double)s_flash.num_programs / id, (double)bytes / s_flash.num_erases);
+  }
+}
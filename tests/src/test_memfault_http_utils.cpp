@@ -6,6 +6,7 @@
 extern "C" {
   #include <stdbool.h>
   #include <stddef.h>
+  #include <stdio.h>
   #include <string.h>
 
   #include "memfault/core/math.h"
@@ -68,7 +69,7 @@ TEST(MfltHttpClientUtils, Test_MfltHttpClientOverrides) {
 }
 
 typedef struct {
-  char buf[256];
+  char buf[512];
   size_t bytes_written;
 } sHttpWriteCtx;
 
@@ -116,6 +117,40 @@ TEST(MfltHttpClientUtils, Test_MfltHttpClientPostSendWriteFailure) {
   }
 }
 
+TEST(MfltHttpClientUtils, Test_MfltHttpClientPostChunkBatch) {
+  const uint8_t batch[] = { 3, 'a', 'b', 'c', 2, 'd', 'e' };
+  mock().expectNCalls(11 + 2 * 4 + 1, "prv_http_write_cb");
+  sHttpWriteCtx ctx = { 0 };
+  CHECK(memfault_http_post_chunk_batch(prv_http_write_cb, &ctx, batch, sizeof(batch)));
+
+  const char *expected_body =
+      "--mflt-chunk-batch\r\n"
+      "Content-Length:3\r\n\r\n"
+      "abc\r\n"
+      "--mflt-chunk-batch\r\n"
+      "Content-Length:2\r\n\r\n"
+      "de\r\n"
+      "--mflt-chunk-batch--\r\n";
+  char expected_string[512];
+  snprintf(expected_string, sizeof(expected_string),
+           "POST /api/v0/chunks/DEMOSERIAL HTTP/1.1\r\n"
+           "Host:chunks.memfault.com\r\n"
+           "User-Agent:MemfaultSDK/0.4.2\r\n"
+           "Memfault-Project-Key:00112233445566778899aabbccddeeff\r\n"
+           "Content-Type:multipart/mixed; boundary=mflt-chunk-batch\r\n"
+           "Content-Length:%d\r\n\r\n%s",
+           (int)strlen(expected_body), expected_body);
+  STRCMP_EQUAL(expected_string, ctx.buf);
+}
+
+TEST(MfltHttpClientUtils, Test_MfltHttpClientPostChunkBatchMalformed) {
+  // the second chunk is truncated
+  const uint8_t batch[] = { 3, 'a', 'b', 'c', 3, 'd', 'e' };
+  sHttpWriteCtx ctx = { 0 };
+  CHECK(!memfault_http_post_chunk_batch(prv_http_write_cb, &ctx, batch, sizeof(batch)));
+  CHECK(!memfault_http_post_chunk_batch(prv_http_write_cb, &ctx, batch, 0));
+}
+
 TEST(MfltHttpClientUtils, Test_MfltHttpClientGetOtaPayloadUrl) {
   mock().expectNCalls(26, "prv_http_write_cb");
   sHttpWriteCtx ctx = { 0 };
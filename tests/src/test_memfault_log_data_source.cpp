@@ -134,6 +134,30 @@ TEST(MemfaultLogDataSource, Test_HasMoreMsgs) {
 }
 
 
+TEST(MemfaultLogDataSource, Test_PendingStats) {
+  prv_add_logs();
+
+  // logs aren't sent until collection is triggered
+  size_t num_msgs = 0xab;
+  size_t num_bytes = 0xab;
+  g_memfault_log_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  LONGS_EQUAL(0, num_msgs);
+  LONGS_EQUAL(0, num_bytes);
+
+  memfault_log_trigger_collection();
+  prv_add_logs();
+  g_memfault_log_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  // the logs are read back in one message
+  LONGS_EQUAL(1, num_msgs);
+  LONGS_EQUAL(expected_encoded_size, num_bytes);
+
+  g_memfault_log_data_source.mark_msg_read_cb();
+  g_memfault_log_data_source.get_pending_stats_cb(&num_msgs, &num_bytes);
+  LONGS_EQUAL(0, num_msgs);
+  LONGS_EQUAL(0, num_bytes);
+}
+
+
 TEST(MemfaultLogDataSource, Test_ReadMsg) {
   prv_add_logs();
 
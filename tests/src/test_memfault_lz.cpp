@@ -0,0 +1,187 @@
+//! @file
+//!
+//! @brief
+
+#include "CppUTest/MemoryLeakDetectorMallocMacros.h"
+#include "CppUTest/MemoryLeakDetectorNewMacros.h"
+#include "CppUTest/TestHarness.h"
+#include "CppUTestExt/MockSupport.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "memfault/core/math.h"
+#include "memfault/util/lz.h"
+
+typedef struct {
+  uint8_t buf[2048];
+  size_t len;
+} sLzTestOutput;
+
+static sLzTestOutput s_compressed;
+static sLzTestOutput s_decompressed;
+
+static void prv_output_write_cb(void *ctx, const void *buf, size_t buf_len) {
+  sLzTestOutput *output = (sLzTestOutput *)ctx;
+  CHECK((output->len + buf_len) <= sizeof(output->buf));
+  memcpy(&output->buf[output->len], buf, buf_len);
+  output->len += buf_len;
+}
+
+TEST_GROUP(MemfaultLz) {
+  void setup() {
+    memset(&s_compressed, 0x0, sizeof(s_compressed));
+    memset(&s_decompressed, 0x0, sizeof(s_decompressed));
+  }
+  void teardown() {
+  }
+};
+
+//! Compresses data (fed to the encoder chunk_len bytes at a time), checks the size-only mode
+//! agrees, decompresses the result (fed one byte at a time) and checks it matches the input
+//!
+//! @return the size of the compressed stream
+static size_t prv_roundtrip(const sMemfaultLzConfig *config, const void *data, size_t data_len,
+                            size_t chunk_len) {
+  s_compressed.len = 0;
+  s_decompressed.len = 0;
+
+  sMemfaultLzEncoder encoder;
+  memfault_lz_encoder_init(&encoder, config, NULL, NULL);
+  memfault_lz_encode(&encoder, data, data_len);
+  const size_t expected_size = memfault_lz_encoder_finish(&encoder);
+
+  memfault_lz_encoder_init(&encoder, config, prv_output_write_cb, &s_compressed);
+  const uint8_t *bytes = (const uint8_t *)data;
+  for (size_t i = 0; i < data_len; i += chunk_len) {
+    memfault_lz_encode(&encoder, &bytes[i], MEMFAULT_MIN(chunk_len, data_len - i));
+  }
+  LONGS_EQUAL(expected_size, memfault_lz_encoder_finish(&encoder));
+  LONGS_EQUAL(expected_size, s_compressed.len);
+
+  sMemfaultLzDecoder decoder;
+  memfault_lz_decoder_init(&decoder, config, prv_output_write_cb, &s_decompressed);
+  for (size_t i = 0; i < s_compressed.len; i++) {
+    CHECK(memfault_lz_decode(&decoder, &s_compressed.buf[i], 1));
+  }
+  LONGS_EQUAL(data_len, s_decompressed.len);
+  MEMCMP_EQUAL(data, s_decompressed.buf, data_len);
+  return s_compressed.len;
+}
+
+TEST(MemfaultLz, Test_EmptyInput) {
+  uint8_t window[16];
+  const sMemfaultLzConfig config = { .window = window, .window_size = sizeof(window) };
+  LONGS_EQUAL(0, prv_roundtrip(&config, NULL, 0, 1));
+}
+
+TEST(MemfaultLz, Test_IncompressibleInput) {
+  uint8_t data[300];
+  srand(1);
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = (uint8_t)rand();
+  }
+
+  uint8_t window[64];
+  const sMemfaultLzConfig config = { .window = window, .window_size = sizeof(window) };
+  const size_t compressed_size = prv_roundtrip(&config, data, sizeof(data), sizeof(data));
+
+  // worst case overhead is one token per literal run
+  const size_t max_overhead =
+      (sizeof(data) + MEMFAULT_LZ_ENCODER_MAX_LITERAL_RUN - 1) / MEMFAULT_LZ_ENCODER_MAX_LITERAL_RUN;
+  CHECK(compressed_size <= sizeof(data) + max_overhead);
+}
+
+TEST(MemfaultLz, Test_Runs) {
+  uint8_t data[500];
+  memset(data, 0xa5, sizeof(data));
+
+  uint8_t window[8];
+  const sMemfaultLzConfig config = { .window = window, .window_size = sizeof(window) };
+  const size_t compressed_size = prv_roundtrip(&config, data, sizeof(data), 7);
+
+  // one literal followed by overlapping matches of the longest length the encoder emits
+  const size_t num_matches = (sizeof(data) - 1 + MEMFAULT_LZ_ENCODER_LOOKAHEAD_LEN - 1) /
+                             MEMFAULT_LZ_ENCODER_LOOKAHEAD_LEN;
+  CHECK(compressed_size <= 2 + (2 * num_matches));
+}
+
+TEST(MemfaultLz, Test_WindowBoundsBackReferences) {
+  // the same 16 byte pattern repeats every 40 bytes
+  uint8_t data[400];
+  srand(2);
+  for (size_t i = 0; i < sizeof(data); i++) {
+    data[i] = ((i % 40) < 16) ? (uint8_t)('a' + (i % 40)) : (uint8_t)rand();
+  }
+
+  uint8_t small_window[32];
+  const sMemfaultLzConfig small_config = {
+    .window = small_window, .window_size = sizeof(small_window)
+  };
+  const size_t small_window_size = prv_roundtrip(&small_config, data, sizeof(data), 3);
+
+  uint8_t large_window[64];
+  const sMemfaultLzConfig large_config = {
+    .window = large_window, .window_size = sizeof(large_window)
+  };
+  const size_t large_window_size = prv_roundtrip(&large_config, data, sizeof(data), 3);
+
+  // the repeats are only reachable with the larger window
+  CHECK(small_window_size >= sizeof(data));
+  CHECK(large_window_size < (sizeof(data) * 3) / 4);
+}
+
+TEST(MemfaultLz, Test_Dictionary) {
+  static const char dict[] = "software_version=1.2.3-dev hardware_version=evt_24 main-fw";
+  static const char data[] = "main-fw hardware_version=evt_24 software_version=1.2.3-dev x";
+
+  uint8_t window[16];
+  sMemfaultLzConfig config = { .window = window, .window_size = sizeof(window) };
+  const size_t without_dict_size = prv_roundtrip(&config, data, sizeof(data), 5);
+
+  config.dict = dict;
+  config.dict_len = strlen(dict);
+  const size_t with_dict_size = prv_roundtrip(&config, data, sizeof(data), 5);
+
+  CHECK(without_dict_size >= sizeof(data));
+  CHECK(with_dict_size < sizeof(data) / 3);
+}
+
+TEST(MemfaultLz, Test_DictionaryOnlyNoWindow) {
+  static const char dict[] = "0123456789abcdef";
+  static const char data[] = "456789abcdef0123456789";
+
+  const sMemfaultLzConfig config = { .dict = dict, .dict_len = strlen(dict) };
+  const size_t compressed_size = prv_roundtrip(&config, data, sizeof(data), 1);
+  CHECK(compressed_size < sizeof(data));
+}
+
+TEST(MemfaultLz, Test_MalformedInput) {
+  uint8_t window[4];
+  const sMemfaultLzConfig config = { .window = window, .window_size = sizeof(window) };
+  sMemfaultLzDecoder decoder;
+
+  // back reference before the start of the data
+  const uint8_t bad_distance[] = { 0x00, 'a', 0x80, 0x02 };
+  memfault_lz_decoder_init(&decoder, &config, prv_output_write_cb, &s_decompressed);
+  CHECK(!memfault_lz_decode(&decoder, bad_distance, sizeof(bad_distance)));
+  // the decoder stays in the error state
+  CHECK(!memfault_lz_decode(&decoder, bad_distance, 1));
+
+  // back reference outside the window
+  const uint8_t outside_window[] = { 0x05, 'a', 'b', 'c', 'd', 'e', 'f', 0x80, 0x06 };
+  memfault_lz_decoder_init(&decoder, &config, prv_output_write_cb, &s_decompressed);
+  CHECK(!memfault_lz_decode(&decoder, outside_window, sizeof(outside_window)));
+
+  // zero distance
+  const uint8_t zero_distance[] = { 0x00, 'a', 0x80, 0x00 };
+  memfault_lz_decoder_init(&decoder, &config, prv_output_write_cb, &s_decompressed);
+  CHECK(!memfault_lz_decode(&decoder, zero_distance, sizeof(zero_distance)));
+
+  // overlong varint
+  const uint8_t bad_varint[] = { 0x00, 'a', 0x80, 0xff, 0xff, 0xff, 0xff, 0xff, 0x01 };
+  memfault_lz_decoder_init(&decoder, &config, prv_output_write_cb, &s_decompressed);
+  CHECK(!memfault_lz_decode(&decoder, bad_varint, sizeof(bad_varint)));
+}
@@ -15,6 +15,7 @@
 #include "fakes/fake_memfault_build_id.h"
 #include "fakes/fake_memfault_platform_time.h"
 #include "memfault/config.h"
+#include "memfault/core/event_storage_implementation.h"
 #include "memfault/core/math.h"
 #include "memfault/core/serializer_helper.h"
 #include "memfault/util/cbor.h"
@@ -205,3 +206,84 @@ TEST(MemfaultMetricsSerializerHelper, Test_MemfaultMetricSerializeEventMetadata)
     MEMCMP_EQUAL(vec->expected_encoding, result, sizeof(result));
   }
 }
+
+static uint8_t s_reservation_buf[sizeof(test_vector)];
+static eMemfaultEventStorageReserveStatus s_reserve_status;
+
+static eMemfaultEventStorageReserveStatus prv_reserve_cb(
+    size_t num_bytes, eMemfaultEventStorageClass event_class,
+    sMemfaultEventStorageReservation *reservation) {
+  LONGS_EQUAL(sizeof(s_reservation_buf), num_bytes);
+  LONGS_EQUAL(kMemfaultEventStorageClass_Heartbeat, event_class);
+  if (s_reserve_status != kMemfaultEventStorageReserveStatus_Ok) {
+    return s_reserve_status;
+  }
+
+  // split the reservation in two as if it wrapped around the end of the storage
+  const size_t split = 5;
+  *reservation = (sMemfaultEventStorageReservation) {
+    .regions = {
+      { .ptr = &s_reservation_buf[sizeof(s_reservation_buf) - split], .len = split },
+      { .ptr = &s_reservation_buf[0], .len = sizeof(s_reservation_buf) - split },
+    },
+    .handle = 0,
+  };
+  return kMemfaultEventStorageReserveStatus_Ok;
+}
+
+static void prv_commit_cb(MEMFAULT_UNUSED const sMemfaultEventStorageReservation *reservation,
+                          bool rollback) {
+  mock().actualCall(__func__).withParameter("rollback", rollback);
+}
+
+static const sMemfaultEventStorageImpl s_fake_reserving_storage_impl = {
+  .reserve_cb = prv_reserve_cb,
+  .commit_cb = prv_commit_cb,
+};
+
+static bool prv_encode_metadata_cb(sMemfaultCborEncoder *encoder, MEMFAULT_UNUSED void *ctx) {
+  return memfault_serializer_helper_encode_metadata(encoder, kMemfaultEventType_Heartbeat);
+}
+
+TEST(MemfaultMetricsSerializerHelper, Test_EncodeToReservation) {
+  memset(s_reservation_buf, 0x0, sizeof(s_reservation_buf));
+  s_reserve_status = kMemfaultEventStorageReserveStatus_Ok;
+
+  sMemfaultCborEncoder encoder;
+  mock().expectOneCall("prv_commit_cb").withParameter("rollback", false);
+  CHECK(memfault_serializer_helper_encode_to_storage(
+      &encoder, &s_fake_reserving_storage_impl, kMemfaultEventStorageClass_Heartbeat,
+      prv_encode_metadata_cb, NULL));
+  mock().checkExpectations();
+
+  uint8_t expected[sizeof(test_vector)];
+  const size_t split = 5;
+  memcpy(&expected[sizeof(expected) - split], &test_vector[0], split);
+  memcpy(&expected[0], &test_vector[split], sizeof(expected) - split);
+  MEMCMP_EQUAL(expected, s_reservation_buf, sizeof(expected));
+
+  LONGS_EQUAL(0, memfault_serializer_helper_read_drop_count());
+  LONGS_EQUAL(0, memfault_serializer_helper_read_write_collision_count());
+}
+
+TEST(MemfaultMetricsSerializerHelper, Test_EncodeToReservationFailures) {
+  sMemfaultCborEncoder encoder;
+
+  // contention is tracked separately from running out of storage
+  s_reserve_status = kMemfaultEventStorageReserveStatus_Busy;
+  CHECK(!memfault_serializer_helper_encode_to_storage(
+      &encoder, &s_fake_reserving_storage_impl, kMemfaultEventStorageClass_Heartbeat,
+      prv_encode_metadata_cb, NULL));
+  LONGS_EQUAL(0, memfault_serializer_helper_read_drop_count());
+  LONGS_EQUAL(1, memfault_serializer_helper_read_write_collision_count());
+
+  s_reserve_status = kMemfaultEventStorageReserveStatus_NoSpace;
+  CHECK(!memfault_serializer_helper_encode_to_storage(
+      &encoder, &s_fake_reserving_storage_impl, kMemfaultEventStorageClass_Heartbeat,
+      prv_encode_metadata_cb, NULL));
+  CHECK(!memfault_serializer_helper_encode_to_storage(
+      &encoder, &s_fake_reserving_storage_impl, kMemfaultEventStorageClass_Heartbeat,
+      prv_encode_metadata_cb, NULL));
+  LONGS_EQUAL(2, memfault_serializer_helper_read_drop_count());
+  LONGS_EQUAL(0, memfault_serializer_helper_read_write_collision_count());
+}
@@ -118,3 +118,35 @@ TEST(MemfaultVarint, Test_Si32_Si32Min) {
   LONGS_EQUAL(sizeof(si32_min), len);
   MEMCMP_EQUAL(si32_min, s_varint_test_buf, sizeof(si32_min));
 }
+
+TEST(MemfaultVarint, Test_DecodeRoundTrip) {
+  const uint32_t values[] = { 0, 127, 128, 16383, 16384, 0xfffffff, 0x10000000, UINT32_MAX };
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    const size_t len = memfault_encode_varint_u32(values[i], s_varint_test_buf);
+    uint32_t value = 0;
+    LONGS_EQUAL(len, memfault_decode_varint_u32(s_varint_test_buf, sizeof(s_varint_test_buf),
+                                                &value));
+    LONGS_EQUAL(values[i], value);
+  }
+}
+
+TEST(MemfaultVarint, Test_DecodePadded) {
+  const uint8_t padded_one[] = { 0x81, 0x80, 0x00, 0xff };
+  uint32_t value = 0;
+  LONGS_EQUAL(3, memfault_decode_varint_u32(padded_one, sizeof(padded_one), &value));
+  LONGS_EQUAL(1, value);
+}
+
+TEST(MemfaultVarint, Test_DecodeInvalid) {
+  uint32_t value = 0xab;
+  const uint8_t truncated[] = { 0x80, 0x80 };
+  LONGS_EQUAL(0, memfault_decode_varint_u32(truncated, sizeof(truncated), &value));
+  LONGS_EQUAL(0, memfault_decode_varint_u32(truncated, 0, &value));
+
+  const uint8_t too_large[] = { 0xff, 0xff, 0xff, 0xff, 0x1f };
+  LONGS_EQUAL(0, memfault_decode_varint_u32(too_large, sizeof(too_large), &value));
+
+  const uint8_t too_long[] = { 0x80, 0x80, 0x80, 0x80, 0x80, 0x00 };
+  LONGS_EQUAL(0, memfault_decode_varint_u32(too_long, sizeof(too_long), &value));
+  LONGS_EQUAL(0xab, value);
+}